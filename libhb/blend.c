@@ -8,8 +8,14 @@
  */
 
 #include "handbrake/handbrake.h"
+#include "handbrake/blend.h"
 #include "libavutil/bswap.h"
 
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#include "libavutil/cpu.h"
+#endif
+
 struct hb_blend_private_s
 {
     int hshift;
@@ -18,7 +24,15 @@ struct hb_blend_private_s
 
     unsigned chroma_coeffs[2][4];
 
-    void (*blend)(const struct hb_blend_private_s *pv, hb_buffer_t *dst,
+    // Scratch rows for gathering chroma alpha and interleaving
+    // chroma samples for semi planar formats
+    uint8_t *src_tmp;
+    uint8_t *alpha_tmp;
+    int      tmp_size;
+
+    BlendFunctions functions;
+
+    void (*blend)(struct hb_blend_private_s *pv, hb_buffer_t *dst,
                   const hb_buffer_t *src, const int shift);
 };
 
@@ -45,7 +59,168 @@ hb_blend_object_t hb_blend =
     .close = hb_blend_close,
 };
 
-static void blend_subsample_8on1x(const hb_blend_private_t *pv, hb_buffer_t *dst, const hb_buffer_t *src, const int shift)
+static void blend_row_8_c(uint8_t       *dst,
+                          const uint8_t *src,
+                          const uint8_t *alpha,
+                          int            width,
+                          int            bias)
+{
+    for (int ii = 0; ii < width; ii++)
+    {
+        dst[ii] = (dst[ii] * (255 - alpha[ii]) + src[ii] * alpha[ii] + bias) / 255;
+    }
+}
+
+static void blend_row_16_c(uint16_t      *dst,
+                           const uint8_t *src,
+                           const uint8_t *alpha,
+                           int            width,
+                           int            alpha_shift,
+                           int            src_shift,
+                           int            bias)
+{
+    const unsigned max = (256 << alpha_shift) - 1;
+
+    for (int ii = 0; ii < width; ii++)
+    {
+        const uint32_t a = alpha[ii] << alpha_shift;
+        dst[ii] = ((uint32_t)dst[ii] * (max - a) +
+                   ((uint32_t)src[ii] << src_shift) * a + bias) / max;
+    }
+}
+
+#if defined(__aarch64__)
+// x / 255 == (x + 1 + (x >> 8)) >> 8 for x <= 65152 (255 * 255 + 127)
+static void blend_row_8_neon(uint8_t       *dst,
+                             const uint8_t *src,
+                             const uint8_t *alpha,
+                             int            width,
+                             int            bias)
+{
+    const uint16x8_t vbias = vdupq_n_u16(bias);
+    const uint16x8_t one   = vdupq_n_u16(1);
+    const uint8x8_t  c255  = vdup_n_u8(255);
+    int ii = 0;
+
+    for (; ii + 8 <= width; ii += 8)
+    {
+        uint8x8_t  d = vld1_u8(dst + ii);
+        uint8x8_t  s = vld1_u8(src + ii);
+        uint8x8_t  a = vld1_u8(alpha + ii);
+        uint16x8_t x = vmull_u8(d, vsub_u8(c255, a));
+
+        x = vaddq_u16(vmlal_u8(x, s, a), vbias);
+        x = vaddq_u16(vaddq_u16(x, one), vshrq_n_u16(x, 8));
+        vst1_u8(dst + ii, vshrn_n_u16(x, 8));
+    }
+    blend_row_8_c(dst + ii, src + ii, alpha + ii, width - ii, bias);
+}
+
+// x / (2^k - 1) for any 32 bit x uses the 33 bit reciprocal
+// 2^32 + magic:  t = (x * magic) >> 32
+//                x / (2^k - 1) == (((x - t) >> 1) + t) >> (k - 1)
+static inline uint16x4_t blend16_neon(uint16x4_t d, uint16x4_t s, uint16x4_t a,
+                                      uint16x4_t vmax, uint32x4_t vbias,
+                                      uint32x2_t magic, int32x4_t shift)
+{
+    uint32x4_t x = vmlal_u16(vmull_u16(d, vsub_u16(vmax, a)), s, a);
+    x = vaddq_u32(x, vbias);
+
+    uint32x4_t t = vcombine_u32(
+                    vshrn_n_u64(vmull_u32(vget_low_u32(x), magic), 32),
+                    vshrn_n_u64(vmull_u32(vget_high_u32(x), magic), 32));
+    x = vaddq_u32(vshrq_n_u32(vsubq_u32(x, t), 1), t);
+    return vmovn_u32(vshlq_u32(x, shift));
+}
+
+static void blend_row_16_neon(uint16_t      *dst,
+                              const uint8_t *src,
+                              const uint8_t *alpha,
+                              int            width,
+                              int            alpha_shift,
+                              int            src_shift,
+                              int            bias)
+{
+    const int        k      = 8 + alpha_shift;
+    const uint64_t   d      = (1 << k) - 1;
+    const uint32x2_t magic  = vdup_n_u32(((1ULL << (32 + k)) + d - 1) / d - (1ULL << 32));
+    const uint16x4_t vmax   = vdup_n_u16(d);
+    const uint32x4_t vbias  = vdupq_n_u32(bias);
+    const int32x4_t  shift  = vdupq_n_s32(-(k - 1));
+    const int16x8_t  sshift = vdupq_n_s16(src_shift);
+    const int16x8_t  ashift = vdupq_n_s16(alpha_shift);
+    int ii = 0;
+
+    for (; ii + 8 <= width; ii += 8)
+    {
+        uint16x8_t dd = vld1q_u16(dst + ii);
+        uint16x8_t s  = vshlq_u16(vmovl_u8(vld1_u8(src + ii)), sshift);
+        uint16x8_t a  = vshlq_u16(vmovl_u8(vld1_u8(alpha + ii)), ashift);
+
+        uint16x4_t lo = blend16_neon(vget_low_u16(dd), vget_low_u16(s),
+                                     vget_low_u16(a), vmax, vbias, magic, shift);
+        uint16x4_t hi = blend16_neon(vget_high_u16(dd), vget_high_u16(s),
+                                     vget_high_u16(a), vmax, vbias, magic, shift);
+        vst1q_u16(dst + ii, vcombine_u16(lo, hi));
+    }
+    blend_row_16_c(dst + ii, src + ii, alpha + ii, width - ii,
+                   alpha_shift, src_shift, bias);
+}
+#endif
+
+static int blend_tmp_alloc(hb_blend_private_t *pv, int size)
+{
+    if (size > pv->tmp_size)
+    {
+        uint8_t *src_tmp   = realloc(pv->src_tmp, size);
+        uint8_t *alpha_tmp = realloc(pv->alpha_tmp, size);
+        if (src_tmp == NULL || alpha_tmp == NULL)
+        {
+            pv->src_tmp   = src_tmp   ? src_tmp   : pv->src_tmp;
+            pv->alpha_tmp = alpha_tmp ? alpha_tmp : pv->alpha_tmp;
+            return -1;
+        }
+        pv->src_tmp   = src_tmp;
+        pv->alpha_tmp = alpha_tmp;
+        pv->tmp_size  = size;
+    }
+    return 0;
+}
+
+// Returns the alpha of each chroma sample of a row, for chroma planes
+// that are horizontally subsampled the alpha of the first luma sample.
+static const uint8_t * chroma_alpha(hb_blend_private_t *pv,
+                                    const uint8_t *a_in, int wshift,
+                                    int start, int count)
+{
+    if (wshift == 0)
+    {
+        return a_in + start;
+    }
+    for (int ii = 0; ii < count; ii++)
+    {
+        pv->alpha_tmp[ii] = a_in[(start + ii) << wshift];
+    }
+    return pv->alpha_tmp;
+}
+
+// Interleaves the U and V samples and their alpha of a row so that a
+// semi planar chroma row can be blended in one pass
+static void interleave_chroma(hb_blend_private_t *pv,
+                              const uint8_t *u_in, const uint8_t *v_in,
+                              const uint8_t *a_in, int wshift,
+                              int start, int count)
+{
+    for (int ii = 0; ii < count; ii++)
+    {
+        pv->src_tmp[ii * 2]       = u_in[start + ii];
+        pv->src_tmp[ii * 2 + 1]   = v_in[start + ii];
+        pv->alpha_tmp[ii * 2]     = a_in[(start + ii) << wshift];
+        pv->alpha_tmp[ii * 2 + 1] = a_in[(start + ii) << wshift];
+    }
+}
+
+static void blend_subsample_8on1x(hb_blend_private_t *pv, hb_buffer_t *dst, const hb_buffer_t *src, const int shift)
 {
     int x0, y0, x0c, y0c;
     int ox, oy;
@@ -90,56 +265,59 @@ static void blend_subsample_8on1x(const hb_blend_private_t *pv, hb_buffer_t *dst
         a_in = src->plane[3].data + oy * src->plane[3].stride;
 
         ox = x0c - x0;
-        is_chroma_line = yy == (yy & ~((1 << pv->hshift) - 1));
-        for (int xx = x0c; ox < width; ox = ++xx - x0)
+        if (oy >= 0)
         {
-            if (ox >= 0 && oy >= 0)
-            {
-                alpha = a_in[ox] << shift;
-                y_out[xx] = ((uint32_t)y_out[xx] * (max_val - alpha) + ((uint32_t)y_in[ox] << shift) * alpha + (max_val >> 1)) / max_val;
-            }
+            // Blend luma
+            const int start = ox > 0 ? ox : 0;
+            pv->functions.blend_row_16(y_out + x0 + start, y_in + start, a_in + start,
+                                        width - start, shift, shift, max_val >> 1);
+        }
 
-            if (is_chroma_line && xx == (xx & ~((1 << pv->wshift) - 1)))
+        is_chroma_line = yy == (yy & ~((1 << pv->hshift) - 1));
+        if (!is_chroma_line)
+        {
+            continue;
+        }
+        for (int xx = x0c; ox < width; xx += 1 << pv->wshift, ox = xx - x0)
+        {
+            // Perform chromaloc-aware subsampling and blending
+            accu_a = accu_b = accu_c = 0;
+            for (int yz = 0, oyz = oy; yz < (1 << pv->hshift) && oy + yz < height; yz++, oyz++)
             {
-                // Perform chromaloc-aware subsampling and blending
-                accu_a = accu_b = accu_c = 0;
-                for (int yz = 0, oyz = oy; yz < (1 << pv->hshift) && oy + yz < height; yz++, oyz++)
+                for (int xz = 0, oxz = ox; xz < (1 << pv->wshift) && ox + xz < width; xz++, oxz++)
                 {
-                    for (int xz = 0, oxz = ox; xz < (1 << pv->wshift) && ox + xz < width; xz++, oxz++)
+                    // Weight of the current chroma sample
+                    coeff = pv->chroma_coeffs[0][xz] * pv->chroma_coeffs[1][yz];
+                    res_u = u_out[xx >> pv->wshift];
+                    res_v = v_out[xx >> pv->wshift];
+
+                    // Chroma sampled area overlap with bitmap
+                    if (oxz >= 0 && oyz >= 0 && ox + xz < width && oy + yz < height)
                     {
-                        // Weight of the current chroma sample
-                        coeff = pv->chroma_coeffs[0][xz] * pv->chroma_coeffs[1][yz];
-                        res_u = u_out[xx >> pv->wshift];
-                        res_v = v_out[xx >> pv->wshift];
-
-                        // Chroma sampled area overlap with bitmap
-                        if (oxz >= 0 && oyz >= 0 && ox + xz < width && oy + yz < height)
-                        {
-                            alpha = (uint32_t)a_in[oxz + yz * src->plane[3].stride] << shift;
-                            res_u *= (max_val - alpha);
-                            res_u = (res_u + ((uint32_t)(u_in + yz * src->plane[1].stride)[oxz] << shift) * alpha + (max_val>>1)) / max_val;
-
-                            res_v *= (max_val - alpha);
-                            res_v = (res_v + ((uint32_t)(v_in + yz * src->plane[2].stride)[oxz] << shift) * alpha + (max_val>>1)) / max_val;
-                        }
-
-                        // Accumulate
-                        accu_a += coeff * res_u;
-                        accu_b += coeff * res_v;
-                        accu_c += coeff;
+                        alpha = (uint32_t)a_in[oxz + yz * src->plane[3].stride] << shift;
+                        res_u *= (max_val - alpha);
+                        res_u = (res_u + ((uint32_t)(u_in + yz * src->plane[1].stride)[oxz] << shift) * alpha + (max_val>>1)) / max_val;
+
+                        res_v *= (max_val - alpha);
+                        res_v = (res_v + ((uint32_t)(v_in + yz * src->plane[2].stride)[oxz] << shift) * alpha + (max_val>>1)) / max_val;
                     }
+
+                    // Accumulate
+                    accu_a += coeff * res_u;
+                    accu_b += coeff * res_v;
+                    accu_c += coeff;
                 }
-                if (accu_c)
-                {
-                    u_out[xx >> pv->wshift] = (accu_a + (accu_c >> 1)) / accu_c;
-                    v_out[xx >> pv->wshift] = (accu_b + (accu_c >> 1)) / accu_c;
-                }
+            }
+            if (accu_c)
+            {
+                u_out[xx >> pv->wshift] = (accu_a + (accu_c >> 1)) / accu_c;
+                v_out[xx >> pv->wshift] = (accu_b + (accu_c >> 1)) / accu_c;
             }
         }
     }
 }
 
-static void blend_subsample_8onbi1x(const hb_blend_private_t *pv, hb_buffer_t *dst, const hb_buffer_t *src, const int shift)
+static void blend_subsample_8onbi1x(hb_blend_private_t *pv, hb_buffer_t *dst, const hb_buffer_t *src, const int shift)
 {
     int x0, y0, x0c, y0c;
     int ox, oy;
@@ -184,56 +362,59 @@ static void blend_subsample_8onbi1x(const hb_blend_private_t *pv, hb_buffer_t *d
         a_in = src->plane[3].data + oy * src->plane[3].stride;
 
         ox = x0c - x0;
-        is_chroma_line = yy == (yy & ~((1 << pv->hshift) - 1));
-        for (int xx = x0c; ox < width; ox = ++xx - x0)
+        if (oy >= 0)
         {
-            if (ox >= 0 && oy >= 0)
-            {
-                alpha = a_in[ox] << shift;
-                y_out[xx] = ((uint32_t)y_out[xx] * (max_val - alpha) + av_bswap16(y_in[ox]) * alpha + (max_val >> 1)) / max_val;
-            }
+            // Blend luma
+            const int start = ox > 0 ? ox : 0;
+            pv->functions.blend_row_16(y_out + x0 + start, y_in + start, a_in + start,
+                                        width - start, shift, 8, max_val >> 1);
+        }
 
-            if (is_chroma_line && xx == (xx & ~((1 << pv->wshift) - 1)))
+        is_chroma_line = yy == (yy & ~((1 << pv->hshift) - 1));
+        if (!is_chroma_line)
+        {
+            continue;
+        }
+        for (int xx = x0c; ox < width; xx += 1 << pv->wshift, ox = xx - x0)
+        {
+            // Perform chromaloc-aware subsampling and blending
+            accu_a = accu_b = accu_c = 0;
+            for (int yz = 0, oyz = oy; yz < (1 << pv->hshift) && oy + yz < height; yz++, oyz++)
             {
-                // Perform chromaloc-aware subsampling and blending
-                accu_a = accu_b = accu_c = 0;
-                for (int yz = 0, oyz = oy; yz < (1 << pv->hshift) && oy + yz < height; yz++, oyz++)
+                for (int xz = 0, oxz = ox; xz < (1 << pv->wshift) && ox + xz < width; xz++, oxz++)
                 {
-                    for (int xz = 0, oxz = ox; xz < (1 << pv->wshift) && ox + xz < width; xz++, oxz++)
+                    // Weight of the current chroma sample
+                    coeff = pv->chroma_coeffs[0][xz] * pv->chroma_coeffs[1][yz];
+                    res_u = u_out[(xx >> pv->wshift) * 2 + 0];
+                    res_v = v_out[(xx >> pv->wshift) * 2 + 1];
+
+                    // Chroma sampled area overlap with bitmap
+                    if (oxz >= 0 && oyz >= 0 && ox + xz < width && oy + yz < height)
                     {
-                        // Weight of the current chroma sample
-                        coeff = pv->chroma_coeffs[0][xz] * pv->chroma_coeffs[1][yz];
-                        res_u = u_out[(xx >> pv->wshift) * 2 + 0];
-                        res_v = v_out[(xx >> pv->wshift) * 2 + 1];
-
-                        // Chroma sampled area overlap with bitmap
-                        if (oxz >= 0 && oyz >= 0 && ox + xz < width && oy + yz < height)
-                        {
-                            alpha = a_in[oxz + yz*src->plane[3].stride] << shift;
-                            res_u *= (max_val - alpha);
-                            res_u = (res_u + av_bswap16((u_in + yz * src->plane[1].stride)[oxz]) * alpha + (max_val>>1)) / max_val;
-
-                            res_v *= (max_val - alpha);
-                            res_v = (res_v + av_bswap16((v_in + yz * src->plane[2].stride)[oxz]) * alpha + (max_val>>1)) / max_val;
-                        }
-
-                        // Accumulate
-                        accu_a += coeff * res_u;
-                        accu_b += coeff * res_v;
-                        accu_c += coeff;
+                        alpha = a_in[oxz + yz*src->plane[3].stride] << shift;
+                        res_u *= (max_val - alpha);
+                        res_u = (res_u + av_bswap16((u_in + yz * src->plane[1].stride)[oxz]) * alpha + (max_val>>1)) / max_val;
+
+                        res_v *= (max_val - alpha);
+                        res_v = (res_v + av_bswap16((v_in + yz * src->plane[2].stride)[oxz]) * alpha + (max_val>>1)) / max_val;
                     }
+
+                    // Accumulate
+                    accu_a += coeff * res_u;
+                    accu_b += coeff * res_v;
+                    accu_c += coeff;
                 }
-                if (accu_c)
-                {
-                    u_out[(xx >> pv->wshift) * 2 + 0] = (accu_a + (accu_c >> 1)) / accu_c;
-                    v_out[(xx >> pv->wshift) * 2 + 1] = (accu_b + (accu_c >> 1)) / accu_c;
-                }
+            }
+            if (accu_c)
+            {
+                u_out[(xx >> pv->wshift) * 2 + 0] = (accu_a + (accu_c >> 1)) / accu_c;
+                v_out[(xx >> pv->wshift) * 2 + 1] = (accu_b + (accu_c >> 1)) / accu_c;
             }
         }
     }
 }
 
-static void blend_subsample_8on8(const hb_blend_private_t *pv, hb_buffer_t *dst, const hb_buffer_t *src, const int shift)
+static void blend_subsample_8on8(hb_blend_private_t *pv, hb_buffer_t *dst, const hb_buffer_t *src, const int shift)
 {
     int x0, y0, x0c, y0c;
     int ox, oy;
@@ -279,55 +460,59 @@ static void blend_subsample_8on8(const hb_blend_private_t *pv, hb_buffer_t *dst,
         a_in = src->plane[3].data + oy * src->plane[3].stride;
 
         ox = x0c - x0;
-        is_chroma_line = yy == (yy & ~((1 << pv->hshift) - 1));
-        for (int xx = x0c; ox < width; ox = ++xx - x0)
+        if (oy >= 0)
         {
-            if (ox >= 0 && oy >= 0)
-            {
-                y_out[xx] = (y_out[xx] * (255 - a_in[ox]) + y_in[ox] * a_in[ox] + 127) / 255;
-            }
+            // Blend luma
+            const int start = ox > 0 ? ox : 0;
+            pv->functions.blend_row_8(y_out + x0 + start, y_in + start, a_in + start,
+                                       width - start, 127);
+        }
 
-            if (is_chroma_line && xx == (xx & ~((1 << pv->wshift) - 1)))
+        is_chroma_line = yy == (yy & ~((1 << pv->hshift) - 1));
+        if (!is_chroma_line)
+        {
+            continue;
+        }
+        for (int xx = x0c; ox < width; xx += 1 << pv->wshift, ox = xx - x0)
+        {
+            // Perform chromaloc-aware subsampling and blending
+            accu_a = accu_b = accu_c = 0;
+            for (int yz = 0, oyz = oy; yz < (1 << pv->hshift) && oy + yz < height; yz++, oyz++)
             {
-                // Perform chromaloc-aware subsampling and blending
-                accu_a = accu_b = accu_c = 0;
-                for (int yz = 0, oyz = oy; yz < (1 << pv->hshift) && oy + yz < height; yz++, oyz++)
+                for (int xz = 0, oxz = ox; xz < (1 << pv->wshift) && ox + xz < width; xz++, oxz++)
                 {
-                    for (int xz = 0, oxz = ox; xz < (1 << pv->wshift) && ox + xz < width; xz++, oxz++)
+                    // Weight of the current chroma sample
+                    coeff = pv->chroma_coeffs[0][xz] * pv->chroma_coeffs[1][yz];
+                    res_u = u_out[xx >> pv->wshift];
+                    res_v = v_out[xx >> pv->wshift];
+
+                    // Chroma sampled area overlap with bitmap
+                    if (oxz >= 0 && oyz >= 0 && ox + xz < width && oy + yz < height)
                     {
-                        // Weight of the current chroma sample
-                        coeff = pv->chroma_coeffs[0][xz] * pv->chroma_coeffs[1][yz];
-                        res_u = u_out[xx >> pv->wshift];
-                        res_v = v_out[xx >> pv->wshift];
-
-                        // Chroma sampled area overlap with bitmap
-                        if (oxz >= 0 && oyz >= 0 && ox + xz < width && oy + yz < height)
-                        {
-                            alpha = a_in[oxz + yz*src->plane[3].stride];
-                            res_u *= (255 - alpha);
-                            res_u = (res_u + (u_in + yz * src->plane[1].stride)[oxz] * alpha + 127) / 255;
-
-                            res_v *= (255 - alpha);
-                            res_v = (res_v + (v_in + yz * src->plane[2].stride)[oxz] * alpha + 127) / 255;
-                        }
-
-                        // Accumulate
-                        accu_a += coeff * res_u;
-                        accu_b += coeff * res_v;
-                        accu_c += coeff;
+                        alpha = a_in[oxz + yz*src->plane[3].stride];
+                        res_u *= (255 - alpha);
+                        res_u = (res_u + (u_in + yz * src->plane[1].stride)[oxz] * alpha + 127) / 255;
+
+                        res_v *= (255 - alpha);
+                        res_v = (res_v + (v_in + yz * src->plane[2].stride)[oxz] * alpha + 127) / 255;
                     }
+
+                    // Accumulate
+                    accu_a += coeff * res_u;
+                    accu_b += coeff * res_v;
+                    accu_c += coeff;
                 }
-                if (accu_c)
-                {
-                    u_out[xx >> pv->wshift] = (accu_a + (accu_c >> 1)) / accu_c;
-                    v_out[xx >> pv->wshift] = (accu_b + (accu_c >> 1)) / accu_c;
-                }
+            }
+            if (accu_c)
+            {
+                u_out[xx >> pv->wshift] = (accu_a + (accu_c >> 1)) / accu_c;
+                v_out[xx >> pv->wshift] = (accu_b + (accu_c >> 1)) / accu_c;
             }
         }
     }
 }
 
-static void blend_subsample_8onbi8(const hb_blend_private_t *pv, hb_buffer_t *dst, const hb_buffer_t *src, const int shift)
+static void blend_subsample_8onbi8(hb_blend_private_t *pv, hb_buffer_t *dst, const hb_buffer_t *src, const int shift)
 {
     int x0, y0, x0c, y0c;
     int ox, oy;
@@ -373,63 +558,67 @@ static void blend_subsample_8onbi8(const hb_blend_private_t *pv, hb_buffer_t *ds
         a_in = src->plane[3].data + oy * src->plane[3].stride;
 
         ox = x0c - x0;
-        is_chroma_line = yy == (yy & ~((1 << pv->hshift) - 1));
-        for (int xx = x0c; ox < width; ox = ++xx - x0)
+        if (oy >= 0)
         {
-            if (ox >= 0 && oy >= 0)
-            {
-                y_out[xx] = (y_out[xx] * (255 - a_in[ox]) + y_in[ox] * a_in[ox] + 127) / 255;
-            }
+            // Blend luma
+            const int start = ox > 0 ? ox : 0;
+            pv->functions.blend_row_8(y_out + x0 + start, y_in + start, a_in + start,
+                                       width - start, 127);
+        }
 
-            if (is_chroma_line && xx == (xx & ~((1 << pv->wshift) - 1)))
+        is_chroma_line = yy == (yy & ~((1 << pv->hshift) - 1));
+        if (!is_chroma_line)
+        {
+            continue;
+        }
+        for (int xx = x0c; ox < width; xx += 1 << pv->wshift, ox = xx - x0)
+        {
+            // Perform chromaloc-aware subsampling and blending
+            accu_a = accu_b = accu_c = 0;
+            for (int yz = 0, oyz = oy; yz < (1 << pv->hshift); yz++, oyz++)
             {
-                // Perform chromaloc-aware subsampling and blending
-                accu_a = accu_b = accu_c = 0;
-                for (int yz = 0, oyz = oy; yz < (1 << pv->hshift); yz++, oyz++)
+                for (int xz = 0, oxz = ox; xz < (1 << pv->wshift); xz++, oxz++)
                 {
-                    for (int xz = 0, oxz = ox; xz < (1 << pv->wshift); xz++, oxz++)
+                    // Weight of the current chroma sample
+                    coeff = pv->chroma_coeffs[0][xz] * pv->chroma_coeffs[1][yz];
+                    res_u = u_out[(xx >> pv->wshift) * 2 + 0];
+                    res_v = v_out[(xx >> pv->wshift) * 2 + 1];
+
+                    // Chroma sampled area overlap with bitmap
+                    if (oxz >= 0 && oyz >= 0 && ox + xz < width && oy + yz < height)
                     {
-                        // Weight of the current chroma sample
-                        coeff = pv->chroma_coeffs[0][xz] * pv->chroma_coeffs[1][yz];
-                        res_u = u_out[(xx >> pv->wshift) * 2 + 0];
-                        res_v = v_out[(xx >> pv->wshift) * 2 + 1];
-
-                        // Chroma sampled area overlap with bitmap
-                        if (oxz >= 0 && oyz >= 0 && ox + xz < width && oy + yz < height)
-                        {
-                            alpha = a_in[oxz + yz*src->plane[3].stride];
-                            res_u *= (255 - alpha);
-                            res_u = (res_u + (u_in + yz * src->plane[1].stride)[oxz] * alpha + 127) / 255;
-
-                            res_v *= (255 - alpha);
-                            res_v = (res_v + (v_in + yz * src->plane[2].stride)[oxz] * alpha + 127) / 255;
-                        }
-
-                        // Accumulate
-                        accu_a += coeff*res_u;
-                        accu_b += coeff*res_v;
-                        accu_c += coeff;
+                        alpha = a_in[oxz + yz*src->plane[3].stride];
+                        res_u *= (255 - alpha);
+                        res_u = (res_u + (u_in + yz * src->plane[1].stride)[oxz] * alpha + 127) / 255;
+
+                        res_v *= (255 - alpha);
+                        res_v = (res_v + (v_in + yz * src->plane[2].stride)[oxz] * alpha + 127) / 255;
                     }
+
+                    // Accumulate
+                    accu_a += coeff*res_u;
+                    accu_b += coeff*res_v;
+                    accu_c += coeff;
                 }
-                if (accu_c)
-                {
-                    u_out[(xx >> pv->wshift) * 2 + 0] = (accu_a + (accu_c >> 1)) / accu_c;
-                    v_out[(xx >> pv->wshift) * 2 + 1] = (accu_b + (accu_c >> 1)) / accu_c;
-                }
+            }
+            if (accu_c)
+            {
+                u_out[(xx >> pv->wshift) * 2 + 0] = (accu_a + (accu_c >> 1)) / accu_c;
+                v_out[(xx >> pv->wshift) * 2 + 1] = (accu_b + (accu_c >> 1)) / accu_c;
             }
         }
     }
 }
 
 // blends src YUVA4**P buffer into dst
-static void blend8on8(const hb_blend_private_t *pv, hb_buffer_t *dst, const hb_buffer_t *src, const int shift)
+static void blend8on8(hb_blend_private_t *pv, hb_buffer_t *dst, const hb_buffer_t *src, const int shift)
 {
     int ww, hh;
     int x0, y0;
     uint8_t *y_in, *y_out;
     uint8_t *u_in, *u_out;
     uint8_t *v_in, *v_out;
-    uint8_t *a_in, alpha;
+    const uint8_t *a_in, *alpha;
 
     const int left = src->f.x;
     const int top  = src->f.y;
@@ -460,14 +649,10 @@ static void blend8on8(const hb_blend_private_t *pv, hb_buffer_t *dst, const hb_b
         y_in  = src->plane[0].data + yy * src->plane[0].stride;
         y_out = dst->plane[0].data + (yy + top) * dst->plane[0].stride;
         a_in = src->plane[3].data + yy * src->plane[3].stride;
-        for (int xx = x0; xx < ww; xx++)
-        {
-            alpha = a_in[xx];
-            // Merge the luminance and alpha with the picture
-            y_out[left + xx] =
-                ((uint16_t)y_out[left + xx] * (255 - alpha) +
-                     (uint16_t)y_in[xx] * alpha) / 255;
-        }
+
+        // Merge the luminance and alpha with the picture
+        pv->functions.blend_row_8(y_out + left + x0, y_in + x0, a_in + x0,
+                                  ww - x0, 0);
     }
 
     // Blend U & V
@@ -483,6 +668,13 @@ static void blend8on8(const hb_blend_private_t *pv, hb_buffer_t *dst, const hb_b
         wshift = 1;
     }
 
+    const int xs    = x0 >> wshift;
+    const int count = (ww >> wshift) - xs;
+    if (wshift && blend_tmp_alloc(pv, count) < 0)
+    {
+        return;
+    }
+
     for (int yy = y0 >> hshift; yy < hh >> hshift; yy++)
     {
         u_in = src->plane[1].data + yy * src->plane[1].stride;
@@ -491,38 +683,32 @@ static void blend8on8(const hb_blend_private_t *pv, hb_buffer_t *dst, const hb_b
         v_out = dst->plane[2].data + (yy + (top >> hshift)) * dst->plane[2].stride;
         a_in = src->plane[3].data + (yy << hshift) * src->plane[3].stride;
 
-        for (int xx = x0 >> wshift; xx < ww >> wshift; xx++)
-        {
-            alpha = a_in[xx << wshift];
+        alpha = chroma_alpha(pv, a_in, wshift, xs, count);
 
-            // Blend U and alpha
-            u_out[(left >> wshift) + xx] =
-                ((uint16_t)u_out[(left >> wshift) + xx] * (255 - alpha) +
-                 (uint16_t)u_in[xx] * alpha) / 255;
+        // Blend U and alpha
+        pv->functions.blend_row_8(u_out + (left >> wshift) + xs, u_in + xs,
+                                  alpha, count, 0);
 
-            // Blend V and alpha
-            v_out[(left >> wshift) + xx] =
-                ((uint16_t)v_out[(left >> wshift) + xx] * (255 - alpha) +
-                 (uint16_t)v_in[xx] * alpha) / 255;
-        }
+        // Blend V and alpha
+        pv->functions.blend_row_8(v_out + (left >> wshift) + xs, v_in + xs,
+                                  alpha, count, 0);
     }
 }
 
-static void blend8on1x(const hb_blend_private_t *pv, hb_buffer_t *dst, const hb_buffer_t *src, const int shift)
+static void blend8on1x(hb_blend_private_t *pv, hb_buffer_t *dst, const hb_buffer_t *src, const int shift)
 {
     int ww, hh;
     int x0, y0;
-    int max;
 
     uint8_t *y_in;
     uint8_t *u_in;
     uint8_t *v_in;
-    uint8_t *a_in;
+    const uint8_t *a_in;
+    const uint8_t *alpha;
 
     uint16_t *y_out;
     uint16_t *u_out;
     uint16_t *v_out;
-    uint16_t alpha;
 
     const int left = src->f.x;
     const int top  = src->f.y;
@@ -548,22 +734,16 @@ static void blend8on1x(const hb_blend_private_t *pv, hb_buffer_t *dst, const hb_
         hh = dst->f.height - top + y0;
     }
 
-    max = (256 << shift) -1;
-
     // Blend luma
     for (int yy = y0; yy < hh; yy++)
     {
         y_in  = src->plane[0].data + yy * src->plane[0].stride;
         y_out = (uint16_t*)(dst->plane[0].data + (yy + top) * dst->plane[0].stride);
         a_in = src->plane[3].data + yy * src->plane[3].stride;
-        for (int xx = x0; xx < ww; xx++)
-        {
-            alpha = a_in[xx] << shift;
-            // Merge the luminance and alpha with the picture
-            y_out[left + xx] =
-                ((uint32_t)y_out[left + xx] * (max - alpha) +
-                    ((uint32_t)y_in[xx] << shift) * alpha) / max;
-        }
+
+        // Merge the luminance and alpha with the picture
+        pv->functions.blend_row_16(y_out + left + x0, y_in + x0, a_in + x0,
+                                   ww - x0, shift, shift, 0);
     }
 
     // Blend U & V
@@ -578,6 +758,13 @@ static void blend8on1x(const hb_blend_private_t *pv, hb_buffer_t *dst, const hb_
         wshift = 1;
     }
 
+    const int xs    = x0 >> wshift;
+    const int count = (ww >> wshift) - xs;
+    if (wshift && blend_tmp_alloc(pv, count) < 0)
+    {
+        return;
+    }
+
     for (int yy = y0 >> hshift; yy < hh >> hshift; yy++)
     {
         u_in = src->plane[1].data + yy * src->plane[1].stride;
@@ -586,31 +773,25 @@ static void blend8on1x(const hb_blend_private_t *pv, hb_buffer_t *dst, const hb_
         v_out = (uint16_t*)(dst->plane[2].data + (yy + (top >> hshift)) * dst->plane[2].stride);
         a_in = src->plane[3].data + (yy << hshift) * src->plane[3].stride;
 
-        for (int xx = x0 >> wshift; xx < ww >> wshift; xx++)
-        {
-            alpha = a_in[xx << wshift] << shift;
+        alpha = chroma_alpha(pv, a_in, wshift, xs, count);
 
-            // Blend U and alpha
-            u_out[(left >> wshift) + xx] =
-                ((uint32_t)u_out[(left >> wshift) + xx] * (max - alpha) +
-                 ((uint32_t)u_in[xx] << shift) * alpha) / max;
+        // Blend U and alpha
+        pv->functions.blend_row_16(u_out + (left >> wshift) + xs, u_in + xs,
+                                   alpha, count, shift, shift, 0);
 
-            // Blend V and alpha
-            v_out[(left >> wshift) + xx] =
-                ((uint32_t)v_out[(left >> wshift) + xx] * (max - alpha) +
-                 ((uint32_t)v_in[xx] << shift) * alpha) / max;
-        }
+        // Blend V and alpha
+        pv->functions.blend_row_16(v_out + (left >> wshift) + xs, v_in + xs,
+                                   alpha, count, shift, shift, 0);
     }
 }
 
-static void blend8onbi8(const hb_blend_private_t *pv, hb_buffer_t *dst, const hb_buffer_t *src, const int shift)
+static void blend8onbi8(hb_blend_private_t *pv, hb_buffer_t *dst, const hb_buffer_t *src, const int shift)
 {
     int ww, hh;
     int x0, y0;
     uint8_t *y_in, *y_out;
-    uint8_t *u_in, *u_out;
-    uint8_t *v_in, *v_out;
-    uint8_t *a_in, alpha;
+    uint8_t *u_in, *v_in, *uv_out;
+    uint8_t *a_in;
 
     const int left = src->f.x;
     const int top  = src->f.y;
@@ -642,14 +823,10 @@ static void blend8onbi8(const hb_blend_private_t *pv, hb_buffer_t *dst, const hb
         y_in  = src->plane[0].data + yy * src->plane[0].stride;
         y_out = dst->plane[0].data + (yy + top) * dst->plane[0].stride;
         a_in = src->plane[3].data + yy * src->plane[3].stride;
-        for (int xx = x0; xx < ww; xx++)
-        {
-            alpha = a_in[xx];
-            // Merge the luminance and alpha with the picture
-            y_out[left + xx] =
-                ((uint16_t)y_out[left + xx] * (255 - alpha) +
-                    (uint16_t)y_in[xx] * alpha) / 255;
-        }
+
+        // Merge the luminance and alpha with the picture
+        pv->functions.blend_row_8(y_out + left + x0, y_in + x0, a_in + x0,
+                                  ww - x0, 0);
     }
 
     // Blend U & V
@@ -665,36 +842,32 @@ static void blend8onbi8(const hb_blend_private_t *pv, hb_buffer_t *dst, const hb
         wshift = 1;
     }
 
+    const int xs    = x0 >> wshift;
+    const int count = (ww >> wshift) - xs;
+    if (blend_tmp_alloc(pv, count * 2) < 0)
+    {
+        return;
+    }
+
     for (int yy = y0 >> hshift; yy < hh >> hshift; yy++)
     {
         u_in = src->plane[1].data + yy * src->plane[1].stride;
-        u_out = dst->plane[1].data + (yy + (top >> hshift)) * dst->plane[1].stride;
         v_in = src->plane[2].data + yy * src->plane[2].stride;
-        v_out = dst->plane[1].data + (yy + (top >> hshift)) * dst->plane[1].stride;
+        uv_out = dst->plane[1].data + (yy + (top >> hshift)) * dst->plane[1].stride;
         a_in = src->plane[3].data + (yy << hshift) * src->plane[3].stride;
 
-        for (int xx = x0 >> wshift; xx < ww >> wshift; xx++)
-        {
-            alpha = a_in[xx << wshift];
+        interleave_chroma(pv, u_in, v_in, a_in, wshift, xs, count);
 
-            // Blend U and alpha
-            u_out[((left >> wshift) + xx) * 2] =
-                ((uint16_t)u_out[((left >> wshift) + xx) * 2] * (255 - alpha) +
-                 (uint16_t)u_in[xx] * alpha) / 255;
-
-            // Blend V and alpha
-            v_out[((left >> wshift) + xx) * 2 +1] =
-                ((uint16_t)v_out[((left >> wshift) + xx) * 2 + 1] * (255 - alpha) +
-                 (uint16_t)v_in[xx] * alpha) / 255;
-        }
+        // Blend U, V and alpha
+        pv->functions.blend_row_8(uv_out + ((left >> wshift) + xs) * 2,
+                                  pv->src_tmp, pv->alpha_tmp, count * 2, 0);
     }
 }
 
-static void blend8onbi1x(const hb_blend_private_t *pv, hb_buffer_t *dst, const hb_buffer_t *src, const int shift)
+static void blend8onbi1x(hb_blend_private_t *pv, hb_buffer_t *dst, const hb_buffer_t *src, const int shift)
 {
     int ww, hh;
     int x0, y0;
-    int max;
 
     uint8_t *y_in;
     uint8_t *u_in;
@@ -702,9 +875,7 @@ static void blend8onbi1x(const hb_blend_private_t *pv, hb_buffer_t *dst, const h
     uint8_t *a_in;
 
     uint16_t *y_out;
-    uint16_t *u_out;
-    uint16_t *v_out;
-    uint16_t alpha;
+    uint16_t *uv_out;
 
     const int left = src->f.x;
     const int top  = src->f.y;
@@ -730,22 +901,16 @@ static void blend8onbi1x(const hb_blend_private_t *pv, hb_buffer_t *dst, const h
         hh = dst->f.height - top + y0;
     }
 
-    max = (256 << shift) -1;
-
     // Blend luma
     for (int yy = y0; yy < hh; yy++)
     {
         y_in  = src->plane[0].data + yy * src->plane[0].stride;
         y_out = (uint16_t*)(dst->plane[0].data + (yy + top) * dst->plane[0].stride);
-        a_in  = src->plane[3].data + yy * src->plane[3].stride;
-        for (int xx = x0; xx < ww; xx++)
-        {
-            alpha = a_in[xx] << shift;
-            // Merge the luminance and alpha with the picture
-            y_out[left + xx] =
-                ((uint32_t)y_out[left + xx] * (max - alpha) +
-                    ((uint32_t)av_bswap16(y_in[xx])) * alpha) / max;
-        }
+        a_in = src->plane[3].data + yy * src->plane[3].stride;
+
+        // Merge the luminance and alpha with the picture
+        pv->functions.blend_row_16(y_out + left + x0, y_in + x0, a_in + x0,
+                                   ww - x0, shift, 8, 0);
     }
 
     // Blend U & V
@@ -760,28 +925,26 @@ static void blend8onbi1x(const hb_blend_private_t *pv, hb_buffer_t *dst, const h
         wshift = 1;
     }
 
+    const int xs    = x0 >> wshift;
+    const int count = (ww >> wshift) - xs;
+    if (blend_tmp_alloc(pv, count * 2) < 0)
+    {
+        return;
+    }
+
     for (int yy = y0 >> hshift; yy < hh >> hshift; yy++)
     {
         u_in = src->plane[1].data + yy * src->plane[1].stride;
-        u_out = (uint16_t *)(dst->plane[1].data + (yy + (top >> hshift)) * dst->plane[1].stride);
         v_in = src->plane[2].data + yy * src->plane[2].stride;
-        v_out = (uint16_t *)(dst->plane[1].data + (yy + (top >> hshift)) * dst->plane[1].stride);
+        uv_out = (uint16_t *)(dst->plane[1].data + (yy + (top >> hshift)) * dst->plane[1].stride);
         a_in = src->plane[3].data + (yy << hshift) * src->plane[3].stride;
 
-        for (int xx = x0 >> wshift; xx < ww >> wshift; xx++)
-        {
-            alpha = a_in[xx << wshift] << shift;
-
-            // Blend averge U and alpha
-            u_out[((left >> wshift) + xx) * 2] =
-                ((uint32_t)u_out[((left >> wshift) + xx) * 2] * (max - alpha) +
-                 ((uint32_t)av_bswap16(u_in[xx])) * alpha) / max;
+        interleave_chroma(pv, u_in, v_in, a_in, wshift, xs, count);
 
-            // Blend V and alpha
-            v_out[((left >> wshift) + xx) * 2 + 1] =
-                ((uint32_t)v_out[((left >> wshift) + xx) * 2 + 1] * (max - alpha) +
-                 ((uint32_t)av_bswap16(v_in[xx])) * alpha) / max;
-        }
+        // Blend U, V and alpha
+        pv->functions.blend_row_16(uv_out + ((left >> wshift) + xs) * 2,
+                                   pv->src_tmp, pv->alpha_tmp, count * 2,
+                                   shift, 8, 0);
     }
 }
 
@@ -812,6 +975,18 @@ static int hb_blend_init(hb_blend_object_t *object,
                                             in_pix_fmt,
                                             in_chroma_location);
 
+    pv->functions.blend_row_8  = blend_row_8_c;
+    pv->functions.blend_row_16 = blend_row_16_c;
+#if defined(ARCH_X86)
+    blend_init_x86(&pv->functions);
+#elif defined(__aarch64__)
+    if (av_get_cpu_flags() & AV_CPU_FLAG_NEON)
+    {
+        pv->functions.blend_row_8  = blend_row_8_neon;
+        pv->functions.blend_row_16 = blend_row_16_neon;
+    }
+#endif
+
     const int needs_subsample = in_desc->log2_chroma_w != overlay_desc->log2_chroma_w ||
                                 in_desc->log2_chroma_h != overlay_desc->log2_chroma_h;
     const int planes_count = av_pix_fmt_count_planes(in_pix_fmt);
@@ -881,5 +1056,7 @@ static void hb_blend_close(hb_blend_object_t *object)
         return;
     }
 
+    free(pv->src_tmp);
+    free(pv->alpha_tmp);
     free(pv);
 }
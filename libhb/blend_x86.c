@@ -0,0 +1,240 @@
+/* blend_x86.c
+
+   Copyright (c) 2003-2026 HandBrake Team
+   This file is part of the HandBrake source code
+   Homepage: <http://handbrake.fr/>.
+   It may be used under the terms of the GNU General Public License v2.
+   For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
+ */
+
+#include "handbrake/handbrake.h"     // needed for ARCH_X86
+
+#if defined(ARCH_X86)
+
+#include <immintrin.h>
+
+#include "libavutil/cpu.h"
+#include "handbrake/blend.h"
+
+// The results must be identical to the C versions in blend.c,
+// so all divisions are exact integer divisions.
+//
+// x / 255 == (x + 1 + (x >> 8)) >> 8 for x <= 65152 (255 * 255 + 127)
+//
+// x / (2^k - 1) for any 32 bit x uses the 33 bit reciprocal
+// 2^32 + magic:  t = (x * magic) >> 32
+//                x / (2^k - 1) == (((x - t) >> 1) + t) >> (k - 1)
+
+static inline uint32_t blend_magic(int k)
+{
+    const uint64_t d = (1 << k) - 1;
+    return (uint32_t)(((1ULL << (32 + k)) + d - 1) / d - (1ULL << 32));
+}
+
+static inline int load_u32(const uint8_t *p)
+{
+    int v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i div255_sse41(__m128i x)
+{
+    const __m128i one = _mm_set1_epi16(1);
+    x = _mm_add_epi16(_mm_add_epi16(x, one), _mm_srli_epi16(x, 8));
+    return _mm_srli_epi16(x, 8);
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i blend8_sse41(__m128i d, __m128i s, __m128i a, __m128i bias)
+{
+    const __m128i c255 = _mm_set1_epi16(255);
+    __m128i x = _mm_add_epi16(_mm_mullo_epi16(d, _mm_sub_epi16(c255, a)),
+                              _mm_mullo_epi16(s, a));
+    return div255_sse41(_mm_add_epi16(x, bias));
+}
+
+__attribute__((target("sse4.1")))
+static void blend_row_8_sse41(uint8_t       *dst,
+                              const uint8_t *src,
+                              const uint8_t *alpha,
+                              int            width,
+                              int            bias)
+{
+    const __m128i zero  = _mm_setzero_si128();
+    const __m128i vbias = _mm_set1_epi16(bias);
+    int ii = 0;
+
+    for (; ii + 16 <= width; ii += 16)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + ii));
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + ii));
+        __m128i a = _mm_loadu_si128((const __m128i *)(alpha + ii));
+
+        __m128i lo = blend8_sse41(_mm_unpacklo_epi8(d, zero),
+                                  _mm_unpacklo_epi8(s, zero),
+                                  _mm_unpacklo_epi8(a, zero), vbias);
+        __m128i hi = blend8_sse41(_mm_unpackhi_epi8(d, zero),
+                                  _mm_unpackhi_epi8(s, zero),
+                                  _mm_unpackhi_epi8(a, zero), vbias);
+        _mm_storeu_si128((__m128i *)(dst + ii), _mm_packus_epi16(lo, hi));
+    }
+    for (; ii < width; ii++)
+    {
+        dst[ii] = (dst[ii] * (255 - alpha[ii]) + src[ii] * alpha[ii] + bias) / 255;
+    }
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i div_max_sse41(__m128i x, __m128i magic, __m128i shift)
+{
+    __m128i even = _mm_mul_epu32(x, magic);
+    __m128i odd  = _mm_mul_epu32(_mm_srli_epi64(x, 32), magic);
+    __m128i t    = _mm_blend_epi16(_mm_srli_epi64(even, 32), odd, 0xcc);
+
+    x = _mm_add_epi32(_mm_srli_epi32(_mm_sub_epi32(x, t), 1), t);
+    return _mm_srl_epi32(x, shift);
+}
+
+__attribute__((target("sse4.1")))
+static void blend_row_16_sse41(uint16_t      *dst,
+                               const uint8_t *src,
+                               const uint8_t *alpha,
+                               int            width,
+                               int            alpha_shift,
+                               int            src_shift,
+                               int            bias)
+{
+    const int      k      = 8 + alpha_shift;
+    const unsigned max    = (1 << k) - 1;
+    const __m128i  vmax   = _mm_set1_epi32(max);
+    const __m128i  vbias  = _mm_set1_epi32(bias);
+    const __m128i  magic  = _mm_set1_epi32(blend_magic(k));
+    const __m128i  shift  = _mm_cvtsi32_si128(k - 1);
+    const __m128i  ashift = _mm_cvtsi32_si128(alpha_shift);
+    const __m128i  sshift = _mm_cvtsi32_si128(src_shift);
+    int ii = 0;
+
+    for (; ii + 4 <= width; ii += 4)
+    {
+        __m128i d = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)(dst + ii)));
+        __m128i s = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(load_u32(src + ii)));
+        __m128i a = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(load_u32(alpha + ii)));
+
+        s = _mm_sll_epi32(s, sshift);
+        a = _mm_sll_epi32(a, ashift);
+
+        __m128i x = _mm_add_epi32(_mm_mullo_epi32(d, _mm_sub_epi32(vmax, a)),
+                                  _mm_mullo_epi32(s, a));
+        x = div_max_sse41(_mm_add_epi32(x, vbias), magic, shift);
+        _mm_storel_epi64((__m128i *)(dst + ii), _mm_packus_epi32(x, x));
+    }
+    for (; ii < width; ii++)
+    {
+        const uint32_t a = alpha[ii] << alpha_shift;
+        dst[ii] = ((uint32_t)dst[ii] * (max - a) +
+                   ((uint32_t)src[ii] << src_shift) * a + bias) / max;
+    }
+}
+
+__attribute__((target("avx2")))
+static inline __m256i blend8_avx2(__m256i d, __m256i s, __m256i a, __m256i bias)
+{
+    const __m256i c255 = _mm256_set1_epi16(255);
+    const __m256i one  = _mm256_set1_epi16(1);
+    __m256i x = _mm256_add_epi16(_mm256_mullo_epi16(d, _mm256_sub_epi16(c255, a)),
+                                 _mm256_mullo_epi16(s, a));
+    x = _mm256_add_epi16(x, bias);
+    x = _mm256_add_epi16(_mm256_add_epi16(x, one), _mm256_srli_epi16(x, 8));
+    return _mm256_srli_epi16(x, 8);
+}
+
+__attribute__((target("avx2")))
+static void blend_row_8_avx2(uint8_t       *dst,
+                             const uint8_t *src,
+                             const uint8_t *alpha,
+                             int            width,
+                             int            bias)
+{
+    const __m256i vbias = _mm256_set1_epi16(bias);
+    int ii = 0;
+
+    for (; ii + 16 <= width; ii += 16)
+    {
+        __m256i d = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(dst + ii)));
+        __m256i s = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(src + ii)));
+        __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(alpha + ii)));
+
+        __m256i x = blend8_avx2(d, s, a, vbias);
+        _mm_storeu_si128((__m128i *)(dst + ii),
+                         _mm_packus_epi16(_mm256_castsi256_si128(x),
+                                          _mm256_extracti128_si256(x, 1)));
+    }
+    blend_row_8_sse41(dst + ii, src + ii, alpha + ii, width - ii, bias);
+}
+
+__attribute__((target("avx2")))
+static void blend_row_16_avx2(uint16_t      *dst,
+                              const uint8_t *src,
+                              const uint8_t *alpha,
+                              int            width,
+                              int            alpha_shift,
+                              int            src_shift,
+                              int            bias)
+{
+    const int      k      = 8 + alpha_shift;
+    const unsigned max    = (1 << k) - 1;
+    const __m256i  vmax   = _mm256_set1_epi32(max);
+    const __m256i  vbias  = _mm256_set1_epi32(bias);
+    const __m256i  magic  = _mm256_set1_epi32(blend_magic(k));
+    const __m128i  shift  = _mm_cvtsi32_si128(k - 1);
+    const __m128i  ashift = _mm_cvtsi32_si128(alpha_shift);
+    const __m128i  sshift = _mm_cvtsi32_si128(src_shift);
+    int ii = 0;
+
+    for (; ii + 8 <= width; ii += 8)
+    {
+        __m256i d = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(dst + ii)));
+        __m256i s = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + ii)));
+        __m256i a = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(alpha + ii)));
+
+        s = _mm256_sll_epi32(s, sshift);
+        a = _mm256_sll_epi32(a, ashift);
+
+        __m256i x = _mm256_add_epi32(_mm256_mullo_epi32(d, _mm256_sub_epi32(vmax, a)),
+                                     _mm256_mullo_epi32(s, a));
+        x = _mm256_add_epi32(x, vbias);
+
+        __m256i even = _mm256_mul_epu32(x, magic);
+        __m256i odd  = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), magic);
+        __m256i t    = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xaa);
+
+        x = _mm256_add_epi32(_mm256_srli_epi32(_mm256_sub_epi32(x, t), 1), t);
+        x = _mm256_srl_epi32(x, shift);
+
+        _mm_storeu_si128((__m128i *)(dst + ii),
+                         _mm_packus_epi32(_mm256_castsi256_si128(x),
+                                          _mm256_extracti128_si256(x, 1)));
+    }
+    blend_row_16_sse41(dst + ii, src + ii, alpha + ii, width - ii,
+                       alpha_shift, src_shift, bias);
+}
+
+void blend_init_x86(BlendFunctions *functions)
+{
+    const int cpu_flags = av_get_cpu_flags();
+
+    if (cpu_flags & AV_CPU_FLAG_AVX2)
+    {
+        functions->blend_row_8  = blend_row_8_avx2;
+        functions->blend_row_16 = blend_row_16_avx2;
+    }
+    else if (cpu_flags & AV_CPU_FLAG_SSE4)
+    {
+        functions->blend_row_8  = blend_row_8_sse41;
+        functions->blend_row_16 = blend_row_16_sse41;
+    }
+}
+
+#endif // ARCH_X86
@@ -61,6 +61,9 @@ static int chroma_smooth_work(hb_filter_object_t *filter,
 static int chroma_smooth_work_thread(hb_filter_object_t *filter,
                                      hb_buffer_t ** buf_in,
                                      hb_buffer_t ** buf_out, int thread);
+static void chroma_smooth_work_band(hb_filter_object_t *filter,
+                                    hb_buffer_t * in, hb_buffer_t * out,
+                                    int plane, int y_start, int y_end, int thread);
 
 static void chroma_smooth_close(hb_filter_object_t *filter);
 
@@ -79,6 +82,7 @@ hb_filter_object_t hb_filter_chroma_smooth =
     .init_thread       = chroma_smooth_init_thread,
     .work              = chroma_smooth_work,
     .work_thread       = chroma_smooth_work_thread,
+    .work_band         = chroma_smooth_work_band,
     .close             = chroma_smooth_close,
     .settings_template = chroma_smooth_template,
 };
@@ -91,6 +95,8 @@ static void name##_##nbits(const uint8_t *frame_src,
                            const int height,                                                                \
                            int stride_src,                                                                  \
                            int stride_dst,                                                                  \
+                           const int y_start,                                                               \
+                           const int y_end,                                                                 \
                            chroma_smooth_plane_context_t * ctx,                                             \
                            chroma_smooth_thread_context_t * tctx)                                           \
 {                                                                                                           \
@@ -100,7 +106,7 @@ static void name##_##nbits(const uint8_t *frame_src,
              Tmp2;                                                                                          \
     const uint##nbits##_t *src  = (const uint##nbits##_t *)frame_src;                                       \
     uint##nbits##_t       *dst  = (uint##nbits##_t *)frame_dst;                                             \
-    const uint##nbits##_t *src2 = (const uint##nbits##_t *)frame_src;                                       \
+    const uint##nbits##_t *src2;                                                                            \
     int32_t res;                                                                                            \
     int x, y, z;                                                                                            \
     const int amount        = ctx->amount;                                                                  \
@@ -112,7 +118,9 @@ static void name##_##nbits(const uint8_t *frame_src,
                                                                                                             \
     if (!amount)                                                                                            \
     {                                                                                                       \
-        hb_image_copy_plane(frame_dst, frame_src, stride_dst, stride_src, height);                          \
+        hb_image_copy_plane(frame_dst + y_start * stride_dst,                                               \
+                            frame_src + y_start * stride_src,                                               \
+                            stride_dst, stride_src, y_end - y_start);                                       \
         return;                                                                                             \
     }                                                                                                       \
                                                                                                             \
@@ -124,12 +132,9 @@ static void name##_##nbits(const uint8_t *frame_src,
     stride_src /= ctx->bps;                                                                                 \
     stride_dst /= ctx->bps;                                                                                 \
                                                                                                             \
-    for (y = -steps; y < height + steps; y++)                                                               \
+    for (y = y_start - steps; y < y_end + steps; y++)                                                       \
     {                                                                                                       \
-        if (y < height)                                                                                     \
-        {                                                                                                   \
-            src2 = src;                                                                                     \
-        }                                                                                                   \
+        src2 = src + MIN(MAX(y, 0), height - 1) * stride_src;                                               \
                                                                                                             \
         memset(SR, 0, sizeof(SR[0]) * (2 * steps));                                                         \
                                                                                                             \
@@ -149,21 +154,15 @@ static void name##_##nbits(const uint8_t *frame_src,
                 Tmp1 = SC[z + 1][x + steps] + Tmp2; SC[z + 1][x + steps] = Tmp2;                            \
             }                                                                                               \
                                                                                                             \
-            if (x >= steps && y >= steps)                                                                   \
+            if (x >= steps && y >= y_start + steps)                                                         \
             {                                                                                               \
-                const uint##nbits##_t *srx = src - steps * stride_src + x - steps;                          \
-                uint##nbits##_t       *dsx = dst - steps * stride_dst + x - steps;                          \
+                const uint##nbits##_t *srx = src + (y - steps) * stride_src + x - steps;                    \
+                uint##nbits##_t       *dsx = dst + (y - steps) * stride_dst + x - steps;                    \
                                                                                                             \
                 res = (int32_t)*srx - ((((int32_t)*srx -                                                    \
                       (int32_t)((Tmp1 + halfscale) >> scalebits)) * amount) >> 16);                         \
                 *dsx = res > max_value ? max_value : res < min_value ? min_value : (uint##nbits##_t)res;    \
             }                                                                                               \
-        }                                                                                                   \
-                                                                                                            \
-        if (y >= 0)                                                                                         \
-        {                                                                                                   \
-            dst += stride_dst;                                                                              \
-            src += stride_src;                                                                              \
         }                                                                                                   \
     }                                                                                                       \
 }                                                                                                           \
@@ -267,6 +266,8 @@ static int chroma_smooth_init(hb_filter_object_t *filter,
             ctx->scalebits = 0;
             ctx->halfscale = 0;
         }
+
+        filter->band_halo = MAX(filter->band_halo, ctx->steps);
     }
 
     if (chroma_smooth_init_thread(filter, 1) < 0)
@@ -390,6 +391,7 @@ static int chroma_smooth_work_thread(hb_filter_object_t *filter,
                       in->plane[c].height,
                       in->plane[c].stride,
                       out->plane[c].stride,
+                      0, in->plane[c].height,
                       ctx, tctx);
     }
 
@@ -399,6 +401,23 @@ static int chroma_smooth_work_thread(hb_filter_object_t *filter,
     return HB_FILTER_OK;
 }
 
+static void chroma_smooth_work_band(hb_filter_object_t *filter,
+                                    hb_buffer_t * in, hb_buffer_t * out,
+                                    int plane, int y_start, int y_end, int thread)
+{
+    hb_filter_private_t *pv = filter->private_data;
+
+    chroma_smooth(in->plane[plane].data,
+                  out->plane[plane].data,
+                  in->plane[plane].width,
+                  in->plane[plane].height,
+                  in->plane[plane].stride,
+                  out->plane[plane].stride,
+                  y_start, y_end,
+                  &pv->plane_ctx[plane],
+                  &pv->thread_ctx[thread][plane]);
+}
+
 static int chroma_smooth_work(hb_filter_object_t *filter,
                               hb_buffer_t ** buf_in,
                               hb_buffer_t ** buf_out)
@@ -30,6 +30,7 @@ Original "Faster" settings:
 
 #include "handbrake/handbrake.h"
 #include "handbrake/taskset.h"
+#include "handbrake/comb_detect.h"
 
 #if defined(__aarch64__)
 #include <arm_neon.h>
@@ -101,6 +102,9 @@ struct hb_filter_private_s
                                   int segment_start, int segment_stop);
     void (*apply_mask)(hb_filter_private_t *pv, hb_buffer_t *b);
 
+    comb_detect_params_t params;
+    CombDetectFunctions  functions;
+
     hb_buffer_list_t   out_list;
 
     // Filter statistics
@@ -241,15 +245,23 @@ static void check_filtered_combing_mask(hb_filter_private_t *pv, int segment, in
         {
             int block_score = 0;
 
-            for (int block_y = 0; block_y < block_height; block_y++)
+            if (pv->functions.block_score != NULL)
             {
-                const int my = y + block_y;
-                const uint8_t *mask_p = &pv->mask_filtered->plane[0].data[my * stride + x];
-
-                for (int block_x = 0; block_x < block_width; block_x++)
+                block_score = pv->functions.block_score(&pv->mask_filtered->plane[0].data[y * stride + x],
+                                                        stride, block_width, block_height);
+            }
+            else
+            {
+                for (int block_y = 0; block_y < block_height; block_y++)
                 {
-                    block_score += mask_p[0];
-                    mask_p++;
+                    const int my = y + block_y;
+                    const uint8_t *mask_p = &pv->mask_filtered->plane[0].data[my * stride + x];
+
+                    for (int block_x = 0; block_x < block_width; block_x++)
+                    {
+                        block_score += mask_p[0];
+                        mask_p++;
+                    }
                 }
             }
 
@@ -404,30 +416,40 @@ static void check_combing_mask(hb_filter_private_t *pv, int segment, int start,
         {
             int block_score = 0;
 
-            for (int block_y = 0; block_y < block_height; block_y++)
+            // The blocks never reach the right edge, so only the
+            // first one needs the edge handling below
+            if (x > 0 && pv->functions.block_score_and3 != NULL)
             {
-                const int mask_y = y + block_y;
-                const uint8_t *mask_p = &pv->mask->plane[0].data[mask_y * stride + x];
-
-                for (int block_x = 0; block_x < block_width; block_x++)
+                block_score = pv->functions.block_score_and3(&pv->mask->plane[0].data[y * stride + x],
+                                                             stride, block_width, block_height);
+            }
+            else
+            {
+                for (int block_y = 0; block_y < block_height; block_y++)
                 {
-                    // We only want to mark a pixel in a block as combed
-                    // if the adjacent pixels are as well. Got to
-                    // handle the sides separately.
-                    if ((x + block_x) == 0)
-                    {
-                        block_score += mask_p[0] & mask_p[1];
-                    }
-                    else if ((x + block_x) == (width -1))
-                    {
-                        block_score += mask_p[-1] & mask_p[0];
-                    }
-                    else
+                    const int mask_y = y + block_y;
+                    const uint8_t *mask_p = &pv->mask->plane[0].data[mask_y * stride + x];
+
+                    for (int block_x = 0; block_x < block_width; block_x++)
                     {
-                        block_score += mask_p[-1] & mask_p[0] & mask_p[1];
-                    }
+                        // We only want to mark a pixel in a block as combed
+                        // if the adjacent pixels are as well. Got to
+                        // handle the sides separately.
+                        if ((x + block_x) == 0)
+                        {
+                            block_score += mask_p[0] & mask_p[1];
+                        }
+                        else if ((x + block_x) == (width -1))
+                        {
+                            block_score += mask_p[-1] & mask_p[0];
+                        }
+                        else
+                        {
+                            block_score += mask_p[-1] & mask_p[0] & mask_p[1];
+                        }
 
-                    mask_p++;
+                        mask_p++;
+                    }
                 }
             }
 
@@ -600,7 +622,13 @@ static void mask_dilate_work(void *thread_args_v)
 
     for (int yy = start; yy < stop; yy++)
     {
-        for (int xx = 1; xx < width - 1; xx++)
+        int xx = 1;
+        if (pv->functions.mask_dilate_row != NULL)
+        {
+            xx += pv->functions.mask_dilate_row(curp + 1, cur + 1, curn + 1,
+                                                dst + 1, width - 2);
+        }
+        for (; xx < width - 1; xx++)
         {
             if (cur[xx])
             {
@@ -770,7 +798,13 @@ static void mask_erode_work(void *thread_args_v)
 
     for (int yy = start; yy < stop; yy++)
     {
-        for (int xx = 1; xx < width - 1; xx++)
+        int xx = 1;
+        if (pv->functions.mask_erode_row != NULL)
+        {
+            xx += pv->functions.mask_erode_row(curp + 1, cur + 1, curn + 1,
+                                               dst + 1, width - 2);
+        }
+        for (; xx < width - 1; xx++)
         {
             if (cur[xx] == 0)
             {
@@ -944,7 +978,13 @@ static void mask_filter_work(void *thread_args_v)
 
     for (int yy = start; yy < stop; yy++)
     {
-        for (int xx = 1; xx < width - 1; xx++)
+        int xx = 1;
+        if (pv->functions.mask_filter_row != NULL)
+        {
+            xx += pv->functions.mask_filter_row(curp + 1, cur + 1, curn + 1, dst + 1,
+                                                width - 2, pv->filter_mode == FILTER_CLASSIC);
+        }
+        for (; xx < width - 1; xx++)
         {
             const int h_count = cur[xx-1] & cur[xx] & cur[xx+1];
             const int v_count = curp[xx] & cur[xx] & curn[xx];
@@ -1161,7 +1201,23 @@ static int comb_detect_init(hb_filter_object_t *filter,
     pv->comb32detect_min = pv->depth >= 8 ? 10 << (pv->depth - 8) : 10;
     pv->comb32detect_max = pv->depth >= 8 ? 15 << (pv->depth - 8) : 15;
 
-    pv->cpu_count = hb_get_cpu_count();
+    pv->params.spatial_metric            = pv->spatial_metric;
+    pv->params.motion_threshold          = pv->motion_threshold;
+    pv->params.spatial_threshold         = pv->spatial_threshold;
+    pv->params.spatial_threshold_squared = pv->spatial_threshold_squared;
+    pv->params.spatial_threshold6        = pv->spatial_threshold6;
+    pv->params.comb32detect_min          = pv->comb32detect_min;
+    pv->params.comb32detect_max          = pv->comb32detect_max;
+    pv->params.gamma_motion_threshold    = pv->gamma_motion_threshold;
+    pv->params.gamma_spatial_threshold   = pv->gamma_spatial_threshold;
+    pv->params.gamma_spatial_threshold6  = pv->gamma_spatial_threshold6;
+    pv->params.gamma_lut                 = pv->gamma_lut;
+
+#if defined(ARCH_X86)
+    comb_detect_init_x86(&pv->functions);
+#endif
+
+    pv->cpu_count = hb_job_thread_count(init->job);
 
     // Make segment sizes an even number of lines
     int height = hb_image_height(init->pix_fmt, init->geometry.height, 0);
@@ -0,0 +1,698 @@
+/* comb_detect_x86.c
+
+   Copyright (c) 2003-2026 HandBrake Team
+   This file is part of the HandBrake source code
+   Homepage: <http://handbrake.fr/>.
+   It may be used under the terms of the GNU General Public License v2.
+   For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
+ */
+
+#include "handbrake/handbrake.h"     // needed for ARCH_X86
+
+#if defined(ARCH_X86)
+
+#include <immintrin.h>
+
+#include "libavutil/cpu.h"
+#include "handbrake/comb_detect.h"
+
+// The masks must be identical to the ones of the C versions in
+// comb_detect.c and templates/comb_detect_template.c.
+//
+// 8 bit samples are compared in 16 bit lanes, so the thresholds are
+// clipped to the int16 range, which doesn't change any comparison.
+// The spatial metric 1 product doesn't fit in 16 bits and is
+// compared in 32 bit lanes. The gamma versions do the float math
+// in the same order as the C code and without fused multiply-add.
+
+static inline int clip_int16(int v)
+{
+    return v < INT16_MIN ? INT16_MIN : v > INT16_MAX ? INT16_MAX : v;
+}
+
+static inline __m128i load8_u8_sse2(const uint8_t *p)
+{
+    return _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)p), _mm_setzero_si128());
+}
+
+static inline __m128i abs16_sse2(__m128i x)
+{
+    return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static int detect_combed_row_8_sse2(const uint8_t *prev, const uint8_t *cur,
+                                    const uint8_t *next, int stride_prev,
+                                    int stride_cur, int stride_next,
+                                    uint8_t *mask, int width, int force_check,
+                                    const comb_detect_params_t *params)
+{
+    const __m128i one         = _mm_set1_epi16(1);
+    const __m128i athresh     = _mm_set1_epi16(clip_int16(params->spatial_threshold));
+    const __m128i athresh_neg = _mm_set1_epi16(clip_int16(-params->spatial_threshold));
+    const __m128i athresh6    = _mm_set1_epi16(clip_int16(params->spatial_threshold6));
+    const __m128i athresh_sq  = _mm_set1_epi32(params->spatial_threshold_squared);
+    const __m128i mthresh     = _mm_set1_epi16(clip_int16(params->motion_threshold));
+    const __m128i c32min      = _mm_set1_epi16(clip_int16(params->comb32detect_min));
+    const __m128i c32max      = _mm_set1_epi16(clip_int16(params->comb32detect_max));
+    const int check_motion    = params->motion_threshold > 0 && !force_check;
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8)
+    {
+        const __m128i c  = load8_u8_sse2(cur + x);
+        const __m128i u1 = load8_u8_sse2(cur + x - stride_cur);
+        const __m128i d1 = load8_u8_sse2(cur + x + stride_cur);
+        const __m128i up_diff   = _mm_sub_epi16(c, u1);
+        const __m128i down_diff = _mm_sub_epi16(c, d1);
+
+        __m128i cond = _mm_or_si128(
+            _mm_and_si128(_mm_cmpgt_epi16(up_diff, athresh),
+                          _mm_cmpgt_epi16(down_diff, athresh)),
+            _mm_and_si128(_mm_cmplt_epi16(up_diff, athresh_neg),
+                          _mm_cmplt_epi16(down_diff, athresh_neg)));
+        if (_mm_movemask_epi8(cond) == 0)
+        {
+            continue;
+        }
+
+        if (check_motion)
+        {
+            __m128i m1, m2;
+            m1 = _mm_cmpgt_epi16(abs16_sse2(_mm_sub_epi16(load8_u8_sse2(prev + x), c)), mthresh);
+            m1 = _mm_and_si128(m1, _mm_cmpgt_epi16(abs16_sse2(_mm_sub_epi16(u1,
+                                   load8_u8_sse2(next + x - stride_next))), mthresh));
+            m1 = _mm_and_si128(m1, _mm_cmpgt_epi16(abs16_sse2(_mm_sub_epi16(d1,
+                                   load8_u8_sse2(next + x + stride_next))), mthresh));
+            m2 = _mm_cmpgt_epi16(abs16_sse2(_mm_sub_epi16(load8_u8_sse2(next + x), c)), mthresh);
+            m2 = _mm_and_si128(m2, _mm_cmpgt_epi16(abs16_sse2(_mm_sub_epi16(
+                                   load8_u8_sse2(prev + x - stride_prev), u1)), mthresh));
+            m2 = _mm_and_si128(m2, _mm_cmpgt_epi16(abs16_sse2(_mm_sub_epi16(
+                                   load8_u8_sse2(prev + x + stride_prev), d1)), mthresh));
+            cond = _mm_and_si128(cond, _mm_or_si128(m1, m2));
+        }
+
+        __m128i metric;
+        switch (params->spatial_metric)
+        {
+            case 0:
+            {
+                const __m128i d2 = load8_u8_sse2(cur + x + 2 * stride_cur);
+                metric = _mm_and_si128(_mm_cmplt_epi16(abs16_sse2(_mm_sub_epi16(c, d2)), c32min),
+                                       _mm_cmpgt_epi16(abs16_sse2(down_diff), c32max));
+            } break;
+
+            case 1:
+            {
+                const __m128i a  = _mm_sub_epi16(u1, c);
+                const __m128i b  = _mm_sub_epi16(d1, c);
+                const __m128i lo = _mm_mullo_epi16(a, b);
+                const __m128i hi = _mm_mulhi_epi16(a, b);
+                metric = _mm_packs_epi32(
+                    _mm_cmpgt_epi32(_mm_unpacklo_epi16(lo, hi), athresh_sq),
+                    _mm_cmpgt_epi32(_mm_unpackhi_epi16(lo, hi), athresh_sq));
+            } break;
+
+            case 2:
+            {
+                const __m128i u2 = load8_u8_sse2(cur + x - 2 * stride_cur);
+                const __m128i d2 = load8_u8_sse2(cur + x + 2 * stride_cur);
+                const __m128i s  = _mm_add_epi16(_mm_add_epi16(u2, _mm_slli_epi16(c, 2)), d2);
+                const __m128i t  = _mm_add_epi16(u1, d1);
+                const __m128i t3 = _mm_add_epi16(t, _mm_add_epi16(t, t));
+                metric = _mm_cmpgt_epi16(abs16_sse2(_mm_sub_epi16(s, t3)), athresh6);
+            } break;
+
+            default:
+                metric = _mm_setzero_si128();
+                break;
+        }
+
+        const __m128i r = _mm_and_si128(_mm_and_si128(cond, metric), one);
+        _mm_storel_epi64((__m128i *)(mask + x), _mm_packus_epi16(r, r));
+    }
+
+    return x;
+}
+
+__attribute__((target("avx2")))
+static int detect_combed_row_8_avx2(const uint8_t *prev, const uint8_t *cur,
+                                    const uint8_t *next, int stride_prev,
+                                    int stride_cur, int stride_next,
+                                    uint8_t *mask, int width, int force_check,
+                                    const comb_detect_params_t *params)
+{
+#define LOAD16(p) _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+#define ABSDIFF_GT(a, b, t) _mm256_cmpgt_epi16(_mm256_abs_epi16(_mm256_sub_epi16(a, b)), t)
+
+    const __m256i one         = _mm256_set1_epi16(1);
+    const __m256i athresh     = _mm256_set1_epi16(clip_int16(params->spatial_threshold));
+    const __m256i athresh_neg = _mm256_set1_epi16(clip_int16(-params->spatial_threshold));
+    const __m256i athresh6    = _mm256_set1_epi16(clip_int16(params->spatial_threshold6));
+    const __m256i athresh_sq  = _mm256_set1_epi32(params->spatial_threshold_squared);
+    const __m256i mthresh     = _mm256_set1_epi16(clip_int16(params->motion_threshold));
+    const __m256i c32min      = _mm256_set1_epi16(clip_int16(params->comb32detect_min));
+    const __m256i c32max      = _mm256_set1_epi16(clip_int16(params->comb32detect_max));
+    const int check_motion    = params->motion_threshold > 0 && !force_check;
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        const __m256i c  = LOAD16(cur + x);
+        const __m256i u1 = LOAD16(cur + x - stride_cur);
+        const __m256i d1 = LOAD16(cur + x + stride_cur);
+        const __m256i up_diff   = _mm256_sub_epi16(c, u1);
+        const __m256i down_diff = _mm256_sub_epi16(c, d1);
+
+        __m256i cond = _mm256_or_si256(
+            _mm256_and_si256(_mm256_cmpgt_epi16(up_diff, athresh),
+                             _mm256_cmpgt_epi16(down_diff, athresh)),
+            _mm256_and_si256(_mm256_cmpgt_epi16(athresh_neg, up_diff),
+                             _mm256_cmpgt_epi16(athresh_neg, down_diff)));
+        if (_mm256_testz_si256(cond, cond))
+        {
+            continue;
+        }
+
+        if (check_motion)
+        {
+            __m256i m1, m2;
+            m1 = ABSDIFF_GT(LOAD16(prev + x), c, mthresh);
+            m1 = _mm256_and_si256(m1, ABSDIFF_GT(u1, LOAD16(next + x - stride_next), mthresh));
+            m1 = _mm256_and_si256(m1, ABSDIFF_GT(d1, LOAD16(next + x + stride_next), mthresh));
+            m2 = ABSDIFF_GT(LOAD16(next + x), c, mthresh);
+            m2 = _mm256_and_si256(m2, ABSDIFF_GT(LOAD16(prev + x - stride_prev), u1, mthresh));
+            m2 = _mm256_and_si256(m2, ABSDIFF_GT(LOAD16(prev + x + stride_prev), d1, mthresh));
+            cond = _mm256_and_si256(cond, _mm256_or_si256(m1, m2));
+        }
+
+        __m256i metric;
+        switch (params->spatial_metric)
+        {
+            case 0:
+            {
+                const __m256i d2 = LOAD16(cur + x + 2 * stride_cur);
+                metric = _mm256_and_si256(
+                    _mm256_cmpgt_epi16(c32min, _mm256_abs_epi16(_mm256_sub_epi16(c, d2))),
+                    _mm256_cmpgt_epi16(_mm256_abs_epi16(down_diff), c32max));
+            } break;
+
+            case 1:
+            {
+                // unpack and pack both work within 128 bit lanes,
+                // so the pixel order is restored
+                const __m256i a  = _mm256_sub_epi16(u1, c);
+                const __m256i b  = _mm256_sub_epi16(d1, c);
+                const __m256i lo = _mm256_mullo_epi16(a, b);
+                const __m256i hi = _mm256_mulhi_epi16(a, b);
+                metric = _mm256_packs_epi32(
+                    _mm256_cmpgt_epi32(_mm256_unpacklo_epi16(lo, hi), athresh_sq),
+                    _mm256_cmpgt_epi32(_mm256_unpackhi_epi16(lo, hi), athresh_sq));
+            } break;
+
+            case 2:
+            {
+                const __m256i u2 = LOAD16(cur + x - 2 * stride_cur);
+                const __m256i d2 = LOAD16(cur + x + 2 * stride_cur);
+                const __m256i s  = _mm256_add_epi16(_mm256_add_epi16(u2, _mm256_slli_epi16(c, 2)), d2);
+                const __m256i t  = _mm256_add_epi16(u1, d1);
+                const __m256i t3 = _mm256_add_epi16(t, _mm256_add_epi16(t, t));
+                metric = _mm256_cmpgt_epi16(_mm256_abs_epi16(_mm256_sub_epi16(s, t3)), athresh6);
+            } break;
+
+            default:
+                metric = _mm256_setzero_si256();
+                break;
+        }
+
+        const __m256i r = _mm256_and_si256(_mm256_and_si256(cond, metric), one);
+        _mm_storeu_si128((__m128i *)(mask + x),
+                         _mm_packus_epi16(_mm256_castsi256_si128(r),
+                                          _mm256_extracti128_si256(r, 1)));
+    }
+
+#undef ABSDIFF_GT
+#undef LOAD16
+
+    return x;
+}
+
+// Stores the low bytes of eight 32 bit lanes holding 0 or 1
+__attribute__((target("avx2")))
+static inline void store_mask8_avx2(uint8_t *mask, __m256i r)
+{
+    const __m128i r16 = _mm_packus_epi32(_mm256_castsi256_si128(r),
+                                         _mm256_extracti128_si256(r, 1));
+    _mm_storel_epi64((__m128i *)mask, _mm_packus_epi16(r16, r16));
+}
+
+__attribute__((target("avx2")))
+static int detect_combed_row_16_avx2(const uint16_t *prev, const uint16_t *cur,
+                                     const uint16_t *next, int stride_prev,
+                                     int stride_cur, int stride_next,
+                                     uint8_t *mask, int width, int force_check,
+                                     const comb_detect_params_t *params)
+{
+#define LOAD8(p) _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(p)))
+#define ABSDIFF_GT(a, b, t) _mm256_cmpgt_epi32(_mm256_abs_epi32(_mm256_sub_epi32(a, b)), t)
+
+    const __m256i one         = _mm256_set1_epi32(1);
+    const __m256i athresh     = _mm256_set1_epi32(params->spatial_threshold);
+    const __m256i athresh_neg = _mm256_set1_epi32(-params->spatial_threshold);
+    const __m256i athresh6    = _mm256_set1_epi32(params->spatial_threshold6);
+    const __m256i athresh_sq  = _mm256_set1_epi32(params->spatial_threshold_squared);
+    const __m256i mthresh     = _mm256_set1_epi32(params->motion_threshold);
+    const __m256i c32min      = _mm256_set1_epi32(params->comb32detect_min);
+    const __m256i c32max      = _mm256_set1_epi32(params->comb32detect_max);
+    const int check_motion    = params->motion_threshold > 0 && !force_check;
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8)
+    {
+        const __m256i c  = LOAD8(cur + x);
+        const __m256i u1 = LOAD8(cur + x - stride_cur);
+        const __m256i d1 = LOAD8(cur + x + stride_cur);
+        const __m256i up_diff   = _mm256_sub_epi32(c, u1);
+        const __m256i down_diff = _mm256_sub_epi32(c, d1);
+
+        __m256i cond = _mm256_or_si256(
+            _mm256_and_si256(_mm256_cmpgt_epi32(up_diff, athresh),
+                             _mm256_cmpgt_epi32(down_diff, athresh)),
+            _mm256_and_si256(_mm256_cmpgt_epi32(athresh_neg, up_diff),
+                             _mm256_cmpgt_epi32(athresh_neg, down_diff)));
+        if (_mm256_testz_si256(cond, cond))
+        {
+            continue;
+        }
+
+        if (check_motion)
+        {
+            __m256i m1, m2;
+            m1 = ABSDIFF_GT(LOAD8(prev + x), c, mthresh);
+            m1 = _mm256_and_si256(m1, ABSDIFF_GT(u1, LOAD8(next + x - stride_next), mthresh));
+            m1 = _mm256_and_si256(m1, ABSDIFF_GT(d1, LOAD8(next + x + stride_next), mthresh));
+            m2 = ABSDIFF_GT(LOAD8(next + x), c, mthresh);
+            m2 = _mm256_and_si256(m2, ABSDIFF_GT(LOAD8(prev + x - stride_prev), u1, mthresh));
+            m2 = _mm256_and_si256(m2, ABSDIFF_GT(LOAD8(prev + x + stride_prev), d1, mthresh));
+            cond = _mm256_and_si256(cond, _mm256_or_si256(m1, m2));
+        }
+
+        __m256i metric;
+        switch (params->spatial_metric)
+        {
+            case 0:
+            {
+                const __m256i d2 = LOAD8(cur + x + 2 * stride_cur);
+                metric = _mm256_and_si256(
+                    _mm256_cmpgt_epi32(c32min, _mm256_abs_epi32(_mm256_sub_epi32(c, d2))),
+                    _mm256_cmpgt_epi32(_mm256_abs_epi32(down_diff), c32max));
+            } break;
+
+            case 1:
+            {
+                const __m256i p = _mm256_mullo_epi32(_mm256_sub_epi32(u1, c),
+                                                     _mm256_sub_epi32(d1, c));
+                metric = _mm256_cmpgt_epi32(p, athresh_sq);
+            } break;
+
+            case 2:
+            {
+                const __m256i u2 = LOAD8(cur + x - 2 * stride_cur);
+                const __m256i d2 = LOAD8(cur + x + 2 * stride_cur);
+                const __m256i s  = _mm256_add_epi32(_mm256_add_epi32(u2, _mm256_slli_epi32(c, 2)), d2);
+                const __m256i t  = _mm256_add_epi32(u1, d1);
+                const __m256i t3 = _mm256_add_epi32(t, _mm256_add_epi32(t, t));
+                metric = _mm256_cmpgt_epi32(_mm256_abs_epi32(_mm256_sub_epi32(s, t3)), athresh6);
+            } break;
+
+            default:
+                metric = _mm256_setzero_si256();
+                break;
+        }
+
+        store_mask8_avx2(mask + x, _mm256_and_si256(_mm256_and_si256(cond, metric), one));
+    }
+
+#undef ABSDIFF_GT
+#undef LOAD8
+
+    return x;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i load_index_avx2(const void *p, int offset, const int bps)
+{
+    if (bps == 1)
+    {
+        return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)((const uint8_t *)p + offset)));
+    }
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)((const uint16_t *)p + offset)));
+}
+
+__attribute__((target("avx2")))
+static inline int detect_gamma_combed_row_avx2(const void *prev, const void *cur,
+                                               const void *next, int stride_prev,
+                                               int stride_cur, int stride_next,
+                                               uint8_t *mask, int width, int force_check,
+                                               const comb_detect_params_t *params,
+                                               const int bps)
+{
+#define GAMMA(p, offset) _mm256_i32gather_ps(lut, load_index_avx2(p, offset, bps), 4)
+#define ABSDIFF_GT(a, b) _mm256_cmp_ps(_mm256_and_ps(_mm256_sub_ps(a, b), abs_mask), mthresh, _CMP_GT_OQ)
+
+    const float  *lut         = params->gamma_lut;
+    const __m256i one         = _mm256_set1_epi32(1);
+    const __m256  abs_mask    = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256  three       = _mm256_set1_ps(3.f);
+    const __m256  four        = _mm256_set1_ps(4.f);
+    const __m256  athresh     = _mm256_set1_ps(params->gamma_spatial_threshold);
+    const __m256  athresh_neg = _mm256_set1_ps(-params->gamma_spatial_threshold);
+    const __m256  athresh6    = _mm256_set1_ps(params->gamma_spatial_threshold6);
+    const __m256  mthresh     = _mm256_set1_ps(params->gamma_motion_threshold);
+    const int check_motion    = params->gamma_motion_threshold > 0 && !force_check;
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8)
+    {
+        const __m256 c  = GAMMA(cur, x);
+        const __m256 u1 = GAMMA(cur, x - stride_cur);
+        const __m256 d1 = GAMMA(cur, x + stride_cur);
+        const __m256 up_diff   = _mm256_sub_ps(c, u1);
+        const __m256 down_diff = _mm256_sub_ps(c, d1);
+
+        __m256 cond = _mm256_or_ps(
+            _mm256_and_ps(_mm256_cmp_ps(up_diff, athresh, _CMP_GT_OQ),
+                          _mm256_cmp_ps(down_diff, athresh, _CMP_GT_OQ)),
+            _mm256_and_ps(_mm256_cmp_ps(up_diff, athresh_neg, _CMP_LT_OQ),
+                          _mm256_cmp_ps(down_diff, athresh_neg, _CMP_LT_OQ)));
+        if (_mm256_testz_ps(cond, cond))
+        {
+            continue;
+        }
+
+        if (check_motion)
+        {
+            __m256 m1, m2;
+            m1 = ABSDIFF_GT(GAMMA(prev, x), c);
+            m1 = _mm256_and_ps(m1, ABSDIFF_GT(u1, GAMMA(next, x - stride_next)));
+            m1 = _mm256_and_ps(m1, ABSDIFF_GT(d1, GAMMA(next, x + stride_next)));
+            m2 = ABSDIFF_GT(GAMMA(next, x), c);
+            m2 = _mm256_and_ps(m2, ABSDIFF_GT(GAMMA(prev, x - stride_prev), u1));
+            m2 = _mm256_and_ps(m2, ABSDIFF_GT(GAMMA(prev, x + stride_prev), d1));
+            cond = _mm256_and_ps(cond, _mm256_or_ps(m1, m2));
+        }
+
+        const __m256 u2 = GAMMA(cur, x - 2 * stride_cur);
+        const __m256 d2 = GAMMA(cur, x + 2 * stride_cur);
+        const __m256 s  = _mm256_add_ps(_mm256_add_ps(u2, _mm256_mul_ps(four, c)), d2);
+        const __m256 t  = _mm256_mul_ps(three, _mm256_add_ps(u1, d1));
+        const __m256 combing = _mm256_and_ps(_mm256_sub_ps(s, t), abs_mask);
+        cond = _mm256_and_ps(cond, _mm256_cmp_ps(combing, athresh6, _CMP_GT_OQ));
+
+        store_mask8_avx2(mask + x, _mm256_and_si256(_mm256_castps_si256(cond), one));
+    }
+
+#undef ABSDIFF_GT
+#undef GAMMA
+
+    return x;
+}
+
+__attribute__((target("avx2")))
+static int detect_gamma_combed_row_8_avx2(const uint8_t *prev, const uint8_t *cur,
+                                          const uint8_t *next, int stride_prev,
+                                          int stride_cur, int stride_next,
+                                          uint8_t *mask, int width, int force_check,
+                                          const comb_detect_params_t *params)
+{
+    return detect_gamma_combed_row_avx2(prev, cur, next, stride_prev, stride_cur,
+                                        stride_next, mask, width, force_check,
+                                        params, 1);
+}
+
+__attribute__((target("avx2")))
+static int detect_gamma_combed_row_16_avx2(const uint16_t *prev, const uint16_t *cur,
+                                           const uint16_t *next, int stride_prev,
+                                           int stride_cur, int stride_next,
+                                           uint8_t *mask, int width, int force_check,
+                                           const comb_detect_params_t *params)
+{
+    return detect_gamma_combed_row_avx2(prev, cur, next, stride_prev, stride_cur,
+                                        stride_next, mask, width, force_check,
+                                        params, 2);
+}
+
+// The mask rows hold bytes, so the eight neighbour count is done with
+// saturating adds, which doesn't change the result of the comparison
+// against the small dilation and erosion thresholds.
+
+static inline __m128i neighbour_sum_sse2(const uint8_t *curp, const uint8_t *cur,
+                                         const uint8_t *curn, int x)
+{
+    __m128i s;
+    s = _mm_adds_epu8(_mm_loadu_si128((const __m128i *)(curp + x - 1)),
+                      _mm_loadu_si128((const __m128i *)(curp + x)));
+    s = _mm_adds_epu8(s, _mm_loadu_si128((const __m128i *)(curp + x + 1)));
+    s = _mm_adds_epu8(s, _mm_loadu_si128((const __m128i *)(cur  + x - 1)));
+    s = _mm_adds_epu8(s, _mm_loadu_si128((const __m128i *)(cur  + x + 1)));
+    s = _mm_adds_epu8(s, _mm_loadu_si128((const __m128i *)(curn + x - 1)));
+    s = _mm_adds_epu8(s, _mm_loadu_si128((const __m128i *)(curn + x)));
+    s = _mm_adds_epu8(s, _mm_loadu_si128((const __m128i *)(curn + x + 1)));
+    return s;
+}
+
+static inline __m128i cmpge_epu8_sse2(__m128i a, __m128i b)
+{
+    return _mm_cmpeq_epi8(_mm_max_epu8(a, b), a);
+}
+
+static int mask_filter_row_sse2(const uint8_t *curp, const uint8_t *cur,
+                                const uint8_t *curn, uint8_t *dst,
+                                int width, int classic)
+{
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        const __m128i c = _mm_loadu_si128((const __m128i *)(cur + x));
+        __m128i r = _mm_and_si128(_mm_and_si128(_mm_loadu_si128((const __m128i *)(cur + x - 1)), c),
+                                  _mm_loadu_si128((const __m128i *)(cur + x + 1)));
+        if (!classic)
+        {
+            r = _mm_and_si128(r, _mm_and_si128(_mm_loadu_si128((const __m128i *)(curp + x)),
+                                               _mm_loadu_si128((const __m128i *)(curn + x))));
+        }
+        _mm_storeu_si128((__m128i *)(dst + x), r);
+    }
+
+    return x;
+}
+
+static int mask_dilate_row_sse2(const uint8_t *curp, const uint8_t *cur,
+                                const uint8_t *curn, uint8_t *dst, int width)
+{
+    const __m128i one       = _mm_set1_epi8(1);
+    const __m128i threshold = _mm_set1_epi8(4);
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        const __m128i zero = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(cur + x)),
+                                            _mm_setzero_si128());
+        const __m128i count = cmpge_epu8_sse2(neighbour_sum_sse2(curp, cur, curn, x), threshold);
+        _mm_storeu_si128((__m128i *)(dst + x),
+                         _mm_andnot_si128(_mm_andnot_si128(count, zero), one));
+    }
+
+    return x;
+}
+
+static int mask_erode_row_sse2(const uint8_t *curp, const uint8_t *cur,
+                               const uint8_t *curn, uint8_t *dst, int width)
+{
+    const __m128i one       = _mm_set1_epi8(1);
+    const __m128i threshold = _mm_set1_epi8(2);
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        const __m128i zero = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(cur + x)),
+                                            _mm_setzero_si128());
+        const __m128i count = cmpge_epu8_sse2(neighbour_sum_sse2(curp, cur, curn, x), threshold);
+        _mm_storeu_si128((__m128i *)(dst + x),
+                         _mm_and_si128(_mm_andnot_si128(zero, count), one));
+    }
+
+    return x;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i neighbour_sum_avx2(const uint8_t *curp, const uint8_t *cur,
+                                         const uint8_t *curn, int x)
+{
+    __m256i s;
+    s = _mm256_adds_epu8(_mm256_loadu_si256((const __m256i *)(curp + x - 1)),
+                         _mm256_loadu_si256((const __m256i *)(curp + x)));
+    s = _mm256_adds_epu8(s, _mm256_loadu_si256((const __m256i *)(curp + x + 1)));
+    s = _mm256_adds_epu8(s, _mm256_loadu_si256((const __m256i *)(cur  + x - 1)));
+    s = _mm256_adds_epu8(s, _mm256_loadu_si256((const __m256i *)(cur  + x + 1)));
+    s = _mm256_adds_epu8(s, _mm256_loadu_si256((const __m256i *)(curn + x - 1)));
+    s = _mm256_adds_epu8(s, _mm256_loadu_si256((const __m256i *)(curn + x)));
+    s = _mm256_adds_epu8(s, _mm256_loadu_si256((const __m256i *)(curn + x + 1)));
+    return s;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i cmpge_epu8_avx2(__m256i a, __m256i b)
+{
+    return _mm256_cmpeq_epi8(_mm256_max_epu8(a, b), a);
+}
+
+__attribute__((target("avx2")))
+static int mask_filter_row_avx2(const uint8_t *curp, const uint8_t *cur,
+                                const uint8_t *curn, uint8_t *dst,
+                                int width, int classic)
+{
+    int x = 0;
+
+    for (; x + 32 <= width; x += 32)
+    {
+        const __m256i c = _mm256_loadu_si256((const __m256i *)(cur + x));
+        __m256i r = _mm256_and_si256(_mm256_and_si256(_mm256_loadu_si256((const __m256i *)(cur + x - 1)), c),
+                                     _mm256_loadu_si256((const __m256i *)(cur + x + 1)));
+        if (!classic)
+        {
+            r = _mm256_and_si256(r, _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(curp + x)),
+                                                     _mm256_loadu_si256((const __m256i *)(curn + x))));
+        }
+        _mm256_storeu_si256((__m256i *)(dst + x), r);
+    }
+
+    return x + mask_filter_row_sse2(curp + x, cur + x, curn + x, dst + x,
+                                    width - x, classic);
+}
+
+__attribute__((target("avx2")))
+static int mask_dilate_row_avx2(const uint8_t *curp, const uint8_t *cur,
+                                const uint8_t *curn, uint8_t *dst, int width)
+{
+    const __m256i one       = _mm256_set1_epi8(1);
+    const __m256i threshold = _mm256_set1_epi8(4);
+    int x = 0;
+
+    for (; x + 32 <= width; x += 32)
+    {
+        const __m256i zero = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(cur + x)),
+                                               _mm256_setzero_si256());
+        const __m256i count = cmpge_epu8_avx2(neighbour_sum_avx2(curp, cur, curn, x), threshold);
+        _mm256_storeu_si256((__m256i *)(dst + x),
+                            _mm256_andnot_si256(_mm256_andnot_si256(count, zero), one));
+    }
+
+    return x + mask_dilate_row_sse2(curp + x, cur + x, curn + x, dst + x, width - x);
+}
+
+__attribute__((target("avx2")))
+static int mask_erode_row_avx2(const uint8_t *curp, const uint8_t *cur,
+                               const uint8_t *curn, uint8_t *dst, int width)
+{
+    const __m256i one       = _mm256_set1_epi8(1);
+    const __m256i threshold = _mm256_set1_epi8(2);
+    int x = 0;
+
+    for (; x + 32 <= width; x += 32)
+    {
+        const __m256i zero = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(cur + x)),
+                                               _mm256_setzero_si256());
+        const __m256i count = cmpge_epu8_avx2(neighbour_sum_avx2(curp, cur, curn, x), threshold);
+        _mm256_storeu_si256((__m256i *)(dst + x),
+                            _mm256_and_si256(_mm256_andnot_si256(zero, count), one));
+    }
+
+    return x + mask_erode_row_sse2(curp + x, cur + x, curn + x, dst + x, width - x);
+}
+
+static inline int hsum_epi64_sse2(__m128i sum)
+{
+    return _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+}
+
+static int block_score_sse2(const uint8_t *mask, int stride,
+                            int block_width, int block_height)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = _mm_setzero_si128();
+    int score = 0;
+
+    for (int y = 0; y < block_height; y++)
+    {
+        const uint8_t *mask_p = mask + y * stride;
+        int x = 0;
+
+        for (; x + 16 <= block_width; x += 16)
+        {
+            sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(mask_p + x)), zero));
+        }
+        for (; x < block_width; x++)
+        {
+            score += mask_p[x];
+        }
+    }
+
+    return score + hsum_epi64_sse2(sum);
+}
+
+static int block_score_and3_sse2(const uint8_t *mask, int stride,
+                                 int block_width, int block_height)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = _mm_setzero_si128();
+    int score = 0;
+
+    for (int y = 0; y < block_height; y++)
+    {
+        const uint8_t *mask_p = mask + y * stride;
+        int x = 0;
+
+        for (; x + 16 <= block_width; x += 16)
+        {
+            const __m128i m = _mm_and_si128(
+                _mm_and_si128(_mm_loadu_si128((const __m128i *)(mask_p + x - 1)),
+                              _mm_loadu_si128((const __m128i *)(mask_p + x))),
+                _mm_loadu_si128((const __m128i *)(mask_p + x + 1)));
+            sum = _mm_add_epi64(sum, _mm_sad_epu8(m, zero));
+        }
+        for (; x < block_width; x++)
+        {
+            score += mask_p[x - 1] & mask_p[x] & mask_p[x + 1];
+        }
+    }
+
+    return score + hsum_epi64_sse2(sum);
+}
+
+void comb_detect_init_x86(CombDetectFunctions *functions)
+{
+    const int cpu_flags = av_get_cpu_flags();
+
+    if (cpu_flags & AV_CPU_FLAG_SSE2)
+    {
+        functions->detect_combed_row_8 = detect_combed_row_8_sse2;
+        functions->mask_filter_row     = mask_filter_row_sse2;
+        functions->mask_dilate_row     = mask_dilate_row_sse2;
+        functions->mask_erode_row      = mask_erode_row_sse2;
+        functions->block_score         = block_score_sse2;
+        functions->block_score_and3    = block_score_and3_sse2;
+    }
+    if (cpu_flags & AV_CPU_FLAG_AVX2)
+    {
+        functions->detect_combed_row_8        = detect_combed_row_8_avx2;
+        functions->detect_combed_row_16       = detect_combed_row_16_avx2;
+        functions->detect_gamma_combed_row_8  = detect_gamma_combed_row_8_avx2;
+        functions->detect_gamma_combed_row_16 = detect_gamma_combed_row_16_avx2;
+        functions->mask_filter_row            = mask_filter_row_avx2;
+        functions->mask_dilate_row            = mask_dilate_row_avx2;
+        functions->mask_erode_row             = mask_erode_row_avx2;
+    }
+}
+
+#endif // ARCH_X86
@@ -94,6 +94,7 @@ enum
     HB_GID_VCODEC_FFV1,
     HB_GID_VCODEC_PRORES,
     HB_GID_VCODEC_DNXHR,
+    HB_GID_VCODEC_PASS,
     HB_GID_ACODEC_ALAC,
     HB_GID_ACODEC_ALAC_PASS,
     HB_GID_ACODEC_AAC,
@@ -348,6 +349,7 @@ hb_encoder_internal_t hb_video_encoders[]  =
     { { "ProRes",                      "ff_prores",        "ProRes (libavcodec)",            HB_VCODEC_FFMPEG_PRORES,                      HB_MUX_MASK_MOV|HB_MUX_MASK_MKV, }, NULL, 0, 1, HB_GID_VCODEC_PRORES,     },
     { { "ProRes (VideoToolbox)",       "vt_prores",        "ProRes (VideoToolbox)",          HB_VCODEC_VT_PRORES,                          HB_MUX_MASK_MOV|HB_MUX_MASK_MKV, }, NULL, 0, 1, HB_GID_VCODEC_PRORES,     },
     { { "Theora",                      "theora",           "Theora (libtheora)",             HB_VCODEC_THEORA,                                             HB_MUX_MASK_MKV, }, NULL, 0, 1, HB_GID_VCODEC_THEORA,     },
+    { { "Video Passthru",              "copy",             "Video Passthru",                 HB_VCODEC_PASS,                               HB_MUX_MASK_MP4|HB_MUX_MASK_MOV|HB_MUX_MASK_WEBM|HB_MUX_MASK_MKV, }, NULL, 0, 1, HB_GID_VCODEC_PASS, },
 };
 int hb_video_encoders_count = sizeof(hb_video_encoders) / sizeof(hb_video_encoders[0]);
 static int hb_video_encoder_is_enabled(int encoder, int disable_hardware)
@@ -436,6 +438,7 @@ static int hb_video_encoder_is_enabled(int encoder, int disable_hardware)
 #if HB_PROJECT_FEATURE_FFMPEG_PRORES
         case HB_VCODEC_FFMPEG_PRORES:
 #endif
+        case HB_VCODEC_PASS:
             return 1;
 
 #if HB_PROJECT_FEATURE_X265
@@ -1857,6 +1860,7 @@ const char* hb_video_quality_get_name(uint32_t codec)
 
         case HB_VCODEC_FFMPEG_DNXHR:
         case HB_VCODEC_FFMPEG_DNXHR_10BIT:
+        case HB_VCODEC_PASS:
         case HB_VCODEC_FFMPEG_MF_H264:
         case HB_VCODEC_FFMPEG_MF_H265:
         case HB_VCODEC_FFMPEG_MF_AV1:
@@ -1876,6 +1880,9 @@ int hb_video_quality_is_supported(uint32_t codec)
 {
     switch (codec)
     {
+        case HB_VCODEC_PASS:
+            return 0;
+
 #ifdef __APPLE__
         case HB_VCODEC_VT_H264:
         case HB_VCODEC_VT_H265:
@@ -1897,6 +1904,7 @@ int hb_video_bitrate_is_supported(uint32_t codec)
         case HB_VCODEC_FFMPEG_FFV1:
         case HB_VCODEC_FFMPEG_PRORES:
         case HB_VCODEC_VT_PRORES:
+        case HB_VCODEC_PASS:
             return 0;
 
         default:
@@ -5426,6 +5434,10 @@ hb_filter_object_t * hb_filter_get( int filter_id )
             filter = &hb_filter_mt_frame;
             break;
 
+        case HB_FILTER_FUSED:
+            filter = &hb_filter_fused;
+            break;
+
 #if defined(__APPLE__)
         case HB_FILTER_ADAPTER_VT:
             filter = &hb_filter_adapter_vt;
@@ -5533,6 +5545,16 @@ void hb_filter_close( hb_filter_object_t ** _f )
     *_f = NULL;
 }
 
+hb_buffer_t * hb_filter_frame_output(hb_filter_object_t * filter,
+                                     hb_buffer_t * in, int pix_fmt)
+{
+    if (filter->in_place && in->f.fmt == pix_fmt && hb_buffer_is_writable(in))
+    {
+        return in;
+    }
+    return hb_frame_buffer_init(pix_fmt, in->f.width, in->f.height);
+}
+
 /**********************************************************************
  * hb_filter_info_close
  **********************************************************************
@@ -1836,7 +1836,8 @@ static int decavcodecvInit( hb_work_object_t * w, hb_job_t * job )
 
     if( pv->job && pv->job->title && !pv->job->title->has_resolution_change )
     {
-        pv->threads = HB_FFMPEG_THREADS_AUTO;
+        pv->threads = pv->job->thread_count > 0 ?
+                      hb_job_thread_count(pv->job) : HB_FFMPEG_THREADS_AUTO;
     }
 
     if (w->hw_device_ctx)
@@ -150,6 +150,7 @@ struct hb_filter_private_s
     yadif_arguments_t  *yadif_arguments;   // Arguments to thread for work
 
     taskset_t           eedi2_taskset;     // Threads for eedi2 - one per plane
+    EEDI2Functions      eedi2_functions;
 
     hb_buffer_list_t    out_list;
 
@@ -272,7 +273,7 @@ static int hb_decomb_init(hb_filter_object_t *filter,
         }
     }
 
-    pv->cpu_count = hb_get_cpu_count();
+    pv->cpu_count = hb_job_thread_count(init->job);
 
     // Make segment sizes an even number of lines
     int height = hb_image_height(init->pix_fmt, init->geometry.height, 0);
@@ -333,6 +334,10 @@ static int hb_decomb_init(hb_filter_object_t *filter,
     init_crop_table((void **)&pv->crop_table, pv->max_value);
     eedi2_init_limlut((void **)&pv->eedi_limlut, pv->depth);
 
+#if defined(ARCH_X86)
+    eedi2_init_x86(&pv->eedi2_functions);
+#endif
+
     // Adjust cpu_count to the appropriate value so it will not use all CPU cores
     if ((height / pv->segment_height[0]) < pv->cpu_count)
     {
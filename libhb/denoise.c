@@ -22,27 +22,75 @@
 
 #include "handbrake/handbrake.h"
 #include "handbrake/hbffmpeg.h"
+#include "handbrake/executor.h"
 #include "libavutil/intreadwrite.h"
 
+#if defined(ARCH_X86)
+#include <immintrin.h>
+#include "libavutil/cpu.h"
+#endif
+
 #define HQDN3D_SPATIAL_LUMA_DEFAULT    4.0f
 #define HQDN3D_SPATIAL_CHROMA_DEFAULT  3.0f
 #define HQDN3D_TEMPORAL_LUMA_DEFAULT   6.0f
 
+#define HQDN3D_BAND_HEIGHT             64
+
 #define LUT_BITS (depth==16 ? 8 : 4)
 #define LOAD(x) (((depth == 8 ? frame_src[x] : AV_RN16A(frame_src + (x) * 2)) << (16 - depth))\
                  + (((1 << (16 - depth)) - 1) >> 1))
 #define STORE(x,val) (depth == 8 ? frame_dst[x] = (val) >> (16 - depth) : \
                                    AV_WN16A(frame_dst + (x) * 2, (val) >> (16 - depth)))
 
+typedef struct
+{
+    void (*horizontal_row)(uint8_t *frame_src, int32_t *pixel,
+                           int w, int first_line, int16_t *spatial);
+    void (*vertical_row)(const int32_t *pixel, uint16_t *line_ant,
+                         uint16_t *frame_ant, uint8_t *frame_dst,
+                         int start, int end, int first_line,
+                         int16_t *spatial, int16_t *temporal);
+    void (*temporal_row)(uint8_t *frame_src, uint8_t *frame_dst,
+                         uint16_t *frame_ant, int start, int end,
+                         int16_t *temporal);
+} hqdn3d_functions_t;
+
+// One plane of a frame, shared by the slices that process it
+typedef struct
+{
+    hqdn3d_functions_t *functions;
+
+    uint8_t  *frame_src;
+    uint8_t  *frame_dst;
+    uint16_t *line_ant;
+    uint16_t *frame_ant;
+    int32_t  *band;
+
+    int w, h;
+    int sstride, dstride;
+    int y0, rows;
+
+    int16_t *spatial;
+    int16_t *temporal;
+
+    int slice_count;
+} hqdn3d_plane_t;
+
 struct hb_filter_private_s
 {
     int16_t  *hqdn3d_coef[6];
     uint16_t *hqdn3d_line;
     uint16_t *hqdn3d_frame[3];
+    int32_t  *hqdn3d_band;
 
     int hsub, vsub;
     int depth;
 
+    hqdn3d_functions_t functions;
+    hb_executor_t     *executor;
+    int                slice_count;
+    int                band_height;
+
     hb_filter_init_t input;
     hb_filter_init_t output;
 };
@@ -73,6 +121,7 @@ hb_filter_object_t hb_filter_denoise =
     .work              = hb_denoise_work,
     .close             = hb_denoise_close,
     .settings_template = denoise_template,
+    .in_place          = 1,
 };
 
 static void hqdn3d_precalc_coef(int16_t *ct, int depth, double dist25)
@@ -99,76 +148,289 @@ static inline unsigned int hqdn3d_lowpass_mul(int prev_mul, int curr_mul, int16_
     return curr_mul + coef[d];
 }
 
-static void hqdn3d_denoise_temporal(uint8_t *frame_src, uint8_t *frame_dst,
-                                    uint16_t *frame_ant,
-                                    int w, int h, int sstride, int dstride,
-                                    int16_t *temporal, int depth)
+/*
+ * The spatial low-pass is recursive in both directions, but the
+ * horizontal recursion of a line only depends on that line and the
+ * vertical recursion of a column only depends on that column.  So the
+ * spatial pass is split in a horizontal pass that runs on slices of
+ * lines and a vertical + temporal pass that runs on slices of columns.
+ * Lines are processed in bands so that the horizontally filtered pixels
+ * stay in cache.  They are kept as 32 bit values because the C filter
+ * never truncated them either.
+ */
+static inline void hqdn3d_horizontal_row(uint8_t *frame_src, int32_t *pixel,
+                                         int w, int first_line,
+                                         int16_t *spatial, int depth)
 {
-    long x, y;
+    long x = 0;
+    uint32_t pixel_ant = LOAD(0);
+
+    /* First line has no top neighbor, its left neighbor includes the pixel itself */
+    if (!first_line)
+    {
+        pixel[0] = pixel_ant;
+        x = 1;
+    }
+    for (; x < w; x++)
+    {
+        pixel[x] = pixel_ant = hqdn3d_lowpass_mul(pixel_ant, LOAD(x), spatial, depth);
+    }
+}
+
+static inline void hqdn3d_vertical_row(const int32_t *pixel, uint16_t *line_ant,
+                                       uint16_t *frame_ant, uint8_t *frame_dst,
+                                       int start, int end, int first_line,
+                                       int16_t *spatial, int16_t *temporal, int depth)
+{
+    long x;
+    uint32_t tmp;
+
+    for (x = start; x < end; x++)
+    {
+        tmp = first_line ? (uint32_t)pixel[x] :
+                           hqdn3d_lowpass_mul(line_ant[x], pixel[x], spatial, depth);
+        line_ant[x] = tmp;
+        frame_ant[x] = tmp = hqdn3d_lowpass_mul(frame_ant[x], tmp, temporal, depth);
+        STORE(x, tmp);
+    }
+}
+
+static inline void hqdn3d_temporal_row(uint8_t *frame_src, uint8_t *frame_dst,
+                                       uint16_t *frame_ant, int start, int end,
+                                       int16_t *temporal, int depth)
+{
+    long x;
     uint32_t tmp;
 
-    temporal += 256 << LUT_BITS;
+    for (x = start; x < end; x++)
+    {
+        frame_ant[x] = tmp = hqdn3d_lowpass_mul(frame_ant[x], LOAD(x), temporal, depth);
+        STORE(x, tmp);
+    }
+}
+
+#if defined(ARCH_X86)
+// The coefficient tables have one entry of padding so that the 32 bit
+// gathers of the last int16_t entry stay inside the allocation.
+__attribute__((target("avx2")))
+static inline __m256i hqdn3d_lowpass_mul_avx2(__m256i prev_mul, __m256i curr_mul,
+                                              int16_t *coef, int depth)
+{
+    __m256i d = _mm256_srai_epi32(_mm256_sub_epi32(prev_mul, curr_mul), 8 - LUT_BITS);
+    __m256i c = _mm256_i32gather_epi32((const int *)coef, d, 2);
+    return _mm256_add_epi32(curr_mul, _mm256_srai_epi32(_mm256_slli_epi32(c, 16), 16));
+}
+
+// Truncates 8 32 bit values to 16 bit
+__attribute__((target("avx2")))
+static inline __m128i hqdn3d_pack16_avx2(__m256i v)
+{
+    v = _mm256_and_si256(v, _mm256_set1_epi32(0xffff));
+    v = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), _MM_SHUFFLE(3, 1, 2, 0));
+    return _mm256_castsi256_si128(v);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i hqdn3d_load_avx2(uint8_t *frame_src, long x, int depth)
+{
+    __m256i v = depth == 8 ?
+        _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(frame_src + x))) :
+        _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(frame_src + x * 2)));
+    return _mm256_add_epi32(_mm256_slli_epi32(v, 16 - depth),
+                            _mm256_set1_epi32(((1 << (16 - depth)) - 1) >> 1));
+}
+
+__attribute__((target("avx2")))
+static inline void hqdn3d_store_avx2(uint8_t *frame_dst, long x, __m256i val, int depth)
+{
+    __m128i v = hqdn3d_pack16_avx2(_mm256_srli_epi32(val, 16 - depth));
+    if (depth == 8)
+    {
+        v = _mm_and_si128(v, _mm_set1_epi16(0xff));
+        _mm_storel_epi64((__m128i *)(frame_dst + x), _mm_packus_epi16(v, v));
+    }
+    else
+    {
+        _mm_storeu_si128((__m128i *)(frame_dst + x * 2), v);
+    }
+}
+
+__attribute__((target("avx2")))
+static inline void hqdn3d_vertical_row_avx2(const int32_t *pixel, uint16_t *line_ant,
+                                            uint16_t *frame_ant, uint8_t *frame_dst,
+                                            int start, int end, int first_line,
+                                            int16_t *spatial, int16_t *temporal, int depth)
+{
+    long x;
 
-    for (y = 0; y < h; y++)
+    for (x = start; x + 8 <= end; x += 8)
     {
-        for (x = 0; x < w; x++)
+        __m256i tmp = _mm256_loadu_si256((const __m256i *)(pixel + x));
+        if (!first_line)
         {
-            frame_ant[x] = tmp = hqdn3d_lowpass_mul(frame_ant[x], LOAD(x), temporal, depth);
-            STORE(x, tmp);
+            __m256i ant = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(line_ant + x)));
+            tmp = hqdn3d_lowpass_mul_avx2(ant, tmp, spatial, depth);
         }
+        _mm_storeu_si128((__m128i *)(line_ant + x), hqdn3d_pack16_avx2(tmp));
 
-        frame_src += sstride;
-        frame_dst += dstride;
-        frame_ant += w;
+        __m256i ant = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(frame_ant + x)));
+        tmp = hqdn3d_lowpass_mul_avx2(ant, tmp, temporal, depth);
+        _mm_storeu_si128((__m128i *)(frame_ant + x), hqdn3d_pack16_avx2(tmp));
+        hqdn3d_store_avx2(frame_dst, x, tmp, depth);
     }
+    hqdn3d_vertical_row(pixel, line_ant, frame_ant, frame_dst, x, end,
+                        first_line, spatial, temporal, depth);
 }
 
-static void hqdn3d_denoise_spatial(uint8_t *frame_src, uint8_t *frame_dst,
-                                   uint16_t *line_ant, uint16_t *frame_ant,
-                                   int w, int h, int sstride, int dstride,
-                                   int16_t *spatial, int16_t *temporal, int depth)
+__attribute__((target("avx2")))
+static inline void hqdn3d_temporal_row_avx2(uint8_t *frame_src, uint8_t *frame_dst,
+                                            uint16_t *frame_ant, int start, int end,
+                                            int16_t *temporal, int depth)
 {
-    long x, y;
-    uint32_t pixel_ant;
-    uint32_t tmp;
+    long x;
 
-    spatial  += 256 << LUT_BITS;
-    temporal += 256 << LUT_BITS;
+    for (x = start; x + 8 <= end; x += 8)
+    {
+        __m256i ant = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(frame_ant + x)));
+        __m256i tmp = hqdn3d_lowpass_mul_avx2(ant, hqdn3d_load_avx2(frame_src, x, depth),
+                                              temporal, depth);
+        _mm_storeu_si128((__m128i *)(frame_ant + x), hqdn3d_pack16_avx2(tmp));
+        hqdn3d_store_avx2(frame_dst, x, tmp, depth);
+    }
+    hqdn3d_temporal_row(frame_src, frame_dst, frame_ant, x, end, temporal, depth);
+}
+#endif
+
+// Instantiate the row functions for each supported depth
+#define HQDN3D_ROW_FUNCTIONS(depth, suffix, attr)                                               \
+attr static void hqdn3d_vertical_row_##depth##suffix(const int32_t *pixel, uint16_t *line_ant,  \
+                                         uint16_t *frame_ant, uint8_t *frame_dst,               \
+                                         int start, int end, int first_line,                    \
+                                         int16_t *spatial, int16_t *temporal)                   \
+{                                                                                               \
+    hqdn3d_vertical_row##suffix(pixel, line_ant, frame_ant, frame_dst, start, end,              \
+                                first_line, spatial, temporal, depth);                          \
+}                                                                                               \
+attr static void hqdn3d_temporal_row_##depth##suffix(uint8_t *frame_src, uint8_t *frame_dst,    \
+                                         uint16_t *frame_ant, int start, int end,               \
+                                         int16_t *temporal)                                     \
+{                                                                                               \
+    hqdn3d_temporal_row##suffix(frame_src, frame_dst, frame_ant, start, end, temporal, depth);  \
+}                                                                                               \
+
+#define HQDN3D_HORIZONTAL_ROW_FUNCTION(depth)                                                   \
+static void hqdn3d_horizontal_row_##depth(uint8_t *frame_src, int32_t *pixel,                   \
+                                          int w, int first_line, int16_t *spatial)              \
+{                                                                                               \
+    hqdn3d_horizontal_row(frame_src, pixel, w, first_line, spatial, depth);                     \
+}                                                                                               \
+
+#if defined(ARCH_X86)
+#define HQDN3D_DEPTH(depth)                                                 \
+HQDN3D_HORIZONTAL_ROW_FUNCTION(depth)                                       \
+HQDN3D_ROW_FUNCTIONS(depth, , )                                             \
+HQDN3D_ROW_FUNCTIONS(depth, _avx2, __attribute__((target("avx2"))))
+#else
+#define HQDN3D_DEPTH(depth)                                                 \
+HQDN3D_HORIZONTAL_ROW_FUNCTION(depth)                                       \
+HQDN3D_ROW_FUNCTIONS(depth, , )
+#endif
+
+HQDN3D_DEPTH(8)
+HQDN3D_DEPTH(9)
+HQDN3D_DEPTH(10)
+HQDN3D_DEPTH(12)
+HQDN3D_DEPTH(14)
+HQDN3D_DEPTH(16)
+
+static void hqdn3d_init_functions(hqdn3d_functions_t *functions, int depth)
+{
+#if defined(ARCH_X86)
+    const int avx2 = !!(av_get_cpu_flags() & AV_CPU_FLAG_AVX2);
+#define HQDN3D_SET_FUNCTIONS(d)                                                             \
+        case d:                                                                             \
+            functions->horizontal_row = hqdn3d_horizontal_row_##d;                          \
+            functions->vertical_row   = avx2 ? hqdn3d_vertical_row_##d##_avx2 :             \
+                                               hqdn3d_vertical_row_##d;                     \
+            functions->temporal_row   = avx2 ? hqdn3d_temporal_row_##d##_avx2 :             \
+                                               hqdn3d_temporal_row_##d;                     \
+            break;
+#else
+#define HQDN3D_SET_FUNCTIONS(d)                                                             \
+        case d:                                                                             \
+            functions->horizontal_row = hqdn3d_horizontal_row_##d;                          \
+            functions->vertical_row   = hqdn3d_vertical_row_##d;                            \
+            functions->temporal_row   = hqdn3d_temporal_row_##d;                            \
+            break;
+#endif
+    switch (depth)
+    {
+        HQDN3D_SET_FUNCTIONS(8)
+        HQDN3D_SET_FUNCTIONS(9)
+        HQDN3D_SET_FUNCTIONS(10)
+        HQDN3D_SET_FUNCTIONS(12)
+        HQDN3D_SET_FUNCTIONS(14)
+        HQDN3D_SET_FUNCTIONS(16)
+    }
+#undef HQDN3D_SET_FUNCTIONS
+}
 
-    /* First line has no top neighbor. Only left one for each tmp and last frame */
-    pixel_ant = LOAD(0);
-    for (x = 0; x < w; x++)
+static void hqdn3d_horizontal_slice(void *opaque, int index)
+{
+    hqdn3d_plane_t *p = opaque;
+    const int start = p->rows * index / p->slice_count;
+    const int end   = p->rows * (index + 1) / p->slice_count;
+
+    for (int yy = start; yy < end; yy++)
     {
-        line_ant[x] = tmp = pixel_ant = hqdn3d_lowpass_mul(pixel_ant, LOAD(x), spatial, depth);
-        frame_ant[x] = tmp = hqdn3d_lowpass_mul(frame_ant[x], tmp, temporal, depth);
-        STORE(x, tmp);
+        const int y = p->y0 + yy;
+        p->functions->horizontal_row(p->frame_src + y * p->sstride,
+                                     p->band + yy * p->w, p->w, y == 0,
+                                     p->spatial);
     }
+}
 
-    for (y = 1; y < h; y++)
+static void hqdn3d_vertical_slice(void *opaque, int index)
+{
+    hqdn3d_plane_t *p = opaque;
+    // Multiples of 8 columns, so only the last slice has a scalar tail
+    const int width = ((p->w + p->slice_count - 1) / p->slice_count + 7) & ~7;
+    const int start = index * width;
+    const int end   = FFMIN(start + width, p->w);
+
+    for (int yy = 0; yy < p->rows && start < end; yy++)
     {
-        frame_src += sstride;
-        frame_dst += dstride;
-        frame_ant += w;
-        pixel_ant = LOAD(0);
+        const int y = p->y0 + yy;
+        p->functions->vertical_row(p->band + yy * p->w, p->line_ant,
+                                   p->frame_ant + y * p->w,
+                                   p->frame_dst + y * p->dstride,
+                                   start, end, y == 0,
+                                   p->spatial, p->temporal);
+    }
+}
 
-        for (x = 0; x < w-1; x++)
-        {
-            line_ant[x] = tmp =  hqdn3d_lowpass_mul(line_ant[x], pixel_ant, spatial, depth);
-            pixel_ant =          hqdn3d_lowpass_mul(pixel_ant, LOAD(x+1), spatial, depth);
-            frame_ant[x] = tmp = hqdn3d_lowpass_mul(frame_ant[x], tmp, temporal, depth);
-            STORE(x, tmp);
-        }
-        line_ant[x] = tmp =  hqdn3d_lowpass_mul(line_ant[x], pixel_ant, spatial, depth);
-        frame_ant[x] = tmp = hqdn3d_lowpass_mul(frame_ant[x], tmp, temporal, depth);
-        STORE(x, tmp);
+static void hqdn3d_temporal_slice(void *opaque, int index)
+{
+    hqdn3d_plane_t *p = opaque;
+    const int start = p->h * index / p->slice_count;
+    const int end   = p->h * (index + 1) / p->slice_count;
+
+    for (int y = start; y < end; y++)
+    {
+        p->functions->temporal_row(p->frame_src + y * p->sstride,
+                                   p->frame_dst + y * p->dstride,
+                                   p->frame_ant + y * p->w,
+                                   0, p->w, p->temporal);
     }
 }
 
-static void hqdn3d_denoise_depth(uint8_t *frame_src, uint8_t *frame_dst,
-                                 uint16_t *line_ant, uint16_t **frame_ant_ptr,
-                                 int w, int h, int sstride, int dstride,
-                                 int16_t *spatial, int16_t *temporal, int depth)
+static void hqdn3d_denoise(hb_filter_private_t *pv,
+                           uint8_t *frame_src, uint8_t *frame_dst,
+                           uint16_t **frame_ant_ptr,
+                           int w, int h, int sstride, int dstride,
+                           int16_t *spatial, int16_t *temporal)
 {
+    const int depth = pv->depth;
     long x, y;
     uint16_t *frame_ant = (*frame_ant_ptr);
 
@@ -187,30 +449,42 @@ static void hqdn3d_denoise_depth(uint8_t *frame_src, uint8_t *frame_dst,
         frame_ant = *frame_ant_ptr;
     }
 
+    hqdn3d_plane_t p =
+    {
+        .functions   = &pv->functions,
+        .frame_src   = frame_src,
+        .frame_dst   = frame_dst,
+        .line_ant    = pv->hqdn3d_line,
+        .frame_ant   = frame_ant,
+        .band        = pv->hqdn3d_band,
+        .w           = w,
+        .h           = h,
+        .sstride     = sstride,
+        .dstride     = dstride,
+        .spatial     = spatial  + (256 << LUT_BITS),
+        .temporal    = temporal + (256 << LUT_BITS),
+        .slice_count = pv->slice_count,
+    };
+
     /* If no spatial coefficients, do temporal denoise only */
     if (spatial[0])
     {
-        hqdn3d_denoise_spatial(frame_src, frame_dst, line_ant, frame_ant,
-                               w, h, sstride, dstride, spatial, temporal, depth);
+        for (p.y0 = 0; p.y0 < h; p.y0 += pv->band_height)
+        {
+            p.rows = FFMIN(pv->band_height, h - p.y0);
+            hb_executor_parallel_for(pv->executor, p.slice_count,
+                                     hqdn3d_horizontal_slice, &p);
+            hb_executor_parallel_for(pv->executor, p.slice_count,
+                                     hqdn3d_vertical_slice, &p);
+        }
     }
     else
     {
-        hqdn3d_denoise_temporal(frame_src, frame_dst, frame_ant,
-                                w, h, sstride, dstride, temporal, depth);
+        hb_executor_parallel_for(pv->executor, p.slice_count,
+                                 hqdn3d_temporal_slice, &p);
     }
 }
 
-#define hqdn3d_denoise(...)                                             \
-        switch (pv->depth) {                                            \
-            case  8: hqdn3d_denoise_depth(__VA_ARGS__,  8); break;      \
-            case  9: hqdn3d_denoise_depth(__VA_ARGS__,  9); break;      \
-            case 10: hqdn3d_denoise_depth(__VA_ARGS__, 10); break;      \
-            case 12: hqdn3d_denoise_depth(__VA_ARGS__, 12); break;      \
-            case 14: hqdn3d_denoise_depth(__VA_ARGS__, 14); break;      \
-            case 16: hqdn3d_denoise_depth(__VA_ARGS__, 16); break;      \
-        }                                                               \
-
-
 static int hb_denoise_init( hb_filter_object_t * filter,
                             hb_filter_init_t * init )
 {
@@ -262,7 +536,7 @@ static int hb_denoise_init( hb_filter_object_t * filter,
 
     for (i = 0; i < 6; i++)
     {
-        pv->hqdn3d_coef[i] = av_malloc((512<<LUT_BITS) * sizeof(int16_t));
+        pv->hqdn3d_coef[i] = av_malloc(((512<<LUT_BITS) + 1) * sizeof(int16_t));
         if (!pv->hqdn3d_coef[i])
         {
             return 0;
@@ -276,6 +550,16 @@ static int hb_denoise_init( hb_filter_object_t * filter,
     hqdn3d_precalc_coef(pv->hqdn3d_coef[4], pv->depth, spatial_chroma_r);
     hqdn3d_precalc_coef(pv->hqdn3d_coef[5], pv->depth, temporal_chroma_r);
 
+    hqdn3d_init_functions(&pv->functions, pv->depth);
+    pv->executor    = hb_executor_get();
+    // Stay within the job's thread budget, the executor is shared
+    pv->slice_count = pv->executor ?
+        MIN(hb_executor_thread_count(pv->executor),
+            hb_job_thread_count(init->job)) : 1;
+    // Each horizontal slice works on HQDN3D_BAND_HEIGHT lines of a band,
+    // so that a frame needs a few bands rather than one per 64 lines
+    pv->band_height = HQDN3D_BAND_HEIGHT * pv->slice_count;
+
     pv->output = *init;
 
     return 0;
@@ -301,6 +585,7 @@ static void hb_denoise_close(hb_filter_object_t * filter)
         free(pv->hqdn3d_line);
         pv->hqdn3d_line = NULL;
     }
+    free(pv->hqdn3d_band);
 	if (pv->hqdn3d_frame[0])
     {
         free(pv->hqdn3d_frame[0]);
@@ -335,7 +620,9 @@ static int hb_denoise_work(hb_filter_object_t *filter,
         return HB_FILTER_DONE;
     }
 
-    out = hb_frame_buffer_init(pv->output.pix_fmt, in->f.width, in->f.height);
+    // Each band is read before it is written and the temporal
+    // denoise reads and writes the same pixel, so this works in place
+    out = hb_filter_frame_output(filter, in, pv->output.pix_fmt);
     out->f.color_prim      = pv->output.color_prim;
     out->f.color_transfer  = pv->output.color_transfer;
     out->f.color_matrix    = pv->output.color_matrix;
@@ -346,15 +633,19 @@ static int hb_denoise_work(hb_filter_object_t *filter,
     {
         pv->hqdn3d_line = malloc(in->plane[0].stride * sizeof(uint16_t));
     }
+    if (!pv->hqdn3d_band)
+    {
+        pv->hqdn3d_band = malloc(in->plane[0].stride * pv->band_height * sizeof(int32_t));
+    }
 
     int c, coef_index;
 
     for (c = 0; c < 3; c++)
     {
         coef_index = c * 2;
-        hqdn3d_denoise(in->plane[c].data,
+        hqdn3d_denoise(pv,
+                       in->plane[c].data,
                        out->plane[c].data,
-                       pv->hqdn3d_line,
                        &pv->hqdn3d_frame[c],
                        AV_CEIL_RSHIFT(in->f.width, (!!c * pv->hsub)),
                        AV_CEIL_RSHIFT(in->f.height, (!!c * pv->vsub)),
@@ -364,7 +655,14 @@ static int hb_denoise_work(hb_filter_object_t *filter,
                        pv->hqdn3d_coef[coef_index+1]);
     }
 
-    hb_buffer_copy_props(out, in);
+    if (out == in)
+    {
+        *buf_in = NULL;
+    }
+    else
+    {
+        hb_buffer_copy_props(out, in);
+    }
     *buf_out = out;
 
     return HB_FILTER_OK;
@@ -127,6 +127,7 @@ hb_filter_object_t hb_filter_detelecine =
     .work              = hb_detelecine_work,
     .close             = hb_detelecine_close,
     .settings_template = detelecine_template,
+    .in_place          = 1,
 };
 
 /*
@@ -1244,7 +1245,9 @@ static int hb_detelecine_work( hb_filter_object_t * filter,
         pullup_pack_frame( ctx, frame );
     }
 
-    out = hb_frame_buffer_init(pv->output.pix_fmt, in->f.width, in->f.height);
+    /* The input was copied into the pullup buffers, so the
+       output can be written over it */
+    out = hb_filter_frame_output(filter, in, pv->output.pix_fmt);
     out->f.color_prim      = pv->output.color_prim;
     out->f.color_transfer  = pv->output.color_transfer;
     out->f.color_matrix    = pv->output.color_matrix;
@@ -1252,13 +1255,23 @@ static int hb_detelecine_work( hb_filter_object_t * filter,
     out->f.chroma_location = pv->output.chroma_location;
 
     /* Copy pullup frame buffer into output buffer */
-    memcpy( out->plane[0].data, frame->buffer->planes[0], frame->buffer->size[0] );
-    memcpy( out->plane[1].data, frame->buffer->planes[1], frame->buffer->size[1] );
-    memcpy( out->plane[2].data, frame->buffer->planes[2], frame->buffer->size[2] );
+    for (int pp = 0; pp < 3; pp++)
+    {
+        hb_image_copy_plane(out->plane[pp].data, frame->buffer->planes[pp],
+                            out->plane[pp].stride, ctx->stride[pp],
+                            out->plane[pp].height);
+    }
 
     pullup_release_frame( frame );
 
-    hb_buffer_copy_props(out, in);
+    if (out == in)
+    {
+        *buf_in = NULL;
+    }
+    else
+    {
+        hb_buffer_copy_props(out, in);
+    }
     *buf_out = out;
 
 output_frame:
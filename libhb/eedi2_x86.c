@@ -0,0 +1,549 @@
+/* eedi2_x86.c
+
+   Copyright (c) 2003-2026 HandBrake Team
+   This file is part of the HandBrake source code
+   Homepage: <http://handbrake.fr/>.
+   It may be used under the terms of the GNU General Public License v2.
+   For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
+ */
+
+#include "handbrake/handbrake.h"     // needed for ARCH_X86
+
+#if defined(ARCH_X86)
+
+#include <immintrin.h>
+
+#include "libavutil/cpu.h"
+#include "handbrake/eedi2.h"
+
+// The results must be identical to the C versions in
+// templates/eedi2_template.c.
+//
+// The direction search keeps one pixel per lane and walks the search
+// distance u in the same order as the C code, so ties resolve the same
+// way. 8 bit samples fit the search metrics in 16 bit lanes, higher bit
+// depths use 32 bit lanes.
+
+#define ABSDIFF16(a, b) _mm256_abs_epi16(_mm256_sub_epi16(a, b))
+#define ABSDIFF32(a, b) _mm256_abs_epi32(_mm256_sub_epi32(a, b))
+
+__attribute__((target("avx2")))
+static inline __m256i load16_u8(const uint8_t *p)
+{
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)p));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i load8_u16(const uint16_t *p)
+{
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)p));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i load8_u8(const uint8_t *p)
+{
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p));
+}
+
+// Sum of the absolute differences of a pixel and its horizontal
+// neighbours to the three pixels around p[offset]
+__attribute__((target("avx2")))
+static inline __m256i sad3_8(__m256i m1, __m256i c, __m256i p1,
+                             const uint8_t *p, int offset)
+{
+    return _mm256_add_epi16(_mm256_add_epi16(ABSDIFF16(m1, load16_u8(p + offset - 1)),
+                                             ABSDIFF16(c,  load16_u8(p + offset))),
+                            ABSDIFF16(p1, load16_u8(p + offset + 1)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i sad3_16(__m256i m1, __m256i c, __m256i p1,
+                              const uint16_t *p, int offset)
+{
+    return _mm256_add_epi32(_mm256_add_epi32(ABSDIFF32(m1, load8_u16(p + offset - 1)),
+                                             ABSDIFF32(c,  load8_u16(p + offset))),
+                            ABSDIFF32(p1, load8_u16(p + offset + 1)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i any_peak3_8(const uint8_t *p, int offset, __m256i peak)
+{
+    return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi16(load16_u8(p + offset - 1), peak),
+                                           _mm256_cmpeq_epi16(load16_u8(p + offset),     peak)),
+                           _mm256_cmpeq_epi16(load16_u8(p + offset + 1), peak));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i any_peak3_16(const uint16_t *p, int offset, __m256i peak)
+{
+    return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi32(load8_u16(p + offset - 1), peak),
+                                           _mm256_cmpeq_epi32(load8_u16(p + offset),     peak)),
+                           _mm256_cmpeq_epi32(load8_u16(p + offset + 1), peak));
+}
+
+// Keeps the first smallest metric and its direction
+#define UPDATE16(min, dir, diff)                                                    \
+    do {                                                                            \
+        const __m256i lt = _mm256_and_si256(gate, _mm256_cmpgt_epi16(min, diff));   \
+        min = _mm256_blendv_epi8(min, diff, lt);                                    \
+        dir = _mm256_blendv_epi8(dir, vu, lt);                                      \
+    } while (0)
+
+#define UPDATE32(min, dir, diff)                                                    \
+    do {                                                                            \
+        const __m256i lt = _mm256_and_si256(gate, _mm256_cmpgt_epi32(min, diff));   \
+        min = _mm256_blendv_epi8(min, diff, lt);                                    \
+        dir = _mm256_blendv_epi8(dir, vu, lt);                                      \
+    } while (0)
+
+__attribute__((target("avx2")))
+static void calc_directions_block_8_avx2(const uint8_t *mskpp, const uint8_t *mskpn,
+                                         const uint8_t *src2p, const uint8_t *srcpp, const uint8_t *srcp,
+                                         const uint8_t *srcpn, const uint8_t *src2n,
+                                         const int maxd, const int nt13, const int nt19,
+                                         const int top, const int bottom, const int depth,
+                                         int dirs[5][EEDI2_DIRECTIONS_BLOCK])
+{
+    const __m256i peak = _mm256_set1_epi16((1 << depth) - 1);
+
+    const __m256i s_m1  = load16_u8(srcp - 1),  s_0  = load16_u8(srcp),  s_p1  = load16_u8(srcp + 1);
+    const __m256i pp_m1 = load16_u8(srcpp - 1), pp_0 = load16_u8(srcpp), pp_p1 = load16_u8(srcpp + 1);
+    const __m256i pn_m1 = load16_u8(srcpn - 1), pn_0 = load16_u8(srcpn), pn_p1 = load16_u8(srcpn + 1);
+    __m256i p2_m1 = pp_m1, p2_0 = pp_0, p2_p1 = pp_p1;
+    __m256i n2_m1 = pn_m1, n2_0 = pn_0, n2_p1 = pn_p1;
+    if (!top)
+    {
+        p2_m1 = load16_u8(src2p - 1); p2_0 = load16_u8(src2p); p2_p1 = load16_u8(src2p + 1);
+    }
+    if (!bottom)
+    {
+        n2_m1 = load16_u8(src2n - 1); n2_0 = load16_u8(src2n); n2_p1 = load16_u8(src2n + 1);
+    }
+
+    const __m256i base = _mm256_add_epi16(ABSDIFF16(s_0, pn_0), ABSDIFF16(s_0, pp_0));
+    __m256i minb = _mm256_min_epi16(_mm256_set1_epi16(nt13), _mm256_mullo_epi16(base, _mm256_set1_epi16(6)));
+    __m256i mina = _mm256_min_epi16(_mm256_set1_epi16(nt19), _mm256_mullo_epi16(base, _mm256_set1_epi16(9)));
+    __m256i minc = mina, mind = minb, mine = minb;
+    __m256i dira = _mm256_set1_epi16(-5000);
+    __m256i dirb = dira, dirc = dira, dird = dira, dire = dira;
+
+    for (int u = -maxd; u <= maxd; u++)
+    {
+        __m256i gate = _mm256_set1_epi16(-1);
+        if (!top)
+        {
+            gate = any_peak3_8(mskpp, u, peak);
+        }
+        if (!bottom)
+        {
+            gate = _mm256_and_si256(gate, any_peak3_8(mskpn, -u, peak));
+        }
+        if (_mm256_testz_si256(gate, gate))
+        {
+            continue;
+        }
+
+        const __m256i vu = _mm256_set1_epi16(u);
+        const __m256i diffsn = sad3_8(s_m1,  s_0,  s_p1,  srcpn, -u);
+        const __m256i diffsp = sad3_8(s_m1,  s_0,  s_p1,  srcpp,  u);
+        const __m256i diffps = sad3_8(pp_m1, pp_0, pp_p1, srcp,  -u);
+        const __m256i diffns = sad3_8(pn_m1, pn_0, pn_p1, srcp,   u);
+        const __m256i diff   = _mm256_add_epi16(_mm256_add_epi16(diffsn, diffsp),
+                                                _mm256_add_epi16(diffps, diffns));
+        __m256i diffd = _mm256_add_epi16(diffsp, diffns);
+        __m256i diffe = _mm256_add_epi16(diffsn, diffps);
+        UPDATE16(minb, dirb, diff);
+
+        if (!top)
+        {
+            const __m256i diff2pp = sad3_8(p2_m1, p2_0, p2_p1, srcpp, -u);
+            const __m256i diffp2p = sad3_8(pp_m1, pp_0, pp_p1, src2p,  u);
+            const __m256i diffa   = _mm256_add_epi16(diff, _mm256_add_epi16(diff2pp, diffp2p));
+            diffd = _mm256_add_epi16(diffd, diffp2p);
+            diffe = _mm256_add_epi16(diffe, diff2pp);
+            UPDATE16(mina, dira, diffa);
+        }
+        if (!bottom)
+        {
+            const __m256i diff2nn = sad3_8(n2_m1, n2_0, n2_p1, srcpn,  u);
+            const __m256i diffn2n = sad3_8(pn_m1, pn_0, pn_p1, src2n, -u);
+            const __m256i diffc   = _mm256_add_epi16(diff, _mm256_add_epi16(diff2nn, diffn2n));
+            diffd = _mm256_add_epi16(diffd, diff2nn);
+            diffe = _mm256_add_epi16(diffe, diffn2n);
+            UPDATE16(minc, dirc, diffc);
+        }
+        UPDATE16(mind, dird, diffd);
+        UPDATE16(mine, dire, diffe);
+    }
+
+    const __m256i dir[5] = { dira, dirb, dirc, dird, dire };
+    for (int k = 0; k < 5; k++)
+    {
+        _mm256_storeu_si256((__m256i *)&dirs[k][0],
+                            _mm256_cvtepi16_epi32(_mm256_castsi256_si128(dir[k])));
+        _mm256_storeu_si256((__m256i *)&dirs[k][8],
+                            _mm256_cvtepi16_epi32(_mm256_extracti128_si256(dir[k], 1)));
+    }
+}
+
+__attribute__((target("avx2")))
+static void calc_directions_8px_16_avx2(const uint16_t *mskpp, const uint16_t *mskpn,
+                                        const uint16_t *src2p, const uint16_t *srcpp, const uint16_t *srcp,
+                                        const uint16_t *srcpn, const uint16_t *src2n,
+                                        const int maxd, const int nt13, const int nt19,
+                                        const int top, const int bottom, const int depth,
+                                        int dirs[5][EEDI2_DIRECTIONS_BLOCK], const int lane)
+{
+    const __m256i peak = _mm256_set1_epi32((1 << depth) - 1);
+
+    const __m256i s_m1  = load8_u16(srcp - 1),  s_0  = load8_u16(srcp),  s_p1  = load8_u16(srcp + 1);
+    const __m256i pp_m1 = load8_u16(srcpp - 1), pp_0 = load8_u16(srcpp), pp_p1 = load8_u16(srcpp + 1);
+    const __m256i pn_m1 = load8_u16(srcpn - 1), pn_0 = load8_u16(srcpn), pn_p1 = load8_u16(srcpn + 1);
+    __m256i p2_m1 = pp_m1, p2_0 = pp_0, p2_p1 = pp_p1;
+    __m256i n2_m1 = pn_m1, n2_0 = pn_0, n2_p1 = pn_p1;
+    if (!top)
+    {
+        p2_m1 = load8_u16(src2p - 1); p2_0 = load8_u16(src2p); p2_p1 = load8_u16(src2p + 1);
+    }
+    if (!bottom)
+    {
+        n2_m1 = load8_u16(src2n - 1); n2_0 = load8_u16(src2n); n2_p1 = load8_u16(src2n + 1);
+    }
+
+    const __m256i base = _mm256_add_epi32(ABSDIFF32(s_0, pn_0), ABSDIFF32(s_0, pp_0));
+    __m256i minb = _mm256_min_epi32(_mm256_set1_epi32(nt13), _mm256_mullo_epi32(base, _mm256_set1_epi32(6)));
+    __m256i mina = _mm256_min_epi32(_mm256_set1_epi32(nt19), _mm256_mullo_epi32(base, _mm256_set1_epi32(9)));
+    __m256i minc = mina, mind = minb, mine = minb;
+    __m256i dira = _mm256_set1_epi32(-5000);
+    __m256i dirb = dira, dirc = dira, dird = dira, dire = dira;
+
+    for (int u = -maxd; u <= maxd; u++)
+    {
+        __m256i gate = _mm256_set1_epi32(-1);
+        if (!top)
+        {
+            gate = any_peak3_16(mskpp, u, peak);
+        }
+        if (!bottom)
+        {
+            gate = _mm256_and_si256(gate, any_peak3_16(mskpn, -u, peak));
+        }
+        if (_mm256_testz_si256(gate, gate))
+        {
+            continue;
+        }
+
+        const __m256i vu = _mm256_set1_epi32(u);
+        const __m256i diffsn = sad3_16(s_m1,  s_0,  s_p1,  srcpn, -u);
+        const __m256i diffsp = sad3_16(s_m1,  s_0,  s_p1,  srcpp,  u);
+        const __m256i diffps = sad3_16(pp_m1, pp_0, pp_p1, srcp,  -u);
+        const __m256i diffns = sad3_16(pn_m1, pn_0, pn_p1, srcp,   u);
+        const __m256i diff   = _mm256_add_epi32(_mm256_add_epi32(diffsn, diffsp),
+                                                _mm256_add_epi32(diffps, diffns));
+        __m256i diffd = _mm256_add_epi32(diffsp, diffns);
+        __m256i diffe = _mm256_add_epi32(diffsn, diffps);
+        UPDATE32(minb, dirb, diff);
+
+        if (!top)
+        {
+            const __m256i diff2pp = sad3_16(p2_m1, p2_0, p2_p1, srcpp, -u);
+            const __m256i diffp2p = sad3_16(pp_m1, pp_0, pp_p1, src2p,  u);
+            const __m256i diffa   = _mm256_add_epi32(diff, _mm256_add_epi32(diff2pp, diffp2p));
+            diffd = _mm256_add_epi32(diffd, diffp2p);
+            diffe = _mm256_add_epi32(diffe, diff2pp);
+            UPDATE32(mina, dira, diffa);
+        }
+        if (!bottom)
+        {
+            const __m256i diff2nn = sad3_16(n2_m1, n2_0, n2_p1, srcpn,  u);
+            const __m256i diffn2n = sad3_16(pn_m1, pn_0, pn_p1, src2n, -u);
+            const __m256i diffc   = _mm256_add_epi32(diff, _mm256_add_epi32(diff2nn, diffn2n));
+            diffd = _mm256_add_epi32(diffd, diff2nn);
+            diffe = _mm256_add_epi32(diffe, diffn2n);
+            UPDATE32(minc, dirc, diffc);
+        }
+        UPDATE32(mind, dird, diffd);
+        UPDATE32(mine, dire, diffe);
+    }
+
+    _mm256_storeu_si256((__m256i *)&dirs[0][lane], dira);
+    _mm256_storeu_si256((__m256i *)&dirs[1][lane], dirb);
+    _mm256_storeu_si256((__m256i *)&dirs[2][lane], dirc);
+    _mm256_storeu_si256((__m256i *)&dirs[3][lane], dird);
+    _mm256_storeu_si256((__m256i *)&dirs[4][lane], dire);
+}
+
+__attribute__((target("avx2")))
+static void calc_directions_block_16_avx2(const uint16_t *mskpp, const uint16_t *mskpn,
+                                          const uint16_t *src2p, const uint16_t *srcpp, const uint16_t *srcp,
+                                          const uint16_t *srcpn, const uint16_t *src2n,
+                                          const int maxd, const int nt13, const int nt19,
+                                          const int top, const int bottom, const int depth,
+                                          int dirs[5][EEDI2_DIRECTIONS_BLOCK])
+{
+    for (int lane = 0; lane < EEDI2_DIRECTIONS_BLOCK; lane += 8)
+    {
+        calc_directions_8px_16_avx2(mskpp + lane, mskpn + lane, src2p + lane, srcpp + lane,
+                                    srcp + lane, srcpn + lane, src2n + lane, maxd, nt13, nt19,
+                                    top, bottom, depth, dirs, lane);
+    }
+}
+
+#undef UPDATE32
+#undef UPDATE16
+
+// mthresh and vthresh are already scaled by the caller. The sums and
+// products are done on samples shifted down to 8 bits, so 32 bit lanes
+// are enough for every bit depth.
+__attribute__((target("avx2")))
+static inline __m256i build_edge_mask_8px_avx2(__m256i pm1, __m256i p0, __m256i pp1,
+                                               __m256i cm1, __m256i c0, __m256i cp1,
+                                               __m256i nm1, __m256i n0, __m256i np1,
+                                               const int mthresh, const int lthresh,
+                                               const int vthresh, const int depth)
+{
+    const __m128i shift = _mm_cvtsi32_si128(depth - 8);
+    const __m256i ten   = _mm256_set1_epi32(10 << (depth - 8));
+
+#define FLAT(a, b, c) _mm256_and_si256(_mm256_and_si256(                   \
+                          _mm256_cmpgt_epi32(ten, ABSDIFF32(a, b)),         \
+                          _mm256_cmpgt_epi32(ten, ABSDIFF32(b, c))),        \
+                          _mm256_cmpgt_epi32(ten, ABSDIFF32(a, c)))
+#define SQ(v) _mm256_mullo_epi32(_mm256_srl_epi32(v, shift), _mm256_srl_epi32(v, shift))
+
+    __m256i skip = _mm256_or_si256(FLAT(p0, c0, n0),
+                                   _mm256_and_si256(FLAT(pm1, cm1, nm1), FLAT(pp1, cp1, np1)));
+    if (_mm256_testc_si256(skip, _mm256_set1_epi32(-1)))
+    {
+        return _mm256_setzero_si256();
+    }
+
+    __m256i sum = _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(pm1, p0), pp1),
+                                   _mm256_add_epi32(_mm256_add_epi32(cm1, c0), cp1));
+    sum = _mm256_add_epi32(sum, _mm256_add_epi32(_mm256_add_epi32(nm1, n0), np1));
+    sum = _mm256_srl_epi32(sum, shift);
+
+    __m256i sumsq = _mm256_add_epi32(_mm256_add_epi32(SQ(pm1), SQ(p0)), SQ(pp1));
+    sumsq = _mm256_add_epi32(sumsq, _mm256_add_epi32(_mm256_add_epi32(SQ(cm1), SQ(c0)), SQ(cp1)));
+    sumsq = _mm256_add_epi32(sumsq, _mm256_add_epi32(_mm256_add_epi32(SQ(nm1), SQ(n0)), SQ(np1)));
+
+    const __m256i variance = _mm256_sub_epi32(_mm256_mullo_epi32(sumsq, _mm256_set1_epi32(9)),
+                                              _mm256_mullo_epi32(sum, sum));
+    skip = _mm256_or_si256(skip, _mm256_cmpgt_epi32(_mm256_set1_epi32(vthresh), variance));
+
+    const __m256i ix = _mm256_sra_epi32(_mm256_sub_epi32(cp1, cm1), shift);
+    const __m256i iy = _mm256_srl_epi32(_mm256_max_epi32(_mm256_max_epi32(ABSDIFF32(p0, n0),
+                                                                          ABSDIFF32(p0, c0)),
+                                                         ABSDIFF32(c0, n0)), shift);
+    const __m256i gradient = _mm256_add_epi32(_mm256_mullo_epi32(ix, ix), _mm256_mullo_epi32(iy, iy));
+
+    const __m256i c2  = _mm256_add_epi32(c0, c0);
+    const __m256i ixx = _mm256_sra_epi32(_mm256_add_epi32(_mm256_sub_epi32(cm1, c2), cp1), shift);
+    const __m256i iyy = _mm256_sra_epi32(_mm256_add_epi32(_mm256_sub_epi32(p0, c2), n0), shift);
+    const __m256i laplacian = _mm256_add_epi32(_mm256_abs_epi32(ixx), _mm256_abs_epi32(iyy));
+
+    // gradient >= mthresh || laplacian >= lthresh
+    const __m256i edge = _mm256_andnot_si256(
+        _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(mthresh), gradient),
+                         _mm256_cmpgt_epi32(_mm256_set1_epi32(lthresh), laplacian)),
+        _mm256_set1_epi32(-1));
+
+#undef SQ
+#undef FLAT
+
+    return _mm256_andnot_si256(skip, edge);
+}
+
+// Narrows a 32 bit lane mask to 16 bits per lane
+__attribute__((target("avx2")))
+static inline __m128i narrow_mask_avx2(__m256i mask)
+{
+    return _mm_packs_epi32(_mm256_castsi256_si128(mask), _mm256_extracti128_si256(mask, 1));
+}
+
+__attribute__((target("avx2")))
+static int build_edge_mask_row_8_avx2(uint8_t *dstp, const uint8_t *srcpp, const uint8_t *srcp,
+                                      const uint8_t *srcpn, const int width, const int mthresh,
+                                      const int lthresh, const int vthresh, const int depth)
+{
+    const __m128i peak = _mm_set1_epi8((1 << depth) - 1);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8)
+    {
+        const __m256i edge = build_edge_mask_8px_avx2(
+            load8_u8(srcpp + x - 1), load8_u8(srcpp + x), load8_u8(srcpp + x + 1),
+            load8_u8(srcp  + x - 1), load8_u8(srcp  + x), load8_u8(srcp  + x + 1),
+            load8_u8(srcpn + x - 1), load8_u8(srcpn + x), load8_u8(srcpn + x + 1),
+            mthresh, lthresh, vthresh, depth);
+        if (!_mm256_testz_si256(edge, edge))
+        {
+            const __m128i m16 = narrow_mask_avx2(edge);
+            const __m128i m8  = _mm_packs_epi16(m16, m16);
+            const __m128i d   = _mm_loadl_epi64((const __m128i *)(dstp + x));
+            _mm_storel_epi64((__m128i *)(dstp + x), _mm_blendv_epi8(d, peak, m8));
+        }
+    }
+
+    return x;
+}
+
+__attribute__((target("avx2")))
+static int build_edge_mask_row_16_avx2(uint16_t *dstp, const uint16_t *srcpp, const uint16_t *srcp,
+                                       const uint16_t *srcpn, const int width, const int mthresh,
+                                       const int lthresh, const int vthresh, const int depth)
+{
+    const __m128i peak = _mm_set1_epi16((1 << depth) - 1);
+    int x = 0;
+
+    for (; x + 8 <= width; x += 8)
+    {
+        const __m256i edge = build_edge_mask_8px_avx2(
+            load8_u16(srcpp + x - 1), load8_u16(srcpp + x), load8_u16(srcpp + x + 1),
+            load8_u16(srcp  + x - 1), load8_u16(srcp  + x), load8_u16(srcp  + x + 1),
+            load8_u16(srcpn + x - 1), load8_u16(srcpn + x), load8_u16(srcpn + x + 1),
+            mthresh, lthresh, vthresh, depth);
+        if (!_mm256_testz_si256(edge, edge))
+        {
+            const __m128i d = _mm_loadu_si128((const __m128i *)(dstp + x));
+            _mm_storeu_si128((__m128i *)(dstp + x), _mm_blendv_epi8(d, peak, narrow_mask_avx2(edge)));
+        }
+    }
+
+    return x;
+}
+
+// The neighbour count is at most 8, so the thresholds are clipped to
+// -1..8 to fit the lanes without changing the comparisons
+static inline int clip_count_threshold(int threshold)
+{
+    return threshold < -1 ? -1 : threshold > 8 ? 8 : threshold;
+}
+
+#define COUNT_PEAK8(count, p)  count = _mm256_sub_epi8(count,  _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p)), peak))
+#define COUNT_PEAK16(count, p) count = _mm256_sub_epi16(count, _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(p)), peak))
+
+#define NEIGHBOUR_COUNT(COUNT_PEAK, count, x)   \
+    COUNT_PEAK(count, mskpp + x - 1);           \
+    COUNT_PEAK(count, mskpp + x);               \
+    COUNT_PEAK(count, mskpp + x + 1);           \
+    COUNT_PEAK(count, mskp  + x - 1);           \
+    COUNT_PEAK(count, mskp  + x + 1);           \
+    COUNT_PEAK(count, mskpn + x - 1);           \
+    COUNT_PEAK(count, mskpn + x);               \
+    COUNT_PEAK(count, mskpn + x + 1)
+
+__attribute__((target("avx2")))
+static int dilate_edge_mask_row_8_avx2(const uint8_t *mskpp, const uint8_t *mskp, const uint8_t *mskpn,
+                                       uint8_t *dstp, const int width, const int dstr, const int depth)
+{
+    const __m256i peak      = _mm256_set1_epi8((1 << depth) - 1);
+    const __m256i threshold = _mm256_set1_epi8(clip_count_threshold(dstr - 1));
+    int x = 0;
+
+    for (; x + 32 <= width; x += 32)
+    {
+        __m256i count = _mm256_setzero_si256();
+        NEIGHBOUR_COUNT(COUNT_PEAK8, count, x);
+
+        const __m256i set = _mm256_and_si256(
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(mskp + x)), _mm256_setzero_si256()),
+            _mm256_cmpgt_epi8(count, threshold));
+        const __m256i d = _mm256_loadu_si256((const __m256i *)(dstp + x));
+        _mm256_storeu_si256((__m256i *)(dstp + x), _mm256_blendv_epi8(d, peak, set));
+    }
+
+    return x;
+}
+
+__attribute__((target("avx2")))
+static int dilate_edge_mask_row_16_avx2(const uint16_t *mskpp, const uint16_t *mskp, const uint16_t *mskpn,
+                                        uint16_t *dstp, const int width, const int dstr, const int depth)
+{
+    const __m256i peak      = _mm256_set1_epi16((1 << depth) - 1);
+    const __m256i threshold = _mm256_set1_epi16(clip_count_threshold(dstr - 1));
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i count = _mm256_setzero_si256();
+        NEIGHBOUR_COUNT(COUNT_PEAK16, count, x);
+
+        const __m256i set = _mm256_and_si256(
+            _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(mskp + x)), _mm256_setzero_si256()),
+            _mm256_cmpgt_epi16(count, threshold));
+        const __m256i d = _mm256_loadu_si256((const __m256i *)(dstp + x));
+        _mm256_storeu_si256((__m256i *)(dstp + x), _mm256_blendv_epi8(d, peak, set));
+    }
+
+    return x;
+}
+
+__attribute__((target("avx2")))
+static int erode_edge_mask_row_8_avx2(const uint8_t *mskpp, const uint8_t *mskp, const uint8_t *mskpn,
+                                      uint8_t *dstp, const int width, const int estr, const int depth)
+{
+    const __m256i peak      = _mm256_set1_epi8((1 << depth) - 1);
+    const __m256i threshold = _mm256_set1_epi8(clip_count_threshold(estr - 1));
+    int x = 0;
+
+    for (; x + 32 <= width; x += 32)
+    {
+        __m256i count = _mm256_setzero_si256();
+        NEIGHBOUR_COUNT(COUNT_PEAK8, count, x);
+
+        const __m256i clear = _mm256_andnot_si256(
+            _mm256_cmpgt_epi8(count, threshold),
+            _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(mskp + x)), peak));
+        const __m256i d = _mm256_loadu_si256((const __m256i *)(dstp + x));
+        _mm256_storeu_si256((__m256i *)(dstp + x), _mm256_andnot_si256(clear, d));
+    }
+
+    return x;
+}
+
+__attribute__((target("avx2")))
+static int erode_edge_mask_row_16_avx2(const uint16_t *mskpp, const uint16_t *mskp, const uint16_t *mskpn,
+                                       uint16_t *dstp, const int width, const int estr, const int depth)
+{
+    const __m256i peak      = _mm256_set1_epi16((1 << depth) - 1);
+    const __m256i threshold = _mm256_set1_epi16(clip_count_threshold(estr - 1));
+    int x = 0;
+
+    for (; x + 16 <= width; x += 16)
+    {
+        __m256i count = _mm256_setzero_si256();
+        NEIGHBOUR_COUNT(COUNT_PEAK16, count, x);
+
+        const __m256i clear = _mm256_andnot_si256(
+            _mm256_cmpgt_epi16(count, threshold),
+            _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(mskp + x)), peak));
+        const __m256i d = _mm256_loadu_si256((const __m256i *)(dstp + x));
+        _mm256_storeu_si256((__m256i *)(dstp + x), _mm256_andnot_si256(clear, d));
+    }
+
+    return x;
+}
+
+#undef NEIGHBOUR_COUNT
+#undef COUNT_PEAK16
+#undef COUNT_PEAK8
+
+void eedi2_init_x86(EEDI2Functions *functions)
+{
+    const int cpu_flags = av_get_cpu_flags();
+
+    if (cpu_flags & AV_CPU_FLAG_AVX2)
+    {
+        functions->build_edge_mask_row_8    = build_edge_mask_row_8_avx2;
+        functions->build_edge_mask_row_16   = build_edge_mask_row_16_avx2;
+        functions->dilate_edge_mask_row_8   = dilate_edge_mask_row_8_avx2;
+        functions->dilate_edge_mask_row_16  = dilate_edge_mask_row_16_avx2;
+        functions->erode_edge_mask_row_8    = erode_edge_mask_row_8_avx2;
+        functions->erode_edge_mask_row_16   = erode_edge_mask_row_16_avx2;
+        functions->calc_directions_block_8  = calc_directions_block_8_avx2;
+        functions->calc_directions_block_16 = calc_directions_block_16_avx2;
+    }
+}
+
+#endif // ARCH_X86
@@ -1435,7 +1435,9 @@ int encavcodecInit( hb_work_object_t * w, hb_job_t * job )
         }
     }
 
-    if (hb_avcodec_open(context, codec, &av_opts, HB_FFMPEG_THREADS_AUTO))
+    if (hb_avcodec_open(context, codec, &av_opts,
+                        job->thread_count > 0 ? hb_job_thread_count(job) :
+                                                HB_FFMPEG_THREADS_AUTO))
     {
         hb_log( "encavcodecInit: avcodec_open failed" );
         ret = 1;
@@ -0,0 +1,487 @@
+/* encsegment.c
+
+   Copyright (c) 2003-2026 HandBrake Team
+   This file is part of the HandBrake source code
+   Homepage: <http://handbrake.fr/>.
+   It may be used under the terms of the GNU General Public License v2.
+   For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
+ */
+
+/* Segmented video encoding
+ *
+ * Encoders like SVT-AV1 at small resolutions, the slower x264 presets or
+ * libvpx don't keep a many-core machine busy on their own. This work
+ * object cuts the filtered video into segments of SEGMENT_DURATION and
+ * hands them round robin to several instances of the job's encoder, each
+ * running on its own thread. Every segment starts with a forced key frame
+ * so that it doesn't reference any other segment, and the encoded
+ * segments are joined back in order before they go to the muxer. Audio
+ * and subtitles are still encoded once by their own work objects.
+ */
+
+#include "handbrake/handbrake.h"
+
+#define SEGMENT_DURATION (2 * 90000)
+
+int  encsegmentInit(hb_work_object_t *, hb_job_t *);
+int  encsegmentWork(hb_work_object_t *, hb_buffer_t **, hb_buffer_t **);
+void encsegmentClose(hb_work_object_t *);
+
+hb_work_object_t hb_encsegment =
+{
+    WORK_ENCSEGMENT,
+    "Segmented video encoder",
+    encsegmentInit,
+    encsegmentWork,
+    encsegmentClose
+};
+
+// Number of encoder instances, see hb_set_segment_encoders()
+static int segment_encoders = 0;
+
+// hb_set_segment_encoders must only be called when no job is running
+void hb_set_segment_encoders( int count )
+{
+    segment_encoders = count > 1 ? count : 0;
+}
+
+typedef struct segment_s segment_t;
+
+struct segment_s
+{
+    int64_t     start;      // start of the first frame
+    int64_t     stop;       // start of the next segment, INT64_MAX if open
+    int         chapter;    // chapter mark of the first frame
+    int         encoder;
+    int64_t     first_dts;  // first decode timestamp from its encoder
+    segment_t * next;
+};
+
+typedef struct
+{
+    hb_work_private_t * pv;
+    hb_work_object_t  * encoder;
+
+    // Private copy of the job that makes the encoder honour key frame
+    // requests, see segment_queue()
+    hb_job_t            job;
+    int                 init_delay;
+    hb_data_t         * extradata;
+
+    hb_thread_t       * thread;
+    hb_buffer_list_t    in;
+    hb_buffer_list_t    out;
+    int                 done;       // encoder flushed, out is complete
+} segment_encoder_t;
+
+struct hb_work_private_s
+{
+    hb_job_t          * job;
+
+    hb_lock_t         * lock;
+    hb_cond_t         * cond;
+    int                 die;
+
+    int                 count;
+    segment_encoder_t * encoders;
+    int                 queue_max;
+
+    segment_t         * first;      // oldest segment not yet output
+    segment_t         * last;       // segment receiving frames
+    int                 segments;
+
+    int64_t             last_dts;
+};
+
+int hb_segment_encoding_supported( hb_job_t * job )
+{
+    if (segment_encoders < 2 || job->indepth_scan ||
+        job->pass_id != HB_PASS_ENCODE)
+    {
+        return 0;
+    }
+    // Constant quality only, rate control can't be shared by independent
+    // encoders. SVT-AV1 only accepts key frame requests in CRF mode.
+    if (job->vquality <= HB_INVALID_VIDEO_QUALITY)
+    {
+        return 0;
+    }
+    // Software encoders that turn a chapter mark into a key frame
+    switch (job->vcodec)
+    {
+        case HB_VCODEC_X264_8BIT:
+        case HB_VCODEC_X264_10BIT:
+        case HB_VCODEC_X265_8BIT:
+        case HB_VCODEC_X265_10BIT:
+        case HB_VCODEC_X265_12BIT:
+        case HB_VCODEC_X265_16BIT:
+        case HB_VCODEC_SVT_AV1_8BIT:
+        case HB_VCODEC_SVT_AV1_10BIT:
+        case HB_VCODEC_FFMPEG_VP8:
+        case HB_VCODEC_FFMPEG_VP9:
+        case HB_VCODEC_FFMPEG_VP9_10BIT:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static void segment_encoder_thread( void * data )
+{
+    segment_encoder_t * enc = data;
+    hb_work_private_t * pv  = enc->pv;
+
+    hb_lock(pv->lock);
+    while (!pv->die && !enc->done)
+    {
+        hb_buffer_t * in = hb_buffer_list_rem_head(&enc->in);
+        if (in == NULL)
+        {
+            hb_cond_wait(pv->cond, pv->lock);
+            continue;
+        }
+        // Wake the dispatcher if it is waiting for room
+        hb_cond_broadcast(pv->cond);
+        hb_unlock(pv->lock);
+
+        hb_buffer_t      * out = NULL, * buf;
+        hb_buffer_list_t   list;
+        int                eof = !!(in->s.flags & HB_BUF_FLAG_EOF);
+
+        enc->encoder->work(enc->encoder, &in, &out);
+        hb_buffer_close(&in);
+
+        // The encoders pass their EOF through, the joined stream gets
+        // the job's EOF instead
+        hb_buffer_list_set(&list, out);
+        out = NULL;
+        hb_lock(pv->lock);
+        while ((buf = hb_buffer_list_rem_head(&list)) != NULL)
+        {
+            if (buf->s.flags & HB_BUF_FLAG_EOF)
+            {
+                hb_buffer_close(&buf);
+                continue;
+            }
+            hb_buffer_list_append(&enc->out, buf);
+        }
+        enc->done = eof;
+        hb_cond_broadcast(pv->cond);
+    }
+    hb_unlock(pv->lock);
+}
+
+static void segment_encoder_push( hb_work_private_t * pv,
+                                  segment_encoder_t * enc, hb_buffer_t * buf )
+{
+    hb_lock(pv->lock);
+    while (!(buf->s.flags & HB_BUF_FLAG_EOF) &&
+           hb_buffer_list_count(&enc->in) >= pv->queue_max)
+    {
+        hb_cond_wait(pv->cond, pv->lock);
+    }
+    hb_buffer_list_append(&enc->in, buf);
+    hb_cond_broadcast(pv->cond);
+    hb_unlock(pv->lock);
+}
+
+int encsegmentInit( hb_work_object_t * w, hb_job_t * job )
+{
+    hb_work_private_t * pv = calloc(1, sizeof(hb_work_private_t));
+    int                 ii, frames;
+
+    if (pv == NULL)
+    {
+        return 1;
+    }
+    w->private_data = pv;
+
+    pv->job      = job;
+    pv->lock     = hb_lock_init();
+    pv->cond     = hb_cond_init();
+    pv->last_dts = AV_NOPTS_VALUE;
+    pv->count    = segment_encoders;
+    pv->encoders = calloc(pv->count, sizeof(segment_encoder_t));
+    if (pv->encoders == NULL)
+    {
+        goto fail;
+    }
+
+    // Room for a whole segment per encoder, so that the dispatcher can go
+    // on to the next encoder while this one works through its segment
+    frames = (int64_t)SEGMENT_DURATION * job->vrate.num /
+             ((int64_t)job->vrate.den * 90000);
+    pv->queue_max = MAX(frames, 1) + 1;
+
+    for (ii = 0; ii < pv->count; ii++)
+    {
+        segment_encoder_t * enc = &pv->encoders[ii];
+
+        enc->pv                = pv;
+        enc->job               = *job;
+        enc->job.chapter_markers = 1;
+        // Share the job's threads between the instances rather than
+        // have each one use the whole machine
+        enc->job.thread_count  = MAX(hb_job_thread_count(job) / pv->count, 1);
+        enc->encoder           = hb_video_encoder(job->h, job->vcodec);
+        if (enc->encoder == NULL)
+        {
+            goto fail;
+        }
+        enc->encoder->done = w->done;
+        // The first instance provides the stream headers
+        if (ii == 0)
+        {
+            enc->encoder->init_delay = w->init_delay;
+            enc->encoder->extradata  = w->extradata;
+        }
+        else
+        {
+            enc->encoder->init_delay = &enc->init_delay;
+            enc->encoder->extradata  = &enc->extradata;
+        }
+        if (enc->encoder->init(enc->encoder, &enc->job))
+        {
+            hb_error("encsegment: failure to initialise %s",
+                     enc->encoder->name);
+            goto fail;
+        }
+        if (ii == 0)
+        {
+            // Publish what the encoder negotiated during init (B-frames,
+            // color overrides, ...) the way a single encoder would have
+            int chapter_markers = job->chapter_markers;
+            int thread_count    = job->thread_count;
+            *job = enc->job;
+            job->chapter_markers = chapter_markers;
+            job->thread_count    = thread_count;
+        }
+    }
+
+    for (ii = 0; ii < pv->count; ii++)
+    {
+        segment_encoder_t * enc = &pv->encoders[ii];
+        enc->thread = hb_thread_init("segment encoder", segment_encoder_thread,
+                                     enc, HB_LOW_PRIORITY);
+    }
+
+    hb_log("encsegment: %d %s instances of %d threads, %d second segments",
+           pv->count, pv->encoders[0].encoder->name,
+           pv->encoders[0].job.thread_count, SEGMENT_DURATION / 90000);
+
+    return 0;
+
+fail:
+    // Close the instances already initialized
+    encsegmentClose(w);
+    return 1;
+}
+
+void encsegmentClose( hb_work_object_t * w )
+{
+    hb_work_private_t * pv = w->private_data;
+    int                 ii;
+
+    if (pv == NULL)
+    {
+        return;
+    }
+
+    hb_lock(pv->lock);
+    pv->die = 1;
+    hb_cond_broadcast(pv->cond);
+    hb_unlock(pv->lock);
+
+    for (ii = 0; pv->encoders != NULL && ii < pv->count; ii++)
+    {
+        segment_encoder_t * enc = &pv->encoders[ii];
+
+        if (enc->thread != NULL)
+        {
+            hb_thread_close(&enc->thread);
+        }
+        if (enc->encoder != NULL)
+        {
+            enc->encoder->close(enc->encoder);
+            free(enc->encoder);
+        }
+        hb_buffer_list_close(&enc->in);
+        hb_buffer_list_close(&enc->out);
+        hb_data_close(&enc->extradata);
+    }
+    while (pv->first != NULL)
+    {
+        segment_t * seg = pv->first;
+        pv->first = seg->next;
+        free(seg);
+    }
+
+    hb_cond_close(&pv->cond);
+    hb_lock_close(&pv->lock);
+    free(pv->encoders);
+    free(pv);
+    w->private_data = NULL;
+}
+
+/***********************************************************************
+ * segment_queue
+ ***********************************************************************
+ * Start a new segment once the current one is long enough and hand the
+ * frame to the encoder of its segment. Segment starts are marked like
+ * chapter starts so that the encoder codes them as key frames.
+ **********************************************************************/
+static void segment_queue( hb_work_private_t * pv, hb_buffer_t * in )
+{
+    segment_t * seg = pv->last;
+
+    if (seg == NULL || in->s.start >= seg->start + SEGMENT_DURATION)
+    {
+        segment_t * next = calloc(1, sizeof(segment_t));
+
+        next->start   = in->s.start;
+        next->stop    = INT64_MAX;
+        next->chapter = pv->job->chapter_markers ? in->s.new_chap : 0;
+        next->encoder = pv->segments++ % pv->count;
+        next->first_dts = AV_NOPTS_VALUE;
+
+        hb_lock(pv->lock);
+        if (seg != NULL)
+        {
+            seg->stop = in->s.start;
+            seg->next = next;
+        }
+        if (pv->first == NULL)
+        {
+            pv->first = next;
+        }
+        pv->last = seg = next;
+        hb_unlock(pv->lock);
+
+        if (in->s.new_chap <= 0)
+        {
+            in->s.new_chap = 1;
+        }
+    }
+    else if (!pv->job->chapter_markers)
+    {
+        // The encoders always honour chapter marks, see encsegmentInit()
+        in->s.new_chap = 0;
+    }
+
+    segment_encoder_push(pv, &pv->encoders[seg->encoder], in);
+}
+
+static void segment_output( hb_work_private_t * pv, segment_t * seg,
+                            hb_buffer_t * buf, hb_buffer_list_t * list )
+{
+    // Drop the marks of key frames that were only requested to start
+    // a segment
+    if (buf->s.start == seg->start)
+    {
+        buf->s.new_chap = seg->chapter;
+    }
+    if (buf->s.renderOffset != AV_NOPTS_VALUE)
+    {
+        int init_delay = *pv->encoders[seg->encoder].encoder->init_delay;
+
+        // An instance derives the decode timestamps of the first packets
+        // of a segment from the frames it encoded before, which belong to
+        // one of its earlier segments. Rebase them to the start of this
+        // segment, where a fresh encoder would have put them.
+        if (seg->first_dts == AV_NOPTS_VALUE)
+        {
+            seg->first_dts = buf->s.renderOffset;
+        }
+        if (buf->s.renderOffset < seg->start)
+        {
+            buf->s.renderOffset = MIN(seg->start - init_delay +
+                                      buf->s.renderOffset - seg->first_dts,
+                                      buf->s.start);
+        }
+        // Last resort, keep them increasing where segments meet
+        if (pv->last_dts != AV_NOPTS_VALUE &&
+            buf->s.renderOffset <= pv->last_dts)
+        {
+            buf->s.renderOffset = pv->last_dts + 1;
+        }
+        pv->last_dts = buf->s.renderOffset;
+    }
+    hb_buffer_list_append(list, buf);
+}
+
+/***********************************************************************
+ * segment_join
+ ***********************************************************************
+ * Move the packets of segments to list in segment order. An encoder
+ * emits the packets of one segment before those of its next one, so a
+ * segment is complete once its encoder has produced a packet that starts
+ * at or after the segment's stop, or has been flushed. Waits for the
+ * encoders when 'wait' is set, otherwise stops at the first segment that
+ * isn't complete yet.
+ **********************************************************************/
+static void segment_join( hb_work_private_t * pv, hb_buffer_list_t * list,
+                          int wait )
+{
+    hb_lock(pv->lock);
+    while (pv->first != NULL)
+    {
+        segment_t         * seg = pv->first;
+        segment_encoder_t * enc = &pv->encoders[seg->encoder];
+        hb_buffer_t       * buf;
+
+        while ((buf = hb_buffer_list_head(&enc->out)) != NULL &&
+               buf->s.start < seg->stop)
+        {
+            hb_buffer_list_rem_head(&enc->out);
+            segment_output(pv, seg, buf, list);
+        }
+        if (buf == NULL && !enc->done)
+        {
+            if (!wait)
+            {
+                break;
+            }
+            hb_cond_wait(pv->cond, pv->lock);
+            continue;
+        }
+        pv->first = seg->next;
+        if (pv->last == seg)
+        {
+            pv->last = NULL;
+        }
+        free(seg);
+    }
+    hb_unlock(pv->lock);
+}
+
+int encsegmentWork( hb_work_object_t * w, hb_buffer_t ** buf_in,
+                    hb_buffer_t ** buf_out )
+{
+    hb_work_private_t * pv = w->private_data;
+    hb_buffer_t       * in = *buf_in;
+    hb_buffer_list_t    list;
+    int                 ii;
+
+    *buf_in = NULL;
+    hb_buffer_list_clear(&list);
+
+    if (in->s.flags & HB_BUF_FLAG_EOF)
+    {
+        // Flush all encoders and send everything that's left downstream,
+        // followed by the EOF
+        for (ii = 0; ii < pv->count; ii++)
+        {
+            segment_encoder_push(pv, &pv->encoders[ii], hb_buffer_eof_init());
+        }
+        segment_join(pv, &list, 1);
+        hb_buffer_list_append(&list, in);
+        *buf_out = hb_buffer_list_clear(&list);
+        return HB_WORK_DONE;
+    }
+
+    segment_queue(pv, in);
+    segment_join(pv, &list, 0);
+    *buf_out = hb_buffer_list_clear(&list);
+
+    return HB_WORK_OK;
+}
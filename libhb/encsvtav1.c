@@ -307,7 +307,7 @@ int encsvtInit(hb_work_object_t *w, hb_job_t *job)
     if (job->pass_id == HB_PASS_ENCODE_ANALYSIS ||
         job->pass_id == HB_PASS_ENCODE_FINAL)
     {
-        hb_interjob_t *interjob = hb_interjob_get(job->h);
+        hb_interjob_t *interjob = job->interjob;
         param->rc_stats_buffer.buf = interjob->context;
         param->rc_stats_buffer.sz  = interjob->context_size;
         param->pass = job->pass_id == HB_PASS_ENCODE_ANALYSIS ? 1 : 2;
@@ -409,7 +409,7 @@ void encsvtClose(hb_work_object_t *w)
     }
     if (pv->job->pass_id == HB_PASS_ENCODE_FINAL || *pv->job->die)
     {
-        hb_interjob_t *interjob = hb_interjob_get(pv->job->h);
+        hb_interjob_t *interjob = pv->job->interjob;
         av_freep(&interjob->context);
     }
 
@@ -620,7 +620,7 @@ static void flush(hb_work_object_t *w, hb_buffer_t *in, hb_buffer_list_t *list)
 {
     hb_work_private_t  *pv = w->private_data;
     hb_job_t *job = pv->job;
-    hb_interjob_t *interjob = hb_interjob_get(job->h);
+    hb_interjob_t *interjob = job->interjob;
 
     send(w, in);
 
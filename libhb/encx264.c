@@ -390,6 +390,10 @@ int encx264Init( hb_work_object_t * w, hb_job_t * job )
                                  0.5;
     param.i_keyint_max = 10 * param.i_keyint_min;
     param.i_log_level  = X264_LOG_INFO;
+    if (job->thread_count > 0)
+    {
+        param.i_threads = hb_job_thread_count(job);
+    }
 
     /* set up the VUI color model & gamma */
     param.vui.i_colorprim = hb_output_color_prim(job);
@@ -898,9 +902,11 @@ static hb_buffer_t *x264_encode( hb_work_object_t *w, hb_buffer_t *in )
     /* XXX this is temporary debugging code to check that the upstream
      * modules (render & sync) have generated a continuous, self-consistent
      * frame stream with the current frame's start time equal to the
-     * previous frame's stop time.
+     * previous frame's stop time. A forced IDR may start a new segment
+     * of a segmented encode, which leaves a gap.
      */
-    if (pv->last_stop != AV_NOPTS_VALUE && pv->last_stop != in->s.start)
+    if (pv->last_stop != AV_NOPTS_VALUE && pv->last_stop != in->s.start &&
+        pv->pic_in.i_type != X264_TYPE_IDR)
     {
         hb_log("encx264 input continuity err: last stop %"PRId64"  start %"PRId64,
                 pv->last_stop, in->s.start);
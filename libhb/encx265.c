@@ -293,6 +293,14 @@ int encx265Init(hb_work_object_t *w, hb_job_t *job)
     /* Bit depth */
     pv->bit_depth = hb_get_bit_depth(job->output_pix_fmt);
 
+    /* Stay within the thread budget of the job */
+    if (job->thread_count > 0)
+    {
+        char pools[16];
+        snprintf(pools, sizeof(pools), "%d", hb_job_thread_count(job));
+        param_parse(pv, param, "pools", pools);
+    }
+
     /* iterate through x265_opts and parse the options */
     hb_dict_t *x265_opts;
     int override_mastering = 0, override_coll = 0, override_chroma_location = 0;
@@ -0,0 +1,634 @@
+/* executor.c
+
+   Copyright (c) 2003-2026 HandBrake Team
+   This file is part of the HandBrake source code
+   Homepage: <http://handbrake.fr/>.
+   It may be used under the terms of the GNU General Public License v2.
+   For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
+ */
+
+#include "handbrake/handbrake.h"
+#include "handbrake/ports.h"
+#include "handbrake/executor.h"
+
+// Task states
+enum
+{
+    TASK_IDLE,      // waiting for hb_task_schedule()
+    TASK_QUEUED,    // on a task queue
+    TASK_RUNNING,   // running on a worker
+    TASK_NOTIFIED,  // running, and scheduled again while running
+    TASK_DONE,
+};
+
+#define atomic_load(p)          __atomic_load_n(p, __ATOMIC_SEQ_CST)
+#define atomic_store(p, v)      __atomic_store_n(p, v, __ATOMIC_SEQ_CST)
+#define atomic_add(p, v)        __atomic_add_fetch(p, v, __ATOMIC_SEQ_CST)
+#define atomic_cas(p, o, n)     __atomic_compare_exchange_n(p, o, n, 0, \
+                                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+
+struct hb_task_s
+{
+    hb_executor_t  * executor;
+    char           * name;
+    hb_task_func_t * func;
+    void           * opaque;
+    int              state;
+    int              stop;
+    int              oneshot;   // owned by its function, see parallel_helper
+};
+
+// Double ended task queue.  The owning worker pushes and pops at the
+// top, other workers steal from the bottom.
+typedef struct
+{
+    hb_lock_t  * lock;
+    hb_task_t ** ring;
+    uint32_t     len;       // ring length (must be power of two)
+    uint32_t     bottom;
+    uint32_t     top;
+} task_queue_t;
+
+typedef struct
+{
+    hb_executor_t * executor;
+    int             index;
+    task_queue_t    queue;
+    hb_thread_t   * thread;
+} executor_worker_t;
+
+struct hb_executor_s
+{
+    int                 thread_count;
+    executor_worker_t * workers;
+    task_queue_t        inject;     // tasks scheduled from other threads
+
+    hb_lock_t         * lock;
+    hb_cond_t         * cond;       // signalled when tasks are queued
+    hb_cond_t         * done_cond;  // broadcast when a task is done
+    int                 pending;    // number of queued tasks
+    int                 sleeping;   // number of workers waiting on cond
+    int                 die;
+};
+
+static __thread executor_worker_t * current_worker;
+
+static hb_lock_t     * executor_lock;
+static hb_executor_t * executor;
+
+static int task_queue_init( task_queue_t * q )
+{
+    q->lock   = hb_lock_init();
+    q->len    = 64;
+    q->ring   = calloc(q->len, sizeof(q->ring[0]));
+    q->bottom = q->top = 0;
+    return q->lock != NULL && q->ring != NULL ? 0 : -1;
+}
+
+static void task_queue_close( task_queue_t * q )
+{
+    hb_lock_close(&q->lock);
+    free(q->ring);
+    q->ring = NULL;
+}
+
+// Called with q->lock held
+static int task_queue_grow( task_queue_t * q )
+{
+    hb_task_t ** ring;
+    uint32_t     ii, count = q->top - q->bottom;
+
+    if (count < q->len)
+    {
+        return 0;
+    }
+    ring = malloc(2 * q->len * sizeof(ring[0]));
+    if (ring == NULL)
+    {
+        return -1;
+    }
+    for (ii = 0; ii < count; ii++)
+    {
+        ring[ii] = q->ring[(q->bottom + ii) & (q->len - 1)];
+    }
+    free(q->ring);
+    q->ring   = ring;
+    q->len   *= 2;
+    q->bottom = 0;
+    q->top    = count;
+    return 0;
+}
+
+static void task_queue_push_top( task_queue_t * q, hb_task_t * t )
+{
+    hb_lock(q->lock);
+    if (task_queue_grow(q) == 0)
+    {
+        q->ring[q->top++ & (q->len - 1)] = t;
+    }
+    else
+    {
+        hb_error("executor: failed to queue task %s", t->name);
+    }
+    hb_unlock(q->lock);
+}
+
+static void task_queue_push_bottom( task_queue_t * q, hb_task_t * t )
+{
+    hb_lock(q->lock);
+    if (task_queue_grow(q) == 0)
+    {
+        q->ring[--q->bottom & (q->len - 1)] = t;
+    }
+    else
+    {
+        hb_error("executor: failed to queue task %s", t->name);
+    }
+    hb_unlock(q->lock);
+}
+
+static hb_task_t * task_queue_pop_top( task_queue_t * q )
+{
+    hb_task_t * t = NULL;
+
+    hb_lock(q->lock);
+    if (q->top != q->bottom)
+    {
+        t = q->ring[--q->top & (q->len - 1)];
+    }
+    hb_unlock(q->lock);
+    return t;
+}
+
+static hb_task_t * task_queue_pop_bottom( task_queue_t * q )
+{
+    hb_task_t * t = NULL;
+
+    hb_lock(q->lock);
+    if (q->top != q->bottom)
+    {
+        t = q->ring[q->bottom++ & (q->len - 1)];
+    }
+    hb_unlock(q->lock);
+    return t;
+}
+
+static void executor_wake( hb_executor_t * e )
+{
+    atomic_add(&e->pending, 1);
+    if (atomic_load(&e->sleeping) > 0)
+    {
+        hb_lock(e->lock);
+        hb_cond_signal(e->cond);
+        hb_unlock(e->lock);
+    }
+}
+
+// Queue a task that is in state TASK_QUEUED.  Tasks scheduled from a
+// worker run next on that worker so that a consumer usually runs on the
+// core that just produced its input.  Requeued tasks go to the bottom so
+// that a busy task can't starve the others.
+static void executor_enqueue( hb_executor_t * e, hb_task_t * t, int requeue )
+{
+    executor_worker_t * w = current_worker;
+
+    if (w != NULL && w->executor == e)
+    {
+        if (requeue)
+        {
+            task_queue_push_bottom(&w->queue, t);
+        }
+        else
+        {
+            task_queue_push_top(&w->queue, t);
+        }
+    }
+    else
+    {
+        task_queue_push_top(&e->inject, t);
+    }
+    executor_wake(e);
+}
+
+static hb_task_t * executor_find_task( executor_worker_t * w )
+{
+    hb_executor_t * e = w->executor;
+    hb_task_t     * t;
+    int             ii;
+
+    t = task_queue_pop_top(&w->queue);
+    if (t == NULL)
+    {
+        t = task_queue_pop_bottom(&e->inject);
+    }
+    for (ii = 1; t == NULL && ii < e->thread_count; ii++)
+    {
+        executor_worker_t * victim;
+
+        victim = &e->workers[(w->index + ii) % e->thread_count];
+        t = task_queue_pop_bottom(&victim->queue);
+    }
+    if (t != NULL)
+    {
+        atomic_add(&e->pending, -1);
+    }
+    return t;
+}
+
+static void task_done( hb_task_t * t )
+{
+    hb_executor_t * e = t->executor;
+
+    hb_lock(e->lock);
+    atomic_store(&t->state, TASK_DONE);
+    hb_cond_broadcast(e->done_cond);
+    hb_unlock(e->lock);
+}
+
+static void task_run( hb_executor_t * e, hb_task_t * t )
+{
+    int result, state;
+
+    atomic_store(&t->state, TASK_RUNNING);
+    if (t->oneshot)
+    {
+        // The task may be freed by its function
+        t->func(t->opaque);
+        return;
+    }
+    if (atomic_load(&t->stop))
+    {
+        task_done(t);
+        return;
+    }
+
+    result = t->func(t->opaque);
+    switch (result)
+    {
+        case HB_TASK_PROGRESS:
+            atomic_store(&t->state, TASK_QUEUED);
+            executor_enqueue(e, t, 1);
+            break;
+
+        case HB_TASK_IDLE:
+            state = TASK_RUNNING;
+            if (!atomic_cas(&t->state, &state, TASK_IDLE))
+            {
+                // Scheduled while running, the task may be able to
+                // make progress now.
+                atomic_store(&t->state, TASK_QUEUED);
+                executor_enqueue(e, t, 1);
+            }
+            break;
+
+        default:
+            task_done(t);
+            break;
+    }
+}
+
+static void executor_thread( void * _w )
+{
+    executor_worker_t * w = _w;
+    hb_executor_t     * e = w->executor;
+    hb_task_t         * t;
+
+    current_worker = w;
+    while (!atomic_load(&e->die))
+    {
+        t = executor_find_task(w);
+        if (t != NULL)
+        {
+            task_run(e, t);
+            continue;
+        }
+
+        hb_lock(e->lock);
+        atomic_add(&e->sleeping, 1);
+        if (atomic_load(&e->pending) <= 0 && !atomic_load(&e->die))
+        {
+            hb_cond_wait(e->cond, e->lock);
+        }
+        atomic_add(&e->sleeping, -1);
+        hb_unlock(e->lock);
+    }
+    current_worker = NULL;
+}
+
+static hb_executor_t * executor_init( int thread_count )
+{
+    hb_executor_t * e;
+    int             ii;
+
+    e = calloc(1, sizeof(hb_executor_t));
+    if (e == NULL)
+    {
+        return NULL;
+    }
+    e->thread_count = thread_count;
+    e->lock         = hb_lock_init();
+    e->cond         = hb_cond_init();
+    e->done_cond    = hb_cond_init();
+    e->workers      = calloc(thread_count, sizeof(executor_worker_t));
+    if (e->workers == NULL || task_queue_init(&e->inject) < 0)
+    {
+        goto fail;
+    }
+    for (ii = 0; ii < thread_count; ii++)
+    {
+        executor_worker_t * w = &e->workers[ii];
+
+        w->executor = e;
+        w->index    = ii;
+        if (task_queue_init(&w->queue) < 0)
+        {
+            goto fail;
+        }
+    }
+    for (ii = 0; ii < thread_count; ii++)
+    {
+        executor_worker_t * w = &e->workers[ii];
+
+        w->thread = hb_thread_init("executor", executor_thread, w,
+                                   HB_NORMAL_PRIORITY);
+        if (w->thread == NULL)
+        {
+            hb_error("executor: failed to start worker thread %d", ii);
+            goto fail;
+        }
+    }
+    hb_log("executor: started %d worker threads", thread_count);
+    return e;
+
+fail:
+    hb_lock(e->lock);
+    atomic_store(&e->die, 1);
+    hb_cond_broadcast(e->cond);
+    hb_unlock(e->lock);
+    for (ii = 0; e->workers != NULL && ii < thread_count; ii++)
+    {
+        hb_thread_close(&e->workers[ii].thread);
+        task_queue_close(&e->workers[ii].queue);
+    }
+    task_queue_close(&e->inject);
+    hb_cond_close(&e->done_cond);
+    hb_cond_close(&e->cond);
+    hb_lock_close(&e->lock);
+    free(e->workers);
+    free(e);
+    return NULL;
+}
+
+static void executor_close( hb_executor_t ** _e )
+{
+    hb_executor_t * e = *_e;
+    int             ii;
+
+    if (e == NULL)
+    {
+        return;
+    }
+    hb_lock(e->lock);
+    atomic_store(&e->die, 1);
+    hb_cond_broadcast(e->cond);
+    hb_unlock(e->lock);
+    for (ii = 0; ii < e->thread_count; ii++)
+    {
+        hb_thread_close(&e->workers[ii].thread);
+        task_queue_close(&e->workers[ii].queue);
+    }
+    task_queue_close(&e->inject);
+    hb_cond_close(&e->done_cond);
+    hb_cond_close(&e->cond);
+    hb_lock_close(&e->lock);
+    free(e->workers);
+    free(e);
+    *_e = NULL;
+}
+
+void hb_executor_global_init( void )
+{
+    executor_lock = hb_lock_init();
+}
+
+void hb_executor_global_close( void )
+{
+    executor_close(&executor);
+    hb_lock_close(&executor_lock);
+}
+
+// Returns the process-wide executor, starting its worker threads on
+// first use.
+hb_executor_t * hb_executor_get( void )
+{
+    hb_executor_t * e;
+
+    hb_lock(executor_lock);
+    if (executor == NULL)
+    {
+        executor = executor_init(hb_get_cpu_count());
+    }
+    e = executor;
+    hb_unlock(executor_lock);
+
+    return e;
+}
+
+int hb_executor_thread_count( hb_executor_t * e )
+{
+    return e->thread_count;
+}
+
+// Parallel for
+//
+// Indices are handed out one at a time to whichever thread asks for the
+// next one, so a slow index doesn't hold back the others.  The caller
+// works on indices too, so a parallel for that runs inside a task can't
+// deadlock waiting for busy workers.  Helper tasks that only get to run
+// after all indices are taken just drop their reference to the group.
+typedef struct
+{
+    hb_executor_t      * executor;
+    hb_parallel_func_t * func;
+    void               * opaque;
+    int                  count;
+    int                  next;      // next index to hand out
+    int                  remaining; // indices not finished yet
+    int                  refs;
+    hb_task_t            helpers[];
+} parallel_group_t;
+
+static void parallel_run( parallel_group_t * g )
+{
+    int index;
+
+    while ((index = atomic_add(&g->next, 1) - 1) < g->count)
+    {
+        g->func(g->opaque, index);
+        if (atomic_add(&g->remaining, -1) == 0)
+        {
+            hb_lock(g->executor->lock);
+            hb_cond_broadcast(g->executor->done_cond);
+            hb_unlock(g->executor->lock);
+        }
+    }
+}
+
+static void parallel_release( parallel_group_t * g )
+{
+    if (atomic_add(&g->refs, -1) == 0)
+    {
+        free(g);
+    }
+}
+
+static int parallel_helper( void * _g )
+{
+    parallel_group_t * g = _g;
+
+    parallel_run(g);
+    parallel_release(g);
+    return HB_TASK_DONE;
+}
+
+// Calls func(opaque, index) for index 0 to count - 1 on the executor
+// threads and the calling thread, and returns when all calls are done.
+void hb_executor_parallel_for( hb_executor_t * e, int count,
+                               hb_parallel_func_t * func, void * opaque )
+{
+    parallel_group_t * g = NULL;
+    int                ii, helpers;
+
+    helpers = e != NULL ? MIN(count - 1, e->thread_count) : 0;
+    if (helpers > 0)
+    {
+        g = calloc(1, sizeof(parallel_group_t) + helpers * sizeof(hb_task_t));
+    }
+    if (g == NULL)
+    {
+        for (ii = 0; ii < count; ii++)
+        {
+            func(opaque, ii);
+        }
+        return;
+    }
+
+    g->executor  = e;
+    g->func      = func;
+    g->opaque    = opaque;
+    g->count     = count;
+    g->remaining = count;
+    g->refs      = helpers + 1;
+    for (ii = 0; ii < helpers; ii++)
+    {
+        hb_task_t * t = &g->helpers[ii];
+
+        t->executor = e;
+        t->name     = "parallel";
+        t->func     = parallel_helper;
+        t->opaque   = g;
+        t->state    = TASK_IDLE;
+        t->oneshot  = 1;
+        hb_task_schedule(t);
+    }
+
+    parallel_run(g);
+
+    hb_lock(e->lock);
+    while (atomic_load(&g->remaining) > 0)
+    {
+        hb_cond_wait(e->done_cond, e->lock);
+    }
+    hb_unlock(e->lock);
+    parallel_release(g);
+}
+
+// Creates an idle task.  Nothing runs until hb_task_schedule() is called.
+hb_task_t * hb_task_init( hb_executor_t * e, const char * name,
+                          hb_task_func_t * func, void * opaque )
+{
+    hb_task_t * t;
+
+    if (e == NULL)
+    {
+        return NULL;
+    }
+    t = calloc(1, sizeof(hb_task_t));
+    if (t == NULL)
+    {
+        return NULL;
+    }
+    t->executor = e;
+    t->name     = strdup(name);
+    t->func     = func;
+    t->opaque   = opaque;
+    t->state    = TASK_IDLE;
+    return t;
+}
+
+// Makes the task run at least once more.  May be called from any thread.
+void hb_task_schedule( hb_task_t * t )
+{
+    int state = atomic_load(&t->state);
+
+    for (;;)
+    {
+        switch (state)
+        {
+            case TASK_IDLE:
+                if (atomic_cas(&t->state, &state, TASK_QUEUED))
+                {
+                    executor_enqueue(t->executor, t, 0);
+                    return;
+                }
+                break;
+
+            case TASK_RUNNING:
+                if (atomic_cas(&t->state, &state, TASK_NOTIFIED))
+                {
+                    return;
+                }
+                break;
+
+            default:
+                // Already queued, notified or done
+                return;
+        }
+    }
+}
+
+// Waits for the task to finish.  A task that is not done yet is not run
+// again.  Must not be called from a task.
+void hb_task_stop( hb_task_t * t )
+{
+    hb_executor_t * e;
+
+    if (t == NULL)
+    {
+        return;
+    }
+    e = t->executor;
+    atomic_store(&t->stop, 1);
+    hb_task_schedule(t);
+
+    hb_lock(e->lock);
+    while (atomic_load(&t->state) != TASK_DONE)
+    {
+        hb_cond_wait(e->done_cond, e->lock);
+    }
+    hb_unlock(e->lock);
+}
+
+void hb_task_close( hb_task_t ** _t )
+{
+    hb_task_t * t = *_t;
+
+    if (t == NULL)
+    {
+        return;
+    }
+    hb_task_stop(t);
+    free(t->name);
+    free(t);
+    *_t = NULL;
+}
@@ -26,6 +26,10 @@
 #endif
 #endif
 
+#if defined(SYS_LINUX)
+#include <sys/mman.h>
+#endif
+
 #define FIFO_TIMEOUT 200
 //#define HB_FIFO_DEBUG 1
 // defining HB_BUFFER_DEBUG and HB_NO_BUFFER_POOL allows tracking
@@ -33,6 +37,10 @@
 // can be determined with "valgrind --leak-check=full"
 //#define HB_BUFFER_DEBUG 1
 //#define HB_NO_BUFFER_POOL 1
+// defining HB_NO_SPSC_FIFO makes hb_fifo_init_spsc() return a regular
+// locked fifo, which helps to rule out the lock-free handoff when
+// debugging pipeline stalls.
+//#define HB_NO_SPSC_FIFO 1
 
 #if defined(HB_BUFFER_DEBUG)
 #include <assert.h>
@@ -54,6 +62,25 @@ struct hb_fifo_s
     hb_buffer_t  * first;
     hb_buffer_t  * last;
 
+    // Single producer / single consumer mode, see hb_fifo_init_spsc().
+    // The producer publishes buffer chains into 'ring' without taking
+    // 'lock'.  'size', 'wait_empty' and 'wait_full' are then accessed
+    // atomically and 'first'/'last' only hold buffers that did not fit
+    // in the ring.
+    int            spsc;
+    hb_buffer_t ** ring;
+    uint32_t       ring_len;    // ring length (must be power of two)
+    uint32_t       in;          // number of chains put into the ring
+    uint32_t       out;         // number of chains taken out of the ring
+    uint32_t       overflow;    // number of buffers on first/last
+
+    // Called after buffers are added to or removed from the fifo,
+    // see hb_fifo_register_push_notify() and hb_fifo_register_get_notify()
+    hb_fifo_notify_t * push_notify;
+    void             * push_opaque;
+    hb_fifo_notify_t * get_notify;
+    void             * get_opaque;
+
 #if defined(HB_FIFO_DEBUG)
     // Fifo list for debugging
     hb_fifo_t    * next;
@@ -81,18 +108,165 @@ static hb_fifo_t fifo_list =
  * too much memory. */
 #define BUFFER_POOL_MAX_ELEMENTS 32
 
+/* uncompressed frames get pools of their own, with buffers of exactly the
+ * size of the frame. rounding frames up to the power of 2 pools above wastes
+ * up to half of each frame, and frames larger than 2^BUFFER_POOL_LAST would
+ * not be pooled at all. the pools are keyed by the frame size, so frames of
+ * different geometries that have the same size share a pool. a job only
+ * uses a few geometries, when more are needed the least recently used pool
+ * is dropped. */
+#define FRAME_POOL_MAX          8
+#define FRAME_POOL_MAX_ELEMENTS 16
+// frames allocated ahead for each geometry at the start of a job,
+// see hb_frame_pool_prewarm()
+#define FRAME_POOL_PREWARM      4
+
+typedef struct
+{
+    int           alloc;        // size of the buffers, 0 if the pool is unused
+    int           count;        // number of buffers in the pool
+    uint64_t      last_use;
+    hb_buffer_t * first;
+} hb_frame_pool_t;
+
 struct hb_buffer_pools_s
 {
     int64_t allocated;
     hb_lock_t *lock;
 #if !defined(HB_NO_BUFFER_POOL)
     hb_fifo_t *pool[MAX_BUFFER_POOLS];
+    // frame pools are protected by 'lock'
+    hb_frame_pool_t frame_pool[FRAME_POOL_MAX];
+    uint64_t        frame_pool_use;
 #endif
 #if defined(HB_BUFFER_DEBUG)
     hb_list_t *alloc_list;
 #endif
 } buffers;
 
+/* frame buffers can be backed by huge pages, which saves page faults and
+ * TLB misses on large frames, see hb_set_huge_pages(). */
+#define HUGE_PAGES_NONE        0
+#define HUGE_PAGES_TRANSPARENT 1
+#define HUGE_PAGES_EXPLICIT    2
+
+// Transparent huge pages are only used for frames at least this large
+#define THP_SIZE (2 * 1024 * 1024)
+
+// How the data of a buffer was allocated, see hb_buffer_s.alloc_type
+enum
+{
+    BUFFER_ALLOC_AV = 0,    // av_malloc()
+    BUFFER_ALLOC_THP,       // posix_memalign() advised to use huge pages
+    BUFFER_ALLOC_HUGETLB,   // mmap() of explicit huge pages
+};
+
+static int huge_pages = HUGE_PAGES_NONE;
+#if defined(SYS_LINUX) && defined(MAP_HUGETLB)
+static size_t huge_page_size = 0;
+#endif
+
+#if defined(SYS_LINUX) && defined(MAP_HUGETLB)
+// Default size of the explicit huge pages, 0 if unknown
+static size_t get_huge_page_size( void )
+{
+    FILE   * file = fopen("/proc/meminfo", "r");
+    char     line[256];
+    size_t   size = 0;
+
+    if (file == NULL)
+    {
+        return 0;
+    }
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        unsigned long kb;
+        if (sscanf(line, "Hugepagesize: %lu kB", &kb) == 1)
+        {
+            size = (size_t)kb * 1024;
+            break;
+        }
+    }
+    fclose(file);
+    return size;
+}
+#endif
+
+// hb_set_huge_pages must only be called when no job is running
+void hb_set_huge_pages( int mode )
+{
+#if defined(SYS_LINUX)
+    huge_pages = mode == HUGE_PAGES_TRANSPARENT ||
+                 mode == HUGE_PAGES_EXPLICIT ? mode : HUGE_PAGES_NONE;
+#if defined(MAP_HUGETLB)
+    if (huge_pages == HUGE_PAGES_EXPLICIT && huge_page_size == 0)
+    {
+        huge_page_size = get_huge_page_size();
+    }
+#endif
+#else
+    if (mode != HUGE_PAGES_NONE)
+    {
+        hb_log("hb_set_huge_pages: huge pages are not supported on this platform");
+    }
+#endif
+}
+
+// Allocates the data of a frame buffer, with huge pages if enabled
+static uint8_t * frame_data_alloc( int alloc, int * alloc_type )
+{
+#if defined(SYS_LINUX) && defined(MAP_HUGETLB)
+    if (huge_pages == HUGE_PAGES_EXPLICIT && huge_page_size > 0)
+    {
+        size_t length = FFALIGN((size_t)alloc, huge_page_size);
+        void * data   = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (data != MAP_FAILED)
+        {
+            *alloc_type = BUFFER_ALLOC_HUGETLB;
+            return data;
+        }
+        // Not enough huge pages reserved (vm.nr_hugepages),
+        // fall back to transparent huge pages
+    }
+#endif
+#if defined(SYS_LINUX) && defined(MADV_HUGEPAGE)
+    if (huge_pages != HUGE_PAGES_NONE && alloc >= THP_SIZE)
+    {
+        void * data;
+        if (posix_memalign(&data, THP_SIZE, alloc) == 0)
+        {
+            madvise(data, alloc, MADV_HUGEPAGE);
+            *alloc_type = BUFFER_ALLOC_THP;
+            return data;
+        }
+    }
+#endif
+    *alloc_type = BUFFER_ALLOC_AV;
+    return av_malloc(alloc);
+}
+
+// Frees the data of any buffer
+static void buffer_data_free( hb_buffer_t * b )
+{
+    switch (b->alloc_type)
+    {
+#if defined(SYS_LINUX) && defined(MAP_HUGETLB)
+        case BUFFER_ALLOC_HUGETLB:
+            munmap(b->data, FFALIGN((size_t)b->alloc, huge_page_size));
+            break;
+#endif
+        case BUFFER_ALLOC_THP:
+            free(b->data);
+            break;
+        default:
+            av_free(b->data);
+            break;
+    }
+    b->data       = NULL;
+    b->alloc_type = BUFFER_ALLOC_AV;
+}
+
 
 #if defined(HB_BUFFER_DEBUG)
 static int hb_fifo_contains( hb_fifo_t *f, hb_buffer_t *b );
@@ -263,7 +437,7 @@ void fifo_list_validate( void )
             b = b->next;
         }
 
-        if ( count != next->size )
+        if ( count != (next->spsc ? next->overflow : next->size) )
         {
             fprintf(stderr, "Invalid fifo size! count %d size %d\n", count, next->size);
             dump_fifo(next);
@@ -277,6 +451,64 @@ void fifo_list_validate( void )
 #endif
 #endif
 
+#if !defined(HB_NO_BUFFER_POOL)
+// The frame pool functions must be called with buffers.lock held
+static hb_frame_pool_t * frame_pool_find( int alloc )
+{
+    int ii;
+    for (ii = 0; ii < FRAME_POOL_MAX; ii++)
+    {
+        if (buffers.frame_pool[ii].alloc == alloc)
+        {
+            return &buffers.frame_pool[ii];
+        }
+    }
+    return NULL;
+}
+
+// Frees the buffers of a frame pool, returns the number of bytes freed
+static int64_t frame_pool_drain( hb_frame_pool_t * pool )
+{
+    int64_t       freed = 0;
+    hb_buffer_t * b;
+
+    while ((b = pool->first) != NULL)
+    {
+        pool->first = b->next;
+        freed += b->alloc;
+        buffer_data_free(b);
+        free(b);
+    }
+    pool->count = 0;
+    return freed;
+}
+
+// Returns the frame pool for buffers of size 'alloc', replaces
+// the least recently used pool if there is none yet
+static hb_frame_pool_t * frame_pool_get( int alloc )
+{
+    hb_frame_pool_t * pool = frame_pool_find(alloc);
+    int               ii;
+
+    if (pool == NULL)
+    {
+        // Unused pools have the lowest last_use and are picked first
+        pool = &buffers.frame_pool[0];
+        for (ii = 1; ii < FRAME_POOL_MAX; ii++)
+        {
+            if (buffers.frame_pool[ii].last_use < pool->last_use)
+            {
+                pool = &buffers.frame_pool[ii];
+            }
+        }
+        buffers.allocated -= frame_pool_drain(pool);
+        pool->alloc = alloc;
+    }
+    pool->last_use = ++buffers.frame_pool_use;
+    return pool;
+}
+#endif
+
 void hb_buffer_pool_free( void )
 {
     int i;
@@ -316,6 +548,20 @@ void hb_buffer_pool_free( void )
                     buffers.pool[i]->buffer_size);
         }
     }
+    for (i = 0; i < FRAME_POOL_MAX; i++)
+    {
+        hb_frame_pool_t *pool = &buffers.frame_pool[i];
+
+        count = pool->count;
+        freed += frame_pool_drain(pool);
+        if (count)
+        {
+            hb_deep_log(2, "Freed %d frames of size %d", count, pool->alloc);
+        }
+        pool->alloc    = 0;
+        pool->last_use = 0;
+    }
+    buffers.frame_pool_use = 0;
 #endif
 
 #if defined(HB_BUFFER_DEBUG) && defined(HB_NO_BUFFER_POOL)
@@ -477,7 +723,7 @@ void hb_buffer_realloc( hb_buffer_t * b, int size )
         if (b->data != NULL)
         {
             memcpy(tmp, b->data, b->alloc);
-            av_free(b->data);
+            buffer_data_free(b);
         }
         b->data  = tmp;
         b->alloc = size;
@@ -834,27 +1080,126 @@ void hb_buffer_init_planes(hb_buffer_t * b)
     }
 }
 
-// this routine gets a buffer for an uncompressed picture
-// with pixel format pix_fmt and dimensions width x height.
-hb_buffer_t * hb_frame_buffer_init( int pix_fmt, int width, int height )
+// Gets a buffer of 'size' bytes for an uncompressed picture
+// from the frame pool of that size
+static hb_buffer_t * frame_buffer_init_internal( int size )
+{
+#if !defined(HB_NO_BUFFER_POOL)
+    hb_buffer_t * b;
+    int           alloc = size + AV_INPUT_BUFFER_PADDING_SIZE;
+
+    if (size == 0)
+    {
+        return hb_buffer_init_internal(size);
+    }
+
+    hb_lock(buffers.lock);
+    hb_frame_pool_t *pool = frame_pool_get(alloc);
+    b = pool->first;
+    if (b != NULL)
+    {
+        pool->first = b->next;
+        pool->count--;
+    }
+    hb_unlock(buffers.lock);
+
+    if (b != NULL)
+    {
+        uint8_t *data       = b->data;
+        int      alloc_type = b->alloc_type;
+
+        memset(b, 0, sizeof(hb_buffer_t));
+        b->data       = data;
+        b->alloc_type = alloc_type;
+    }
+    else
+    {
+        if (!(b = calloc(sizeof(hb_buffer_t), 1)))
+        {
+            hb_error("out of memory");
+            return NULL;
+        }
+        b->data = frame_data_alloc(alloc, &b->alloc_type);
+        if (!b->data)
+        {
+            hb_error("out of memory");
+            free(b);
+            return NULL;
+        }
+#if defined(HB_BUFFER_DEBUG)
+        memset(b->data, 0, size);
+#endif
+        hb_lock(buffers.lock);
+        buffers.allocated += alloc;
+        hb_unlock(buffers.lock);
+    }
+
+    b->alloc          = alloc;
+    b->size           = size;
+    b->s.start        = AV_NOPTS_VALUE;
+    b->s.stop         = AV_NOPTS_VALUE;
+    b->s.renderOffset = AV_NOPTS_VALUE;
+    b->s.scr_sequence = -1;
+#if defined(HB_BUFFER_DEBUG)
+    hb_lock(buffers.lock);
+    hb_list_add(buffers.alloc_list, b);
+    hb_unlock(buffers.lock);
+#endif
+    return b;
+#else
+    return hb_buffer_init_internal(size);
+#endif
+}
+
+// Puts a buffer back into the frame pool of its size,
+// returns 0 if there is no such pool or if it is full
+static int frame_buffer_recycle( hb_buffer_t * b )
+{
+    int ret = 0;
+
+#if !defined(HB_NO_BUFFER_POOL)
+    if (b->data == NULL || b->storage_type != STANDARD)
+    {
+        return 0;
+    }
+
+    hb_lock(buffers.lock);
+    hb_frame_pool_t *pool = frame_pool_find(b->alloc);
+    if (pool != NULL && pool->count < FRAME_POOL_MAX_ELEMENTS)
+    {
+        b->next     = pool->first;
+        pool->first = b;
+        pool->count++;
+        ret = 1;
+    }
+    hb_unlock(buffers.lock);
+#endif
+
+    return ret;
+}
+
+// Size of an uncompressed picture with pixel format pix_fmt and
+// dimensions width x height, -1 if the pixel format is unknown
+static int frame_buffer_size( int pix_fmt, int width, int height,
+                              int * max_plane )
 {
     const AVPixFmtDescriptor * desc = av_pix_fmt_desc_get(pix_fmt);
-    hb_buffer_t              * buf;
     uint8_t                    has_plane[4] = {0,};
-    int                        ii, pp, max_plane = 0;
+    int                        ii, pp;
 
     if (desc == NULL)
     {
-        return NULL;
+        return -1;
     }
 
     int size = 0;
+    *max_plane = 0;
     for (ii = 0; ii < desc->nb_components; ii++)
     {
         pp    = desc->comp[ii].plane;
-        if (pp > max_plane)
+        if (pp > *max_plane)
         {
-            max_plane = pp;
+            *max_plane = pp;
         }
         if (!has_plane[pp])
         {
@@ -863,8 +1208,87 @@ hb_buffer_t * hb_frame_buffer_init( int pix_fmt, int width, int height )
                     hb_image_height( pix_fmt, height, pp );
         }
     }
+    return size;
+}
+
+// Fills the frame pool of pictures with pixel format pix_fmt and
+// dimensions width x height, so that the first frames of a job don't
+// have to wait for new memory to be allocated and faulted in
+void hb_frame_pool_prewarm( int pix_fmt, int width, int height )
+{
+#if !defined(HB_NO_BUFFER_POOL)
+    hb_buffer_t * list = NULL, * b;
+    int           max_plane, count;
+    int           size = frame_buffer_size(pix_fmt, width, height, &max_plane);
+
+    if (size <= 0)
+    {
+        return;
+    }
+    int alloc = size + AV_INPUT_BUFFER_PADDING_SIZE;
+
+    hb_lock(buffers.lock);
+    count = FRAME_POOL_PREWARM - frame_pool_get(alloc)->count;
+    hb_unlock(buffers.lock);
+
+    for (; count > 0; count--)
+    {
+        if (!(b = calloc(sizeof(hb_buffer_t), 1)))
+        {
+            break;
+        }
+        b->data = frame_data_alloc(alloc, &b->alloc_type);
+        if (b->data == NULL)
+        {
+            free(b);
+            break;
+        }
+        // Fault the pages in now
+        memset(b->data, 0, alloc);
+        b->alloc = alloc;
+        b->next  = list;
+        list     = b;
+    }
+
+    // The pool may have been replaced meanwhile, the buffers
+    // that don't fit in it anymore are freed right away
+    hb_lock(buffers.lock);
+    hb_frame_pool_t *pool = frame_pool_find(alloc);
+    while ((b = list) != NULL)
+    {
+        list = b->next;
+        if (pool != NULL && pool->count < FRAME_POOL_MAX_ELEMENTS)
+        {
+            b->next     = pool->first;
+            pool->first = b;
+            pool->count++;
+            buffers.allocated += alloc;
+        }
+        else
+        {
+            buffer_data_free(b);
+            free(b);
+        }
+    }
+    hb_unlock(buffers.lock);
+#endif
+}
 
-    buf = hb_buffer_init_internal(size);
+// this routine gets a buffer for an uncompressed picture
+// with pixel format pix_fmt and dimensions width x height.
+hb_buffer_t * hb_frame_buffer_init( int pix_fmt, int width, int height )
+{
+    hb_buffer_t              * buf;
+    int                        max_plane;
+    int                        size = frame_buffer_size(pix_fmt, width,
+                                                        height, &max_plane);
+
+    if (size < 0)
+    {
+        return NULL;
+    }
+
+    buf = frame_buffer_init_internal(size);
 
     if( buf == NULL )
         return NULL;
@@ -937,7 +1361,7 @@ DEF_MIRROR_STRIDE_FUNC(mirror_stride, 8)
 void hb_frame_buffer_mirror_stride(hb_buffer_t * buf)
 {
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(buf->f.fmt);
-    int   depth = desc->comp[0].depth > 8 ? 2 : 1;
+    int   depth = desc->comp[0].depth;
 
     for (int pp = 0; pp <= buf->f.max_plane; pp++)
     {
@@ -1002,15 +1426,17 @@ void hb_video_buffer_realloc( hb_buffer_t * buf, int width, int height )
 // from src to dst.
 void hb_buffer_swap_copy( hb_buffer_t *src, hb_buffer_t *dst )
 {
-    uint8_t *data  = dst->data;
-    int      size  = dst->size;
-    int      alloc = dst->alloc;
+    uint8_t *data       = dst->data;
+    int      size       = dst->size;
+    int      alloc      = dst->alloc;
+    int      alloc_type = dst->alloc_type;
 
     *dst = *src;
 
-    src->data  = data;
-    src->size  = size;
-    src->alloc = alloc;
+    src->data       = data;
+    src->size       = size;
+    src->alloc      = alloc;
+    src->alloc_type = alloc_type;
 }
 
 static void free_buffer_resources(hb_buffer_t *b)
@@ -1053,6 +1479,19 @@ void hb_buffer_close( hb_buffer_t ** _b )
 
         free_buffer_resources(b);
 
+        // Frame buffers have the exact size of the frame
+        // and go back to the frame pool of that size
+        if (buffer_pool && (buffer_pool->buffer_size != b->alloc ||
+                            b->alloc_type != BUFFER_ALLOC_AV))
+        {
+            buffer_pool = NULL;
+        }
+        if (buffer_pool == NULL && frame_buffer_recycle(b))
+        {
+            b = next;
+            continue;
+        }
+
         if (buffer_pool && !hb_fifo_is_full(buffer_pool))
         {
 #if defined(HB_BUFFER_DEBUG)
@@ -1070,7 +1509,7 @@ void hb_buffer_close( hb_buffer_t ** _b )
         // free the buf
         if (b->data && b->storage_type == STANDARD)
         {
-            av_free(b->data);
+            buffer_data_free(b);
             hb_lock(buffers.lock);
             buffers.allocated -= b->alloc;
             hb_unlock(buffers.lock);
@@ -1191,6 +1630,274 @@ void hb_image_close(hb_image_t **_image)
     }
 }
 
+
+/*
+ * Single producer / single consumer fifo
+ *
+ * Most fifos in the pipeline connect exactly one producer thread to
+ * exactly one consumer thread.  For those, buffers are handed over
+ * through a ring of buffer chains indexed by free running 'in' and
+ * 'out' counters that are only written by the producer and the consumer
+ * respectively, so neither side has to take the fifo lock to push or
+ * pull a buffer.
+ *
+ * The lock and condition variables are only used when one side has to
+ * sleep.  A consumer that finds the fifo empty raises 'wait_empty' and
+ * re-checks 'size' with the lock held before waiting, and the producer
+ * only takes the lock to signal after it has seen 'wait_empty' set.
+ * 'wait_full' works the same way for a producer waiting for room.
+ *
+ * hb_fifo_push() never blocks, so a push that doesn't fit in the ring
+ * is parked on the locked first/last list.  All further pushes go to
+ * that list until the consumer has drained it, which preserves the
+ * order of the buffers.
+ */
+#define fifo_load(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define fifo_store(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+
+static uint32_t chain_count( hb_buffer_t * b, hb_buffer_t ** last )
+{
+    uint32_t count = 1;
+
+    while (b->next != NULL)
+    {
+        b = b->next;
+        count++;
+    }
+    if (last != NULL)
+    {
+        *last = b;
+    }
+    return count;
+}
+
+static void spsc_signal_empty( hb_fifo_t * f )
+{
+    if (__atomic_load_n(&f->wait_empty, __ATOMIC_SEQ_CST))
+    {
+        hb_lock(f->lock);
+        f->wait_empty = 0;
+        hb_cond_signal(f->cond_empty);
+        hb_unlock(f->lock);
+    }
+}
+
+static void spsc_signal_full( hb_fifo_t * f, uint32_t size )
+{
+    if (__atomic_load_n(&f->wait_full, __ATOMIC_SEQ_CST) &&
+        size <= f->capacity - f->thresh)
+    {
+        hb_lock(f->lock);
+        f->wait_full = 0;
+        hb_cond_signal(f->cond_full);
+        hb_unlock(f->lock);
+    }
+}
+
+static void spsc_alert_full( hb_fifo_t * f )
+{
+    if (f->cond_alert_full != NULL &&
+        __atomic_load_n(&f->size, __ATOMIC_SEQ_CST) >= f->capacity)
+    {
+        hb_lock(f->lock);
+        hb_cond_broadcast(f->cond_alert_full);
+        hb_unlock(f->lock);
+    }
+}
+
+// Producer side
+static void spsc_push( hb_fifo_t * f, hb_buffer_t * b )
+{
+    hb_buffer_t * last;
+    uint32_t      count = chain_count(b, &last);
+    uint32_t      in    = __atomic_load_n(&f->in, __ATOMIC_RELAXED);
+
+    spsc_alert_full(f);
+
+    if (fifo_load(&f->overflow) == 0 &&
+        in - fifo_load(&f->out) < f->ring_len)
+    {
+        f->ring[in & (f->ring_len - 1)] = b;
+        fifo_store(&f->in, in + 1);
+        __atomic_add_fetch(&f->size, count, __ATOMIC_SEQ_CST);
+    }
+    else
+    {
+        hb_lock(f->lock);
+        if (f->first == NULL)
+        {
+            f->first = b;
+        }
+        else
+        {
+            f->last->next = b;
+        }
+        f->last = last;
+        __atomic_add_fetch(&f->overflow, count, __ATOMIC_RELEASE);
+        __atomic_add_fetch(&f->size, count, __ATOMIC_SEQ_CST);
+        hb_unlock(f->lock);
+    }
+    spsc_signal_empty(f);
+}
+
+static int spsc_full_wait( hb_fifo_t * f )
+{
+    if (__atomic_load_n(&f->size, __ATOMIC_SEQ_CST) >= f->capacity)
+    {
+        hb_lock(f->lock);
+        __atomic_store_n(&f->wait_full, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&f->size, __ATOMIC_SEQ_CST) >= f->capacity)
+        {
+            hb_cond_timedwait(f->cond_full, f->lock, FIFO_TIMEOUT);
+        }
+        hb_unlock(f->lock);
+    }
+    return __atomic_load_n(&f->size, __ATOMIC_SEQ_CST) < f->capacity;
+}
+
+// Consumer side
+static hb_buffer_t * spsc_get( hb_fifo_t * f )
+{
+    hb_buffer_t * b;
+    // 'overflow' must be sampled before the ring.  While it is non-zero
+    // the producer doesn't add to the ring, so an empty ring then means
+    // that everything older than the parked buffers has been consumed.
+    uint32_t      overflow = fifo_load(&f->overflow);
+    uint32_t      out      = __atomic_load_n(&f->out, __ATOMIC_RELAXED);
+
+    if (out != fifo_load(&f->in))
+    {
+        hb_buffer_t ** slot = &f->ring[out & (f->ring_len - 1)];
+
+        b = *slot;
+        if (b->next != NULL)
+        {
+            // The slot stays owned by the consumer until 'out' advances
+            *slot   = b->next;
+            b->next = NULL;
+        }
+        else
+        {
+            fifo_store(&f->out, out + 1);
+        }
+    }
+    else if (overflow > 0)
+    {
+        hb_lock(f->lock);
+        b        = f->first;
+        f->first = b->next;
+        if (f->first == NULL)
+        {
+            f->last = NULL;
+        }
+        b->next  = NULL;
+        __atomic_sub_fetch(&f->overflow, 1, __ATOMIC_RELEASE);
+        hb_unlock(f->lock);
+    }
+    else
+    {
+        return NULL;
+    }
+
+    spsc_signal_full(f, __atomic_sub_fetch(&f->size, 1, __ATOMIC_SEQ_CST));
+
+    return b;
+}
+
+static void spsc_wait_empty( hb_fifo_t * f )
+{
+    hb_lock(f->lock);
+    __atomic_store_n(&f->wait_empty, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&f->size, __ATOMIC_SEQ_CST) < 1)
+    {
+        hb_cond_timedwait(f->cond_empty, f->lock, FIFO_TIMEOUT);
+    }
+    hb_unlock(f->lock);
+}
+
+// Returns the buffer at position 'index' without removing it
+static hb_buffer_t * spsc_see( hb_fifo_t * f, int index )
+{
+    hb_buffer_t * b;
+    uint32_t      overflow = fifo_load(&f->overflow);
+    uint32_t      out      = __atomic_load_n(&f->out, __ATOMIC_RELAXED);
+    uint32_t      in       = fifo_load(&f->in);
+
+    for (; out != in; out++)
+    {
+        for (b = f->ring[out & (f->ring_len - 1)]; b != NULL; b = b->next)
+        {
+            if (index-- == 0)
+            {
+                return b;
+            }
+        }
+    }
+    if (overflow == 0)
+    {
+        return NULL;
+    }
+
+    hb_lock(f->lock);
+    for (b = f->first; b != NULL && index > 0; b = b->next)
+    {
+        index--;
+    }
+    hb_unlock(f->lock);
+
+    return b;
+}
+
+static int spsc_size_bytes( hb_fifo_t * f )
+{
+    hb_buffer_t * b;
+    int           ret = 0;
+    int           ii;
+
+    for (ii = 0; (b = spsc_see(f, ii)) != NULL; ii++)
+    {
+        ret += b->size;
+    }
+    return ret;
+}
+
+// Puts buffers back in front of the buffers the consumer has not seen yet.
+// This writes the consumer's next slot and may park buffers on the
+// overflow list while the producer still sees 'overflow' as 0, so it is
+// only safe while the fifo is idle: no push or get may run concurrently.
+static void spsc_push_head( hb_fifo_t * f, hb_buffer_t * b )
+{
+    hb_buffer_t * last;
+    uint32_t      count = chain_count(b, &last);
+    uint32_t      out   = __atomic_load_n(&f->out, __ATOMIC_RELAXED);
+
+    spsc_alert_full(f);
+
+    if (out != fifo_load(&f->in))
+    {
+        hb_buffer_t ** slot = &f->ring[out & (f->ring_len - 1)];
+
+        last->next = *slot;
+        *slot      = b;
+        __atomic_add_fetch(&f->size, count, __ATOMIC_SEQ_CST);
+    }
+    else
+    {
+        // Prepending to the overflow list keeps the producer off the
+        // ring until these buffers have been consumed again.
+        hb_lock(f->lock);
+        last->next = f->first;
+        if (f->first == NULL)
+        {
+            f->last = last;
+        }
+        f->first = b;
+        __atomic_add_fetch(&f->overflow, count, __ATOMIC_RELEASE);
+        __atomic_add_fetch(&f->size, count, __ATOMIC_SEQ_CST);
+        hb_unlock(f->lock);
+    }
+}
+
 hb_fifo_t * hb_fifo_init( int capacity, int thresh )
 {
     hb_fifo_t * f;
@@ -1209,16 +1916,80 @@ hb_fifo_t * hb_fifo_init( int capacity, int thresh )
     return f;
 }
 
+// Creates a fifo that may only be pushed to by one thread and pulled from
+// by one other thread at a time.  Pushes and pulls are lock-free unless
+// the other side is sleeping on the fifo.  hb_fifo_push_head() is only
+// allowed while neither side is using the fifo.
+hb_fifo_t * hb_fifo_init_spsc( int capacity, int thresh )
+{
+    hb_fifo_t * f = hb_fifo_init(capacity, thresh);
+
+#if !defined(HB_NO_SPSC_FIFO)
+    // Leave room for pushes beyond capacity (hb_fifo_push doesn't wait)
+    // so that the overflow list is only needed in unusual cases.
+    f->ring_len = 8;
+    while (f->ring_len < 2 * (uint32_t)capacity)
+    {
+        f->ring_len <<= 1;
+    }
+    f->ring = calloc(f->ring_len, sizeof(f->ring[0]));
+    f->spsc = f->ring != NULL;
+#endif
+
+    return f;
+}
+
 void hb_fifo_register_full_cond( hb_fifo_t * f, hb_cond_t * c )
 {
     f->cond_alert_full = c;
 }
 
+// Registers a function that is called, without the fifo lock held,
+// each time buffers are pushed to the fifo.  Must be registered before
+// the fifo is shared between threads.
+void hb_fifo_register_push_notify( hb_fifo_t * f, hb_fifo_notify_t * func,
+                                   void * opaque )
+{
+    f->push_notify = func;
+    f->push_opaque = opaque;
+}
+
+// Registers a function that is called, without the fifo lock held,
+// each time a buffer is pulled out of the fifo.
+void hb_fifo_register_get_notify( hb_fifo_t * f, hb_fifo_notify_t * func,
+                                  void * opaque )
+{
+    f->get_notify = func;
+    f->get_opaque = opaque;
+}
+
+static inline void fifo_notify_push( hb_fifo_t * f )
+{
+    if (f->push_notify != NULL)
+    {
+        f->push_notify(f->push_opaque);
+    }
+}
+
+static inline hb_buffer_t * fifo_notify_get( hb_fifo_t * f, hb_buffer_t * b )
+{
+    if (b != NULL && f->get_notify != NULL)
+    {
+        f->get_notify(f->get_opaque);
+    }
+    return b;
+}
+
 int hb_fifo_size_bytes( hb_fifo_t * f )
 {
     int ret = 0;
     hb_buffer_t * link;
 
+    if (f->spsc)
+    {
+        return spsc_size_bytes(f);
+    }
+
     hb_lock( f->lock );
     link = f->first;
     while ( link )
@@ -1235,6 +2006,11 @@ int hb_fifo_size( hb_fifo_t * f )
 {
     int ret;
 
+    if (f->spsc)
+    {
+        return __atomic_load_n(&f->size, __ATOMIC_SEQ_CST);
+    }
+
     hb_lock( f->lock );
     ret = f->size;
     hb_unlock( f->lock );
@@ -1246,6 +2022,11 @@ int hb_fifo_is_full( hb_fifo_t * f )
 {
     int ret;
 
+    if (f->spsc)
+    {
+        return __atomic_load_n(&f->size, __ATOMIC_SEQ_CST) >= f->capacity;
+    }
+
     hb_lock( f->lock );
     ret = ( f->size >= f->capacity );
     hb_unlock( f->lock );
@@ -1257,6 +2038,11 @@ float hb_fifo_percent_full( hb_fifo_t * f )
 {
     float ret;
 
+    if (f->spsc)
+    {
+        return __atomic_load_n(&f->size, __ATOMIC_SEQ_CST) / f->capacity;
+    }
+
     hb_lock( f->lock );
     ret = f->size / f->capacity;
     hb_unlock( f->lock );
@@ -1270,6 +2056,17 @@ hb_buffer_t * hb_fifo_get_wait( hb_fifo_t * f )
 {
     hb_buffer_t * b;
 
+    if (f->spsc)
+    {
+        b = spsc_get(f);
+        if (b == NULL)
+        {
+            spsc_wait_empty(f);
+            b = spsc_get(f);
+        }
+        return fifo_notify_get(f, b);
+    }
+
     hb_lock( f->lock );
     if( f->size < 1 )
     {
@@ -1292,7 +2089,7 @@ hb_buffer_t * hb_fifo_get_wait( hb_fifo_t * f )
     }
     hb_unlock( f->lock );
 
-    return b;
+    return fifo_notify_get(f, b);
 }
 
 // Pulls a packet out of this FIFO, or returns NULL if no packet is available.
@@ -1300,6 +2097,11 @@ hb_buffer_t * hb_fifo_get( hb_fifo_t * f )
 {
     hb_buffer_t * b;
 
+    if (f->spsc)
+    {
+        return fifo_notify_get(f, spsc_get(f));
+    }
+
     hb_lock( f->lock );
     if( f->size < 1 )
     {
@@ -1317,13 +2119,24 @@ hb_buffer_t * hb_fifo_get( hb_fifo_t * f )
     }
     hb_unlock( f->lock );
 
-    return b;
+    return fifo_notify_get(f, b);
 }
 
 hb_buffer_t * hb_fifo_see_wait( hb_fifo_t * f )
 {
     hb_buffer_t * b;
 
+    if (f->spsc)
+    {
+        b = spsc_see(f, 0);
+        if (b == NULL)
+        {
+            spsc_wait_empty(f);
+            b = spsc_see(f, 0);
+        }
+        return b;
+    }
+
     hb_lock( f->lock );
     if( f->size < 1 )
     {
@@ -1347,6 +2160,11 @@ hb_buffer_t * hb_fifo_see( hb_fifo_t * f )
 {
     hb_buffer_t * b;
 
+    if (f->spsc)
+    {
+        return spsc_see(f, 0);
+    }
+
     hb_lock( f->lock );
     if( f->size < 1 )
     {
@@ -1363,6 +2181,11 @@ hb_buffer_t * hb_fifo_see2( hb_fifo_t * f )
 {
     hb_buffer_t * b;
 
+    if (f->spsc)
+    {
+        return spsc_see(f, 1);
+    }
+
     hb_lock( f->lock );
     if( f->size < 2 )
     {
@@ -1381,6 +2204,11 @@ int hb_fifo_full_wait( hb_fifo_t * f )
 {
     int result;
 
+    if (f->spsc)
+    {
+        return spsc_full_wait(f);
+    }
+
     hb_lock( f->lock );
     if( f->size >= f->capacity )
     {
@@ -1401,6 +2229,14 @@ void hb_fifo_push_wait( hb_fifo_t * f, hb_buffer_t * b )
         return;
     }
 
+    if (f->spsc)
+    {
+        spsc_full_wait(f);
+        spsc_push(f, b);
+        fifo_notify_push(f);
+        return;
+    }
+
     hb_lock( f->lock );
     if( f->size >= f->capacity )
     {
@@ -1430,6 +2266,7 @@ void hb_fifo_push_wait( hb_fifo_t * f, hb_buffer_t * b )
         hb_cond_signal( f->cond_empty );
     }
     hb_unlock( f->lock );
+    fifo_notify_push(f);
 }
 
 // Appends the specified packet list to the end of the specified FIFO.
@@ -1440,6 +2277,13 @@ void hb_fifo_push( hb_fifo_t * f, hb_buffer_t * b )
         return;
     }
 
+    if (f->spsc)
+    {
+        spsc_push(f, b);
+        fifo_notify_push(f);
+        return;
+    }
+
     hb_lock( f->lock );
     if (f->size >= f->capacity &&
         f->cond_alert_full != NULL)
@@ -1467,9 +2311,12 @@ void hb_fifo_push( hb_fifo_t * f, hb_buffer_t * b )
         hb_cond_signal( f->cond_empty );
     }
     hb_unlock( f->lock );
+    fifo_notify_push(f);
 }
 
 // Prepends the specified packet list to the start of the specified FIFO.
+// On a fifo from hb_fifo_init_spsc() the fifo must be idle, see
+// spsc_push_head().
 void hb_fifo_push_head( hb_fifo_t * f, hb_buffer_t * b )
 {
     hb_buffer_t * tmp;
@@ -1480,6 +2327,13 @@ void hb_fifo_push_head( hb_fifo_t * f, hb_buffer_t * b )
         return;
     }
 
+    if (f->spsc)
+    {
+        spsc_push_head(f, b);
+        fifo_notify_push(f);
+        return;
+    }
+
     hb_lock( f->lock );
     if (f->size >= f->capacity &&
         f->cond_alert_full != NULL)
@@ -1510,6 +2364,7 @@ void hb_fifo_push_head( hb_fifo_t * f, hb_buffer_t * b )
     f->size += ( size + 1 );
 
     hb_unlock( f->lock );
+    fifo_notify_push(f);
 }
 
 void hb_fifo_close( hb_fifo_t ** _f )
@@ -1529,6 +2384,7 @@ void hb_fifo_close( hb_fifo_t ** _f )
     hb_lock_close( &f->lock );
     hb_cond_close( &f->cond_empty );
     hb_cond_close( &f->cond_full );
+    free( f->ring );
 
 #if defined(HB_FIFO_DEBUG)
     // Remove the fifo from the global fifo list
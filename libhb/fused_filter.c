@@ -0,0 +1,371 @@
+/* fused_filter.c
+
+   Copyright (c) 2003-2026 HandBrake Team
+   This file is part of the HandBrake source code
+   Homepage: <http://handbrake.fr/>.
+   It may be used under the terms of the GNU General Public License v2.
+   For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
+ */
+
+/* This is a pseudo-filter that runs a sequence of consecutive filters
+ * in one pass. Each frame is cut in bands of lines small enough to stay
+ * in cache, and every band goes through all the filters before the next
+ * one is started, instead of every filter walking the whole frame.
+ *
+ * The filters must provide work_band, i.e. each output line may only
+ * depend on the input lines at most band_halo lines away, and no
+ * context may be carried over from one frame to the next. The lines
+ * of a band that the following filters need as context are computed
+ * again by each band that needs them. Bands are independent and are
+ * spread over the executor threads. */
+
+#include "handbrake/handbrake.h"
+#include "handbrake/executor.h"
+
+// Target size of the luma lines of a band
+#define FUSED_BAND_BYTES      (256 * 1024)
+#define FUSED_BAND_LINES_MIN  16
+
+typedef struct
+{
+    // Intermediate lines, the filters alternate between the two
+    uint8_t     * mem[2][3];
+    hb_buffer_t   band[2];
+} fused_thread_context_t;
+
+struct hb_filter_private_s
+{
+    hb_list_t              * list;      // fused filters, in order
+    int                      halo;      // sum of the filters' band_halo
+
+    hb_executor_t          * executor;
+    int                      threads;
+    fused_thread_context_t * thread_ctx;
+
+    int                      width;
+    int                      height;
+    int                      band_count;
+};
+
+// A frame shared by the threads that process its bands
+typedef struct
+{
+    hb_filter_private_t * pv;
+    hb_buffer_t         * in;
+    hb_buffer_t         * out;
+    int                   thread_count;
+} fused_frame_t;
+
+static int fused_work(hb_filter_object_t *filter,
+                      hb_buffer_t **buf_in,
+                      hb_buffer_t **buf_out);
+static void fused_close(hb_filter_object_t *filter);
+
+hb_filter_object_t hb_filter_fused =
+{
+    .id                = HB_FILTER_FUSED,
+    .enforce_order     = 0,
+    .name              = "Fused filters (fused)",
+    .short_name        = "fused",
+    .settings          = NULL,
+    .work              = fused_work,
+    .close             = fused_close,
+};
+
+static hb_filter_object_t * fused_band_filter(hb_filter_object_t *filter)
+{
+    // Frame threaded filters are wrapped, see hb_filter_init()
+    if (filter->sub_filter != NULL)
+    {
+        filter = filter->sub_filter;
+    }
+    return filter->work_band != NULL ? filter : NULL;
+}
+
+static void fused_thread_close(hb_filter_private_t *pv)
+{
+    if (pv->thread_ctx == NULL)
+    {
+        return;
+    }
+    for (int t = 0; t < pv->threads; t++)
+    {
+        for (int ii = 0; ii < 2; ii++)
+        {
+            for (int c = 0; c < 3; c++)
+            {
+                av_freep(&pv->thread_ctx[t].mem[ii][c]);
+            }
+        }
+    }
+    free(pv->thread_ctx);
+    pv->thread_ctx = NULL;
+}
+
+static int fused_thread_init(hb_filter_private_t *pv, hb_buffer_t *out)
+{
+    fused_thread_close(pv);
+
+    // Bands of FUSED_BAND_BYTES of luma, but at least one per thread
+    int lines = FUSED_BAND_BYTES / out->plane[0].stride;
+    lines = MIN(lines, (out->f.height + pv->threads - 1) / pv->threads);
+    lines = MAX(lines, FUSED_BAND_LINES_MIN);
+
+    pv->width      = out->f.width;
+    pv->height     = out->f.height;
+    pv->band_count = (out->f.height + lines - 1) / lines;
+
+    pv->thread_ctx = calloc(pv->threads, sizeof(fused_thread_context_t));
+    if (pv->thread_ctx == NULL)
+    {
+        hb_error("fused: calloc failed");
+        return -1;
+    }
+    for (int t = 0; t < pv->threads; t++)
+    {
+        fused_thread_context_t *tctx = &pv->thread_ctx[t];
+
+        for (int ii = 0; ii < 2; ii++)
+        {
+            tctx->band[ii].f = out->f;
+            for (int c = 0; c < 3; c++)
+            {
+                // The lines of the band, the context needed by the
+                // following filters and one line for hb_frame_buffer_mirror_stride()
+                int height = (out->plane[c].height + pv->band_count - 1) /
+                             pv->band_count + 2 * pv->halo + 1;
+
+                tctx->band[ii].plane[c].stride = out->plane[c].stride;
+                tctx->band[ii].plane[c].width  = out->plane[c].width;
+                tctx->band[ii].plane[c].height = out->plane[c].height;
+                tctx->mem[ii][c] = av_malloc(out->plane[c].stride * height);
+                if (tctx->mem[ii][c] == NULL)
+                {
+                    hb_error("fused: malloc failed");
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+// Mirror the stride padding of lines [y_start, y_end) of a plane
+static void fused_mirror_stride(hb_buffer_t *buf, int plane,
+                                int y_start, int y_end)
+{
+    hb_buffer_t lines;
+
+    memset(&lines, 0, sizeof(lines));
+    lines.f.fmt         = buf->f.fmt;
+    lines.f.max_plane   = plane;
+    lines.plane[plane]  = buf->plane[plane];
+    lines.plane[plane].data  += y_start * buf->plane[plane].stride;
+    lines.plane[plane].height = y_end - y_start;
+    hb_frame_buffer_mirror_stride(&lines);
+}
+
+static void fused_band(fused_frame_t *f, fused_thread_context_t *tctx,
+                       int band, int plane, int thread)
+{
+    hb_filter_private_t *pv = f->pv;
+    const int height  = f->in->plane[plane].height;
+    const int y_start = height * band / pv->band_count;
+    const int y_end   = height * (band + 1) / pv->band_count;
+    const int count   = hb_list_count(pv->list);
+
+    hb_buffer_t *src = f->in;
+    int halo = pv->halo;
+
+    for (int ii = 0; ii < count; ii++)
+    {
+        hb_filter_object_t *filter = fused_band_filter(hb_list_item(pv->list, ii));
+        hb_buffer_t *dst;
+
+        // Lines needed by the following filters
+        halo -= filter->band_halo;
+        const int start = MAX(y_start - halo, 0);
+        const int end   = MIN(y_end + halo, height);
+
+        if (ii == count - 1)
+        {
+            dst = f->out;
+        }
+        else
+        {
+            // Point the band at where its first line would be in a
+            // frame, so that the filters address it in frame coordinates
+            dst = &tctx->band[ii & 1];
+            dst->plane[plane].data = tctx->mem[ii & 1][plane] -
+                                     start * dst->plane[plane].stride;
+        }
+
+        filter->work_band(filter, src, dst, plane, start, end, thread);
+
+        if (dst != f->out)
+        {
+            fused_mirror_stride(dst, plane, start, end);
+        }
+        src = dst;
+    }
+}
+
+static void fused_thread(void *opaque, int index)
+{
+    fused_frame_t          *f    = opaque;
+    hb_filter_private_t    *pv   = f->pv;
+    fused_thread_context_t *tctx = &pv->thread_ctx[index];
+
+    const int band_start = pv->band_count * index / f->thread_count;
+    const int band_end   = pv->band_count * (index + 1) / f->thread_count;
+
+    for (int band = band_start; band < band_end; band++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            fused_band(f, tctx, band, c, index);
+        }
+    }
+}
+
+static void fused_close(hb_filter_object_t *filter)
+{
+    hb_filter_private_t *pv = filter->private_data;
+
+    if (pv == NULL)
+    {
+        return;
+    }
+
+    // The fused filters are still in the job's filter list,
+    // they are closed from there
+    fused_thread_close(pv);
+    hb_list_close(&pv->list);
+    free(pv);
+    filter->private_data = NULL;
+}
+
+static int fused_work(hb_filter_object_t  * filter,
+                      hb_buffer_t        ** buf_in,
+                      hb_buffer_t        ** buf_out)
+{
+    hb_filter_private_t *pv = filter->private_data;
+    hb_buffer_t *in = *buf_in, *out;
+
+    if (in->s.flags & HB_BUF_FLAG_EOF)
+    {
+        *buf_out = in;
+        *buf_in = NULL;
+        return HB_FILTER_DONE;
+    }
+
+    out = hb_frame_buffer_init(in->f.fmt, in->f.width, in->f.height);
+    out->f.color_prim      = in->f.color_prim;
+    out->f.color_transfer  = in->f.color_transfer;
+    out->f.color_matrix    = in->f.color_matrix;
+    out->f.color_range     = in->f.color_range;
+    out->f.chroma_location = in->f.chroma_location;
+
+    if (pv->thread_ctx == NULL ||
+        pv->width != in->f.width || pv->height != in->f.height)
+    {
+        if (fused_thread_init(pv, out) < 0)
+        {
+            hb_buffer_close(&out);
+            return HB_FILTER_FAILED;
+        }
+    }
+
+    hb_frame_buffer_mirror_stride(in);
+
+    fused_frame_t f =
+    {
+        .pv           = pv,
+        .in           = in,
+        .out          = out,
+        .thread_count = MIN(pv->threads, pv->band_count),
+    };
+    hb_executor_parallel_for(pv->executor, f.thread_count, fused_thread, &f);
+
+    hb_buffer_copy_props(out, in);
+    *buf_out = out;
+
+    return HB_FILTER_OK;
+}
+
+static int fused_init(hb_filter_object_t *filter, hb_job_t *job,
+                      hb_list_t *list, int start, int count)
+{
+    filter->private_data = calloc(sizeof(struct hb_filter_private_s), 1);
+    if (filter->private_data == NULL)
+    {
+        hb_error("fused: calloc failed");
+        return -1;
+    }
+    hb_filter_private_t *pv = filter->private_data;
+
+    pv->list     = hb_list_init();
+    pv->executor = hb_executor_get();
+    pv->threads  = pv->executor ?
+        MIN(hb_executor_thread_count(pv->executor),
+            hb_job_thread_count(job)) : 1;
+
+    for (int ii = start; ii < start + count; ii++)
+    {
+        hb_filter_object_t *band_filter = fused_band_filter(hb_list_item(list, ii));
+
+        // Each band thread needs its own context
+        if (band_filter->init_thread != NULL &&
+            band_filter->init_thread(band_filter, pv->threads) < 0)
+        {
+            return -1;
+        }
+        pv->halo += band_filter->band_halo;
+        hb_list_add(pv->list, hb_list_item(list, ii));
+    }
+
+    return 0;
+}
+
+void hb_fused_filter_combine(hb_job_t *job, hb_list_t *list)
+{
+    for (int ii = 0; ii < hb_list_count(list); ii++)
+    {
+        int count = 0;
+
+        while (ii + count < hb_list_count(list))
+        {
+            hb_filter_object_t *filter = hb_list_item(list, ii + count);
+            if (filter->skip || fused_band_filter(filter) == NULL)
+            {
+                break;
+            }
+            count++;
+        }
+        if (count < 2)
+        {
+            continue;
+        }
+
+        hb_filter_object_t *fused = hb_filter_init(HB_FILTER_FUSED);
+        fused->aliased = 1;
+        if (fused_init(fused, job, list, ii, count) < 0)
+        {
+            hb_log("fused: failed to fuse filters, running them separately");
+            fused->close(fused);
+            hb_filter_close(&fused);
+            ii += count - 1;
+            continue;
+        }
+
+        // The fused filters stay in the list so that they are reported
+        // and closed as usual, but they don't run on their own anymore
+        for (int jj = ii; jj < ii + count; jj++)
+        {
+            hb_filter_object_t *filter = hb_list_item(list, jj);
+            filter->skip = 1;
+        }
+        hb_list_insert(list, ii, fused);
+        ii += count;
+    }
+}
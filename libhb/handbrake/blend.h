@@ -0,0 +1,35 @@
+/* blend.h
+
+   Copyright (c) 2003-2026 HandBrake Team
+   This file is part of the HandBrake source code
+   Homepage: <http://handbrake.fr/>.
+   It may be used under the terms of the GNU General Public License v2.
+   For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
+ */
+
+#ifndef HANDBRAKE_BLEND_H
+#define HANDBRAKE_BLEND_H
+
+typedef struct
+{
+    // dst = (dst * (255 - a) + src * a + bias) / 255
+    void (*blend_row_8)(uint8_t       *dst,
+                        const uint8_t *src,
+                        const uint8_t *alpha,
+                        int            width,
+                        int            bias);
+
+    // max = (256 << alpha_shift) - 1, a = alpha << alpha_shift
+    // dst = (dst * (max - a) + (src << src_shift) * a + bias) / max
+    void (*blend_row_16)(uint16_t      *dst,
+                         const uint8_t *src,
+                         const uint8_t *alpha,
+                         int            width,
+                         int            alpha_shift,
+                         int            src_shift,
+                         int            bias);
+} BlendFunctions;
+
+void blend_init_x86(BlendFunctions *functions);
+
+#endif // HANDBRAKE_BLEND_H
@@ -0,0 +1,78 @@
+/* comb_detect.h
+
+   Copyright (c) 2003-2026 HandBrake Team
+   This file is part of the HandBrake source code
+   Homepage: <http://handbrake.fr/>.
+   It may be used under the terms of the GNU General Public License v2.
+   For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
+ */
+
+#ifndef HANDBRAKE_COMB_DETECT_H
+#define HANDBRAKE_COMB_DETECT_H
+
+typedef struct
+{
+    int          spatial_metric;
+    int          motion_threshold;
+    int          spatial_threshold;
+    int          spatial_threshold_squared;
+    int          spatial_threshold6;
+    int          comb32detect_min;
+    int          comb32detect_max;
+    float        gamma_motion_threshold;
+    float        gamma_spatial_threshold;
+    float        gamma_spatial_threshold6;
+    const float *gamma_lut;
+} comb_detect_params_t;
+
+// Optional accelerated kernels, a NULL entry means the C code is used.
+//
+// The row functions process a prefix of the row and return the number
+// of pixels they handled, the caller finishes the row. The detect row
+// functions only write the mask where combing is found, the caller
+// clears the mask row beforehand. Strides are in samples.
+typedef struct
+{
+    int (*detect_combed_row_8)(const uint8_t *prev, const uint8_t *cur,
+                               const uint8_t *next, int stride_prev,
+                               int stride_cur, int stride_next,
+                               uint8_t *mask, int width, int force_check,
+                               const comb_detect_params_t *params);
+    int (*detect_combed_row_16)(const uint16_t *prev, const uint16_t *cur,
+                                const uint16_t *next, int stride_prev,
+                                int stride_cur, int stride_next,
+                                uint8_t *mask, int width, int force_check,
+                                const comb_detect_params_t *params);
+    int (*detect_gamma_combed_row_8)(const uint8_t *prev, const uint8_t *cur,
+                                     const uint8_t *next, int stride_prev,
+                                     int stride_cur, int stride_next,
+                                     uint8_t *mask, int width, int force_check,
+                                     const comb_detect_params_t *params);
+    int (*detect_gamma_combed_row_16)(const uint16_t *prev, const uint16_t *cur,
+                                      const uint16_t *next, int stride_prev,
+                                      int stride_cur, int stride_next,
+                                      uint8_t *mask, int width, int force_check,
+                                      const comb_detect_params_t *params);
+
+    // curp, cur and curn are the mask rows above, at and below dst,
+    // the pixels left and right of each processed pixel are read
+    int (*mask_filter_row)(const uint8_t *curp, const uint8_t *cur,
+                           const uint8_t *curn, uint8_t *dst,
+                           int width, int classic);
+    int (*mask_dilate_row)(const uint8_t *curp, const uint8_t *cur,
+                           const uint8_t *curn, uint8_t *dst, int width);
+    int (*mask_erode_row)(const uint8_t *curp, const uint8_t *cur,
+                          const uint8_t *curn, uint8_t *dst, int width);
+
+    // Sum of a block of the mask, the and3 variant only counts pixels
+    // whose left and right neighbours are set too and reads one pixel
+    // on either side of the block
+    int (*block_score)(const uint8_t *mask, int stride,
+                       int block_width, int block_height);
+    int (*block_score_and3)(const uint8_t *mask, int stride,
+                            int block_width, int block_height);
+} CombDetectFunctions;
+
+void comb_detect_init_x86(CombDetectFunctions *functions);
+
+#endif // HANDBRAKE_COMB_DETECT_H
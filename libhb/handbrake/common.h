@@ -786,6 +786,9 @@ struct hb_job_s
 #define HB_VCODEC_FFMPEG_DNXHR       (0x00000101 | HB_VCODEC_FFMPEG_MASK)
 #define HB_VCODEC_FFMPEG_DNXHR_10BIT (0x00000102 | HB_VCODEC_FFMPEG_MASK)
 
+// Copies the source video, see vidpass.c
+#define HB_VCODEC_PASS               0x00000200
+
 /* define an invalid CQ value compatible with all CQ-capable codecs */
 #define HB_INVALID_VIDEO_QUALITY (-1000.)
 
@@ -1008,6 +1011,12 @@ struct hb_job_s
 
     uint64_t        st_paused;
 
+    // Threads the decoder, filters and encoder may each use,
+    // 0 for one per CPU. See hb_set_job_threads().
+    int             thread_count;
+    // Data passed between the passes of this job
+    struct hb_interjob_s * interjob;
+
     int             init_delay;
     hb_data_t     * extradata;
 
@@ -1581,6 +1590,7 @@ struct hb_work_object_s
     hb_work_private_t * private_data;
 
     hb_thread_t       * thread;
+    hb_task_t         * task;
     volatile int      * done;
     volatile int      * die;
     int                 status;
@@ -1615,6 +1625,9 @@ extern hb_work_object_t hb_encx264;
 extern hb_work_object_t hb_enctheora;
 extern hb_work_object_t hb_encx265;
 extern hb_work_object_t hb_encsvtav1;
+extern hb_work_object_t hb_encsegment;
+extern hb_work_object_t hb_decvidpass;
+extern hb_work_object_t hb_encvidpass;
 extern hb_work_object_t hb_decavcodeca;
 extern hb_work_object_t hb_decavcodecv;
 extern hb_work_object_t hb_declpcm;
@@ -1685,6 +1698,13 @@ struct hb_filter_object_s
                                         hb_buffer_t **, hb_buffer_t ** );
     int                (* work_thread)( hb_filter_object_t *,
                                         hb_buffer_t **, hb_buffer_t **, int );
+    // Filters lines [y_start, y_end) of one plane, for filters whose
+    // output lines only depend on the input lines at most band_halo
+    // lines away. Lets consecutive filters run fused, see fused_filter.c
+    void               (* work_band)  ( hb_filter_object_t *,
+                                        hb_buffer_t *, hb_buffer_t *,
+                                        int plane, int y_start, int y_end,
+                                        int thread );
     void               (* close)      ( hb_filter_object_t * );
     hb_filter_info_t * (* info)       ( hb_filter_object_t * );
 
@@ -1698,6 +1718,7 @@ struct hb_filter_object_s
     hb_filter_private_t * private_data;
 
     hb_thread_t         * thread;
+    hb_task_t           * task;
     volatile int        * done;
     int                   status;
 
@@ -1707,6 +1728,12 @@ struct hb_filter_object_s
     int64_t               chapter_time;
 
     hb_filter_object_t  * sub_filter;
+
+    int                   band_halo;
+
+    // work may return its input frame with the output written over it,
+    // when the frame is not shared, see hb_filter_frame_output()
+    int                   in_place;
 #endif
 };
 
@@ -1774,7 +1801,9 @@ enum
 
     HB_FILTER_LAST,
     // wrapper filter for frame based multi-threading of simple filters
-    HB_FILTER_MT_FRAME
+    HB_FILTER_MT_FRAME,
+    // wrapper filter that runs consecutive simple filters on bands of lines
+    HB_FILTER_FUSED
 };
 
 hb_filter_object_t * hb_filter_get( int filter_id );
@@ -17,6 +17,56 @@
  */
 extern const int eedi2_limlut[33] __attribute__ ((aligned (16)));
 
+#define EEDI2_DIRECTIONS_BLOCK 16
+
+/**
+ * Optional accelerated kernels, a NULL entry means the C code is used.
+ *
+ * The row functions process a prefix of the pixels 1..width-2 of a row,
+ * the pointers point at pixel 1, and return the number of pixels they
+ * handled. The caller finishes the row.
+ *
+ * The directions functions run the direction search of
+ * eedi2_calc_directions() for EEDI2_DIRECTIONS_BLOCK pixels whose search
+ * window of +-maxd pixels lies within the row. The pointers point at the
+ * first pixel of the block. dirs receives the best direction of each of
+ * the five metrics for each pixel, or -5000 when nothing was found.
+ */
+typedef struct
+{
+    int  (*build_edge_mask_row_8)(uint8_t *dstp, const uint8_t *srcpp, const uint8_t *srcp,
+                                  const uint8_t *srcpn, const int width, const int mthresh,
+                                  const int lthresh, const int vthresh, const int depth);
+    int  (*build_edge_mask_row_16)(uint16_t *dstp, const uint16_t *srcpp, const uint16_t *srcp,
+                                   const uint16_t *srcpn, const int width, const int mthresh,
+                                   const int lthresh, const int vthresh, const int depth);
+
+    int  (*dilate_edge_mask_row_8)(const uint8_t *mskpp, const uint8_t *mskp, const uint8_t *mskpn,
+                                   uint8_t *dstp, const int width, const int dstr, const int depth);
+    int  (*dilate_edge_mask_row_16)(const uint16_t *mskpp, const uint16_t *mskp, const uint16_t *mskpn,
+                                    uint16_t *dstp, const int width, const int dstr, const int depth);
+
+    int  (*erode_edge_mask_row_8)(const uint8_t *mskpp, const uint8_t *mskp, const uint8_t *mskpn,
+                                  uint8_t *dstp, const int width, const int estr, const int depth);
+    int  (*erode_edge_mask_row_16)(const uint16_t *mskpp, const uint16_t *mskp, const uint16_t *mskpn,
+                                   uint16_t *dstp, const int width, const int estr, const int depth);
+
+    void (*calc_directions_block_8)(const uint8_t *mskpp, const uint8_t *mskpn,
+                                    const uint8_t *src2p, const uint8_t *srcpp, const uint8_t *srcp,
+                                    const uint8_t *srcpn, const uint8_t *src2n,
+                                    const int maxd, const int nt13, const int nt19,
+                                    const int top, const int bottom, const int depth,
+                                    int dirs[5][EEDI2_DIRECTIONS_BLOCK]);
+    void (*calc_directions_block_16)(const uint16_t *mskpp, const uint16_t *mskpn,
+                                     const uint16_t *src2p, const uint16_t *srcpp, const uint16_t *srcp,
+                                     const uint16_t *srcpn, const uint16_t *src2n,
+                                     const int maxd, const int nt13, const int nt19,
+                                     const int top, const int bottom, const int depth,
+                                     int dirs[5][EEDI2_DIRECTIONS_BLOCK]);
+} EEDI2Functions;
+
+void eedi2_init_x86(EEDI2Functions *functions);
+
 // Used to order a sequence of metrics for median filtering
 void eedi2_sort_metrics(int *order, const int length);
 
@@ -39,17 +89,20 @@ void eedi2_upscale_by_2_8(const uint8_t *srcp, uint8_t *dstp, const int height,
 
 // Finds places where vertically adjacent pixels abruptly change intensity
 void eedi2_build_edge_mask_8(uint8_t *dstp, const int dst_pitch, const uint8_t *srcp, const int src_pitch,
-                             int mthresh, int lthresh, int vthresh, const int height, const int width, const int depth);
+                             int mthresh, int lthresh, int vthresh, const int height, const int width, const int depth,
+                             const EEDI2Functions *functions);
 
 // Expands and smooths out the edge mask by considering a pixel
 // to be masked if >= dilation threshold adjacent pixels are masked.
 void eedi2_dilate_edge_mask_8(const uint8_t *mskp, const int msk_pitch, uint8_t *dstp, const int dst_pitch,
-                              const int dstr, const int height, const int width, const int depth);
+                              const int dstr, const int height, const int width, const int depth,
+                              const EEDI2Functions *functions);
 
 // Contracts the edge mask by considering a pixel to be masked
 // only if > erosion threshold adjacent pixels are masked
 void eedi2_erode_edge_mask_8(const uint8_t *mskp, const int msk_pitch, uint8_t *dstp, const int dst_pitch,
-                             const int estr, const int height, const int width, const int depth);
+                             const int estr, const int height, const int width, const int depth,
+                             const EEDI2Functions *functions);
 
 // Smooths out horizontally aligned holes in the mask
 // If none of the 6 horizontally adjacent pixels are masked,
@@ -63,7 +116,8 @@ void eedi2_remove_small_gaps_8(const uint8_t *mskp, const int msk_pitch, uint8_t
 // thought of as YADIF_CHECK on steroids. Both find edge directions.
 void eedi2_calc_directions_8(const int plane, const uint8_t *mskp, const int msk_pitch, const uint8_t *srcp, const int src_pitch,
                              uint8_t *dstp, const int dst_pitch, const int maxd, const int nt, const int height, const int width,
-                             const int depth, const uint8_t limlut[33]);
+                             const int depth, const uint8_t limlut[33],
+                             const EEDI2Functions *functions);
 
 void eedi2_filter_map_8(const uint8_t *mskp, const int msk_pitch, const uint8_t *dmskp, const int dmsk_pitch,
                        uint8_t *dstp, const int dst_pitch, const int height, const int width, const int depth);
@@ -119,17 +173,20 @@ void eedi2_upscale_by_2_16(const uint16_t *srcp, uint16_t *dstp, const int heigh
 
 // Finds places where vertically adjacent pixels abruptly change intensity
 void eedi2_build_edge_mask_16(uint16_t *dstp, const int dst_pitch, const uint16_t *srcp, const int src_pitch,
-                             int mthresh, int lthresh, int vthresh, const int height, const int width, const int bitsPerSample);
+                             int mthresh, int lthresh, int vthresh, const int height, const int width, const int bitsPerSample,
+                             const EEDI2Functions *functions);
 
 // Expands and smooths out the edge mask by considering a pixel
 // to be masked if >= dilation threshold adjacent pixels are masked.
 void eedi2_dilate_edge_mask_16(const uint16_t *mskp, const int msk_pitch, uint16_t *dstp, const int dst_pitch,
-                              const int dstr, const int height, const int width, const int depth);
+                              const int dstr, const int height, const int width, const int depth,
+                              const EEDI2Functions *functions);
 
 // Contracts the edge mask by considering a pixel to be masked
 // only if > erosion threshold adjacent pixels are masked
 void eedi2_erode_edge_mask_16(const uint16_t *mskp, const int msk_pitch, uint16_t *dstp, const int dst_pitch,
-                             const int estr, const int height, const int width, const int depth);
+                             const int estr, const int height, const int width, const int depth,
+                             const EEDI2Functions *functions);
 
 // Smooths out horizontally aligned holes in the mask
 // If none of the 6 horizontally adjacent pixels are masked,
@@ -143,7 +200,8 @@ void eedi2_remove_small_gaps_16(const uint16_t *mskp, const int msk_pitch, uint1
 // thought of as YADIF_CHECK on steroids. Both find edge directions.
 void eedi2_calc_directions_16(const int plane, const uint16_t *mskp, const int msk_pitch, const uint16_t *srcp, const int src_pitch,
                              uint16_t *dstp, const int dst_pitch, const int maxd, const int nt, const int height, const int width,
-                              const int depth, const uint16_t limlut[33]);
+                              const int depth, const uint16_t limlut[33],
+                              const EEDI2Functions *functions);
 
 void eedi2_filter_map_16(const uint16_t *mskp, const int msk_pitch, const uint16_t *dmskp, const int dmsk_pitch,
                        uint16_t *dstp, const int dst_pitch, const int height, const int width, const int depth);
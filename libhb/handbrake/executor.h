@@ -0,0 +1,57 @@
+/* executor.h
+
+   Copyright (c) 2003-2026 HandBrake Team
+   This file is part of the HandBrake source code
+   Homepage: <http://handbrake.fr/>.
+   It may be used under the terms of the GNU General Public License v2.
+   For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
+ */
+
+#ifndef HANDBRAKE_EXECUTOR_H
+#define HANDBRAKE_EXECUTOR_H
+
+/*
+ * Process-wide work-stealing thread pool.
+ *
+ * A task is a function that performs one step of work each time it is
+ * run and reports whether it made progress.  A task that can't make
+ * progress goes idle until hb_task_schedule() is called for it, e.g. by
+ * a fifo notification when its input has data or its output has room.
+ * A task never runs on more than one thread at a time.
+ *
+ * Each worker thread has its own task queue.  Tasks scheduled from a
+ * worker go to that worker's queue so that the consumer of a buffer
+ * usually runs on the core that produced it.  Idle workers steal tasks
+ * from the other queues.
+ *
+ * hb_executor_parallel_for() splits data parallel work (e.g. the slices
+ * of a filter) over the same threads, so filters don't need threads of
+ * their own.
+ */
+
+enum
+{
+    HB_TASK_PROGRESS,   // made progress, run again
+    HB_TASK_IDLE,       // can't make progress, wait for hb_task_schedule()
+    HB_TASK_DONE,       // finished, never run again
+};
+
+typedef int (hb_task_func_t)( void * opaque );
+typedef void (hb_parallel_func_t)( void * opaque, int index );
+
+void            hb_executor_global_init( void );
+void            hb_executor_global_close( void );
+
+hb_executor_t * hb_executor_get( void );
+int             hb_executor_thread_count( hb_executor_t * e );
+void            hb_executor_parallel_for( hb_executor_t * e, int count,
+                                          hb_parallel_func_t * func,
+                                          void * opaque );
+
+hb_task_t     * hb_task_init( hb_executor_t * e, const char * name,
+                              hb_task_func_t * func, void * opaque );
+void            hb_task_schedule( hb_task_t * t );
+void            hb_task_stop( hb_task_t * t );
+void            hb_task_close( hb_task_t ** _t );
+
+#endif // HANDBRAKE_EXECUTOR_H
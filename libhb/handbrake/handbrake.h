@@ -42,6 +42,68 @@ int           hb_get_build( hb_handle_t * );
 char *        hb_dvd_name( char * path );
 void          hb_dvd_set_dvdnav( int enable );
 
+/* hb_set_work_executor()
+   Run decoders, filters and encoders of subsequent jobs as tasks on a
+   shared work-stealing thread pool instead of one thread each. */
+void          hb_set_work_executor( int enable );
+
+/* hb_set_scan_threads()
+   Decode the previews of files on up to this many threads at once during
+   subsequent scans, each with its own stream and decoder. 0 uses one
+   thread per CPU, 1 (the default) decodes them one after another. */
+void          hb_set_scan_threads( int threads );
+
+/* hb_set_batch_scan_threads()
+   Scan up to this many files of a folder or a list of paths at once
+   during subsequent scans. Titles are still listed in file order. 0 uses
+   one thread per CPU, 1 (the default) scans them one after another. */
+void          hb_set_batch_scan_threads( int threads );
+
+/* hb_set_scan_cache()
+   Keep the preview scan results of files in the user config directory
+   and reuse them when the same unchanged file is scanned again with the
+   same scan parameters. */
+void          hb_set_scan_cache( int enable );
+
+/* hb_set_preview_memory_limit()
+   Keep the scan previews of each handle in memory, up to this many
+   megabytes (default 256). Previews beyond that are written to temporary
+   files. 0 writes all of them to temporary files. */
+void          hb_set_preview_memory_limit( int megabytes );
+
+/* hb_set_read_ahead()
+   Read up to this many megabytes of the source ahead of the demuxer on
+   a separate thread during subsequent jobs, so that decoding doesn't
+   wait for slow storage. 0 (the default) reads on demand. */
+void          hb_set_read_ahead( int megabytes );
+
+/* hb_set_segment_encoders()
+   Encode the video of subsequent jobs in short segments spread over this
+   many instances of the video encoder at once. Only used for single pass
+   constant quality x264, x265, SVT-AV1, VP8 and VP9 encodes. 0 (the
+   default) encodes with a single instance. */
+void          hb_set_segment_encoders( int count );
+
+/* hb_set_job_concurrency()
+   Work on up to this many jobs of the queue at once after hb_start().
+   Their progress is reported by hb_get_active_job_state(). JSON jobs,
+   which rescan the source, still run on their own. 1 is the default. */
+void          hb_set_job_concurrency( int jobs );
+
+/* hb_set_job_threads()
+   Limit the decoder, filters and encoder of each job to this many
+   threads. 0 (the default) shares the CPUs evenly between concurrent
+   jobs, or uses all of them for a single job. */
+void          hb_set_job_threads( int threads );
+
+/* hb_set_huge_pages()
+   Back the uncompressed frames of subsequent jobs with huge pages, which
+   saves page faults and TLB misses on high resolution encodes. 0 (the
+   default) uses regular pages, 1 transparent huge pages, 2 explicit huge
+   pages reserved with vm.nr_hugepages, falling back to transparent huge
+   pages once they run out. Only supported on Linux. */
+void          hb_set_huge_pages( int mode );
+
 /* hb_scan()
    Scan the specified paths. Can be a DVD device, a VIDEO_TS folder or
    a VOB file. If title_index is 0, scan all titles. */
@@ -81,6 +143,8 @@ int           hb_save_preview( hb_handle_t * h, int title, int preview,
                                hb_buffer_t *buf, int format );
 hb_buffer_t * hb_read_preview( hb_handle_t * h, hb_title_t *title,
                                int preview, int format );
+int           hb_export_preview( hb_handle_t * h, int title, int preview,
+                                 const char * filename );
 #endif // __LIBHB__
 
 hb_image_t  * hb_get_preview(hb_handle_t * h, hb_dict_t * job_dict,
@@ -141,6 +205,13 @@ hb_interjob_t * hb_interjob_get( hb_handle_t * );
 void hb_get_state( hb_handle_t *, hb_state_t * );
 void hb_get_state2( hb_handle_t *, hb_state_t * );
 
+/* hb_get_active_job_count(), hb_get_active_job_state()
+   The number of jobs being worked on, and the state of each of them,
+   oldest first. hb_get_state() reports the oldest one. Returns -1 if
+   there is no job at that index. */
+int  hb_get_active_job_count( hb_handle_t * );
+int  hb_get_active_job_state( hb_handle_t *, int index, hb_state_t * );
+
 /* hb_close()
    Aborts all current jobs if any, frees memory. */
 void          hb_close( hb_handle_t ** );
@@ -47,6 +47,11 @@ void         hb_title_close( hb_title_t ** );
  **********************************************************************/
 int  hb_get_pid( hb_handle_t * );
 void hb_set_state( hb_handle_t *, hb_state_t * );
+#define HB_MAX_ACTIVE_JOBS 16
+void hb_add_active_job( hb_handle_t *, hb_job_t * );
+void hb_rem_active_job( hb_handle_t *, hb_job_t * );
+void hb_get_job_state( hb_job_t *, hb_state_t * );
+void hb_set_job_state( hb_job_t *, hb_state_t * );
 void hb_set_work_error( hb_handle_t * h, hb_error_code err );
 void hb_job_setup_passes(hb_handle_t *h, hb_job_t *job, hb_list_t *list_pass);
 
@@ -134,6 +139,7 @@ struct hb_buffer_s
 {
     int           size;     // size of this packet
     int           alloc;    // used internally by the packet allocator (hb_buffer_init)
+    int           alloc_type; // used internally by the frame allocator (hb_frame_buffer_init)
     uint8_t *     data;     // packet data
     int           offset;   // used internally by packet lists (hb_list_t)
 
@@ -171,6 +177,7 @@ hb_buffer_t * hb_buffer_wrapper_init();
 hb_buffer_t * hb_buffer_init( int size );
 hb_buffer_t * hb_buffer_eof_init( void );
 hb_buffer_t * hb_frame_buffer_init( int pix_fmt, int w, int h);
+void          hb_frame_pool_prewarm( int pix_fmt, int w, int h );
 void          hb_frame_buffer_blank_stride(hb_buffer_t * buf);
 void          hb_frame_buffer_mirror_stride(hb_buffer_t * buf);
 void          hb_buffer_init_planes( hb_buffer_t * b );
@@ -199,8 +206,17 @@ void          hb_buffer_copy_props(hb_buffer_t *dst, const hb_buffer_t *src);
 
 int           hb_buffer_is_writable(const hb_buffer_t *buf);
 
+typedef void (hb_fifo_notify_t)( void * opaque );
+
 hb_fifo_t   * hb_fifo_init( int capacity, int thresh );
+hb_fifo_t   * hb_fifo_init_spsc( int capacity, int thresh );
 void          hb_fifo_register_full_cond( hb_fifo_t * f, hb_cond_t * c );
+void          hb_fifo_register_push_notify( hb_fifo_t * f,
+                                            hb_fifo_notify_t * func,
+                                            void * opaque );
+void          hb_fifo_register_get_notify( hb_fifo_t * f,
+                                           hb_fifo_notify_t * func,
+                                           void * opaque );
 int           hb_fifo_size( hb_fifo_t * );
 int           hb_fifo_size_bytes( hb_fifo_t * );
 int           hb_fifo_is_full( hb_fifo_t * );
@@ -285,7 +301,8 @@ hb_thread_t * hb_scan_init( hb_handle_t *, volatile int * die,
                             int crop_auto_switch_threshold, int crop_median_threshold,
                             hb_list_t * exclude_extensions, int hw_decode, int keep_duplicate_titles);
 hb_thread_t * hb_work_init( hb_list_t * jobs,
-                            volatile int * die, hb_error_code * error, hb_job_t ** job );
+                            volatile int * die, hb_error_code * error );
+int hb_job_thread_count( hb_job_t * job );
 void ReadLoop( void * _w );
 void hb_work_loop( void * );
 hb_work_object_t * hb_muxer_init( hb_job_t * );
@@ -295,6 +312,16 @@ hb_work_object_t * hb_audio_encoder( hb_handle_t *, int );
 hb_work_object_t * hb_video_decoder( hb_handle_t *, int, int, void *, hb_hwaccel_t *hw_accel);
 hb_work_object_t * hb_video_encoder( hb_handle_t *, int );
 
+/***********************************************************************
+ * encsegment.c
+ **********************************************************************/
+int hb_segment_encoding_supported( hb_job_t * job );
+
+/***********************************************************************
+ * vidpass.c
+ **********************************************************************/
+int hb_video_passthru_supported( hb_title_t * title, int mux );
+
 /***********************************************************************
  * sync.c
  **********************************************************************/
@@ -331,6 +358,14 @@ hb_title_t  * hb_batch_title_scan( hb_batch_t * d, int t );
 hb_title_t  * hb_batch_title_scan_single( hb_handle_t * h, char * filename, int t );
 int           hb_is_valid_batch_path( const char * filename );
 
+/***********************************************************************
+ * scancache.c
+ **********************************************************************/
+int  hb_scan_cache_load( hb_handle_t * h, hb_title_t * title,
+                         const char * params, int store_previews );
+void hb_scan_cache_save( hb_handle_t * h, hb_title_t * title,
+                         const char * params, int stored_previews );
+
 /***********************************************************************
  * dvd.c
  **********************************************************************/
@@ -423,6 +458,9 @@ enum
     WORK_ENCX264,
     WORK_ENCX265,
     WORK_ENCSVTAV1,
+    WORK_ENCSEGMENT,
+    WORK_DECVIDPASS,
+    WORK_ENCVIDPASS,
     WORK_ENCTHEORA,
     WORK_DECAVCODEC,
     WORK_DECAVCODECV,
@@ -460,9 +498,21 @@ extern hb_filter_object_t hb_filter_lapsharp;
 extern hb_filter_object_t hb_filter_unsharp;
 extern hb_filter_object_t hb_filter_avfilter;
 extern hb_filter_object_t hb_filter_mt_frame;
+extern hb_filter_object_t hb_filter_fused;
 extern hb_filter_object_t hb_filter_colorspace;
 extern hb_filter_object_t hb_filter_format;
 
+// Combine consecutive filters that have a work_band into one
+// hb_filter_fused, filters must be initialized. The fused filter uses
+// up to hb_job_thread_count(job) threads.
+void hb_fused_filter_combine(hb_job_t * job, hb_list_t * list);
+
+// Returns the frame a filter writes its output for 'in' to. That is 'in'
+// itself if the filter works in place and the frame can be written to,
+// otherwise a new frame with the same dimensions from the frame pools
+hb_buffer_t * hb_filter_frame_output(hb_filter_object_t * filter,
+                                     hb_buffer_t * in, int pix_fmt);
+
 #if defined(__APPLE__)
 extern hb_filter_object_t hb_filter_adapter_vt;
 extern hb_filter_object_t hb_filter_comb_detect_vt;
@@ -11,6 +11,12 @@
 #ifndef HANDBRAKE_NLMEANS_H
 #define HANDBRAKE_NLMEANS_H
 
+struct PixelSum
+{
+    float weight_sum;
+    float pixel_sum;
+};
+
 typedef struct
 {
     void (*build_integral)(uint32_t *integral,
@@ -26,8 +32,21 @@ typedef struct
                            int    dx,
                            int    dy,
                            int    n);
+
+    // Optional, adds the weighted compare pixels of one row of a
+    // displacement to sums and returns the number of pixels processed,
+    // the caller finishes the row
+    int  (*accumulate_row)(struct PixelSum *sums,
+                     const uint32_t *integral_ptr1,
+                     const uint32_t *integral_ptr2,
+                     const void  *compare,
+                           int    n,
+                           int    dst_w,
+                     const float *exptable,
+                     const float  weight_fact_table,
+                     const int    diff_max);
 } NLMeansFunctions;
 
-void nlmeans_init_x86(NLMeansFunctions *functions);
+void nlmeans_init_x86(NLMeansFunctions *functions, int depth);
 
 #endif // HANDBRAKE_NLMEANS_H
@@ -127,6 +127,7 @@ struct dirent * hb_readdir(HB_DIR *dir);
 int hb_mkdir(const char *name);
 int hb_stat(const char *path, hb_stat_t *sb);
 FILE * hb_fopen(const char *path, const char *mode);
+int hb_rename(const char *oldpath, const char *newpath);
 char * hb_strr_dir_sep(const char *path);
 
 /************************************************************************
@@ -10,17 +10,11 @@
 #ifndef HANDBRAKE_TASKSET_H
 #define HANDBRAKE_TASKSET_H
 
-#define TASKSET_POSIX_COMPLIANT 1
-
-typedef struct hb_tasket_thread_t {
-    hb_thread_t      * thread;
-    hb_lock_t        * lock;
-    hb_cond_t        * begin_cond;
-    hb_cond_t        * complete_cond;
-    int                begin;
-    int                complete;
-    int                stop;
-} taskset_thread_t;
+/*
+ * A taskset runs work_func once for each of its thread_count segments
+ * every time taskset_cycle() is called.  The segments run on the shared
+ * executor threads (see executor.h), not on threads of their own.
+ */
 
 typedef struct hb_taskset_s {
     int                thread_count;
@@ -28,8 +22,7 @@ typedef struct hb_taskset_s {
     int                arg_size;
     const char       * task_descr;
     uint8_t          * task_threads_args;
-    int                task_thread_started;
-    taskset_thread_t * task_threads;
+    hb_executor_t    * executor;
 } taskset_t;
 
 typedef struct hb_taskset_thread_arg_s {
@@ -11,6 +11,7 @@
 #include "handbrake/hbffmpeg.h"
 #include "handbrake/hbavfilter.h"
 #include "handbrake/encx264.h"
+#include "handbrake/executor.h"
 #include "handbrake/vaapi_common.h"
 #include "libavfilter/avfilter.h"
 #include <stdio.h>
@@ -29,6 +30,22 @@
 #endif
 #endif
 
+/* A scan preview kept in memory, see hb_save_preview() */
+typedef struct hb_preview_s hb_preview_t;
+struct hb_preview_s
+{
+    int            title;
+    int            index;
+    int            format;    // format of the file it spills to
+    int            on_disk;   // the preview file is up to date
+    int            spilling;  // evicted, being written to its file
+    int            generation; // preview_generation when evicted
+    hb_buffer_t  * buf;       // packed YUV 4:2:0 picture
+    hb_preview_t * prev;      // less recently used
+    hb_preview_t * next;      // more recently used
+    hb_preview_t * spill_next; // next preview written by the same thread
+};
+
 struct hb_handle_s
 {
     int            id;
@@ -48,6 +65,14 @@ struct hb_handle_s
     int            sequence_id;
     hb_list_t    * jobs;
     hb_job_t     * current_job;
+    /* Current pass and state of each job being worked on, oldest
+       first */
+    int            active_job_count;
+    struct
+    {
+        hb_job_t   * job;
+        hb_state_t   state;
+    } active_jobs[HB_MAX_ACTIVE_JOBS];
     volatile int   work_die;
     hb_error_code  work_error;
     hb_thread_t  * work_thread;
@@ -62,6 +87,15 @@ struct hb_handle_s
 
     volatile int   scan_die;
 
+    /* Scan previews kept in memory, least recently used first. Above
+       preview_memory_limit the oldest ones are written to temporary
+       files and dropped. */
+    hb_lock_t    * preview_lock;
+    hb_preview_t * preview_first;
+    hb_preview_t * preview_last;
+    int64_t        preview_memory;
+    int            preview_generation; // bumped by preview_store_clear()
+
     /* Stash of persistent data between jobs, for stuff
        like correcting frame count and framerate estimates
        on multi-pass encodes where frames get dropped.     */
@@ -76,6 +110,7 @@ int hb_instance_counter = 0;
 int disable_hardware = 0;
 
 static void thread_func( void * );
+static void preview_store_clear( hb_handle_t * h );
 
 int hb_avcodec_open(AVCodecContext *avctx, const AVCodec *codec,
                     AVDictionary **av_opts, int thread_count)
@@ -225,6 +260,8 @@ hb_handle_t * hb_init( int verbose )
     h->pause_lock = hb_lock_init();
     h->pause_date = -1;
 
+    h->preview_lock = hb_lock_init();
+
     h->interjob = calloc( sizeof( hb_interjob_t ), 1 );
 
     /* Start library thread */
@@ -323,6 +360,8 @@ void hb_remove_previews( hb_handle_t * h )
     DIR           * dir;
     struct dirent * entry;
 
+    preview_store_clear( h );
+
     dirname = hb_get_temporary_directory();
     dir = opendir( dirname );
     if (dir == NULL)
@@ -514,28 +553,32 @@ hb_list_t * hb_get_title_coverarts( hb_handle_t * h, int title )
 #define HB_PLANES_MAX   3
 #define HB_FORMAT_CHARS 4
 
-int hb_save_preview( hb_handle_t * h, int title, int preview, hb_buffer_t *buf, int format )
+// Memory budget of the scan previews of a handle, see hb_set_preview_memory_limit()
+static int64_t preview_memory_limit = (int64_t)256 << 20;
+
+// hb_set_preview_memory_limit must only be called when no scan is running
+void hb_set_preview_memory_limit( int megabytes )
 {
-    FILE    * file;
-    char    * filename;
-    char      reason[80];
-    char      format_string[HB_FORMAT_CHARS];
+    preview_memory_limit = megabytes > 0 ? (int64_t)megabytes << 20 : 0;
+}
 
+static const char * preview_extension( int format )
+{
     switch (format)
     {
         case HB_PREVIEW_FORMAT_YUV:
-            strncpy(format_string, "yuv", HB_FORMAT_CHARS);
-            break;
+            return "yuv";
         case HB_PREVIEW_FORMAT_JPG:
-            strncpy(format_string, "jpg", HB_FORMAT_CHARS);
-            break;
+            return "jpg";
         default:
-            hb_error("hb_save_preview: Unsupported preview format %d", format);
-            return -1;
+            return NULL;
     }
+}
 
-    filename = hb_get_temporary_filename("%d_%d_%d.%s", hb_get_instance_id(h),
-                                         title, preview, format_string);
+static int write_preview( const char * filename, hb_buffer_t * buf, int format )
+{
+    FILE    * file;
+    char      reason[80];
 
     file = hb_fopen(filename, "wb");
     if (file == NULL)
@@ -546,7 +589,6 @@ int hb_save_preview( hb_handle_t * h, int title, int preview, hb_buffer_t *buf,
         }
         hb_error("hb_save_preview: Failed to open %s (reason: %s)",
                  filename, reason);
-        free(filename);
         return -1;
     }
 
@@ -629,18 +671,375 @@ int hb_save_preview( hb_handle_t * h, int title, int preview, hb_buffer_t *buf,
     }
 
 done:
-    free(filename);
     fclose(file);
 
     return 0;
 }
 
+// Copies the planes of a YUV 4:2:0 picture, cropping or leaving
+// the bottom right of dst untouched if the sizes differ
+static void preview_copy_planes( hb_buffer_t * dst, const hb_buffer_t * src )
+{
+    int pp, hh;
+
+    for (pp = 0; pp < HB_PLANES_MAX; pp++)
+    {
+        const uint8_t * src_data = src->plane[pp].data;
+        uint8_t       * dst_data = dst->plane[pp].data;
+        const int              w = MIN(src->plane[pp].width,  dst->plane[pp].width);
+        const int              h = MIN(src->plane[pp].height, dst->plane[pp].height);
+
+        for (hh = 0; hh < h; hh++)
+        {
+            memcpy(dst_data, src_data, w);
+            dst_data += dst->plane[pp].stride;
+            src_data += src->plane[pp].stride;
+        }
+    }
+}
+
+static hb_buffer_t * preview_copy( const hb_buffer_t * src )
+{
+    hb_buffer_t * buf;
+
+    buf = hb_frame_buffer_init(AV_PIX_FMT_YUV420P,
+                               src->plane[0].width, src->plane[0].height);
+    if (buf != NULL)
+    {
+        preview_copy_planes(buf, src);
+    }
+    return buf;
+}
+
+// The preview_* helpers below must be called with preview_lock held
+
+// spilling tells whether a preview being written to its file may be
+// returned, it can be read but it is not owned by the caller. Those
+// left over from before preview_store_clear() are never returned.
+static hb_preview_t * preview_find( hb_handle_t * h, int title, int index,
+                                    int spilling )
+{
+    hb_preview_t * preview;
+
+    for (preview = h->preview_last; preview != NULL; preview = preview->prev)
+    {
+        if (preview->title == title && preview->index == index &&
+            (!preview->spilling ||
+             (spilling && preview->generation == h->preview_generation)))
+        {
+            return preview;
+        }
+    }
+    return NULL;
+}
+
+static void preview_link( hb_handle_t * h, hb_preview_t * preview )
+{
+    preview->prev = h->preview_last;
+    preview->next = NULL;
+    if (h->preview_last != NULL)
+    {
+        h->preview_last->next = preview;
+    }
+    else
+    {
+        h->preview_first = preview;
+    }
+    h->preview_last     = preview;
+    h->preview_memory += preview->buf->size;
+}
+
+static void preview_unlink( hb_handle_t * h, hb_preview_t * preview )
+{
+    if (preview->prev != NULL)
+    {
+        preview->prev->next = preview->next;
+    }
+    else
+    {
+        h->preview_first = preview->next;
+    }
+    if (preview->next != NULL)
+    {
+        preview->next->prev = preview->prev;
+    }
+    else
+    {
+        h->preview_last = preview->prev;
+    }
+    preview->prev = preview->next = NULL;
+    if (!preview->spilling)
+    {
+        h->preview_memory -= preview->buf->size;
+    }
+}
+
+static void preview_close( hb_preview_t ** _preview )
+{
+    hb_preview_t * preview = *_preview;
+
+    if (preview != NULL)
+    {
+        hb_buffer_close(&preview->buf);
+        free(preview);
+    }
+    *_preview = NULL;
+}
+
+static int preview_is_spilling( hb_handle_t * h, int title, int index )
+{
+    hb_preview_t * preview;
+
+    for (preview = h->preview_first; preview != NULL; preview = preview->next)
+    {
+        if (preview->title == title && preview->index == index &&
+            preview->spilling)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Drops the least recently used previews until the rest fits the
+// memory budget. The ones without an up to date file stay readable
+// while they are written, which preview_store_spill() does once
+// preview_lock is released, so they are returned marked spilling.
+// Only one preview of a (title, index) is written at a time, the
+// others wait for the next trim.
+static hb_preview_t * preview_store_trim( hb_handle_t * h )
+{
+    hb_preview_t * preview, * next, * spill = NULL;
+
+    for (preview = h->preview_first;
+         preview != NULL && h->preview_memory > preview_memory_limit;
+         preview = next)
+    {
+        next = preview->next;
+        if (preview->spilling ||
+            preview_is_spilling(h, preview->title, preview->index))
+        {
+            continue;
+        }
+        if (preview->on_disk)
+        {
+            preview_unlink(h, preview);
+            preview_close(&preview);
+            continue;
+        }
+        h->preview_memory  -= preview->buf->size;
+        preview->spilling   = 1;
+        preview->generation = h->preview_generation;
+        preview->spill_next = spill;
+        spill               = preview;
+    }
+    return spill;
+}
+
+// Writes the previews returned by preview_store_trim() to temporary
+// files and drops them. Must be called without preview_lock held.
+// The file is written under another name and only moved in place if
+// the store wasn't cleared meanwhile, so that a preview of an earlier
+// scan can't turn up after hb_remove_previews().
+static void preview_store_spill( hb_handle_t * h, hb_preview_t * spill )
+{
+    while (spill != NULL)
+    {
+        hb_preview_t * preview = spill, * more;
+        char         * filename, * tmpname;
+
+        spill = preview->spill_next;
+        filename = hb_get_temporary_filename("%d_%d_%d.%s",
+                                             hb_get_instance_id(h),
+                                             preview->title, preview->index,
+                                             preview_extension(preview->format));
+        tmpname = hb_strdup_printf("%s.tmp", filename);
+        if (write_preview(tmpname, preview->buf, preview->format) != 0)
+        {
+            free(tmpname);
+            tmpname = NULL;
+        }
+
+        hb_lock(h->preview_lock);
+        if (tmpname != NULL &&
+            (preview->generation != h->preview_generation ||
+             hb_rename(tmpname, filename) != 0))
+        {
+            unlink(tmpname);
+        }
+        preview_unlink(h, preview);
+        // Previews of the same (title, index) were left for later
+        more = preview_store_trim(h);
+        hb_unlock(h->preview_lock);
+        preview_close(&preview);
+        free(tmpname);
+        free(filename);
+
+        while (more != NULL)
+        {
+            preview             = more;
+            more                = more->spill_next;
+            preview->spill_next = spill;
+            spill               = preview;
+        }
+    }
+}
+
+// Takes ownership of buf. on_disk tells whether the temporary file
+// of the preview already holds this picture.
+static void preview_store_insert( hb_handle_t * h, int title, int index,
+                                  int format, hb_buffer_t * buf, int on_disk )
+{
+    hb_preview_t * preview, * spill;
+
+    if (buf == NULL)
+    {
+        return;
+    }
+
+    hb_lock(h->preview_lock);
+    preview = preview_find(h, title, index, 0);
+    if (preview != NULL)
+    {
+        preview_unlink(h, preview);
+        hb_buffer_close(&preview->buf);
+    }
+    else
+    {
+        preview = calloc(1, sizeof(hb_preview_t));
+        if (preview == NULL)
+        {
+            hb_unlock(h->preview_lock);
+            hb_buffer_close(&buf);
+            return;
+        }
+        preview->title = title;
+        preview->index = index;
+    }
+    preview->format  = format;
+    preview->on_disk = on_disk;
+    preview->buf     = buf;
+    preview_link(h, preview);
+    spill = preview_store_trim(h);
+    hb_unlock(h->preview_lock);
+
+    preview_store_spill(h, spill);
+}
+
+// Copies a preview kept in memory into buf.
+// Returns 0 if the preview is not in memory.
+static int preview_store_read( hb_handle_t * h, int title, int index,
+                               hb_buffer_t * buf )
+{
+    hb_preview_t * preview;
+
+    hb_lock(h->preview_lock);
+    preview = preview_find(h, title, index, 1);
+    if (preview != NULL)
+    {
+        // Most recently used now, unless it is on its way out
+        if (!preview->spilling)
+        {
+            preview_unlink(h, preview);
+            preview_link(h, preview);
+        }
+        preview_copy_planes(buf, preview->buf);
+    }
+    hb_unlock(h->preview_lock);
+
+    return preview != NULL;
+}
+
+static void preview_store_clear( hb_handle_t * h )
+{
+    hb_preview_t * preview, * next;
+
+    // Previews being written are dropped by their writer, which
+    // discards the file once it sees the new generation
+    hb_lock(h->preview_lock);
+    h->preview_generation++;
+    for (preview = h->preview_first; preview != NULL; preview = next)
+    {
+        next = preview->next;
+        if (!preview->spilling)
+        {
+            preview_unlink(h, preview);
+            preview_close(&preview);
+        }
+    }
+    hb_unlock(h->preview_lock);
+}
+
+/**
+ * Stores a scan preview. Previews are kept in memory, up to the
+ * budget set with hb_set_preview_memory_limit(), and only written
+ * to temporary files when they don't fit.
+ */
+int hb_save_preview( hb_handle_t * h, int title, int preview, hb_buffer_t *buf, int format )
+{
+    char * filename;
+    int    ret;
+
+    if (preview_extension(format) == NULL)
+    {
+        hb_error("hb_save_preview: Unsupported preview format %d", format);
+        return -1;
+    }
+
+    if (preview_memory_limit > 0)
+    {
+        hb_buffer_t * copy = preview_copy(buf);
+        if (copy != NULL)
+        {
+            preview_store_insert(h, title, preview, format, copy, 0);
+            return 0;
+        }
+    }
+
+    filename = hb_get_temporary_filename("%d_%d_%d.%s", hb_get_instance_id(h),
+                                         title, preview,
+                                         preview_extension(format));
+    ret = write_preview(filename, buf, format);
+    free(filename);
+
+    return ret;
+}
+
+/**
+ * Writes a scan preview to a JPEG file.
+ * Returns -1 if the preview is not kept in memory.
+ */
+int hb_export_preview( hb_handle_t * h, int title, int preview,
+                       const char * filename )
+{
+    hb_preview_t * entry;
+    hb_buffer_t  * buf = NULL;
+    int            ret = -1;
+
+    // Encode a copy so that other threads don't wait for the file
+    hb_lock(h->preview_lock);
+    entry = preview_find(h, title, preview, 1);
+    if (entry != NULL)
+    {
+        buf = preview_copy(entry->buf);
+    }
+    hb_unlock(h->preview_lock);
+
+    if (buf != NULL)
+    {
+        ret = write_preview(filename, buf, HB_PREVIEW_FORMAT_JPG);
+        hb_buffer_close(&buf);
+    }
+    return ret;
+}
+
 hb_buffer_t * hb_read_preview(hb_handle_t * h, hb_title_t *title, int preview, int format)
 {
     FILE    * file = NULL;
     char    * filename = NULL;
     char      reason[80];
     char      format_string[HB_FORMAT_CHARS];
+    int       loaded = 0;
 
     hb_buffer_t * buf;
     buf = hb_frame_buffer_init(AV_PIX_FMT_YUV420P,
@@ -657,6 +1056,11 @@ hb_buffer_t * hb_read_preview(hb_handle_t * h, hb_title_t *title, int preview, i
         goto done;
     }
 
+    if (preview_store_read(h, title->index, preview, buf))
+    {
+        return buf;
+    }
+
     switch (format)
     {
         case HB_PREVIEW_FORMAT_YUV:
@@ -715,6 +1119,7 @@ hb_buffer_t * hb_read_preview(hb_handle_t * h, hb_title_t *title, int preview, i
                 data += stride;
             }
         }
+        loaded = 1;
     }
     else if (format == HB_PREVIEW_FORMAT_JPG)
     {
@@ -762,6 +1167,10 @@ hb_buffer_t * hb_read_preview(hb_handle_t * h, hb_title_t *title, int preview, i
             hb_error("hb_read_preview: JPEG decompression failed for "
                      "preview image %s", filename);
         }
+        else
+        {
+            loaded = 1;
+        }
 
         tjDestroy(jpeg_decompressor);
         tjFree(jpeg_data);
@@ -771,6 +1180,13 @@ done:
     free(filename);
     fclose(file);
 
+    // Keep it in memory for the next time it's requested
+    if (loaded && preview_memory_limit > 0)
+    {
+        preview_store_insert(h, title->index, preview, format,
+                             preview_copy(buf), 1);
+    }
+
     return buf;
 }
 
@@ -959,6 +1375,7 @@ hb_image_t * hb_get_preview(hb_handle_t * h, hb_dict_t * job_dict,
     }
 
     hb_avfilter_combine(list_filter);
+    hb_fused_filter_combine(job, list_filter);
 
     for( ii = 0; ii < hb_list_count( list_filter ); )
     {
@@ -1944,7 +2361,8 @@ int hb_add( hb_handle_t * h, hb_job_t * job )
 
 void hb_job_setup_passes(hb_handle_t * h, hb_job_t * job, hb_list_t * list_pass)
 {
-    if (job->vquality > HB_INVALID_VIDEO_QUALITY && ! hb_video_multipass_is_supported(job->vcodec, 1))
+    if ((job->vquality > HB_INVALID_VIDEO_QUALITY && ! hb_video_multipass_is_supported(job->vcodec, 1)) ||
+        job->vcodec == HB_VCODEC_PASS)
     {
         job->multipass = 0;
     }
@@ -1995,6 +2413,7 @@ void hb_start( hb_handle_t * h )
     hb_lock( h->state_lock );
     h->state.state       = HB_STATE_WORKING;
     h->state.sequence_id = 0;
+    h->active_job_count  = 0;
 #define p h->state.param.working
     p.pass         = -1;
     p.pass_count   = -1;
@@ -2014,7 +2433,7 @@ void hb_start( hb_handle_t * h )
     h->pause_duration = 0;
     h->work_die       = 0;
     h->work_error     = HB_ERROR_NONE;
-    h->work_thread    = hb_work_init( h->jobs, &h->work_die, &h->work_error, &h->current_job );
+    h->work_thread    = hb_work_init( h->jobs, &h->work_die, &h->work_error );
 }
 
 /**
@@ -2049,9 +2468,14 @@ void hb_resume( hb_handle_t * h )
             // Calculate paused time for current job sequence
             h->pause_duration    += hb_get_date() - h->pause_date;
 
-            // Calculate paused time for current job pass
+            // Calculate paused time for current job passes
             // Required to calculate accurate ETA for pass
-            h->current_job->st_paused += hb_get_date() - h->pause_date;
+            hb_lock( h->state_lock );
+            for (int ii = 0; ii < h->active_job_count; ii++)
+            {
+                h->active_jobs[ii].job->st_paused += hb_get_date() - h->pause_date;
+            }
+            hb_unlock( h->state_lock );
             h->pause_date              = -1;
             h->state.param.working.paused = h->pause_duration;
         }
@@ -2132,6 +2556,7 @@ void hb_close( hb_handle_t ** _h )
     hb_list_close( &h->jobs );
     hb_lock_close( &h->state_lock );
     hb_lock_close( &h->pause_lock );
+    hb_lock_close( &h->preview_lock );
 
     hb_system_sleep_opaque_close(&h->system_sleep_opaque);
 
@@ -2194,6 +2619,9 @@ int hb_global_init()
     hb_register(&hb_encx265);
 #endif
     hb_register(&hb_encsvtav1);
+    hb_register(&hb_encsegment);
+    hb_register(&hb_decvidpass);
+    hb_register(&hb_encvidpass);
 
     hb_x264_global_init();
     hb_common_global_init(disable_hardware);
@@ -2203,6 +2631,8 @@ int hb_global_init()
      */
     hb_buffer_pool_init();
 
+    hb_executor_global_init();
+
     // Initialize the builtin presets hb_dict_t
     hb_presets_builtin_init();
 
@@ -2241,6 +2671,7 @@ void hb_global_close()
         rmdir( dirname );
     }
 
+    hb_executor_global_close();
     hb_common_global_close(disable_hardware);
 }
 
@@ -2401,6 +2832,183 @@ void hb_set_state( hb_handle_t * h, hb_state_t * s )
     hb_unlock( h->pause_lock );
 }
 
+static int active_job_index( hb_handle_t * h, hb_job_t * job )
+{
+    int ii;
+
+    for (ii = 0; ii < h->active_job_count; ii++)
+    {
+        if (h->active_jobs[ii].state.sequence_id == job->sequence_id)
+        {
+            return ii;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Registers a pass of a job that is being worked on. Later passes of
+ * the same job replace the earlier ones.
+ * @param h Handle to hb_handle_t
+ * @param job Handle to the job pass
+ */
+void hb_add_active_job( hb_handle_t * h, hb_job_t * job )
+{
+    int ii;
+
+    if (job == NULL)
+    {
+        return;
+    }
+    hb_lock( h->state_lock );
+    ii = active_job_index(h, job);
+    if (ii < 0 && h->active_job_count < HB_MAX_ACTIVE_JOBS)
+    {
+        hb_state_t * s = &h->active_jobs[h->active_job_count].state;
+
+        ii = h->active_job_count++;
+        memset(s, 0, sizeof(*s));
+        s->state                 = HB_STATE_WORKING;
+        s->sequence_id           = job->sequence_id;
+        s->param.working.hours   = -1;
+        s->param.working.minutes = -1;
+        s->param.working.seconds = -1;
+    }
+    if (ii >= 0)
+    {
+        h->active_jobs[ii].job = job;
+    }
+    h->current_job = job;
+    hb_unlock( h->state_lock );
+}
+
+/**
+ * Unregisters a job once all of its passes are done.
+ * @param h Handle to hb_handle_t
+ * @param job Handle to any pass of the job
+ */
+void hb_rem_active_job( hb_handle_t * h, hb_job_t * job )
+{
+    int ii, count;
+
+    if (job == NULL)
+    {
+        return;
+    }
+    hb_lock( h->state_lock );
+    ii = active_job_index(h, job);
+    if (ii >= 0)
+    {
+        count = --h->active_job_count;
+        memmove(&h->active_jobs[ii], &h->active_jobs[ii + 1],
+                (count - ii) * sizeof(h->active_jobs[0]));
+        h->current_job = count > 0 ? h->active_jobs[count - 1].job : NULL;
+
+        // The next oldest job takes over the overall state
+        if (ii == 0 && count > 0 && h->state.state != HB_STATE_PAUSED)
+        {
+            uint64_t paused = h->state.param.working.paused;
+
+            h->state = h->active_jobs[0].state;
+            if (h->state.state != HB_STATE_MUXING)
+            {
+                h->state.param.working.paused = paused;
+            }
+        }
+    }
+    hb_unlock( h->state_lock );
+}
+
+/**
+ * Returns the number of jobs being worked on.
+ * @param h Handle to hb_handle_t
+ */
+int hb_get_active_job_count( hb_handle_t * h )
+{
+    int count;
+
+    hb_lock( h->state_lock );
+    count = h->active_job_count;
+    hb_unlock( h->state_lock );
+
+    return count;
+}
+
+/**
+ * Returns the state of one of the jobs being worked on, oldest first.
+ * @param h Handle to hb_handle_t
+ * @param index Index of the job
+ * @param s Handle to hb_state_t which to copy the state data.
+ * @return 0 on success, -1 if there is no job at index
+ */
+int hb_get_active_job_state( hb_handle_t * h, int index, hb_state_t * s )
+{
+    int ret = -1;
+
+    hb_lock( h->state_lock );
+    if (index >= 0 && index < h->active_job_count)
+    {
+        memcpy( s, &h->active_jobs[index].state, sizeof( hb_state_t ) );
+        ret = 0;
+    }
+    hb_unlock( h->state_lock );
+
+    return ret;
+}
+
+/**
+ * Returns the state of a job, like hb_get_state2() does for the
+ * oldest job.
+ * @param job Handle to hb_job_t
+ * @param s Handle to hb_state_t which to copy the state data.
+ */
+void hb_get_job_state( hb_job_t * job, hb_state_t * s )
+{
+    hb_handle_t * h = job->h;
+    int           ii;
+
+    hb_lock( h->state_lock );
+    ii = active_job_index(h, job);
+    if (ii >= 0)
+    {
+        memcpy( s, &h->active_jobs[ii].state, sizeof( hb_state_t ) );
+    }
+    else
+    {
+        memcpy( s, &h->state, sizeof( hb_state_t ) );
+    }
+    hb_unlock( h->state_lock );
+}
+
+/**
+ * Sets the state of a job. The oldest job also sets the overall state.
+ * Jobs that could not be registered are not tracked.
+ * @param job Handle to hb_job_t
+ * @param s Handle to new hb_state_t
+ */
+void hb_set_job_state( hb_job_t * job, hb_state_t * s )
+{
+    hb_handle_t * h = job->h;
+    int           ii;
+
+    hb_lock( h->pause_lock );
+    hb_lock( h->state_lock );
+    ii = active_job_index(h, job);
+    if (ii >= 0)
+    {
+        h->active_jobs[ii].state             = *s;
+        h->active_jobs[ii].state.sequence_id = job->sequence_id;
+    }
+    if (ii == 0)
+    {
+        h->state.state       = s->state;
+        h->state.sequence_id = job->sequence_id;
+        h->state.param       = s->param;
+    }
+    hb_unlock( h->state_lock );
+    hb_unlock( h->pause_lock );
+}
+
 void hb_set_work_error( hb_handle_t * h, hb_error_code err )
 {
     h->work_error = err;
@@ -2419,7 +3027,9 @@ void hb_system_sleep_prevent(hb_handle_t *h)
 /* Passes a pointer to persistent data */
 hb_interjob_t * hb_interjob_get( hb_handle_t * h )
 {
-    return h->interjob;
+    hb_job_t * job = h->current_job;
+
+    return job != NULL && job->interjob != NULL ? job->interjob : h->interjob;
 }
 
 int hb_is_hardware_disabled(void)
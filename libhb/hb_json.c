@@ -12,46 +12,82 @@
 #include "handbrake/hb_json.h"
 #include "libavutil/base64.h"
 
-/**
- * Convert an hb_state_t to a jansson dict
- * @param state - Pointer to hb_state_t to convert
- */
-hb_dict_t* hb_state_to_dict( hb_state_t * state)
+static const char * state_name( int state )
 {
-    const char * state_s;
-    hb_dict_t *dict = NULL;
-    json_error_t error;
-
-    switch (state->state)
+    switch (state)
     {
     case HB_STATE_IDLE:
-        state_s = "IDLE";
-        break;
+        return "IDLE";
     case HB_STATE_SCANNING:
-        state_s = "SCANNING";
-        break;
+        return "SCANNING";
     case HB_STATE_SCANDONE:
-        state_s = "SCANDONE";
-        break;
+        return "SCANDONE";
     case HB_STATE_WORKING:
-        state_s = "WORKING";
-        break;
+        return "WORKING";
     case HB_STATE_PAUSED:
-        state_s = "PAUSED";
-        break;
+        return "PAUSED";
     case HB_STATE_SEARCHING:
-        state_s = "SEARCHING";
-        break;
+        return "SEARCHING";
     case HB_STATE_WORKDONE:
-        state_s = "WORKDONE";
-        break;
+        return "WORKDONE";
     case HB_STATE_MUXING:
-        state_s = "MUXING";
-        break;
+        return "MUXING";
     default:
-        state_s = "UNKNOWN";
-        break;
+        return "UNKNOWN";
     }
+}
+
+/**
+ * Convert the progress of each job being worked on to an hb_value_t array
+ * @param h - Pointer to an hb_handle_t hb instance
+ */
+static hb_value_t * jobs_state_to_array( hb_handle_t * h )
+{
+    hb_value_t * jobs = hb_value_array_init();
+    json_error_t error;
+    hb_state_t   state;
+    int          ii;
+
+    for (ii = 0; hb_get_active_job_state(h, ii, &state) == 0; ii++)
+    {
+        hb_dict_t * job_dict;
+        float       progress;
+
+        progress = state.state == HB_STATE_MUXING ?
+                   state.param.muxing.progress : state.param.working.progress;
+        job_dict = json_pack_ex(&error, 0,
+            "{s:o, s:o, s:o, s:o, s:o, s:o, s:o, s:o, s:o, s:o, s:o, s:o}",
+            "SequenceID",   hb_value_int(state.sequence_id),
+            "State",        hb_value_string(state_name(state.state)),
+            "Progress",     hb_value_double(progress),
+            "PassID",       hb_value_int(state.param.working.pass_id),
+            "Pass",         hb_value_int(state.param.working.pass),
+            "PassCount",    hb_value_int(state.param.working.pass_count),
+            "Rate",         hb_value_double(state.param.working.rate_cur),
+            "RateAvg",      hb_value_double(state.param.working.rate_avg),
+            "ETASeconds",   hb_value_int(state.param.working.eta_seconds),
+            "Hours",        hb_value_int(state.param.working.hours),
+            "Minutes",      hb_value_int(state.param.working.minutes),
+            "Seconds",      hb_value_int(state.param.working.seconds));
+        if (job_dict == NULL)
+        {
+            hb_error("hb_state_to_dict, json pack failure: %s", error.text);
+            continue;
+        }
+        hb_value_array_append(jobs, job_dict);
+    }
+    return jobs;
+}
+
+/**
+ * Convert an hb_state_t to a jansson dict
+ * @param state - Pointer to hb_state_t to convert
+ */
+hb_dict_t* hb_state_to_dict( hb_state_t * state)
+{
+    const char * state_s = state_name(state->state);
+    hb_dict_t *dict = NULL;
+    json_error_t error;
 
     switch (state->state)
     {
@@ -159,6 +195,14 @@ char* hb_get_state_json( hb_handle_t * h )
 
     hb_get_state(h, &state);
     hb_dict_t *dict = hb_state_to_dict(&state);
+    if (dict != NULL && hb_get_active_job_count(h) > 0 &&
+        (state.state == HB_STATE_WORKING ||
+         state.state == HB_STATE_PAUSED  ||
+         state.state == HB_STATE_SEARCHING ||
+         state.state == HB_STATE_MUXING))
+    {
+        hb_dict_set(dict, "Jobs", jobs_state_to_array(h));
+    }
 
     char *json_state = hb_value_get_json(dict);
     hb_value_free(&dict);
@@ -8,6 +8,12 @@
  */
 
 #include "handbrake/handbrake.h"
+#include "handbrake/executor.h"
+
+#if defined(ARCH_X86)
+#include <immintrin.h>
+#include "libavutil/cpu.h"
+#endif
 
 #define LAPSHARP_STRENGTH_LUMA_DEFAULT   0.2
 #define LAPSHARP_STRENGTH_CHROMA_DEFAULT 0.2
@@ -15,6 +21,10 @@
 #define LAPSHARP_KERNELS 4
 #define LAPSHARP_KERNEL_LUMA_DEFAULT   2
 #define LAPSHARP_KERNEL_CHROMA_DEFAULT 2
+#define LAPSHARP_KERNEL_SIZE_MAX       5
+
+// Pixels convolved at a time by the C row function
+#define LAPSHARP_BLOCK_WIDTH 64
 
 typedef struct
 {
@@ -23,8 +33,22 @@ typedef struct
 
     double strength;  // strength
     int    kernel;    // which kernel to use; kernels[kernel]
+
+    // Non zero kernel coefficients and their offsets from the center pixel
+    int    taps;
+    int    tap_x[LAPSHARP_KERNEL_SIZE_MAX * LAPSHARP_KERNEL_SIZE_MAX];
+    int    tap_y[LAPSHARP_KERNEL_SIZE_MAX * LAPSHARP_KERNEL_SIZE_MAX];
+    int    tap_coef[LAPSHARP_KERNEL_SIZE_MAX * LAPSHARP_KERNEL_SIZE_MAX];
 } lapsharp_plane_context_t;
 
+// Sharpens pixels [start, end) of a row, stride is in pixels
+typedef void (lapsharp_row_func_t)(const uint8_t *frame_src,
+                                   uint8_t *frame_dst,
+                                   int stride,
+                                   int start,
+                                   int end,
+                                   const lapsharp_plane_context_t *ctx);
+
 typedef struct {
     const int   *mem;
     const int    size;
@@ -90,6 +114,10 @@ struct hb_filter_private_s
     int depth;
 
     lapsharp_plane_context_t plane_ctx[3];
+    lapsharp_row_func_t    * row;
+
+    hb_executor_t          * executor;
+    int                      slice_count;
 
     hb_filter_init_t         input;
     hb_filter_init_t         output;
@@ -102,6 +130,10 @@ static int hb_lapsharp_work(hb_filter_object_t *filter,
                             hb_buffer_t ** buf_in,
                             hb_buffer_t ** buf_out);
 
+static void hb_lapsharp_work_band(hb_filter_object_t *filter,
+                                  hb_buffer_t * in, hb_buffer_t * out,
+                                  int plane, int y_start, int y_end, int thread);
+
 static void hb_lapsharp_close(hb_filter_object_t *filter);
 
 static const char hb_lapsharp_template[] =
@@ -118,76 +150,227 @@ hb_filter_object_t hb_filter_lapsharp =
     .settings          = NULL,
     .init              = hb_lapsharp_init,
     .work              = hb_lapsharp_work,
+    .work_band         = hb_lapsharp_work_band,
     .close             = hb_lapsharp_close,
     .settings_template = hb_lapsharp_template,
 };
 
-#define DEF_LAPSHARP_FUNC(name, nbits, pixelbits)                                                \
+// The taps are summed into a block of 32 bit accumulators first, so
+// that the compiler can vectorize the loops
+#define DEF_LAPSHARP_ROW_FUNC(name, nbits, pixelbits)                                            \
 static void name##_##nbits(const uint8_t *frame_src,                                             \
                                  uint8_t *frame_dst,                                             \
-                           const int width,                                                      \
-                           const int height,                                                     \
-                           int stride_src,                                                       \
-                           int stride_dst,                                                       \
-                           lapsharp_plane_context_t *ctx)                                        \
+                           const int stride,                                                     \
+                           const int start,                                                      \
+                           const int end,                                                        \
+                           const lapsharp_plane_context_t *ctx)                                  \
 {                                                                                                \
-    const kernel_t *kernel = &kernels[ctx->kernel];                                              \
-                                                                                                 \
     const uint##nbits##_t *src = (const uint##nbits##_t *)frame_src;                             \
     uint##nbits##_t       *dst = (uint##nbits##_t *)frame_dst;                                   \
                                                                                                  \
-    stride_src /= ctx->bps;                                                                      \
-    stride_dst /= ctx->bps;                                                                      \
-                                                                                                 \
-    /* Sharpen using selected kernel */                                                          \
-    const int offset_min    = -((kernel->size - 1) / 2);                                         \
-    const int offset_max    =   (kernel->size + 1) / 2;                                          \
-    const int stride_border =   (stride_src - width) / 2;                                        \
-    const int max_value     = ctx->max_value;                                                    \
+    const double coef      = kernels[ctx->kernel].coef;                                          \
+    const double strength  = ctx->strength;                                                      \
+    const int    max_value = ctx->max_value;                                                     \
                                                                                                  \
+    int32_t acc[LAPSHARP_BLOCK_WIDTH];                                                           \
     int##pixelbits##_t pixel;                                                                    \
                                                                                                  \
-    for (int y = 0; y < height; y++)                                                             \
+    for (int x0 = start; x0 < end; x0 += LAPSHARP_BLOCK_WIDTH)                                   \
     {                                                                                            \
-        for (int x = 0; x < width; x++)                                                          \
+        const int n = MIN(LAPSHARP_BLOCK_WIDTH, end - x0);                                       \
+                                                                                                 \
+        memset(acc, 0, sizeof(acc));                                                             \
+        for (int t = 0; t < ctx->taps; t++)                                                      \
         {                                                                                        \
-            if ((y < offset_max) ||                                                              \
-                (y > height - offset_max) ||                                                     \
-                (x < stride_border + offset_max) ||                                              \
-                (x > width + stride_border - offset_max))                                        \
+            const uint##nbits##_t *tap = src + ctx->tap_y[t] * stride + ctx->tap_x[t] + x0;      \
+            const int32_t c = ctx->tap_coef[t];                                                  \
+            for (int i = 0; i < n; i++)                                                          \
             {                                                                                    \
-                *(dst + stride_dst*y + x) = *(src + stride_src*y + x);                           \
-                continue;                                                                        \
+                acc[i] += c * tap[i];                                                            \
             }                                                                                    \
+        }                                                                                        \
                                                                                                  \
-            pixel = 0;                                                                           \
-            for (int k = offset_min; k < offset_max; k++)                                        \
-            {                                                                                    \
-                for (int j = offset_min; j < offset_max; j++)                                    \
-                {                                                                                \
-                    pixel += kernel->mem[((j - offset_min) * kernel->size) +                     \
-                             k - offset_min] * *(src + stride_src*(y + j) + (x + k));            \
-                }                                                                                \
-            }                                                                                    \
-            pixel = (int##pixelbits##_t)(((pixel * kernel->coef) - *(src + stride_src*y + x)) *  \
-                        ctx->strength) + *(src + stride_src*y + x);                              \
+        for (int i = 0; i < n; i++)                                                              \
+        {                                                                                        \
+            const int##pixelbits##_t cur = src[x0 + i];                                          \
+            pixel = (int##pixelbits##_t)(((acc[i] * coef) - cur) * strength) + cur;              \
             pixel = pixel < 0 ? 0 : pixel;                                                       \
             pixel = pixel > max_value ? max_value : pixel;                                       \
-            *(dst + stride_dst*y + x) = (uint##nbits##_t)(pixel);                                \
+            dst[x0 + i] = (uint##nbits##_t)(pixel);                                              \
         }                                                                                        \
     }                                                                                            \
 }                                                                                                \
 
-DEF_LAPSHARP_FUNC(lapsharp, 16, 32)
-DEF_LAPSHARP_FUNC(lapsharp, 8, 16)
+DEF_LAPSHARP_ROW_FUNC(lapsharp_row, 16, 32)
+DEF_LAPSHARP_ROW_FUNC(lapsharp_row, 8, 16)
+
+#if defined(ARCH_X86)
+__attribute__((target("avx2")))
+static inline __m256i lapsharp_load_avx2(const uint8_t *src, int x, int bps)
+{
+    return bps == 1 ?
+        _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(src + x))) :
+        _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(src + x * 2)));
+}
+
+// Same double precision arithmetic as the C code, so the output is identical
+__attribute__((target("avx2")))
+static inline __m128i lapsharp_sharpen_avx2(__m128i acc, __m128i cur,
+                                            __m256d coef, __m256d strength)
+{
+    __m256d v = _mm256_mul_pd(_mm256_cvtepi32_pd(acc), coef);
+    v = _mm256_mul_pd(_mm256_sub_pd(v, _mm256_cvtepi32_pd(cur)), strength);
+    return _mm_add_epi32(_mm256_cvttpd_epi32(v), cur);
+}
 
-#define hb_lapsharp(...)                               \
-    switch (pv->depth)                                 \
-    {                                                  \
-        case  8: lapsharp_8(__VA_ARGS__); break;       \
-        default: lapsharp_16(__VA_ARGS__); break;      \
-    }                                                  \
+__attribute__((target("avx2")))
+static inline void lapsharp_row_avx2(const uint8_t *frame_src,
+                                           uint8_t *frame_dst,
+                                     const int stride,
+                                     const int start,
+                                     const int end,
+                                     const lapsharp_plane_context_t *ctx,
+                                     const int bps)
+{
+    const __m256d coef      = _mm256_set1_pd(kernels[ctx->kernel].coef);
+    const __m256d strength  = _mm256_set1_pd(ctx->strength);
+    const __m256i max_value = _mm256_set1_epi32(ctx->max_value);
+    int x;
 
+    for (x = start; x + 8 <= end; x += 8)
+    {
+        __m256i acc = _mm256_setzero_si256();
+        for (int t = 0; t < ctx->taps; t++)
+        {
+            __m256i v = lapsharp_load_avx2(frame_src,
+                                           x + ctx->tap_y[t] * stride + ctx->tap_x[t], bps);
+            acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(v,
+                                        _mm256_set1_epi32(ctx->tap_coef[t])));
+        }
+
+        __m256i cur = lapsharp_load_avx2(frame_src, x, bps);
+        __m128i lo  = lapsharp_sharpen_avx2(_mm256_castsi256_si128(acc),
+                                            _mm256_castsi256_si128(cur), coef, strength);
+        __m128i hi  = lapsharp_sharpen_avx2(_mm256_extracti128_si256(acc, 1),
+                                            _mm256_extracti128_si256(cur, 1), coef, strength);
+        __m256i pixel = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+        pixel = _mm256_min_epi32(_mm256_max_epi32(pixel, _mm256_setzero_si256()), max_value);
+
+        // Pack the 8 clamped 32 bit values to 16 bit
+        pixel = _mm256_permute4x64_epi64(_mm256_packus_epi32(pixel, pixel),
+                                         _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i out = _mm256_castsi256_si128(pixel);
+        if (bps == 1)
+        {
+            _mm_storel_epi64((__m128i *)(frame_dst + x), _mm_packus_epi16(out, out));
+        }
+        else
+        {
+            _mm_storeu_si128((__m128i *)(frame_dst + x * 2), out);
+        }
+    }
+
+    if (bps == 1)
+    {
+        lapsharp_row_8(frame_src, frame_dst, stride, x, end, ctx);
+    }
+    else
+    {
+        lapsharp_row_16(frame_src, frame_dst, stride, x, end, ctx);
+    }
+}
+
+__attribute__((target("avx2")))
+static void lapsharp_row_8_avx2(const uint8_t *frame_src, uint8_t *frame_dst,
+                                int stride, int start, int end,
+                                const lapsharp_plane_context_t *ctx)
+{
+    lapsharp_row_avx2(frame_src, frame_dst, stride, start, end, ctx, 1);
+}
+
+__attribute__((target("avx2")))
+static void lapsharp_row_16_avx2(const uint8_t *frame_src, uint8_t *frame_dst,
+                                 int stride, int start, int end,
+                                 const lapsharp_plane_context_t *ctx)
+{
+    lapsharp_row_avx2(frame_src, frame_dst, stride, start, end, ctx, 2);
+}
+#endif
+
+static lapsharp_row_func_t * lapsharp_get_row_func(int depth)
+{
+#if defined(ARCH_X86)
+    if (av_get_cpu_flags() & AV_CPU_FLAG_AVX2)
+    {
+        return depth > 8 ? lapsharp_row_16_avx2 : lapsharp_row_8_avx2;
+    }
+#endif
+    return depth > 8 ? lapsharp_row_16 : lapsharp_row_8;
+}
+
+// A frame shared by the slices that process it
+typedef struct
+{
+    hb_filter_private_t * pv;
+    hb_buffer_t         * in;
+    hb_buffer_t         * out;
+    int                   slice_count;
+} lapsharp_frame_t;
+
+static void lapsharp_plane(hb_filter_private_t *pv,
+                           const lapsharp_plane_context_t *ctx,
+                           const uint8_t *src,
+                           uint8_t *dst,
+                           const int width,
+                           const int height,
+                           const int stride_src,
+                           const int stride_dst,
+                           const int y_start,
+                           const int y_end)
+{
+    const kernel_t *kernel = &kernels[ctx->kernel];
+    const int bps = ctx->bps;
+
+    // Pixels closer to the borders than the kernel are copied
+    const int offset_max    = (kernel->size + 1) / 2;
+    const int stride_border = (stride_src / bps - width) / 2;
+    const int x_start       = MIN(MAX(stride_border + offset_max, 0), width);
+    const int x_end         = MAX(MIN(width + stride_border - offset_max + 1, width), x_start);
+
+    for (int y = y_start; y < y_end; y++)
+    {
+        const uint8_t *s = src + stride_src * y;
+        uint8_t       *d = dst + stride_dst * y;
+
+        if ((y < offset_max) || (y > height - offset_max))
+        {
+            memcpy(d, s, width * bps);
+            continue;
+        }
+
+        memcpy(d, s, x_start * bps);
+        pv->row(s, d, stride_src / bps, x_start, x_end, ctx);
+        memcpy(d + x_end * bps, s + x_end * bps, (width - x_end) * bps);
+    }
+}
+
+static void lapsharp_slice(void *opaque, int index)
+{
+    lapsharp_frame_t    *f  = opaque;
+    hb_filter_private_t *pv = f->pv;
+
+    for (int c = 0; c < 3; c++)
+    {
+        const int height = f->in->plane[c].height;
+
+        lapsharp_plane(pv, &pv->plane_ctx[c],
+                       f->in->plane[c].data, f->out->plane[c].data,
+                       f->in->plane[c].width, height,
+                       f->in->plane[c].stride, f->out->plane[c].stride,
+                       height * index / f->slice_count,
+                       height * (index + 1) / f->slice_count);
+    }
+}
 
 static int hb_lapsharp_init(hb_filter_object_t *filter,
                             hb_filter_init_t   *init)
@@ -297,7 +480,34 @@ static int hb_lapsharp_init(hb_filter_object_t *filter,
         {
             ctx->kernel = c ? LAPSHARP_KERNEL_CHROMA_DEFAULT : LAPSHARP_KERNEL_LUMA_DEFAULT;
         }
+
+        const kernel_t *kernel = &kernels[ctx->kernel];
+        const int       offset = (kernel->size - 1) / 2;
+
+        ctx->taps = 0;
+        for (int j = 0; j < kernel->size; j++)
+        {
+            for (int k = 0; k < kernel->size; k++)
+            {
+                if (kernel->mem[j * kernel->size + k] != 0)
+                {
+                    ctx->tap_y[ctx->taps]    = j - offset;
+                    ctx->tap_x[ctx->taps]    = k - offset;
+                    ctx->tap_coef[ctx->taps] = kernel->mem[j * kernel->size + k];
+                    ctx->taps++;
+                }
+            }
+        }
+
+        filter->band_halo = MAX(filter->band_halo, offset);
     }
+
+    pv->row         = lapsharp_get_row_func(pv->depth);
+    pv->executor    = hb_executor_get();
+    pv->slice_count = pv->executor ?
+        MIN(hb_executor_thread_count(pv->executor),
+            hb_job_thread_count(init->job)) : 1;
+
     pv->output = *init;
 
     return 0;
@@ -338,21 +548,31 @@ static int hb_lapsharp_work(hb_filter_object_t *filter,
     out->f.color_range     = pv->output.color_range;
     out->f.chroma_location = pv->output.chroma_location;
 
-    int c;
-    for (c = 0; c < 3; c++)
+    // Slices of at least 16 lines of the luma plane
+    lapsharp_frame_t f =
     {
-        lapsharp_plane_context_t * ctx = &pv->plane_ctx[c];
-        hb_lapsharp(in->plane[c].data,
-                    out->plane[c].data,
-                    in->plane[c].width,
-                    in->plane[c].height,
-                    in->plane[c].stride,
-                    out->plane[c].stride,
-                    ctx);
-    }
+        .pv          = pv,
+        .in          = in,
+        .out         = out,
+        .slice_count = MAX(MIN(pv->slice_count, in->plane[0].height / 16), 1),
+    };
+    hb_executor_parallel_for(pv->executor, f.slice_count, lapsharp_slice, &f);
 
     hb_buffer_copy_props(out, in);
     *buf_out = out;
 
     return HB_FILTER_OK;
 }
+
+static void hb_lapsharp_work_band(hb_filter_object_t *filter,
+                                  hb_buffer_t * in, hb_buffer_t * out,
+                                  int plane, int y_start, int y_end, int thread)
+{
+    hb_filter_private_t *pv = filter->private_data;
+
+    lapsharp_plane(pv, &pv->plane_ctx[plane],
+                   in->plane[plane].data, out->plane[plane].data,
+                   in->plane[plane].width, in->plane[plane].height,
+                   in->plane[plane].stride, out->plane[plane].stride,
+                   y_start, y_end);
+}
@@ -8,6 +8,7 @@
  */
 
 #include "handbrake/handbrake.h"
+#include "handbrake/motion_metric.h"
 
 #if defined (__aarch64__) && !defined(__APPLE__)
     #include <arm_neon.h>
@@ -23,6 +24,8 @@ struct hb_motion_metric_private_s
     uint8_t *approx_buf_a;
     uint8_t *approx_buf_b;
 
+    MotionMetricFunctions functions;
+
     float (*motion_metric)(hb_motion_metric_private_t *pv,
                            int width, int height,
                            int stride_a, int stride_b,
@@ -76,6 +79,28 @@ APPROX_FRAME_DATA(16)
 // Compute the sum of squared errors for a 16x16 block
 // Gamma adjusts pixel values so that less visible differences
 // count less.
+#define DEF_SSE_BLOCK16(nbits)                                                         \
+static unsigned sse_block16##_##nbits(const unsigned *gamma_lut,                       \
+                                   const uint##nbits##_t *a, const uint##nbits##_t *b, \
+                                   int stride_a, int stride_b)                         \
+{                                                                                      \
+    unsigned sum = 0;                                                                  \
+    for (int y = 0; y < 16; y++)                                                       \
+    {                                                                                  \
+        for (int x = 0; x < 16; x++)                                                   \
+        {                                                                              \
+            int diff = gamma_lut[a[x]] - gamma_lut[b[x]];                              \
+            sum += diff * diff;                                                        \
+        }                                                                              \
+        a += stride_a;                                                                 \
+        b += stride_b;                                                                 \
+    }                                                                                  \
+    return sum;                                                                        \
+}                                                                                      \
+
+DEF_SSE_BLOCK16(8)
+DEF_SSE_BLOCK16(16)
+
 #if defined (__aarch64__) && !defined(__APPLE__)
 
 #define DEF_MOTION_METRIC(nbits)                                                           \
@@ -138,28 +163,6 @@ static float motion_metric##_##nbits(hb_motion_metric_private_t *pv,
 
 #else
 
-#define DEF_SSE_BLOCK16(nbits)                                                         \
-static inline unsigned sse_block16##_##nbits(unsigned *gamma_lut,                      \
-                                   const uint##nbits##_t *a, const uint##nbits##_t *b, \
-                                   int stride_a, int stride_b)                         \
-{                                                                                      \
-    unsigned sum = 0;                                                                  \
-    for (int y = 0; y < 16; y++)                                                       \
-    {                                                                                  \
-        for (int x = 0; x < 16; x++)                                                   \
-        {                                                                              \
-            int diff = gamma_lut[a[x]] - gamma_lut[b[x]];                              \
-            sum += diff * diff;                                                        \
-        }                                                                              \
-        a += stride_a;                                                                 \
-        b += stride_b;                                                                 \
-    }                                                                                  \
-    return sum;                                                                        \
-}                                                                                      \
-
-DEF_SSE_BLOCK16(8)
-DEF_SSE_BLOCK16(16)
-
 // Sum of squared errors.  Computes and sums the SSEs for all
 // 16x16 blocks in the images.  Only checks the Y component.
 #define DEF_MOTION_METRIC(nbits)                                                            \
@@ -184,7 +187,7 @@ static float motion_metric##_##nbits(hb_motion_metric_private_t *pv,
     {                                                                                       \
         for (int x = 0; x < bw; x++)                                                        \
         {                                                                                   \
-            sum += sse_block16##_##nbits(pv->gamma_lut,                                     \
+            sum += pv->functions.sse_block16##_##nbits(pv->gamma_lut,                       \
                         buf_a + y * 16 * stride_a + x * 16,                                 \
                         buf_b + y * 16 * stride_b + x * 16,                                 \
                         stride_a, stride_b);                                                \
@@ -213,9 +216,9 @@ static float motion_metric_fast##_##nbits(hb_motion_metric_private_t *pv,
     buf_a = (uint##nbits##_t *)pv->approx_buf_a;                                            \
     buf_b = (uint##nbits##_t *)pv->approx_buf_b;                                            \
                                                                                             \
-    approximate_frame_data##_##nbits((const uint##nbits##_t *)a, buf_a,                     \
+    pv->functions.approximate_frame_data##_##nbits((const uint##nbits##_t *)a, buf_a,       \
                                      stride_a / pv->bps, stride_buf_a, width, height);      \
-    approximate_frame_data##_##nbits((const uint##nbits##_t *)b, buf_b,                     \
+    pv->functions.approximate_frame_data##_##nbits((const uint##nbits##_t *)b, buf_b,       \
                                      stride_b / pv->bps, stride_buf_b, width, height);      \
                                                                                             \
     return motion_metric##_##nbits(pv, width, height,                                       \
@@ -250,6 +253,14 @@ static int hb_motion_metric_init(hb_motion_metric_object_t *metric,
     }
     build_gamma_lut(pv);
 
+    pv->functions.approximate_frame_data_8  = approximate_frame_data_8;
+    pv->functions.approximate_frame_data_16 = approximate_frame_data_16;
+    pv->functions.sse_block16_8             = sse_block16_8;
+    pv->functions.sse_block16_16            = sse_block16_16;
+#if defined(ARCH_X86)
+    motion_metric_init_x86(&pv->functions);
+#endif
+
     int fast = 0;
     if (init->geometry.width >= 1920 || init->geometry.height >= 1080)
     {
@@ -0,0 +1,293 @@
+/* motion_metric_x86.c
+
+   Copyright (c) 2003-2026 HandBrake Team
+   This file is part of the HandBrake source code
+   Homepage: <http://handbrake.fr/>.
+   It may be used under the terms of the GNU General Public License v2.
+   For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
+ */
+
+#include "handbrake/handbrake.h"     // needed for ARCH_X86
+
+#if defined(ARCH_X86)
+
+#include <immintrin.h>
+
+#include "libavutil/cpu.h"
+#include "handbrake/motion_metric.h"
+
+// The results must be identical to the C versions in motion_metric.c.
+// APPROX(a, b, c, d) is avg(avg(a, b), avg(c, d)) with avg rounding up,
+// which is exactly what pavgb/pavgw compute.
+
+#define APPROX(a, b, c, d) (((((uint32_t)a + b + 1) >> 1) + (((uint32_t)c + d + 1) >> 1) + 1) >> 1)
+
+#define APPROX_PIXEL(source, stride, jj)                                        \
+    APPROX(APPROX(source[jj * 4], source[jj * 4 + stride],                      \
+                  source[jj * 4 + 1], source[jj * 4 + stride + 1]),             \
+           APPROX(source[jj * 4 + 2], source[jj * 4 + stride + 2],              \
+                  source[jj * 4 + 3], source[jj * 4 + stride + 3]),             \
+           APPROX(source[jj * 4 + stride * 2], source[jj * 4 + stride * 3],     \
+                  source[jj * 4 + stride * 2 + 1], source[jj * 4 + stride * 3 + 1]), \
+           APPROX(source[jj * 4 + stride * 2 + 2], source[jj * 4 + stride * 3 + 2], \
+                  source[jj * 4 + stride * 2 + 3], source[jj * 4 + stride * 3 + 3]))
+
+// Averages the 4 horizontally adjacent 8 bit samples of each 32 bit lane
+// of a vertically averaged row pair
+static inline __m128i approx_quad_8_sse2(__m128i top, __m128i bottom)
+{
+    const __m128i mask16 = _mm_set1_epi32(0x00ff00ff);
+    const __m128i mask32 = _mm_set1_epi32(0x0000ffff);
+
+    __m128i v = _mm_avg_epu8(top, bottom);
+    v = _mm_avg_epu16(_mm_and_si128(v, mask16), _mm_srli_epi16(v, 8));
+    v = _mm_avg_epu16(_mm_and_si128(v, mask32), _mm_srli_epi32(v, 16));
+    return v;
+}
+
+static void approximate_frame_data_8_sse2(const uint8_t *source, uint8_t *dest,
+                                          int source_stride, int dest_stride,
+                                          int width, int height)
+{
+    for (int ii = 0; ii < height; ii++)
+    {
+        const uint8_t *r0 = source;
+        const uint8_t *r1 = source + source_stride;
+        const uint8_t *r2 = source + source_stride * 2;
+        const uint8_t *r3 = source + source_stride * 3;
+        int jj = 0;
+
+        for (; jj + 16 <= width; jj += 16)
+        {
+            __m128i out[4];
+            for (int kk = 0; kk < 4; kk++)
+            {
+                const int off = jj * 4 + kk * 16;
+                __m128i t = approx_quad_8_sse2(_mm_loadu_si128((const __m128i *)(r0 + off)),
+                                               _mm_loadu_si128((const __m128i *)(r1 + off)));
+                __m128i b = approx_quad_8_sse2(_mm_loadu_si128((const __m128i *)(r2 + off)),
+                                               _mm_loadu_si128((const __m128i *)(r3 + off)));
+                out[kk] = _mm_avg_epu16(t, b);
+            }
+            _mm_storeu_si128((__m128i *)(dest + jj),
+                             _mm_packus_epi16(_mm_packs_epi32(out[0], out[1]),
+                                              _mm_packs_epi32(out[2], out[3])));
+        }
+        for (; jj < width; jj++)
+        {
+            dest[jj] = APPROX_PIXEL(source, source_stride, jj);
+        }
+        source += source_stride * 4;
+        dest += dest_stride;
+    }
+}
+
+// Averages the 4 horizontally adjacent 16 bit samples of each 64 bit lane
+// of a vertically averaged row pair
+static inline __m128i approx_quad_16_sse2(__m128i top, __m128i bottom)
+{
+    const __m128i mask32 = _mm_set1_epi32(0x0000ffff);
+    const __m128i mask64 = _mm_set_epi32(0, 0x0000ffff, 0, 0x0000ffff);
+
+    __m128i v = _mm_avg_epu16(top, bottom);
+    v = _mm_avg_epu16(_mm_and_si128(v, mask32), _mm_srli_epi32(v, 16));
+    v = _mm_avg_epu16(_mm_and_si128(v, mask64), _mm_srli_epi64(v, 32));
+    return v;
+}
+
+static void approximate_frame_data_16_sse2(const uint16_t *source, uint16_t *dest,
+                                           int source_stride, int dest_stride,
+                                           int width, int height)
+{
+    const __m128i bias = _mm_set1_epi32(0x8000);
+    const __m128i sign = _mm_set1_epi16((short)0x8000);
+
+    for (int ii = 0; ii < height; ii++)
+    {
+        const uint16_t *r0 = source;
+        const uint16_t *r1 = source + source_stride;
+        const uint16_t *r2 = source + source_stride * 2;
+        const uint16_t *r3 = source + source_stride * 3;
+        int jj = 0;
+
+        for (; jj + 8 <= width; jj += 8)
+        {
+            __m128i out[4];
+            for (int kk = 0; kk < 4; kk++)
+            {
+                const int off = jj * 4 + kk * 8;
+                __m128i t = approx_quad_16_sse2(_mm_loadu_si128((const __m128i *)(r0 + off)),
+                                                _mm_loadu_si128((const __m128i *)(r1 + off)));
+                __m128i b = approx_quad_16_sse2(_mm_loadu_si128((const __m128i *)(r2 + off)),
+                                                _mm_loadu_si128((const __m128i *)(r3 + off)));
+                // Move the two results to the low 64 bits
+                out[kk] = _mm_shuffle_epi32(_mm_avg_epu16(t, b), _MM_SHUFFLE(3, 1, 2, 0));
+            }
+            // SSE2 has no unsigned 32 to 16 bit pack, pack with a bias
+            __m128i lo = _mm_sub_epi32(_mm_unpacklo_epi64(out[0], out[1]), bias);
+            __m128i hi = _mm_sub_epi32(_mm_unpacklo_epi64(out[2], out[3]), bias);
+            _mm_storeu_si128((__m128i *)(dest + jj),
+                             _mm_xor_si128(_mm_packs_epi32(lo, hi), sign));
+        }
+        for (; jj < width; jj++)
+        {
+            dest[jj] = APPROX_PIXEL(source, source_stride, jj);
+        }
+        source += source_stride * 4;
+        dest += dest_stride;
+    }
+}
+
+// Gamma values are at most 4130 (the LUT is scaled by max_value - 1, so
+// the last 8 bit entry overshoots 4095), so the differences fit in 16 bits
+// and pmaddwd sums the squares of adjacent pairs without overflow.
+static inline __m128i gamma8_sse2(const unsigned *gamma_lut, const uint8_t *p)
+{
+    return _mm_setr_epi16(gamma_lut[p[0]], gamma_lut[p[1]],
+                          gamma_lut[p[2]], gamma_lut[p[3]],
+                          gamma_lut[p[4]], gamma_lut[p[5]],
+                          gamma_lut[p[6]], gamma_lut[p[7]]);
+}
+
+static inline __m128i gamma16_sse2(const unsigned *gamma_lut, const uint16_t *p)
+{
+    return _mm_setr_epi16(gamma_lut[p[0]], gamma_lut[p[1]],
+                          gamma_lut[p[2]], gamma_lut[p[3]],
+                          gamma_lut[p[4]], gamma_lut[p[5]],
+                          gamma_lut[p[6]], gamma_lut[p[7]]);
+}
+
+static inline unsigned hsum_epi32_sse2(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return (unsigned)_mm_cvtsi128_si32(v);
+}
+
+#define DEF_SSE_BLOCK16_SSE2(nbits)                                                         \
+static unsigned sse_block16##_##nbits##_sse2(const unsigned *gamma_lut,                     \
+                                            const uint##nbits##_t *a,                       \
+                                            const uint##nbits##_t *b,                       \
+                                            int stride_a, int stride_b)                     \
+{                                                                                           \
+    __m128i sum = _mm_setzero_si128();                                                      \
+    for (int y = 0; y < 16; y++)                                                            \
+    {                                                                                       \
+        __m128i d0 = _mm_sub_epi16(gamma##nbits##_sse2(gamma_lut, a),                       \
+                                   gamma##nbits##_sse2(gamma_lut, b));                      \
+        __m128i d1 = _mm_sub_epi16(gamma##nbits##_sse2(gamma_lut, a + 8),                   \
+                                   gamma##nbits##_sse2(gamma_lut, b + 8));                  \
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(d0, d0));                                   \
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(d1, d1));                                   \
+        a += stride_a;                                                                      \
+        b += stride_b;                                                                      \
+    }                                                                                       \
+    return hsum_epi32_sse2(sum);                                                            \
+}                                                                                           \
+
+DEF_SSE_BLOCK16_SSE2(8)
+DEF_SSE_BLOCK16_SSE2(16)
+
+__attribute__((target("avx2")))
+static inline __m256i approx_quad_8_avx2(__m256i top, __m256i bottom)
+{
+    const __m256i mask16 = _mm256_set1_epi32(0x00ff00ff);
+    const __m256i mask32 = _mm256_set1_epi32(0x0000ffff);
+
+    __m256i v = _mm256_avg_epu8(top, bottom);
+    v = _mm256_avg_epu16(_mm256_and_si256(v, mask16), _mm256_srli_epi16(v, 8));
+    v = _mm256_avg_epu16(_mm256_and_si256(v, mask32), _mm256_srli_epi32(v, 16));
+    return v;
+}
+
+__attribute__((target("avx2")))
+static void approximate_frame_data_8_avx2(const uint8_t *source, uint8_t *dest,
+                                          int source_stride, int dest_stride,
+                                          int width, int height)
+{
+    // Undo the per 128 bit lane interleaving of the packs below
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    for (int ii = 0; ii < height; ii++)
+    {
+        const uint8_t *r0 = source;
+        const uint8_t *r1 = source + source_stride;
+        const uint8_t *r2 = source + source_stride * 2;
+        const uint8_t *r3 = source + source_stride * 3;
+        int jj = 0;
+
+        for (; jj + 32 <= width; jj += 32)
+        {
+            __m256i out[4];
+            for (int kk = 0; kk < 4; kk++)
+            {
+                const int off = jj * 4 + kk * 32;
+                __m256i t = approx_quad_8_avx2(_mm256_loadu_si256((const __m256i *)(r0 + off)),
+                                               _mm256_loadu_si256((const __m256i *)(r1 + off)));
+                __m256i b = approx_quad_8_avx2(_mm256_loadu_si256((const __m256i *)(r2 + off)),
+                                               _mm256_loadu_si256((const __m256i *)(r3 + off)));
+                out[kk] = _mm256_avg_epu16(t, b);
+            }
+            __m256i v = _mm256_packus_epi16(_mm256_packs_epi32(out[0], out[1]),
+                                            _mm256_packs_epi32(out[2], out[3]));
+            _mm256_storeu_si256((__m256i *)(dest + jj),
+                                _mm256_permutevar8x32_epi32(v, order));
+        }
+        approximate_frame_data_8_sse2(source + jj * 4, dest + jj,
+                                      source_stride, dest_stride, width - jj, 1);
+        source += source_stride * 4;
+        dest += dest_stride;
+    }
+}
+
+#define DEF_SSE_BLOCK16_AVX2(nbits, load)                                                   \
+__attribute__((target("avx2")))                                                             \
+static unsigned sse_block16##_##nbits##_avx2(const unsigned *gamma_lut,                     \
+                                            const uint##nbits##_t *a,                       \
+                                            const uint##nbits##_t *b,                       \
+                                            int stride_a, int stride_b)                     \
+{                                                                                           \
+    const int *lut = (const int *)gamma_lut;                                                \
+    __m256i sum = _mm256_setzero_si256();                                                   \
+    for (int y = 0; y < 16; y++)                                                            \
+    {                                                                                       \
+        __m256i ga0 = _mm256_i32gather_epi32(lut, load(a), 4);                              \
+        __m256i ga1 = _mm256_i32gather_epi32(lut, load(a + 8), 4);                          \
+        __m256i gb0 = _mm256_i32gather_epi32(lut, load(b), 4);                              \
+        __m256i gb1 = _mm256_i32gather_epi32(lut, load(b + 8), 4);                          \
+        __m256i d   = _mm256_packs_epi32(_mm256_sub_epi32(ga0, gb0),                        \
+                                         _mm256_sub_epi32(ga1, gb1));                       \
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(d, d));                               \
+        a += stride_a;                                                                      \
+        b += stride_b;                                                                      \
+    }                                                                                       \
+    return hsum_epi32_sse2(_mm_add_epi32(_mm256_castsi256_si128(sum),                       \
+                                         _mm256_extracti128_si256(sum, 1)));                \
+}                                                                                           \
+
+#define LOAD8_AVX2(p)  _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(p)))
+#define LOAD16_AVX2(p) _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)(p)))
+
+DEF_SSE_BLOCK16_AVX2(8, LOAD8_AVX2)
+DEF_SSE_BLOCK16_AVX2(16, LOAD16_AVX2)
+
+void motion_metric_init_x86(MotionMetricFunctions *functions)
+{
+    const int cpu_flags = av_get_cpu_flags();
+
+    if (cpu_flags & AV_CPU_FLAG_SSE2)
+    {
+        functions->approximate_frame_data_8  = approximate_frame_data_8_sse2;
+        functions->approximate_frame_data_16 = approximate_frame_data_16_sse2;
+        functions->sse_block16_8             = sse_block16_8_sse2;
+        functions->sse_block16_16            = sse_block16_16_sse2;
+    }
+    if (cpu_flags & AV_CPU_FLAG_AVX2)
+    {
+        functions->approximate_frame_data_8  = approximate_frame_data_8_avx2;
+        functions->sse_block16_8             = sse_block16_8_avx2;
+        functions->sse_block16_16            = sse_block16_16_avx2;
+    }
+}
+
+#endif // ARCH_X86
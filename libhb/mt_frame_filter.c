@@ -68,7 +68,7 @@ static int mt_frame_init(hb_filter_object_t * filter,
     pv->sub_filter = filter->sub_filter;
     pv->sub_filter->init(pv->sub_filter, init);
 
-    pv->thread_count = hb_get_cpu_count();
+    pv->thread_count = hb_job_thread_count(init->job);
     pv->buf = calloc(pv->thread_count, sizeof(hb_buffer_t *));
     if (pv->buf == NULL)
     {
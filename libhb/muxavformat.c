@@ -539,6 +539,61 @@ static int avformatInit( hb_mux_object_t * m )
             }
             break;
 
+        case HB_VCODEC_PASS:
+        {
+            hb_title_t * title = job->title;
+
+            if (title->opaque_priv != NULL)
+            {
+                // Keep what libavformat knows about the source video,
+                // profile, level, field order...
+                AVFormatContext *ic = (AVFormatContext*)title->opaque_priv;
+                avcodec_parameters_copy(track->st->codecpar,
+                                        ic->streams[title->video_id]->codecpar);
+                av_freep(&track->st->codecpar->extradata);
+                track->st->codecpar->extradata_size = 0;
+                track->st->codecpar->codec_tag = 0;
+            }
+            track->st->codecpar->codec_id = title->video_codec_param;
+            if (job->mux & HB_MUX_MASK_ISOBFF_FAMILY)
+            {
+                if (title->video_codec_param == AV_CODEC_ID_H264)
+                {
+                    track->st->codecpar->codec_tag = MKTAG('a','v','c','1');
+                }
+                else if (title->video_codec_param == AV_CODEC_ID_HEVC)
+                {
+                    track->st->codecpar->codec_tag = MKTAG('h','v','c','1');
+                }
+            }
+
+            // Elementary streams carry their codec configuration in band,
+            // have libavformat pick it up from the first key frame
+            if (job->extradata == NULL || job->extradata->size == 0)
+            {
+                const AVBitStreamFilter  *bsf;
+                AVBSFContext             *ctx;
+                int                       ret;
+
+                bsf = av_bsf_get_by_name("extract_extradata");
+                ret = av_bsf_alloc(bsf, &ctx);
+                if (ret < 0)
+                {
+                    hb_error("Video passthru bitstream filter: alloc failure");
+                    goto error;
+                }
+                track->bitstream_context = ctx;
+                avcodec_parameters_copy(track->bitstream_context->par_in,
+                                        track->st->codecpar);
+                ret = av_bsf_init(track->bitstream_context);
+                if (ret < 0)
+                {
+                    // Not every codec has parameter sets to extract
+                    av_bsf_free(&track->bitstream_context);
+                }
+            }
+        } break;
+
         default:
             hb_error("muxavformat: Unknown video codec: %x", job->vcodec);
             goto error;
@@ -32,6 +32,7 @@ typedef struct
 
 typedef struct
 {
+    hb_lock_t     * lock;   // protects mf and buffered_size
     hb_mux_data_t * mux_data;
     uint64_t        frames;
     uint64_t        bytes;
@@ -41,7 +42,13 @@ typedef struct
 
 typedef struct
 {
-    hb_lock_t       * mutex;
+    hb_lock_t       * mutex;      // protects all but the tracks' fifos
+    hb_cond_t       * cond;       // signaled when tracks get data or eof,
+                                  // and as the writer drains them
+    hb_thread_t     * writer;     // see muxWriter()
+    uint64_t          pushed;     // number of buffers and eofs queued
+    int               drain;      // a track is waiting for room
+    int               stop;
     int               done;
     hb_mux_object_t * m;
     double            pts;        // end time of next muxing chunk
@@ -60,6 +67,7 @@ struct hb_work_private_s
 {
     hb_job_t  * job;
     int         track;
+    int         eof;
     hb_mux_t  * mux;
     hb_list_t * list_work;
 };
@@ -243,13 +251,19 @@ static int add_mux_track( hb_mux_t *mux, hb_mux_data_t *mux_data,
     hb_track_t *track = calloc( sizeof( hb_track_t ), 1 );
     if (track)
     {
+        track->lock = hb_lock_init();
         track->mux_data = mux_data;
         track->mf.flen = 8;
         track->mf.fifo = calloc( sizeof(track->mf.fifo[0]), track->mf.flen );
     }
 
-    if (track == NULL || track->mf.fifo == NULL)
+    if (track == NULL || track->lock == NULL || track->mf.fifo == NULL)
     {
+        if (track != NULL)
+        {
+            hb_lock_close(&track->lock);
+            free(track->mf.fifo);
+        }
         free(track);
         return -1;
     }
@@ -265,23 +279,26 @@ static int add_mux_track( hb_mux_t *mux, hb_mux_data_t *mux_data,
 
 static int mf_full( hb_track_t * track )
 {
-    if ( track->buffered_size > MAX_BUFFERING )
-        return 1;
+    int full;
 
-    return 0;
+    hb_lock( track->lock );
+    full = track->buffered_size > MAX_BUFFERING;
+    hb_unlock( track->lock );
+
+    return full;
 }
 
-static void mf_push( hb_mux_t * mux, int tk, hb_buffer_t *buf )
+// Adds a buffer to the fifo of a track.  Only the track is locked, so
+// tracks can queue their buffers while the writer thread is writing.
+// Returns the number of bytes that were buffered before.
+static int mf_push( hb_track_t * track, hb_buffer_t *buf )
 {
-    hb_track_t * track = mux->track[tk];
+    hb_lock( track->lock );
+
     uint32_t mask = track->mf.flen - 1;
     uint32_t in = track->mf.in;
+    int      buffered_size = track->buffered_size;
 
-    hb_buffer_reduce( buf, buf->size );
-    if ( track->buffered_size > MAX_BUFFERING )
-    {
-        hb_bitvec_cpy(mux->rdy, mux->allRdy);
-    }
     if ( ( ( in + 1 ) & mask ) == ( track->mf.out & mask ) )
     {
         // fifo is full - expand it to double the current size.
@@ -311,136 +328,127 @@ static void mf_push( hb_mux_t * mux, int tk, hb_buffer_t *buf )
     track->mf.fifo[in & mask] = buf;
     track->mf.in = in + 1;
     track->buffered_size += buf->size;
-    mux->buffered_size += buf->size;
+
+    hb_unlock( track->lock );
+
+    return buffered_size;
 }
 
-static hb_buffer_t *mf_pull( hb_mux_t * mux, int tk )
+// Removes the first buffer of the fifo of a track if it starts before 'pts'
+static hb_buffer_t *mf_pull( hb_track_t * track, double pts )
 {
-    hb_track_t *track =mux->track[tk];
     hb_buffer_t *b = NULL;
+
+    hb_lock( track->lock );
     if ( track->mf.out != track->mf.in )
     {
         // the fifo isn't empty
         b = track->mf.fifo[track->mf.out & (track->mf.flen - 1)];
-        ++track->mf.out;
-
-        track->buffered_size -= b->size;
-        mux->buffered_size -= b->size;
+        if ( b->s.start < pts )
+        {
+            ++track->mf.out;
+            track->buffered_size -= b->size;
+        }
+        else
+        {
+            b = NULL;
+        }
     }
+    hb_unlock( track->lock );
+
     return b;
 }
 
-static hb_buffer_t *mf_peek( hb_track_t *track )
+// Returns 1 if the fifo of a track is empty, or else the start time of
+// the last buffer in 'last_start'
+static int mf_empty( hb_track_t *track, int64_t *last_start )
 {
-    return track->mf.out == track->mf.in ?
-                NULL : track->mf.fifo[track->mf.out & (track->mf.flen - 1)];
-}
+    int empty;
 
-static void MoveToInternalFifos( int tk, hb_mux_t *mux, hb_buffer_t * buf )
-{
-    // move all the buffers on the track's fifo to our internal
-    // fifo so that (a) we don't deadlock in the reader and
-    // (b) we can control how data from multiple tracks is
-    // interleaved in the output file.
-    mf_push( mux, tk, buf );
-    if ( buf->s.start >= mux->pts )
+    hb_lock( track->lock );
+    empty = track->mf.out == track->mf.in;
+    if ( !empty && last_start != NULL )
     {
-        // buffer is past our next interleave point so
-        // note that this track is ready to be output.
-        hb_bitvec_set(mux->rdy, tk);
+        *last_start = track->mf.fifo[(track->mf.in-1) & (track->mf.flen-1)]->s.start;
     }
+    hb_unlock( track->lock );
+
+    return empty;
 }
 
-static void OutputTrackChunk( hb_mux_t *mux, int tk, hb_mux_object_t *m )
+// Writes the buffers of a track that start before 'pts' and returns their
+// size.  It is called without mux->mutex, the writer thread is the only
+// one that takes buffers out of the tracks' fifos.
+static int OutputTrackChunk( hb_mux_t *mux, int tk, hb_mux_object_t *m,
+                             double pts )
 {
     hb_track_t *track = mux->track[tk];
     hb_buffer_t *buf;
+    int size = 0;
 
-    while ( ( buf = mf_peek( track ) ) != NULL && buf->s.start < mux->pts )
+    while ( ( buf = mf_pull( track, pts ) ) != NULL )
     {
-        buf = mf_pull( mux, tk );
         track->frames += 1;
         track->bytes  += buf->size;
+        size          += buf->size;
         m->mux( m, track->mux_data, buf );
     }
+    return size;
 }
 
-static int muxWork( hb_work_object_t * w, hb_buffer_t ** buf_in,
-                     hb_buffer_t ** buf_out )
+// Outputs all that can be output in 'interleave' size chunks once
+// all tracks have at least 'interleave' ticks of data.
+// Must be called with mux->mutex held, which is released during the writes.
+static void muxWriteChunks( hb_mux_t * mux )
 {
-    hb_work_private_t * pv = w->private_data;
-    hb_job_t    * job = pv->job;
-    hb_mux_t    * mux = pv->mux;
-    hb_track_t  * track;
-    int           i;
-    hb_buffer_t * buf = *buf_in;
-
-    hb_lock( mux->mutex );
-    if ( mux->done )
-    {
-        hb_unlock( mux->mutex );
-        return HB_WORK_DONE;
-    }
-
-    if (buf->s.flags & HB_BUF_FLAG_EOF)
-    {
-        // EOF - mark this track as done
-        hb_buffer_close( &buf );
-        hb_bitvec_set(mux->eof, pv->track);
-        hb_bitvec_set(mux->rdy, pv->track);
-    }
-    else if ((job->pass_id != HB_PASS_ENCODE &&
-              job->pass_id != HB_PASS_ENCODE_FINAL) ||
-             hb_bitvec_bit(mux->eof, pv->track))
-    {
-        hb_buffer_close( &buf );
-    }
-    else
-    {
-        MoveToInternalFifos( pv->track, mux, buf );
-    }
-    *buf_in = NULL;
-
-    if (!hb_bitvec_and_cmp(mux->rdy, mux->allRdy, mux->allRdy) &&
-        !hb_bitvec_and_cmp(mux->eof, mux->allEof, mux->allEof))
-    {
-        hb_unlock( mux->mutex );
-        return HB_WORK_OK;
-    }
+    hb_track_t * track;
+    int64_t      last_start;
+    int          i, empty;
 
     hb_bitvec_t *more;
     more = hb_bitvec_new(0);
     hb_bitvec_cpy(more, mux->rdy);
-    // all tracks have at least 'interleave' ticks of data. Output
-    // all that we can in 'interleave' size chunks.
-    while ((hb_bitvec_and_cmp(mux->rdy, mux->allRdy, mux->allRdy) &&
-            hb_bitvec_any(more) && mux->buffered_size > MIN_BUFFERING ) ||
-           (hb_bitvec_cmp(mux->eof, mux->allEof)))
+    while (!mux->stop &&
+           ((hb_bitvec_and_cmp(mux->rdy, mux->allRdy, mux->allRdy) &&
+             hb_bitvec_any(more) && mux->buffered_size > MIN_BUFFERING ) ||
+            (hb_bitvec_cmp(mux->eof, mux->allEof))))
     {
+        double pts = mux->pts;
+
         hb_bitvec_zero(more);
         for ( i = 0; i < mux->ntracks; ++i )
         {
             track = mux->track[i];
-            OutputTrackChunk( mux, i, mux->m );
+
+            hb_unlock( mux->mutex );
+            int size = OutputTrackChunk( mux, i, mux->m, pts );
+            hb_lock( mux->mutex );
+
+            if ( size > 0 )
+            {
+                // wake up the tracks waiting for room, see muxWork()
+                mux->buffered_size -= size;
+                hb_cond_broadcast( mux->cond );
+            }
             if ( mf_full( track ) )
             {
                 // If the track's fifo is still full, advance
                 // the current interleave point and try again.
                 hb_bitvec_cpy(mux->rdy, mux->allRdy);
+                hb_bitvec_set(more, i);
                 break;
             }
 
             // if the track is at eof or still has data that's past
             // our next interleave point then leave it marked as rdy.
             // Otherwise clear rdy.
+            empty = mf_empty( track, &last_start );
             if (hb_bitvec_bit(mux->eof, i) &&
-                (track->mf.out == track->mf.in ||
-                 track->mf.fifo[(track->mf.in-1) & (track->mf.flen-1)]->s.start
-                     < mux->pts + mux->interleave))
+                (empty || last_start < pts + mux->interleave))
             {
                 hb_bitvec_clr(mux->rdy, i);
             }
-            if ( track->mf.out != track->mf.in )
+            if ( !empty )
             {
                 hb_bitvec_set(more, i);
             }
@@ -452,7 +460,7 @@ static int muxWork( hb_work_object_t * w, hb_buffer_t ** buf_in,
         {
             for ( i = 0; i < mux->ntracks; ++i )
             {
-                if ( mux->track[i]->mf.out != mux->track[i]->mf.in )
+                if ( !mf_empty( mux->track[i], NULL ) )
                 {
                     break;
                 }
@@ -460,18 +468,126 @@ static int muxWork( hb_work_object_t * w, hb_buffer_t ** buf_in,
             if ( i >= mux->ntracks )
             {
                 mux->done = 1;
-                *w->done = 1;
-                hb_unlock( mux->mutex );
-                hb_bitvec_free(&more);
-                return HB_WORK_DONE;
+                hb_cond_broadcast( mux->cond );
+                break;
             }
         }
         mux->pts += mux->interleave;
     }
     hb_bitvec_free(&more);
+}
+
+// The writer thread interleaves the tracks and writes them to the file,
+// so that the file I/O doesn't hold up the encoders that feed the tracks.
+static void muxWriter( void * _mux )
+{
+    hb_mux_t * mux = _mux;
+    uint64_t   seen = 0;
 
+    hb_lock( mux->mutex );
+    while ( !mux->done && !mux->stop )
+    {
+        if ( mux->pushed == seen && !mux->drain )
+        {
+            hb_cond_wait( mux->cond, mux->mutex );
+            continue;
+        }
+        seen = mux->pushed;
+        mux->drain = 0;
+
+        if (hb_bitvec_and_cmp(mux->rdy, mux->allRdy, mux->allRdy) ||
+            hb_bitvec_and_cmp(mux->eof, mux->allEof, mux->allEof))
+        {
+            muxWriteChunks( mux );
+        }
+        // let the tracks waiting for room check again
+        hb_cond_broadcast( mux->cond );
+    }
     hb_unlock( mux->mutex );
-    return HB_WORK_OK;
+}
+
+static int muxWork( hb_work_object_t * w, hb_buffer_t ** buf_in,
+                     hb_buffer_t ** buf_out )
+{
+    hb_work_private_t * pv = w->private_data;
+    hb_job_t    * job = pv->job;
+    hb_mux_t    * mux = pv->mux;
+    hb_buffer_t * buf = *buf_in;
+    int           done;
+
+    *buf_in = NULL;
+    if (buf->s.flags & HB_BUF_FLAG_EOF)
+    {
+        // EOF - mark this track as done
+        hb_buffer_close( &buf );
+        pv->eof = 1;
+
+        hb_lock( mux->mutex );
+        hb_bitvec_set(mux->eof, pv->track);
+        hb_bitvec_set(mux->rdy, pv->track);
+        mux->pushed++;
+        hb_cond_broadcast( mux->cond );
+        if (hb_bitvec_cmp(mux->eof, mux->allEof))
+        {
+            // This was the last track, the job is complete
+            // once the writer has purged all the tracks
+            while ( !mux->done && !mux->stop )
+            {
+                hb_cond_wait( mux->cond, mux->mutex );
+            }
+            *w->done = 1;
+        }
+        done = mux->done;
+        hb_unlock( mux->mutex );
+
+        return done ? HB_WORK_DONE : HB_WORK_OK;
+    }
+
+    if ((job->pass_id != HB_PASS_ENCODE &&
+         job->pass_id != HB_PASS_ENCODE_FINAL) || pv->eof)
+    {
+        hb_buffer_close( &buf );
+        return mux->done ? HB_WORK_DONE : HB_WORK_OK;
+    }
+
+    // move all the buffers on the track's fifo to our internal
+    // fifo so that (a) we don't deadlock in the reader and
+    // (b) we can control how data from multiple tracks is
+    // interleaved in the output file.
+    hb_buffer_reduce( buf, buf->size );
+
+    int64_t start = buf->s.start;
+    int     size  = buf->size;
+    int     buffered_size = mf_push( mux->track[pv->track], buf );
+
+    hb_lock( mux->mutex );
+    if ( buffered_size > MAX_BUFFERING )
+    {
+        hb_bitvec_cpy(mux->rdy, mux->allRdy);
+    }
+    if ( start >= mux->pts )
+    {
+        // buffer is past our next interleave point so
+        // note that this track is ready to be output.
+        hb_bitvec_set(mux->rdy, pv->track);
+    }
+    mux->buffered_size += size;
+    mux->pushed++;
+    hb_cond_broadcast( mux->cond );
+    // Hold the encoder back while the writer can't keep up, rather than
+    // buffer without bound. Waiting for the other tracks to catch up could
+    // block them too, so let the writer output what it has.
+    while ( mux->buffered_size > MAX_BUFFERING && !mux->done && !mux->stop )
+    {
+        hb_bitvec_cpy(mux->rdy, mux->allRdy);
+        mux->drain = 1;
+        hb_cond_broadcast( mux->cond );
+        hb_cond_wait( mux->cond, mux->mutex );
+    }
+    done = mux->done;
+    hb_unlock( mux->mutex );
+
+    return done ? HB_WORK_DONE : HB_WORK_OK;
 }
 
 static void muxFlush(hb_mux_t * mux)
@@ -483,8 +599,8 @@ static void muxFlush(hb_mux_t * mux)
         done = 1;
         for (ii = 0; ii < mux->ntracks; ii++)
         {
-            OutputTrackChunk(mux, ii, mux->m);
-            if (mux->track[ii]->mf.out != mux->track[ii]->mf.in)
+            mux->buffered_size -= OutputTrackChunk(mux, ii, mux->m, mux->pts);
+            if (!mf_empty(mux->track[ii], NULL))
             {
                 // track buffer is not empty
                 done = 0;
@@ -517,7 +633,31 @@ static void muxClose( hb_work_object_t * muxer )
     hb_work_object_t  * w;
     int                 i;
 
+    // Stop the writer, then close the mux work threads, which may
+    // be waiting for it, before anything they use goes away
     hb_lock( mux->mutex );
+    mux->stop = 1;
+    hb_cond_broadcast( mux->cond );
+    hb_unlock( mux->mutex );
+
+    while ((w = hb_list_item(pv->list_work, 0)))
+    {
+        hb_list_rem(pv->list_work, w);
+        if (w->thread != NULL)
+        {
+            hb_thread_close( &w->thread );
+        }
+        free(w->private_data);
+        free(w);
+    }
+    hb_list_close(&pv->list_work);
+
+    if (mux->writer != NULL)
+    {
+        hb_thread_close( &mux->writer );
+    }
+
+    // Only this thread is left, write what the writer didn't get to
     muxFlush(mux);
 
     // Update state before closing muxer.  Closing the muxer
@@ -529,10 +669,10 @@ static void muxClose( hb_work_object_t * muxer )
     {
         /* Update the UI */
         hb_state_t state;
-        hb_get_state2(job->h, &state);
+        hb_get_job_state(job, &state);
         state.state = HB_STATE_MUXING;
         state.param.muxing.progress = 0;
-        hb_set_state(job->h, &state);
+        hb_set_job_state(job, &state);
     }
 
     if( mux->m )
@@ -586,34 +726,22 @@ static void muxClose( hb_work_object_t * muxer )
     {
         hb_buffer_t * b;
         track = mux->track[i];
-        while ( (b = mf_pull( mux, i )) != NULL )
+        while ( (b = mf_pull( track, INFINITY )) != NULL )
         {
             hb_buffer_close( &b );
         }
+        hb_lock_close(&track->lock);
         free(track->mf.fifo);
         free(track);
     }
     free(mux->track);
-    hb_unlock( mux->mutex );
+    hb_cond_close( &mux->cond );
     hb_lock_close( &mux->mutex );
     hb_bitvec_free(&mux->eof);
     hb_bitvec_free(&mux->rdy);
     hb_bitvec_free(&mux->allEof);
     hb_bitvec_free(&mux->allRdy);
     free( mux );
-
-    // Close mux work threads
-    while ((w = hb_list_item(pv->list_work, 0)))
-    {
-        hb_list_rem(pv->list_work, w);
-        if (w->thread != NULL)
-        {
-            hb_thread_close( &w->thread );
-        }
-        free(w->private_data);
-        free(w);
-    }
-    hb_list_close(&pv->list_work);
     free( pv );
     muxer->private_data = NULL;
 }
@@ -634,7 +762,8 @@ static int muxInit( hb_work_object_t * muxer, hb_job_t * job )
     }
 
     mux->mutex = hb_lock_init();
-    if (mux->mutex == NULL)
+    mux->cond  = hb_cond_init();
+    if (mux->mutex == NULL || mux->cond == NULL)
     {
         goto fail;
     }
@@ -747,7 +876,8 @@ static int muxInit( hb_work_object_t * muxer, hb_job_t * job )
         }
     }
 
-    /* Launch processing threads */
+    /* Launch the writer and the processing threads */
+    mux->writer = hb_thread_init("mux writer", muxWriter, mux, HB_LOW_PRIORITY);
     for (int i = 0; i < hb_list_count(pv->list_work); i++)
     {
         hb_work_object_t *w = hb_list_item(pv->list_work, i);
@@ -757,8 +887,9 @@ static int muxInit( hb_work_object_t * muxer, hb_job_t * job )
     return 0;
 
 fail:
-    if (pv->mux == NULL)
+    if (pv->mux == NULL && mux != NULL)
     {
+        hb_cond_close(&mux->cond);
         hb_lock_close(&mux->mutex);
         free(mux);
     }
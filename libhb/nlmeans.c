@@ -109,12 +109,6 @@ typedef struct
     hb_buffer_t *buf;        // input buf sidedata
 } Frame;
 
-struct PixelSum
-{
-    float weight_sum;
-    float pixel_sum;
-};
-
 typedef struct
 {
     taskset_thread_arg_t arg;
@@ -248,7 +242,7 @@ static int nlmeans_init(hb_filter_object_t *filter,
             pv->nlmeans_deborder      = nlmeans_deborder_8;
             pv->nlmeans_plane         = nlmeans_plane_8;
         #if defined(ARCH_X86)
-            nlmeans_init_x86(functions);
+            nlmeans_init_x86(functions, pv->depth);
         #endif
             break;
 
@@ -259,6 +253,9 @@ static int nlmeans_init(hb_filter_object_t *filter,
             pv->nlmeans_prefilter     = nlmeans_prefilter_16;
             pv->nlmeans_deborder      = nlmeans_deborder_16;
             pv->nlmeans_plane         = nlmeans_plane_16;
+        #if defined(ARCH_X86)
+            nlmeans_init_x86(functions, pv->depth);
+        #endif
             break;
     }
 
@@ -360,7 +357,7 @@ static int nlmeans_init(hb_filter_object_t *filter,
 
     // Threads
     if (pv->threads < 1) {
-        pv->threads = hb_get_cpu_count();
+        pv->threads = hb_job_thread_count(init->job);
 
         // Reduce internal thread count where we have many logical cores
         // Too many threads increases CPU cache pressure, reducing performance
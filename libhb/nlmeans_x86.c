@@ -12,7 +12,7 @@
 
 #if defined(ARCH_X86)
 
-#include <emmintrin.h>
+#include <immintrin.h>
 
 #include "libavutil/cpu.h"
 #include "handbrake/nlmeans.h"
@@ -148,9 +148,409 @@ static void build_integral_sse2(uint32_t *integral,
     }
 }
 
-void nlmeans_init_x86(NLMeansFunctions *functions)
+// The AVX2 and AVX-512 integral kernels fuse the horizontal prefix sum
+// with the addition of the row above, which the row order of the loops
+// makes equivalent to the separate passes of the C version. Like the SSE2
+// version they process whole blocks of 16 pixels, the integral stride
+// leaves room for that.
+
+__attribute__((target("avx2")))
+static inline __m256i load8_epu32_avx2(const void *p, const int bps)
+{
+    if (bps == 1)
+    {
+        return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p));
+    }
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)p));
+}
+
+// Inclusive prefix sum of the lanes plus the running total in carry,
+// carry is updated to the last lane of the result
+__attribute__((target("avx2")))
+static inline __m256i prefix_sum_avx2(__m256i v, __m256i *carry)
+{
+    v = _mm256_add_epi32(v, _mm256_slli_si256(v, 4));
+    v = _mm256_add_epi32(v, _mm256_slli_si256(v, 8));
+    const __m256i low = _mm256_shuffle_epi32(v, 0xff);
+    v = _mm256_add_epi32(v, _mm256_permute2x128_si256(low, low, 0x08));
+    v = _mm256_add_epi32(v, *carry);
+    *carry = _mm256_permutevar8x32_epi32(v, _mm256_set1_epi32(7));
+    return v;
+}
+
+__attribute__((target("avx2")))
+static inline void build_integral_avx2(uint32_t *integral,
+                                       int       integral_stride,
+                                 const void  *in_src_pre,
+                                 const void  *in_compare_pre,
+                                       int       w,
+                                       int       border,
+                                       int       dst_w,
+                                       int       dst_h,
+                                       int       dx,
+                                       int       dy,
+                                       int       n,
+                                 const int       bps)
+{
+    const int bw = w + 2 * border;
+    const int n_half = (n-1) /2;
+
+    const uint8_t *src_pre      = (const uint8_t *)in_src_pre;
+    const uint8_t *compare_pre  = (const uint8_t *)in_compare_pre;
+
+    for (int y = 0; y < dst_h + n; y++)
+    {
+        __m256i prevadd = _mm256_setzero_si256();
+
+        const uint8_t *p1 = src_pre     + ((y-n_half   )*bw - n_half     ) * bps;
+        const uint8_t *p2 = compare_pre + ((y-n_half+dy)*bw - n_half + dx) * bps;
+        uint32_t *out = integral + (y*integral_stride);
+
+        for (int x = 0; x < dst_w + n; x += 8)
+        {
+            __m256i diff = _mm256_sub_epi32(load8_epu32_avx2(p1, bps),
+                                            load8_epu32_avx2(p2, bps));
+            diff = prefix_sum_avx2(_mm256_mullo_epi32(diff, diff), &prevadd);
+            if (y > 0)
+            {
+                diff = _mm256_add_epi32(diff, _mm256_loadu_si256((const __m256i *)(out - integral_stride)));
+            }
+            _mm256_storeu_si256((__m256i *)out, diff);
+
+            out += 8;
+            p1  += 8 * bps;
+            p2  += 8 * bps;
+        }
+    }
+}
+
+__attribute__((target("avx2")))
+static void build_integral_avx2_8(uint32_t *integral,
+                                  int       integral_stride,
+                            const void  *src,
+                            const void  *src_pre,
+                            const void  *compare,
+                            const void  *compare_pre,
+                                  int       w,
+                                  int       border,
+                                  int       dst_w,
+                                  int       dst_h,
+                                  int       dx,
+                                  int       dy,
+                                  int       n)
+{
+    build_integral_avx2(integral, integral_stride, src_pre, compare_pre,
+                        w, border, dst_w, dst_h, dx, dy, n, 1);
+}
+
+__attribute__((target("avx2")))
+static void build_integral_avx2_16(uint32_t *integral,
+                                   int       integral_stride,
+                             const void  *src,
+                             const void  *src_pre,
+                             const void  *compare,
+                             const void  *compare_pre,
+                                   int       w,
+                                   int       border,
+                                   int       dst_w,
+                                   int       dst_h,
+                                   int       dx,
+                                   int       dy,
+                                   int       n)
+{
+    build_integral_avx2(integral, integral_stride, src_pre, compare_pre,
+                        w, border, dst_w, dst_h, dx, dy, n, 2);
+}
+
+// The weights are computed with the same float operations in the same
+// order as the C version, so the sums are identical. Pixels whose patch
+// difference is out of range add a zero weight.
+__attribute__((target("avx2")))
+static inline int accumulate_row_avx2(struct PixelSum *sums,
+                                const uint32_t *integral_ptr1,
+                                const uint32_t *integral_ptr2,
+                                const void  *in_compare,
+                                      int    n,
+                                      int    dst_w,
+                                const float *exptable,
+                                const float  weight_fact_table,
+                                const int    diff_max,
+                                const int    bps)
+{
+    const uint8_t *compare = (const uint8_t *)in_compare;
+    const __m256 fact  = _mm256_set1_ps(weight_fact_table);
+    const __m256i max  = _mm256_set1_epi32(diff_max);
+    int x = 0;
+
+    for (; x + 8 <= dst_w; x += 8)
+    {
+        const __m256i a = _mm256_loadu_si256((const __m256i *)(integral_ptr2 + x + n));
+        const __m256i b = _mm256_loadu_si256((const __m256i *)(integral_ptr2 + x));
+        const __m256i c = _mm256_loadu_si256((const __m256i *)(integral_ptr1 + x + n));
+        const __m256i d = _mm256_loadu_si256((const __m256i *)(integral_ptr1 + x));
+        const __m256i diff = _mm256_add_epi32(_mm256_sub_epi32(_mm256_sub_epi32(a, b), c), d);
+
+        const __m256i in_range = _mm256_cmpgt_epi32(max, diff);
+        if (_mm256_testz_si256(in_range, in_range))
+        {
+            continue;
+        }
+
+        const __m256i diffidx = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(diff), fact));
+        const __m256 weight   = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), exptable, diffidx,
+                                                         _mm256_castsi256_ps(in_range), 4);
+        const __m256 pixel    = _mm256_cvtepi32_ps(load8_epu32_avx2(compare + x * bps, bps));
+        const __m256 weighted = _mm256_mul_ps(weight, pixel);
+
+        // Interleave to match the layout of struct PixelSum
+        const __m256 lo = _mm256_unpacklo_ps(weight, weighted);
+        const __m256 hi = _mm256_unpackhi_ps(weight, weighted);
+        float *s = &sums[x].weight_sum;
+        _mm256_storeu_ps(s,     _mm256_add_ps(_mm256_loadu_ps(s),     _mm256_permute2f128_ps(lo, hi, 0x20)));
+        _mm256_storeu_ps(s + 8, _mm256_add_ps(_mm256_loadu_ps(s + 8), _mm256_permute2f128_ps(lo, hi, 0x31)));
+    }
+
+    return x;
+}
+
+__attribute__((target("avx2")))
+static int accumulate_row_avx2_8(struct PixelSum *sums,
+                           const uint32_t *integral_ptr1,
+                           const uint32_t *integral_ptr2,
+                           const void  *compare,
+                                 int    n,
+                                 int    dst_w,
+                           const float *exptable,
+                           const float  weight_fact_table,
+                           const int    diff_max)
+{
+    return accumulate_row_avx2(sums, integral_ptr1, integral_ptr2, compare, n, dst_w,
+                               exptable, weight_fact_table, diff_max, 1);
+}
+
+__attribute__((target("avx2")))
+static int accumulate_row_avx2_16(struct PixelSum *sums,
+                            const uint32_t *integral_ptr1,
+                            const uint32_t *integral_ptr2,
+                            const void  *compare,
+                                  int    n,
+                                  int    dst_w,
+                            const float *exptable,
+                            const float  weight_fact_table,
+                            const int    diff_max)
+{
+    return accumulate_row_avx2(sums, integral_ptr1, integral_ptr2, compare, n, dst_w,
+                               exptable, weight_fact_table, diff_max, 2);
+}
+
+#define AVX512_TARGET "avx512f,avx512bw,avx512dq,avx512vl"
+
+__attribute__((target(AVX512_TARGET)))
+static inline __m512i load16_epu32_avx512(const void *p, const int bps)
+{
+    if (bps == 1)
+    {
+        return _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)p));
+    }
+    return _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *)p));
+}
+
+__attribute__((target(AVX512_TARGET)))
+static inline void build_integral_avx512(uint32_t *integral,
+                                         int       integral_stride,
+                                   const void  *in_src_pre,
+                                   const void  *in_compare_pre,
+                                         int       w,
+                                         int       border,
+                                         int       dst_w,
+                                         int       dst_h,
+                                         int       dx,
+                                         int       dy,
+                                         int       n,
+                                   const int       bps)
 {
-    if (av_get_cpu_flags() & AV_CPU_FLAG_SSE2)
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i last = _mm512_set1_epi32(15);
+    const int bw = w + 2 * border;
+    const int n_half = (n-1) /2;
+
+    const uint8_t *src_pre      = (const uint8_t *)in_src_pre;
+    const uint8_t *compare_pre  = (const uint8_t *)in_compare_pre;
+
+    for (int y = 0; y < dst_h + n; y++)
+    {
+        __m512i prevadd = zero;
+
+        const uint8_t *p1 = src_pre     + ((y-n_half   )*bw - n_half     ) * bps;
+        const uint8_t *p2 = compare_pre + ((y-n_half+dy)*bw - n_half + dx) * bps;
+        uint32_t *out = integral + (y*integral_stride);
+
+        for (int x = 0; x < dst_w + n; x += 16)
+        {
+            __m512i diff = _mm512_sub_epi32(load16_epu32_avx512(p1, bps),
+                                            load16_epu32_avx512(p2, bps));
+            diff = _mm512_mullo_epi32(diff, diff);
+
+            // Inclusive prefix sum, alignr shifts the lanes up and
+            // fills with zeros
+            diff = _mm512_add_epi32(diff, _mm512_alignr_epi32(diff, zero, 15));
+            diff = _mm512_add_epi32(diff, _mm512_alignr_epi32(diff, zero, 14));
+            diff = _mm512_add_epi32(diff, _mm512_alignr_epi32(diff, zero, 12));
+            diff = _mm512_add_epi32(diff, _mm512_alignr_epi32(diff, zero, 8));
+            diff = _mm512_add_epi32(diff, prevadd);
+            prevadd = _mm512_permutexvar_epi32(last, diff);
+
+            if (y > 0)
+            {
+                diff = _mm512_add_epi32(diff, _mm512_loadu_si512(out - integral_stride));
+            }
+            _mm512_storeu_si512(out, diff);
+
+            out += 16;
+            p1  += 16 * bps;
+            p2  += 16 * bps;
+        }
+    }
+}
+
+__attribute__((target(AVX512_TARGET)))
+static void build_integral_avx512_8(uint32_t *integral,
+                                    int       integral_stride,
+                              const void  *src,
+                              const void  *src_pre,
+                              const void  *compare,
+                              const void  *compare_pre,
+                                    int       w,
+                                    int       border,
+                                    int       dst_w,
+                                    int       dst_h,
+                                    int       dx,
+                                    int       dy,
+                                    int       n)
+{
+    build_integral_avx512(integral, integral_stride, src_pre, compare_pre,
+                          w, border, dst_w, dst_h, dx, dy, n, 1);
+}
+
+__attribute__((target(AVX512_TARGET)))
+static void build_integral_avx512_16(uint32_t *integral,
+                                     int       integral_stride,
+                               const void  *src,
+                               const void  *src_pre,
+                               const void  *compare,
+                               const void  *compare_pre,
+                                     int       w,
+                                     int       border,
+                                     int       dst_w,
+                                     int       dst_h,
+                                     int       dx,
+                                     int       dy,
+                                     int       n)
+{
+    build_integral_avx512(integral, integral_stride, src_pre, compare_pre,
+                          w, border, dst_w, dst_h, dx, dy, n, 2);
+}
+
+__attribute__((target(AVX512_TARGET)))
+static inline int accumulate_row_avx512(struct PixelSum *sums,
+                                  const uint32_t *integral_ptr1,
+                                  const uint32_t *integral_ptr2,
+                                  const void  *in_compare,
+                                        int    n,
+                                        int    dst_w,
+                                  const float *exptable,
+                                  const float  weight_fact_table,
+                                  const int    diff_max,
+                                  const int    bps)
+{
+    const uint8_t *compare = (const uint8_t *)in_compare;
+    const __m512 fact  = _mm512_set1_ps(weight_fact_table);
+    const __m512i max  = _mm512_set1_epi32(diff_max);
+    const __m512i interleave_lo = _mm512_setr_epi32(0, 16, 1, 17, 2, 18, 3, 19,
+                                                    4, 20, 5, 21, 6, 22, 7, 23);
+    const __m512i interleave_hi = _mm512_setr_epi32(8, 24, 9, 25, 10, 26, 11, 27,
+                                                    12, 28, 13, 29, 14, 30, 15, 31);
+    int x = 0;
+
+    for (; x + 16 <= dst_w; x += 16)
+    {
+        const __m512i a = _mm512_loadu_si512(integral_ptr2 + x + n);
+        const __m512i b = _mm512_loadu_si512(integral_ptr2 + x);
+        const __m512i c = _mm512_loadu_si512(integral_ptr1 + x + n);
+        const __m512i d = _mm512_loadu_si512(integral_ptr1 + x);
+        const __m512i diff = _mm512_add_epi32(_mm512_sub_epi32(_mm512_sub_epi32(a, b), c), d);
+
+        const __mmask16 in_range = _mm512_cmpgt_epi32_mask(max, diff);
+        if (in_range == 0)
+        {
+            continue;
+        }
+
+        const __m512i diffidx = _mm512_cvttps_epi32(_mm512_mul_ps(_mm512_cvtepi32_ps(diff), fact));
+        const __m512 weight   = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), in_range, diffidx,
+                                                         exptable, 4);
+        const __m512 pixel    = _mm512_cvtepi32_ps(load16_epu32_avx512(compare + x * bps, bps));
+        const __m512 weighted = _mm512_mul_ps(weight, pixel);
+
+        float *s = &sums[x].weight_sum;
+        _mm512_storeu_ps(s,      _mm512_add_ps(_mm512_loadu_ps(s),
+                                               _mm512_permutex2var_ps(weight, interleave_lo, weighted)));
+        _mm512_storeu_ps(s + 16, _mm512_add_ps(_mm512_loadu_ps(s + 16),
+                                               _mm512_permutex2var_ps(weight, interleave_hi, weighted)));
+    }
+
+    return x;
+}
+
+__attribute__((target(AVX512_TARGET)))
+static int accumulate_row_avx512_8(struct PixelSum *sums,
+                             const uint32_t *integral_ptr1,
+                             const uint32_t *integral_ptr2,
+                             const void  *compare,
+                                   int    n,
+                                   int    dst_w,
+                             const float *exptable,
+                             const float  weight_fact_table,
+                             const int    diff_max)
+{
+    return accumulate_row_avx512(sums, integral_ptr1, integral_ptr2, compare, n, dst_w,
+                                 exptable, weight_fact_table, diff_max, 1);
+}
+
+__attribute__((target(AVX512_TARGET)))
+static int accumulate_row_avx512_16(struct PixelSum *sums,
+                              const uint32_t *integral_ptr1,
+                              const uint32_t *integral_ptr2,
+                              const void  *compare,
+                                    int    n,
+                                    int    dst_w,
+                              const float *exptable,
+                              const float  weight_fact_table,
+                              const int    diff_max)
+{
+    return accumulate_row_avx512(sums, integral_ptr1, integral_ptr2, compare, n, dst_w,
+                                 exptable, weight_fact_table, diff_max, 2);
+}
+
+#undef AVX512_TARGET
+
+void nlmeans_init_x86(NLMeansFunctions *functions, int depth)
+{
+    const int cpu_flags = av_get_cpu_flags();
+
+    if (cpu_flags & AV_CPU_FLAG_AVX512)
+    {
+        functions->build_integral = depth > 8 ? build_integral_avx512_16 : build_integral_avx512_8;
+        functions->accumulate_row = depth > 8 ? accumulate_row_avx512_16 : accumulate_row_avx512_8;
+        hb_log("NLMeans using AVX-512 optimizations");
+    }
+    else if (cpu_flags & AV_CPU_FLAG_AVX2)
+    {
+        functions->build_integral = depth > 8 ? build_integral_avx2_16 : build_integral_avx2_8;
+        functions->accumulate_row = depth > 8 ? accumulate_row_avx2_16 : accumulate_row_avx2_8;
+        hb_log("NLMeans using AVX2 optimizations");
+    }
+    else if (depth == 8 && (cpu_flags & AV_CPU_FLAG_SSE2))
     {
         functions->build_integral = build_integral_sse2;
         hb_log("NLMeans using SSE2 optimizations");
@@ -1753,7 +1753,7 @@ static OSStatus hb_vt_reuse_session(hb_work_object_t *w, hb_job_t * job, hb_work
 {
     OSStatus err = noErr;
 
-    hb_interjob_t *interjob = hb_interjob_get(job->h);
+    hb_interjob_t *interjob = job->interjob;
     vt_interjob_t *context  = interjob->context;
 
     hb_vt_set_cookie(w, context->format);
@@ -2112,7 +2112,7 @@ static void hb_vt_end_pass(hb_work_private_t *pv)
         context->format      = pv->format;
         context->areBframes  = pv->job->areBframes;
 
-        hb_interjob_t *interjob = hb_interjob_get(pv->job->h);
+        hb_interjob_t *interjob = pv->job->interjob;
         interjob->context = context;
     }
     else if (pv->job->pass_id == HB_PASS_ENCODE_FINAL)
@@ -846,6 +846,27 @@ FILE * hb_fopen(const char *path, const char *mode)
 #endif
 }
 
+/************************************************************************
+ * hb_rename
+ ************************************************************************
+ * Wrapper to the real rename, needed to handle utf8 filenames on
+ * windows, where it also has to replace an existing newpath.
+ ***********************************************************************/
+int hb_rename(const char *oldpath, const char *newpath)
+{
+#ifdef SYS_MINGW
+    wchar_t old_utf16[MAX_PATH];
+    wchar_t new_utf16[MAX_PATH];
+    if (!MultiByteToWideChar(CP_UTF8, 0, oldpath, -1, old_utf16, MAX_PATH))
+        return -1;
+    if (!MultiByteToWideChar(CP_UTF8, 0, newpath, -1, new_utf16, MAX_PATH))
+        return -1;
+    return MoveFileExW(old_utf16, new_utf16, MOVEFILE_REPLACE_EXISTING) ? 0 : -1;
+#else
+    return rename(oldpath, newpath);
+#endif
+}
+
 HB_DIR* hb_opendir(const char *path)
 {
 #ifdef SYS_MINGW
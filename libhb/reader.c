@@ -33,6 +33,15 @@ typedef struct
     hb_buffer_list_t list;
 } buffer_splice_list_t;
 
+// A block of the source read ahead of the demuxer
+typedef struct reader_block_s reader_block_t;
+struct reader_block_s
+{
+    hb_buffer_t    * buf;       // NULL at the end of the source
+    int              chapter;   // chapter when the block was read
+    reader_block_t * next;
+};
+
 struct hb_work_private_s
 {
     hb_handle_t  * h;
@@ -60,14 +69,34 @@ struct hb_work_private_s
 
     buffer_splice_list_t * splice_list;
     int                    splice_list_size;
+
+    // Read-ahead thread, see hb_set_read_ahead()
+    hb_thread_t    * read_ahead_thread;
+    hb_lock_t      * read_ahead_lock;
+    hb_cond_t      * read_ahead_cond;
+    reader_block_t * read_ahead_first;
+    reader_block_t * read_ahead_last;
+    int64_t          read_ahead_bytes;
+    volatile int     read_ahead_die;
+    int              read_ahead_error;
 };
 
+// Bytes of the source read ahead of the demuxer, see hb_set_read_ahead()
+static int64_t read_ahead_size = 0;
+
+// hb_set_read_ahead must only be called when no job is running
+void hb_set_read_ahead( int megabytes )
+{
+    read_ahead_size = megabytes > 0 ? (int64_t)megabytes << 20 : 0;
+}
+
 /***********************************************************************
  * Local prototypes
  **********************************************************************/
 static hb_fifo_t ** GetFifoForId( hb_work_private_t * r, int id );
 static hb_buffer_list_t * get_splice_list(hb_work_private_t * r, int id);
 static void UpdateState( hb_work_private_t  * r );
+static void read_ahead_stop( hb_work_private_t * r );
 
 /***********************************************************************
  * reader_init
@@ -343,6 +372,7 @@ static void reader_close( hb_work_object_t * w )
     {
         return;
     }
+    read_ahead_stop(r);
     if (r->bd)
     {
         hb_bd_stop( r->bd );
@@ -449,17 +479,16 @@ static void reader_send_eof( hb_work_private_t * r )
     hb_log("reader: done. %d scr changes", r->demux.scr_changes);
 }
 
-static int reader_work( hb_work_object_t * w, hb_buffer_t ** buf_in,
-                        hb_buffer_t ** buf_out)
+/*
+ * Reads the next block of the source. Returns the chapter the block
+ * belongs to, buf is left NULL if the chapter is past the end of the
+ * title or the job or at the end of the source.
+ */
+static int reader_read( hb_work_private_t * r, hb_buffer_t ** buf )
 {
-    hb_work_private_t  * r = w->private_data;
-    hb_fifo_t         ** fifos;
-    hb_buffer_t        * buf;
-    hb_buffer_list_t     list;
-    int                  ii, chapter = -1;
-
-    hb_buffer_list_clear(&list);
+    int chapter = -1;
 
+    *buf = NULL;
     if (r->bd)
         chapter = hb_bd_chapter( r->bd );
     else if (r->dvd)
@@ -467,48 +496,200 @@ static int reader_work( hb_work_object_t * w, hb_buffer_t ** buf_in,
     else if (r->stream)
         chapter = hb_stream_chapter( r->stream );
 
-    if( chapter < 0 )
-    {
-        hb_log( "reader: end of the title reached" );
-        reader_send_eof(r);
-        return HB_WORK_DONE;
-    }
-    if( chapter > r->chapter_end )
+    if (chapter < 0 || chapter > r->chapter_end)
     {
-        hb_log("reader: end of chapter %d (media %d) reached at media chapter %d",
-                r->job->chapter_end, r->chapter_end, chapter);
-        reader_send_eof(r);
-        return HB_WORK_DONE;
+        return chapter;
     }
 
     if (r->bd)
     {
-        if( (buf = hb_bd_read( r->bd )) == NULL )
-        {
-            reader_send_eof(r);
-            return HB_WORK_DONE;
-        }
+        *buf = hb_bd_read( r->bd );
     }
     else if (r->dvd)
     {
-        if( (buf = hb_dvd_read( r->dvd )) == NULL )
+        *buf = hb_dvd_read( r->dvd );
+    }
+    else if (r->stream)
+    {
+        *buf = hb_stream_read( r->stream );
+    }
+    return chapter;
+}
+
+/*
+ * Reads the source ahead of the demuxer on its own thread, so that
+ * decoding doesn't wait for storage latency. At most read_ahead_size
+ * bytes are queued.
+ */
+static void read_ahead_func( void * _r )
+{
+    hb_work_private_t * r = _r;
+    int                 done = 0;
+
+    while (!done)
+    {
+        reader_block_t * block;
+
+        hb_lock(r->read_ahead_lock);
+        while (!r->read_ahead_die &&
+               r->read_ahead_bytes >= read_ahead_size)
         {
-            reader_send_eof(r);
-            return HB_WORK_DONE;
+            hb_cond_wait(r->read_ahead_cond, r->read_ahead_lock);
         }
+        hb_unlock(r->read_ahead_lock);
+        if (r->read_ahead_die)
+        {
+            break;
+        }
+
+        block = calloc(1, sizeof(reader_block_t));
+        if (block == NULL)
+        {
+            // Fail the job rather than leave read_ahead_get() waiting
+            hb_error("reader: read-ahead allocation failed");
+            *r->job->done_error = HB_ERROR_UNKNOWN;
+            *r->job->die = 1;
+            hb_lock(r->read_ahead_lock);
+            r->read_ahead_error = 1;
+            hb_cond_broadcast(r->read_ahead_cond);
+            hb_unlock(r->read_ahead_lock);
+            break;
+        }
+        block->chapter = reader_read(r, &block->buf);
+        done = block->buf == NULL;
+
+        hb_lock(r->read_ahead_lock);
+        if (r->read_ahead_last != NULL)
+        {
+            r->read_ahead_last->next = block;
+        }
+        else
+        {
+            r->read_ahead_first = block;
+        }
+        r->read_ahead_last = block;
+        if (block->buf != NULL)
+        {
+            r->read_ahead_bytes += block->buf->size;
+        }
+        hb_cond_broadcast(r->read_ahead_cond);
+        hb_unlock(r->read_ahead_lock);
     }
-    else if (r->stream)
+}
+
+static void read_ahead_start( hb_work_private_t * r )
+{
+    hb_log("reader: reading up to %"PRId64" MB ahead",
+           read_ahead_size >> 20);
+    r->read_ahead_lock   = hb_lock_init();
+    r->read_ahead_cond   = hb_cond_init();
+    r->read_ahead_thread = hb_thread_init("reader read-ahead",
+                                          read_ahead_func, r,
+                                          HB_NORMAL_PRIORITY);
+}
+
+// Same as reader_read, from the blocks queued by read_ahead_func
+static int read_ahead_get( hb_work_private_t * r, hb_buffer_t ** buf )
+{
+    reader_block_t * block;
+    int              chapter;
+
+    hb_lock(r->read_ahead_lock);
+    while (r->read_ahead_first == NULL && !r->read_ahead_error)
+    {
+        hb_cond_wait(r->read_ahead_cond, r->read_ahead_lock);
+    }
+    if (r->read_ahead_first == NULL)
     {
-        if ( (buf = hb_stream_read( r->stream )) == NULL )
+        // The read-ahead thread failed, end the job here
+        hb_unlock(r->read_ahead_lock);
+        *buf = NULL;
+        return 0;
+    }
+    block   = r->read_ahead_first;
+    chapter = block->chapter;
+    *buf    = block->buf;
+    // The last block stays queued, the reader may be asked again
+    if (block->buf != NULL)
+    {
+        r->read_ahead_first = block->next;
+        if (r->read_ahead_first == NULL)
         {
-            reader_send_eof(r);
-            return HB_WORK_DONE;
+            r->read_ahead_last = NULL;
         }
+        r->read_ahead_bytes -= block->buf->size;
+        free(block);
+        hb_cond_broadcast(r->read_ahead_cond);
+    }
+    hb_unlock(r->read_ahead_lock);
+
+    return chapter;
+}
+
+static void read_ahead_stop( hb_work_private_t * r )
+{
+    reader_block_t * block;
+
+    if (r->read_ahead_thread == NULL)
+    {
+        return;
+    }
+
+    hb_lock(r->read_ahead_lock);
+    r->read_ahead_die = 1;
+    hb_cond_broadcast(r->read_ahead_cond);
+    hb_unlock(r->read_ahead_lock);
+    hb_thread_close(&r->read_ahead_thread);
+
+    while ((block = r->read_ahead_first) != NULL)
+    {
+        r->read_ahead_first = block->next;
+        hb_buffer_close(&block->buf);
+        free(block);
+    }
+    r->read_ahead_last = NULL;
+    hb_cond_close(&r->read_ahead_cond);
+    hb_lock_close(&r->read_ahead_lock);
+}
+
+static int reader_work( hb_work_object_t * w, hb_buffer_t ** buf_in,
+                        hb_buffer_t ** buf_out)
+{
+    hb_work_private_t  * r = w->private_data;
+    hb_fifo_t         ** fifos;
+    hb_buffer_t        * buf;
+    hb_buffer_list_t     list;
+    int                  ii, chapter;
+
+    hb_buffer_list_clear(&list);
+
+    // Started on the first read rather than in reader_init, decoders
+    // may still be reading stream information while they initialize
+    if (read_ahead_size > 0 && r->read_ahead_thread == NULL)
+    {
+        read_ahead_start(r);
     }
+
+    if (r->read_ahead_thread != NULL)
+        chapter = read_ahead_get( r, &buf );
     else
+        chapter = reader_read( r, &buf );
+
+    if( chapter < 0 )
+    {
+        hb_log( "reader: end of the title reached" );
+        reader_send_eof(r);
+        return HB_WORK_DONE;
+    }
+    if( chapter > r->chapter_end )
+    {
+        hb_log("reader: end of chapter %d (media %d) reached at media chapter %d",
+                r->job->chapter_end, r->chapter_end, chapter);
+        reader_send_eof(r);
+        return HB_WORK_DONE;
+    }
+    if (buf == NULL)
     {
-        // This should never happen
-        hb_error("Stream not initialized");
         reader_send_eof(r);
         return HB_WORK_DONE;
     }
@@ -625,7 +806,7 @@ static void UpdateState( hb_work_private_t  * r )
         r->st_first = now;
     }
 
-    hb_get_state2(r->job->h, &state);
+    hb_get_job_state(r->job, &state);
 #define p state.param.working
     state.state = HB_STATE_WORKING;
     p.progress  = (float) r->last_pts / (float) r->duration;
@@ -658,7 +839,7 @@ static void UpdateState( hb_work_private_t  * r )
     }
 #undef p
 
-    hb_set_state( r->job->h, &state );
+    hb_set_job_state(r->job, &state);
 }
 
 /***********************************************************************
@@ -38,6 +38,10 @@ typedef struct
     hb_list_t    * exclude_extensions;
 
     int            hw_decode;
+
+    // Set in the copies used by concurrent title workers, which report
+    // per title progress instead of per preview progress
+    int            title_worker;
     
 } hb_scan_t;
 
@@ -45,6 +49,7 @@ typedef struct
 #define AUDIO_DECODE_ERROR_LIMIT (10)
 
 static void ScanFunc( void * );
+static int  ScanTitle( hb_scan_t *, hb_title_t * title );
 static int  DecodePreviews( hb_scan_t *, hb_title_t * title, int flush );
 static hb_audio_t * find_audio_for_id(hb_title_t * title, int id);
 static void LookForAudio(hb_scan_t *scan, hb_title_t *title, hb_audio_t * audio, hb_buffer_t *b);
@@ -53,6 +58,24 @@ static void UpdateState1(hb_scan_t *scan, int title);
 static void UpdateState2(hb_scan_t *scan, int title);
 static void UpdateState3(hb_scan_t *scan, int preview);
 
+// Number of previews of a file decoded at once, see hb_set_scan_threads()
+static int scan_threads = 1;
+
+// hb_set_scan_threads must only be called when no scan is running
+void hb_set_scan_threads( int threads )
+{
+    scan_threads = threads > 0 ? threads : hb_get_cpu_count();
+}
+
+// Number of files of a batch scanned at once, see hb_set_batch_scan_threads()
+static int batch_scan_threads = 1;
+
+// hb_set_batch_scan_threads must only be called when no scan is running
+void hb_set_batch_scan_threads( int threads )
+{
+    batch_scan_threads = threads > 0 ? threads : hb_get_cpu_count();
+}
+
 static const char *aspect_to_string(hb_rational_t *dar)
 {
     double aspect = (double)dar->num / dar->den;
@@ -129,11 +152,150 @@ hb_thread_t * hb_scan_init( hb_handle_t * handle, volatile int * die,
     return hb_thread_init( "scan", ScanFunc, data, HB_NORMAL_PRIORITY );
 }
 
+// -----------------------------------------------
+// concurrent scanning of the files of a batch
+
+typedef void (scan_file_func_t)( hb_scan_t * scan, int index, void * opaque );
+
+typedef struct {
+    hb_scan_t        * data;
+    hb_lock_t        * lock;
+    int                count;
+    int                next;        // next file to scan
+    int                done;        // number of files scanned
+    scan_file_func_t * func;
+    void             * opaque;
+    void            (* progress)( hb_scan_t * scan, int done );
+} scan_queue_t;
+
+typedef struct {
+    scan_queue_t * queue;
+    hb_scan_t      scan;    // DecodePreviews may turn off hw_decode
+    hb_thread_t  * thread;
+} scan_worker_t;
+
+static void scan_worker_func( void * _w )
+{
+    scan_worker_t * w = _w;
+    scan_queue_t  * q = w->queue;
+
+    for (;;)
+    {
+        int index;
+
+        hb_lock(q->lock);
+        if (*q->data->die || q->next >= q->count)
+        {
+            hb_unlock(q->lock);
+            break;
+        }
+        index = q->next++;
+        hb_unlock(q->lock);
+
+        q->func(&w->scan, index, q->opaque);
+
+        hb_lock(q->lock);
+        q->progress(q->data, ++q->done);
+        hb_unlock(q->lock);
+    }
+}
+
+/*
+ * Runs func for file 0 to count - 1 on up to threads threads.
+ * Files are handed out in order and results are stored by index by
+ * func, so the caller can assemble them in a deterministic order.
+ */
+static void ScanFilesConcurrent( hb_scan_t * data, int threads, int count,
+                                 scan_file_func_t * func, void * opaque,
+                                 void (* progress)( hb_scan_t *, int ) )
+{
+    scan_queue_t    q;
+    scan_worker_t * workers;
+    int             i;
+
+    memset(&q, 0, sizeof(q));
+    q.data     = data;
+    q.lock     = hb_lock_init();
+    q.count    = count;
+    q.func     = func;
+    q.opaque   = opaque;
+    q.progress = progress;
+
+    workers = calloc(threads, sizeof(*workers));
+    for (i = 0; i < threads; i++)
+    {
+        workers[i].queue = &q;
+        workers[i].scan  = *data;
+        workers[i].scan.title_worker = 1;
+        workers[i].thread = hb_thread_init("scan file", scan_worker_func,
+                                           &workers[i], HB_NORMAL_PRIORITY);
+    }
+    for (i = 0; i < threads; i++)
+    {
+        hb_thread_close(&workers[i].thread);
+    }
+    free(workers);
+    hb_lock_close(&q.lock);
+}
+
+static void scan_batch_file( hb_scan_t * scan, int index, void * opaque )
+{
+    hb_title_t ** titles = opaque;
+
+    titles[index] = hb_batch_title_scan(scan->batch, index + 1);
+}
+
+static void scan_path( hb_scan_t * scan, int index, void * opaque )
+{
+    hb_title_t ** titles = opaque;
+    char        * path   = hb_list_item(scan->paths, index);
+
+    if (hb_is_valid_batch_path(path))
+    {
+        titles[index] = hb_batch_title_scan_single(scan->h, path, index + 1);
+    }
+}
+
+static void scan_title_previews( hb_scan_t * scan, int index, void * opaque )
+{
+    int        * npreviews = opaque;
+    hb_title_t * title = hb_list_item(scan->title_set->list_title, index);
+
+    npreviews[index] = ScanTitle(scan, title);
+}
+
+static void ScanFiles( hb_scan_t * data, int count,
+                       scan_file_func_t * func )
+{
+    hb_title_t ** titles = calloc(count, sizeof(*titles));
+    int           threads = MIN(batch_scan_threads, count);
+    int           i;
+
+    hb_log("scan: scanning %d files on %d threads", count, threads);
+    ScanFilesConcurrent(data, threads, count, func, titles, UpdateState1);
+
+    // Keep the file order of a sequential scan
+    for (i = 0; i < count; i++)
+    {
+        if (titles[i] == NULL)
+        {
+            continue;
+        }
+        if (*data->die)
+        {
+            hb_title_close(&titles[i]);
+            continue;
+        }
+        hb_list_add(data->title_set->list_title, titles[i]);
+    }
+    free(titles);
+}
+
 static void ScanFunc( void * _data )
 {
     hb_scan_t  * data = (hb_scan_t *) _data;
     hb_title_t * title;
-    int          i;
+    int          i, j;
     int          feature = 0;
 
     data->bd = NULL;
@@ -211,7 +373,16 @@ static void ScanFunc( void * _data )
         else
         {
             /* Scan all titles */
-            for( i = 0; i < hb_batch_title_count( data->batch ); i++ )
+            if (batch_scan_threads > 1)
+            {
+                ScanFiles(data, hb_batch_title_count(data->batch),
+                          scan_batch_file);
+                if (*data->die)
+                {
+                    goto finish;
+                }
+            }
+            else for( i = 0; i < hb_batch_title_count( data->batch ); i++ )
             {
                 if (*data->die)
                 {
@@ -257,7 +428,15 @@ static void ScanFunc( void * _data )
     else // We have many file paths to process.
     {
         // If dragging a batch of files, maybe not, but if the UI's implement a recursive folder maybe?
-        for (i = 0; i < hb_list_count( data->paths ); i++)
+        if (batch_scan_threads > 1)
+        {
+            ScanFiles(data, hb_list_count(data->paths), scan_path);
+            if (*data->die)
+            {
+                goto finish;
+            }
+        }
+        else for (i = 0; i < hb_list_count( data->paths ); i++)
         {
             if (*data->die)
             {
@@ -279,11 +458,38 @@ static void ScanFunc( void * _data )
         }
     }
 
-    for( i = 0; i < hb_list_count( data->title_set->list_title ); )
+    int title_count = hb_list_count( data->title_set->list_title );
+    if (data->bd == NULL && data->dvd == NULL &&
+        batch_scan_threads > 1 && title_count > 1)
     {
-        int j, npreviews;
-        hb_audio_t * audio;
+        // Each file of a batch is read through its own stream, so their
+        // previews can be decoded concurrently.  BD and DVD titles share
+        // the disc reader.
+        int *npreviews = calloc(title_count, sizeof(*npreviews));
 
+        ScanFilesConcurrent(data, MIN(batch_scan_threads, title_count),
+                            title_count, scan_title_previews, npreviews,
+                            UpdateState2);
+        if (*data->die)
+        {
+            free(npreviews);
+            goto finish;
+        }
+        for (i = 0, j = 0; j < title_count; j++)
+        {
+            title = hb_list_item( data->title_set->list_title, i );
+            if (npreviews[j] == 0)
+            {
+                hb_list_rem( data->title_set->list_title, title );
+                hb_title_close( &title );
+                continue;
+            }
+            i++;
+        }
+        free(npreviews);
+    }
+    else for( i = 0; i < hb_list_count( data->title_set->list_title ); )
+    {
         if ( *data->die )
         {
             goto finish;
@@ -292,81 +498,13 @@ static void ScanFunc( void * _data )
 
         UpdateState2(data, i + 1);
 
-        /* Decode previews */
-        /* this will also detect more AC3 / DTS information */
-        npreviews = DecodePreviews( data, title, 1 );
-        if (npreviews == 0 && data->hw_decode)
-        {
-            // Try without the hardware decoder
-            // Some hwaccel implementations don't automatically
-            // fall back to the software encoder
-            data->hw_decode = 0;
-            npreviews = DecodePreviews( data, title, 1 );
-        }
-        if (npreviews < 2)
-        {
-            // Try harder to get some valid frames
-            // Allow libav to return "corrupt" frames
-            hb_log("scan: Too few previews (%d), trying harder", npreviews);
-            title->flags |= HBTF_NO_IDR;
-            npreviews = DecodePreviews( data, title, 0 );
-        }
-        if (npreviews == 0)
+        if (ScanTitle(data, title) == 0)
         {
             /* TODO: free things */
             hb_list_rem( data->title_set->list_title, title );
-            for( j = 0; j < hb_list_count( title->list_audio ); j++)
-            {
-                audio = hb_list_item( title->list_audio, j );
-                if ( audio->priv.scan_cache )
-                {
-                    hb_fifo_flush( audio->priv.scan_cache );
-                    hb_fifo_close( &audio->priv.scan_cache );
-                }
-            }
             hb_title_close( &title );
             continue;
         }
-        title->preview_count = npreviews;
-
-        /* Make sure we found audio rates and bitrates */
-        for( j = 0; j < hb_list_count( title->list_audio ); )
-        {
-            audio = hb_list_item( title->list_audio, j );
-            if ( audio->priv.scan_cache )
-            {
-                hb_fifo_flush( audio->priv.scan_cache );
-                hb_fifo_close( &audio->priv.scan_cache );
-            }
-            if( !audio->config.in.bitrate )
-            {
-                hb_log( "scan: removing audio 0x%x because no bitrate found",
-                        audio->id );
-                hb_list_rem( title->list_audio, audio );
-                free( audio );
-                continue;
-            }
-            j++;
-        }
-
-        for (j = 0; j < hb_list_count(title->list_subtitle); j++)
-        {
-            hb_subtitle_t *subtitle = hb_list_item(title->list_subtitle, j);
-            if ((subtitle->source == VOBSUB || subtitle->source == PGSSUB) &&
-                (subtitle->width <= 0 || subtitle->height <= 0))
-            {
-                // VOBSUB and PGS width and height needs to be set to the
-                // title width and height for any stream type that does
-                // not provide this information (DVDs, BDs, VOBs, and M2TSs).
-                // Title width and height don't get set until we decode
-                // previews, so we can't set subtitle width/height till
-                // we get here.
-                subtitle->width  = title->geometry.width;
-                subtitle->height = title->geometry.height;
-            }
-            // Initialize subtitle extradata if not set by demux already
-            hb_subtitle_extradata_init(subtitle);
-        }
         i++;
     }
 
@@ -437,6 +575,120 @@ finish:
     hb_buffer_pool_free();
 }
 
+/***********************************************************************
+ * ScanTitle
+ ***********************************************************************
+ * Decodes the previews of a title and drops the audio tracks that
+ * could not be identified. Returns the number of previews decoded,
+ * the caller removes the title if there are none.
+ **********************************************************************/
+static int ScanTitle( hb_scan_t * data, hb_title_t * title )
+{
+    int j, npreviews = 0, cached = 0;
+    hb_audio_t * audio;
+    char * cache_params = NULL;
+
+    if (data->bd == NULL && data->dvd == NULL)
+    {
+        // Everything the preview results depend on besides the file
+        cache_params = hb_strdup_printf("previews=%d:%d crop=%d:%d",
+                                        data->preview_count,
+                                        data->store_previews,
+                                        data->crop_threshold_frames,
+                                        data->crop_threshold_pixels);
+        npreviews = cached = hb_scan_cache_load(data->h, title, cache_params,
+                                                data->store_previews);
+    }
+    if (cached)
+    {
+        goto cleanup;
+    }
+
+    /* Decode previews */
+    /* this will also detect more AC3 / DTS information */
+    npreviews = DecodePreviews( data, title, 1 );
+    if (npreviews == 0 && data->hw_decode)
+    {
+        // Try without the hardware decoder
+        // Some hwaccel implementations don't automatically
+        // fall back to the software encoder
+        data->hw_decode = 0;
+        npreviews = DecodePreviews( data, title, 1 );
+    }
+    if (npreviews < 2)
+    {
+        // Try harder to get some valid frames
+        // Allow libav to return "corrupt" frames
+        hb_log("scan: Too few previews (%d), trying harder", npreviews);
+        title->flags |= HBTF_NO_IDR;
+        npreviews = DecodePreviews( data, title, 0 );
+    }
+    if (npreviews == 0)
+    {
+        for( j = 0; j < hb_list_count( title->list_audio ); j++)
+        {
+            audio = hb_list_item( title->list_audio, j );
+            if ( audio->priv.scan_cache )
+            {
+                hb_fifo_flush( audio->priv.scan_cache );
+                hb_fifo_close( &audio->priv.scan_cache );
+            }
+        }
+        free(cache_params);
+        return 0;
+    }
+    title->preview_count = npreviews;
+
+cleanup:
+    /* Make sure we found audio rates and bitrates */
+    for( j = 0; j < hb_list_count( title->list_audio ); )
+    {
+        audio = hb_list_item( title->list_audio, j );
+        if ( audio->priv.scan_cache )
+        {
+            hb_fifo_flush( audio->priv.scan_cache );
+            hb_fifo_close( &audio->priv.scan_cache );
+        }
+        if( !audio->config.in.bitrate )
+        {
+            hb_log( "scan: removing audio 0x%x because no bitrate found",
+                    audio->id );
+            hb_list_rem( title->list_audio, audio );
+            free( audio );
+            continue;
+        }
+        j++;
+    }
+
+    for (j = 0; j < hb_list_count(title->list_subtitle); j++)
+    {
+        hb_subtitle_t *subtitle = hb_list_item(title->list_subtitle, j);
+        if ((subtitle->source == VOBSUB || subtitle->source == PGSSUB) &&
+            (subtitle->width <= 0 || subtitle->height <= 0))
+        {
+            // VOBSUB and PGS width and height needs to be set to the
+            // title width and height for any stream type that does
+            // not provide this information (DVDs, BDs, VOBs, and M2TSs).
+            // Title width and height don't get set until we decode
+            // previews, so we can't set subtitle width/height till
+            // we get here.
+            subtitle->width  = title->geometry.width;
+            subtitle->height = title->geometry.height;
+        }
+        // Initialize subtitle extradata if not set by demux already
+        hb_subtitle_extradata_init(subtitle);
+    }
+
+    if (cache_params != NULL && !cached)
+    {
+        hb_scan_cache_save(data->h, title, cache_params,
+                           data->store_previews ? data->preview_count : 0);
+    }
+    free(cache_params);
+
+    return npreviews;
+}
+
 // -----------------------------------------------
 // stuff related to cropping
 
@@ -608,76 +860,495 @@ static int has_resolution_change( info_list_t *info_list )
     h = info_list[0].info.geometry.height;
     for ( i = 1; info_list[i].count; ++i )
     {
-        if (w != info_list[i].info.geometry.width ||
-            h != info_list[i].info.geometry.height)
-            return 1;
+        if (w != info_list[i].info.geometry.width ||
+            h != info_list[i].info.geometry.height)
+            return 1;
+    }
+    return 0;
+}
+
+static int is_close_to( int val, int target, int thresh )
+{
+    int diff = val - target;
+    diff = diff < 0 ? -diff : diff;
+    return diff < thresh;
+}
+
+static hb_buffer_t * read_buf(hb_scan_t * data, hb_stream_t * stream)
+{
+    if (data->bd)
+    {
+        return hb_bd_read(data->bd);
+    }
+    else if (data->dvd)
+    {
+        return hb_dvd_read(data->dvd);
+    }
+    else if (stream)
+    {
+        return hb_stream_read(stream);
+    }
+
+    // This shouldn't happen
+    return NULL;
+}
+
+static void flush_audio_scan_cache( hb_title_t * title )
+{
+    int ii;
+
+    for (ii = 0; ii < hb_list_count(title->list_audio); ii++)
+    {
+        hb_audio_t * audio = hb_list_item(title->list_audio, ii);
+        if (audio->priv.scan_cache)
+        {
+            hb_fifo_flush(audio->priv.scan_cache);
+        }
+    }
+}
+
+// -----------------------------------------------
+// decoding of a single preview
+
+enum
+{
+    PREVIEW_SKIPPED,    // no usable picture at this position
+    PREVIEW_DONE,       // info, comb and crop results are valid
+    PREVIEW_EOF,        // ran out of data, later positions are dropped
+};
+
+typedef struct {
+    int            status;
+    hb_work_info_t info;
+    int            interlaced;
+    int            has_crop;
+    int            crop[4];
+} preview_result_t;
+
+// A video decoder and the state it carries from one preview to the next
+typedef struct {
+    hb_stream_t      * stream;
+    hb_work_object_t * vid_decoder;
+    void             * hw_device_ctx;
+
+    int                probe_audio;
+    int                abort_audio;
+    // Held while probing changes the title's audio list, which the
+    // other preview workers check concurrently
+    hb_lock_t        * audio_lock;
+    int                cc_wait;
+
+    int                progressive_count;
+    int                pulldown_count;
+    int                doubled_frame_count;
+    int                vid_samples;
+} preview_decoder_t;
+
+// Preview results of a title, merged in preview order
+typedef struct {
+    int             npreviews;
+    int             interlaced_preview_count;
+    int             progressive_count;
+    int             pulldown_count;
+    int             doubled_frame_count;
+    int             vid_samples;
+    info_list_t   * info_list;
+    crop_record_t * crops;
+} preview_stats_t;
+
+static int preview_decoder_open( hb_scan_t * data, preview_decoder_t * dec,
+                                 hb_title_t * title )
+{
+    hb_hwaccel_t *hwaccel = hb_get_hwaccel(data->hw_decode);
+
+    if (hwaccel &&
+        hwaccel->caps & HB_HWACCEL_CAP_SCAN &&
+        hb_hwaccel_is_available(hwaccel, title->video_codec_param))
+    {
+        hb_hwaccel_hw_device_ctx_init(hwaccel->type, -1, &dec->hw_device_ctx);
+    }
+
+    dec->cc_wait = 10;
+    dec->vid_decoder = hb_get_work(data->h, title->video_codec);
+    dec->vid_decoder->codec_param = title->video_codec_param;
+    dec->vid_decoder->hw_device_ctx = dec->hw_device_ctx;
+    dec->vid_decoder->hw_accel = hwaccel;
+    dec->vid_decoder->title = title;
+
+    if (dec->vid_decoder->init(dec->vid_decoder, NULL))
+    {
+        hb_error("Decoder init failed!");
+        free(dec->vid_decoder);
+        dec->vid_decoder = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static void preview_decoder_close( preview_decoder_t * dec )
+{
+    if (dec->vid_decoder != NULL)
+    {
+        dec->vid_decoder->close(dec->vid_decoder);
+        free(dec->vid_decoder);
+        dec->vid_decoder = NULL;
+    }
+    hb_hwaccel_hw_device_ctx_close(&dec->hw_device_ctx);
+    hb_stream_close(&dec->stream);
+}
+
+static int seek_preview( hb_scan_t * data, hb_stream_t * stream, int i )
+{
+    if (data->bd)
+    {
+        return hb_bd_seek(data->bd, (float)(i + 1) / (data->preview_count + 1.0));
+    }
+    else if (data->dvd)
+    {
+        return hb_dvd_seek(data->dvd, (float)(i + 1) / (data->preview_count + 1.0));
+    }
+    else if (stream)
+    {
+        /* we start reading streams at zero rather than 1/11 because
+         * short streams may have only one sequence header in the entire
+         * file and we need it to decode any previews.
+         *
+         * Also, seeking to position 0 loses the palette of avi files
+         * so skip initial seek */
+        if (i != 0)
+        {
+            return hb_stream_seek(stream, (float)i / (data->preview_count + 1.0));
+        }
+        hb_stream_set_need_keyframe(stream, 1);
+    }
+    return 1;
+}
+
+static int audio_pending( preview_decoder_t * dec, hb_title_t * title )
+{
+    return dec->probe_audio && !AllAudioOK(title);
+}
+
+static void decode_preview( hb_scan_t * data, preview_decoder_t * dec,
+                            hb_title_t * title, int i, int flush,
+                            preview_result_t * result )
+{
+    hb_work_object_t * vid_decoder = dec->vid_decoder;
+    hb_buffer_t      * buf, * buf_es;
+    hb_buffer_list_t   list_es;
+    int                frame_wait;
+    int                frames;
+
+    memset(result, 0, sizeof(*result));
+    result->status = PREVIEW_SKIPPED;
+    hb_buffer_list_clear(&list_es);
+
+    hb_deep_log( 2, "scan: preview %d", i + 1 );
+
+    if (flush && vid_decoder->flush)
+        vid_decoder->flush( vid_decoder );
+    if (title->flags & HBTF_NO_IDR)
+    {
+        if (!flush)
+        {
+            // If we are doing the first previews decode attempt,
+            // set this threshold high so that we get the best
+            // quality frames possible.
+            frame_wait = 100;
+        }
+        else
+        {
+            // If we failed to get enough valid frames in the first
+            // previews decode attempt, lower the threshold to improve
+            // our chances of getting something to work with.
+            frame_wait = 10;
+        }
+    }
+    else
+    {
+        // For certain mpeg-2 streams, libav is delivering a
+        // dummy first frame that is all black.  So always skip
+        // one frame
+        frame_wait = 1;
+    }
+    frames = 0;
+
+    hb_buffer_t * vid_buf = NULL, * last_vid_buf = NULL;
+
+    int packets = 0;
+    vid_decoder->frame_count = 0;
+    while (vid_decoder->frame_count < PREVIEW_READ_THRESH ||
+          (audio_pending(dec, title) && packets < 10000))
+    {
+        if ((buf = read_buf(data, dec->stream)) == NULL)
+        {
+            // If we reach EOF and no audio, don't continue looking for
+            // audio
+            dec->abort_audio = 1;
+            if (vid_buf != NULL || last_vid_buf != NULL)
+            {
+                break;
+            }
+            hb_log("Warning: Could not read data for preview %d, skipped",
+                   i + 1 );
+
+            // If we reach EOF and no video, don't continue looking for
+            // video
+            result->status = PREVIEW_EOF;
+            return;
+        }
+
+        packets++;
+        if (buf->size <= 0)
+        {
+            // Ignore "null" frames
+            hb_buffer_close(&buf);
+            continue;
+        }
+
+        (hb_demux[title->demuxer])(buf, &list_es, 0 );
+
+        while ((buf_es = hb_buffer_list_rem_head(&list_es)) != NULL)
+        {
+            if( buf_es->s.id == title->video_id && vid_buf == NULL )
+            {
+                vid_decoder->work( vid_decoder, &buf_es, &vid_buf );
+                // There are 2 conditions we decode additional
+                // video frames for during scan.
+                // 1. We did not detect IDR frames, so the initial video
+                //    frames may be corrupt.  We decode extra frames to
+                //    increase the probability of a complete preview frame
+                // 2. Some frames do not contain CC data, even though
+                //    CCs are present in the stream.  So we need to decode
+                //    additional frames to find the CCs.
+                if (vid_buf != NULL && (frame_wait || dec->cc_wait))
+                {
+                    hb_work_info_t vid_info;
+                    if (vid_decoder->info(vid_decoder, &vid_info))
+                    {
+                        if (is_close_to(vid_info.rate.den, 900900, 100) &&
+                            (vid_buf->s.flags & PIC_FLAG_REPEAT_FIRST_FIELD))
+                        {
+                            /* Potentially soft telecine material */
+                            dec->pulldown_count++;
+                        }
+
+                        if (vid_buf->s.flags & PIC_FLAG_REPEAT_FRAME)
+                        {
+                            // AVCHD-Lite specifies that all streams are
+                            // 50 or 60 fps.  To produce 25 or 30 fps, camera
+                            // makers are repeating all frames.
+                            dec->doubled_frame_count++;
+                        }
+
+                        if (is_close_to(vid_info.rate.den, 1126125, 100 ))
+                        {
+                            // Frame FPS is 23.976 (meaning it's
+                            // progressive), so start keeping track of
+                            // how many are reporting at that speed. When
+                            // enough show up that way, we want to make
+                            // that the overall title FPS.
+                            dec->progressive_count++;
+                        }
+                        dec->vid_samples++;
+                    }
+
+                    if (frames > 0 && vid_buf->s.frametype == HB_FRAME_I)
+                        frame_wait = 0;
+                    if (frame_wait || dec->cc_wait)
+                    {
+                        hb_buffer_close(&last_vid_buf);
+                        last_vid_buf = vid_buf;
+                        vid_buf = NULL;
+                        if (frame_wait) frame_wait--;
+                        if (dec->cc_wait) dec->cc_wait--;
+                    }
+                    frames++;
+                }
+            }
+            else if (audio_pending(dec, title) && !dec->abort_audio)
+            {
+                hb_audio_t * audio = find_audio_for_id(title, buf_es->s.id);
+                if (audio != NULL && audio->priv.scan_error_count < AUDIO_DECODE_ERROR_LIMIT)
+                {
+                    if (dec->audio_lock != NULL)
+                    {
+                        hb_lock(dec->audio_lock);
+                    }
+                    LookForAudio( data, title, audio, buf_es );
+                    if (dec->audio_lock != NULL)
+                    {
+                        hb_unlock(dec->audio_lock);
+                    }
+                    buf_es = NULL;
+                }
+            }
+            if ( buf_es )
+                hb_buffer_close( &buf_es );
+        }
+
+        if (vid_buf && (dec->abort_audio || !audio_pending(dec, title)))
+            break;
+    }
+    hb_buffer_list_close(&list_es);
+
+    if (vid_buf == NULL)
+    {
+        vid_buf = last_vid_buf;
+        last_vid_buf = NULL;
+    }
+    hb_buffer_close(&last_vid_buf);
+
+    if (vid_buf == NULL)
+    {
+        hb_log( "scan: could not get a decoded picture" );
+        return;
+    }
+
+    /* Get size and rate infos */
+
+    hb_work_info_t vid_info;
+    if( !vid_decoder->info( vid_decoder, &vid_info ) )
+    {
+        /*
+         * Could not fill vid_info, don't continue and try to use vid_info
+         * in this case.
+         */
+        hb_log( "scan: could not get a video information" );
+        hb_buffer_close( &vid_buf );
+        return;
+    }
+
+    if (vid_info.geometry.width  != vid_buf->f.width ||
+        vid_info.geometry.height != vid_buf->f.height)
+    {
+        hb_log( "scan: video geometry information does not match buffer" );
+        hb_buffer_close( &vid_buf );
+        return;
+    }
+    result->info = vid_info;
+
+    /* Check preview for interlacing artifacts */
+    if( hb_detect_comb( vid_buf, 10, 30, 9, 10, 30, 9 ) )
+    {
+        hb_deep_log( 2, "Interlacing detected in preview frame %i", i+1);
+        result->interlaced = 1;
+    }
+
+    if( data->store_previews )
+    {
+        hb_save_preview( data->h, title->index, i, vid_buf, HB_PREVIEW_FORMAT_JPG );
+    }
+
+    /* Detect black borders */
+
+    int top, bottom, left, right;
+    int h4 = vid_info.geometry.height / 4, w4 = vid_info.geometry.width / 4;
+
+    // When widescreen content is matted to 16:9 or 4:3 there's sometimes
+    // a thin border on the outer edge of the matte. On TV content it can be
+    // "line 21" VBI data that's normally hidden in the overscan. For HD
+    // content it can just be a diagnostic added in post production so that
+    // the frame borders are visible. We try to ignore these borders so
+    // we can crop the matte. The border width depends on the resolution
+    // (12 pixels on 1080i looks visually the same as 4 pixels on 480i)
+    // so we allow the border to be up to 1% of the frame height.
+    const int border = vid_info.geometry.height / 100;
+
+    for ( top = border; top < h4; ++top )
+    {
+        if ( ! row_all_dark( vid_buf, top ) )
+            break;
+    }
+    if ( top <= border )
+    {
+        // we never made it past the border region - see if the rows we
+        // didn't check are dark or if we shouldn't crop at all.
+        for ( top = 0; top < border; ++top )
+        {
+            if ( ! row_all_dark( vid_buf, top ) )
+                break;
+        }
+        if ( top >= border )
+        {
+            top = 0;
+        }
+    }
+    for ( bottom = border; bottom < h4; ++bottom )
+    {
+        if ( ! row_all_dark( vid_buf, vid_info.geometry.height - 1 - bottom ) )
+            break;
+    }
+    if ( bottom <= border )
+    {
+        for ( bottom = 0; bottom < border; ++bottom )
+        {
+            if ( ! row_all_dark( vid_buf, vid_info.geometry.height - 1 - bottom ) )
+                break;
+        }
+        if ( bottom >= border )
+        {
+            bottom = 0;
+        }
+    }
+    for ( left = 0; left < w4; ++left )
+    {
+        if ( ! column_all_dark( vid_buf, top, bottom, left ) )
+            break;
+    }
+    for ( right = 0; right < w4; ++right )
+    {
+        if ( ! column_all_dark( vid_buf, top, bottom, vid_info.geometry.width - 1 - right ) )
+            break;
     }
-    return 0;
-}
 
-static int is_close_to( int val, int target, int thresh )
-{
-    int diff = val - target;
-    diff = diff < 0 ? -diff : diff;
-    return diff < thresh;
+    // only record the result if all the crops are less than a quarter of
+    // the frame otherwise we can get fooled by frames with a lot of black
+    // like titles, credits & fade-thru-black transitions.
+    if ( top < h4 && bottom < h4 && left < w4 && right < w4 )
+    {
+        result->has_crop = 1;
+        result->crop[0] = top;
+        result->crop[1] = bottom;
+        result->crop[2] = left;
+        result->crop[3] = right;
+    }
+    hb_buffer_close( &vid_buf );
+    result->status = PREVIEW_DONE;
 }
 
-static hb_buffer_t * read_buf(hb_scan_t * data, hb_stream_t * stream)
+static void record_preview( preview_stats_t * stats, preview_result_t * result )
 {
-    if (data->bd)
-    {
-        return hb_bd_read(data->bd);
-    }
-    else if (data->dvd)
+    remember_info( stats->info_list, &result->info );
+    if (result->interlaced)
     {
-        return hb_dvd_read(data->dvd);
+        stats->interlaced_preview_count++;
     }
-    else if (stream)
+    if (result->has_crop)
     {
-        return hb_stream_read(stream);
+        record_crop( stats->crops, result->crop[0], result->crop[1],
+                                   result->crop[2], result->crop[3] );
     }
-
-    // This shouldn't happen
-    return NULL;
+    ++stats->npreviews;
 }
 
-/***********************************************************************
- * DecodePreviews
- ***********************************************************************
- * Decode 10 pictures for the given title.
- * It assumes that data->reader and data->vts have successfully been
- * DVDOpen()ed and ifoOpen()ed.
- **********************************************************************/
-static int DecodePreviews( hb_scan_t * data, hb_title_t * title, int flush )
+static void record_decoder_stats( preview_stats_t * stats,
+                                  preview_decoder_t * dec )
 {
-    int                i, npreviews = 0, abort = 0;
-    hb_buffer_t      * buf, * buf_es;
-    hb_buffer_list_t   list_es;
-    int                progressive_count = 0;
-    int                pulldown_count = 0;
-    int                doubled_frame_count = 0;
-    int                interlaced_preview_count = 0;
-    int                vid_samples = 0;
-    int                frame_wait = 0;
-    int                cc_wait = 10;
-    int                frames;
-    hb_stream_t      * stream = NULL;
-    info_list_t      * info_list;
-    int                abort_audio = 0;
-
-    info_list = calloc(data->preview_count+1, sizeof(*info_list));
-    crop_record_t *crops = crop_record_init( data->preview_count );
+    stats->progressive_count   += dec->progressive_count;
+    stats->pulldown_count      += dec->pulldown_count;
+    stats->doubled_frame_count += dec->doubled_frame_count;
+    stats->vid_samples         += dec->vid_samples;
+}
 
-    hb_buffer_list_clear(&list_es);
+static int decode_previews_sequential( hb_scan_t * data, hb_title_t * title,
+                                       int flush, preview_stats_t * stats )
+{
+    preview_decoder_t dec;
+    preview_result_t  result;
+    int               i;
 
-    if( data->batch )
-    {
-        hb_log( "scan: decoding previews for title %d (%s)", title->index, title->path );
-    }
-    else
-    {
-        hb_log( "scan: decoding previews for title %d", title->index );
-    }
+    memset(&dec, 0, sizeof(dec));
 
     if (data->bd)
     {
@@ -692,397 +1363,392 @@ static int DecodePreviews( hb_scan_t * data, hb_title_t * title, int flush )
     }
     else // data->batch or a single file
     {
-        stream = hb_stream_open(data->h, title->path, title, 0);
+        dec.stream = hb_stream_open(data->h, title->path, title, 0);
     }
 
-    if (data->bd == NULL && data->dvd == NULL && stream == NULL)
+    if (data->bd == NULL && data->dvd == NULL && dec.stream == NULL)
     {
         hb_error("Can't open stream!");
-        free(info_list);
-        crop_record_free(crops);
-        hb_stream_close(&stream);
-        return 0;
+        return -1;
     }
 
     if (title->video_codec == WORK_NONE)
     {
         hb_error("No video decoder set!");
-        free(info_list);
-        crop_record_free(crops);
-        hb_stream_close(&stream);
-        return 0;
-    }
-
-    void *hw_device_ctx = NULL;
-    hb_hwaccel_t *hwaccel = hb_get_hwaccel(data->hw_decode);
-
-    if (hwaccel &&
-        hwaccel->caps & HB_HWACCEL_CAP_SCAN &&
-        hb_hwaccel_is_available(hwaccel, title->video_codec_param))
-    {
-        hb_hwaccel_hw_device_ctx_init(hwaccel->type, -1, &hw_device_ctx);
+        preview_decoder_close(&dec);
+        return -1;
     }
 
-    hb_work_object_t *vid_decoder = hb_get_work(data->h, title->video_codec);
-    vid_decoder->codec_param = title->video_codec_param;
-    vid_decoder->hw_device_ctx = hw_device_ctx;
-    vid_decoder->hw_accel = hwaccel;
-    vid_decoder->title = title;
-
-    if (vid_decoder->init(vid_decoder, NULL))
+    if (preview_decoder_open(data, &dec, title))
     {
-        hb_error("Decoder init failed!");
-        free(info_list);
-        crop_record_free(crops);
-        free( vid_decoder );
-        hb_stream_close(&stream);
-        hb_hwaccel_hw_device_ctx_close(&hw_device_ctx);
-        return 0;
+        preview_decoder_close(&dec);
+        return -1;
     }
+    dec.probe_audio = 1;
 
     for( i = 0; i < data->preview_count; i++ )
     {
-        int j;
-
         UpdateState3(data, i + 1);
 
         if ( *data->die )
         {
-            free( info_list );
-            crop_record_free( crops );
-            vid_decoder->close( vid_decoder );
-            free( vid_decoder );
-            hb_stream_close(&stream);
-            hb_hwaccel_hw_device_ctx_close(&hw_device_ctx);
-            return 0;
-        }
-        if (data->bd)
-        {
-            if( !hb_bd_seek( data->bd, (float) ( i + 1 ) / ( data->preview_count + 1.0 ) ) )
-          {
-              continue;
-          }
+            preview_decoder_close(&dec);
+            return -1;
         }
-        if (data->dvd)
+        if (!seek_preview(data, dec.stream, i))
         {
-            if( !hb_dvd_seek( data->dvd, (float) ( i + 1 ) / ( data->preview_count + 1.0 ) ) )
-          {
-              continue;
-          }
+            continue;
         }
-        else if (stream)
+
+        decode_preview(data, &dec, title, i, flush, &result);
+        if (result.status == PREVIEW_DONE)
         {
-            /* we start reading streams at zero rather than 1/11 because
-             * short streams may have only one sequence header in the entire
-             * file and we need it to decode any previews.
-             *
-             * Also, seeking to position 0 loses the palette of avi files
-             * so skip initial seek */
-            if (i != 0)
-            {
-                if (!hb_stream_seek(stream,
-                                    (float)i / (data->preview_count + 1.0)))
-                {
-                    continue;
-                }
-            }
-            else
-            {
-                hb_stream_set_need_keyframe(stream, 1);
-            }
+            record_preview(stats, &result);
         }
-
-        hb_deep_log( 2, "scan: preview %d", i + 1 );
-
-        if (flush && vid_decoder->flush)
-            vid_decoder->flush( vid_decoder );
-        if (title->flags & HBTF_NO_IDR)
+        if (result.status != PREVIEW_SKIPPED)
         {
-            if (!flush)
-            {
-                // If we are doing the first previews decode attempt,
-                // set this threshold high so that we get the best
-                // quality frames possible.
-                frame_wait = 100;
-            }
-            else
-            {
-                // If we failed to get enough valid frames in the first
-                // previews decode attempt, lower the threshold to improve
-                // our chances of getting something to work with.
-                frame_wait = 10;
-            }
+            /* Make sure we found audio rates and bitrates */
+            flush_audio_scan_cache(title);
         }
-        else
+        if (result.status == PREVIEW_EOF)
         {
-            // For certain mpeg-2 streams, libav is delivering a
-            // dummy first frame that is all black.  So always skip
-            // one frame
-            frame_wait = 1;
+            break;
         }
-        frames = 0;
+    }
+    UpdateState3(data, i);
 
-        hb_buffer_t * vid_buf = NULL, * last_vid_buf = NULL;
+    record_decoder_stats(stats, &dec);
+    preview_decoder_close(&dec);
 
-        int packets = 0;
-        vid_decoder->frame_count = 0;
-        while (vid_decoder->frame_count < PREVIEW_READ_THRESH ||
-              (!AllAudioOK(title) && packets < 10000))
-        {
-            if ((buf = read_buf(data, stream)) == NULL)
-            {
-                // If we reach EOF and no audio, don't continue looking for
-                // audio
-                abort_audio = 1;
-                if (vid_buf != NULL || last_vid_buf != NULL)
-                {
-                    break;
-                }
-                hb_log("Warning: Could not read data for preview %d, skipped",
-                       i + 1 );
+    return stats->npreviews;
+}
 
-                // If we reach EOF and no video, don't continue looking for
-                // video
-                abort = 1;
-                goto skip_preview;
-            }
+// -----------------------------------------------
+// concurrent decoding of the previews of a file
 
-            packets++;
-            if (buf->size <= 0)
-            {
-                // Ignore "null" frames
-                hb_buffer_close(&buf);
-                continue;
-            }
+typedef struct {
+    hb_scan_t        * data;
+    hb_title_t       * title;
+    int                flush;
+
+    hb_lock_t        * lock;
+    int                next;        // next preview position to decode
+    int                done;        // number of positions decoded
+    int                eof;         // a position ran out of data
+    int                audio_busy;  // a worker is probing audio
+    preview_result_t * results;
+} preview_queue_t;
 
-            (hb_demux[title->demuxer])(buf, &list_es, 0 );
+typedef struct {
+    preview_queue_t   * queue;
+    preview_decoder_t   dec;
+    hb_title_t          title;
+    hb_thread_t       * thread;
+} preview_worker_t;
 
-            while ((buf_es = hb_buffer_list_rem_head(&list_es)) != NULL)
-            {
-                if( buf_es->s.id == title->video_id && vid_buf == NULL )
-                {
-                    vid_decoder->work( vid_decoder, &buf_es, &vid_buf );
-                    // There are 2 conditions we decode additional
-                    // video frames for during scan.
-                    // 1. We did not detect IDR frames, so the initial video
-                    //    frames may be corrupt.  We decode extra frames to
-                    //    increase the probability of a complete preview frame
-                    // 2. Some frames do not contain CC data, even though
-                    //    CCs are present in the stream.  So we need to decode
-                    //    additional frames to find the CCs.
-                    if (vid_buf != NULL && (frame_wait || cc_wait))
-                    {
-                        hb_work_info_t vid_info;
-                        if (vid_decoder->info(vid_decoder, &vid_info))
-                        {
-                            if (is_close_to(vid_info.rate.den, 900900, 100) &&
-                                (vid_buf->s.flags & PIC_FLAG_REPEAT_FIRST_FIELD))
-                            {
-                                /* Potentially soft telecine material */
-                                pulldown_count++;
-                            }
-
-                            if (vid_buf->s.flags & PIC_FLAG_REPEAT_FRAME)
-                            {
-                                // AVCHD-Lite specifies that all streams are
-                                // 50 or 60 fps.  To produce 25 or 30 fps, camera
-                                // makers are repeating all frames.
-                                doubled_frame_count++;
-                            }
-
-                            if (is_close_to(vid_info.rate.den, 1126125, 100 ))
-                            {
-                                // Frame FPS is 23.976 (meaning it's
-                                // progressive), so start keeping track of
-                                // how many are reporting at that speed. When
-                                // enough show up that way, we want to make
-                                // that the overall title FPS.
-                                progressive_count++;
-                            }
-                            vid_samples++;
-                        }
+/*
+ * Opening a stream points title->opaque_priv at its demuxer and the
+ * video decoder adds closed caption tracks and HDR metadata to its
+ * title.  So each worker opens its stream and decoder on a private
+ * copy of the title which is merged back once the previews are done.
+ */
+static void preview_title_init( hb_title_t * copy, hb_title_t * title )
+{
+    int ii;
 
-                        if (frames > 0 && vid_buf->s.frametype == HB_FRAME_I)
-                            frame_wait = 0;
-                        if (frame_wait || cc_wait)
-                        {
-                            hb_buffer_close(&last_vid_buf);
-                            last_vid_buf = vid_buf;
-                            vid_buf = NULL;
-                            if (frame_wait) frame_wait--;
-                            if (cc_wait) cc_wait--;
-                        }
-                        frames++;
-                    }
-                }
-                else if (!AllAudioOK(title) && !abort_audio)
-                {
-                    hb_audio_t * audio = find_audio_for_id(title, buf_es->s.id);
-                    if (audio != NULL && audio->priv.scan_error_count < AUDIO_DECODE_ERROR_LIMIT)
-                    {
-                        LookForAudio( data, title, audio, buf_es );
-                        buf_es = NULL;
-                    }
-                }
-                if ( buf_es )
-                    hb_buffer_close( &buf_es );
-            }
+    *copy = *title;
+    copy->list_subtitle = hb_list_init();
+    copy->list_audio    = hb_list_init();
+    for (ii = 0; ii < hb_list_count(title->list_audio); ii++)
+    {
+        hb_list_add(copy->list_audio, hb_list_item(title->list_audio, ii));
+    }
+}
 
-            if (vid_buf && (abort_audio || AllAudioOK(title)))
-                break;
-        }
-        hb_buffer_list_close(&list_es);
+static int has_subtitle_source( hb_title_t * title, int source )
+{
+    int ii;
 
-        if (vid_buf == NULL)
+    for (ii = 0; ii < hb_list_count(title->list_subtitle); ii++)
+    {
+        hb_subtitle_t * subtitle = hb_list_item(title->list_subtitle, ii);
+        if (subtitle->source == source)
         {
-            vid_buf = last_vid_buf;
-            last_vid_buf = NULL;
+            return 1;
         }
-        hb_buffer_close(&last_vid_buf);
+    }
+    return 0;
+}
+
+static void preview_title_close( hb_title_t * title, hb_title_t * copy )
+{
+    hb_subtitle_t * subtitle;
 
-        if (vid_buf == NULL)
+    while ((subtitle = hb_list_item(copy->list_subtitle, 0)) != NULL)
+    {
+        hb_list_rem(copy->list_subtitle, subtitle);
+        if (has_subtitle_source(title, subtitle->source))
         {
-            hb_log( "scan: could not get a decoded picture" );
+            hb_subtitle_close(&subtitle);
             continue;
         }
+        subtitle->track = hb_list_count(title->list_subtitle);
+        hb_list_add(title->list_subtitle, subtitle);
+    }
+    hb_list_close(&copy->list_subtitle);
+    hb_list_close(&copy->list_audio);
 
-        /* Get size and rate infos */
-
-        hb_work_info_t vid_info;
-        if( !vid_decoder->info( vid_decoder, &vid_info ) )
+    if (title->color_prim     == HB_COLR_PRI_UNSET &&
+        title->color_transfer == HB_COLR_TRA_UNSET &&
+        title->color_matrix   == HB_COLR_MAT_UNSET)
+    {
+        title->color_prim     = copy->color_prim;
+        title->color_transfer = copy->color_transfer;
+        title->color_matrix   = copy->color_matrix;
+        title->color_range    = copy->color_range;
+    }
+    if (copy->mastering.has_primaries || copy->mastering.has_luminance)
+    {
+        title->mastering = copy->mastering;
+    }
+    if (copy->coll.max_cll || copy->coll.max_fall)
+    {
+        title->coll = copy->coll;
+    }
+    if (copy->initial_rpu != title->initial_rpu)
+    {
+        if (title->initial_rpu == NULL)
         {
-            /*
-             * Could not fill vid_info, don't continue and try to use vid_info
-             * in this case.
-             */
-            hb_log( "scan: could not get a video information" );
-            hb_buffer_close( &vid_buf );
-            continue;
+            title->initial_rpu      = copy->initial_rpu;
+            title->initial_rpu_type = copy->initial_rpu_type;
         }
-
-        if (vid_info.geometry.width  != vid_buf->f.width ||
-            vid_info.geometry.height != vid_buf->f.height)
+        else
         {
-            hb_log( "scan: video geometry information does not match buffer" );
-            hb_buffer_close( &vid_buf );
-            continue;
+            hb_data_close(&copy->initial_rpu);
         }
-        remember_info( info_list, &vid_info );
+    }
+    title->hdr_10_plus |= copy->hdr_10_plus;
+    if (title->ambient.ambient_illuminance.num == 0 &&
+        title->ambient.ambient_illuminance.den == 0)
+    {
+        title->ambient = copy->ambient;
+    }
+}
+
+static void preview_worker_func( void * _w )
+{
+    preview_worker_t * w    = _w;
+    preview_queue_t  * q    = w->queue;
+    hb_scan_t        * data = q->data;
 
-        /* Check preview for interlacing artifacts */
-        if( hb_detect_comb( vid_buf, 10, 30, 9, 10, 30, 9 ) )
+    for (;;)
+    {
+        preview_result_t * result;
+        int                i;
+
+        hb_lock(q->lock);
+        if (*data->die || q->eof || q->next >= data->preview_count)
         {
-            hb_deep_log( 2, "Interlacing detected in preview frame %i", i+1);
-            interlaced_preview_count++;
+            hb_unlock(q->lock);
+            break;
         }
+        i = q->next++;
 
-        if( data->store_previews )
+        // Audio probing updates the title's audio list, so only one
+        // worker at a time does it, and under q->lock when it changes
+        // what AllAudioOK() reads
+        w->dec.probe_audio = 0;
+        if (!q->audio_busy && !AllAudioOK(q->title))
         {
-            hb_save_preview( data->h, title->index, i, vid_buf, HB_PREVIEW_FORMAT_JPG );
+            q->audio_busy = 1;
+            w->dec.probe_audio = 1;
         }
+        hb_unlock(q->lock);
 
-        /* Detect black borders */
-
-        int top, bottom, left, right;
-        int h4 = vid_info.geometry.height / 4, w4 = vid_info.geometry.width / 4;
-
-        // When widescreen content is matted to 16:9 or 4:3 there's sometimes
-        // a thin border on the outer edge of the matte. On TV content it can be
-        // "line 21" VBI data that's normally hidden in the overscan. For HD
-        // content it can just be a diagnostic added in post production so that
-        // the frame borders are visible. We try to ignore these borders so
-        // we can crop the matte. The border width depends on the resolution
-        // (12 pixels on 1080i looks visually the same as 4 pixels on 480i)
-        // so we allow the border to be up to 1% of the frame height.
-        const int border = vid_info.geometry.height / 100;
-
-        for ( top = border; top < h4; ++top )
+        result = &q->results[i];
+        if (seek_preview(data, w->dec.stream, i))
         {
-            if ( ! row_all_dark( vid_buf, top ) )
-                break;
+            decode_preview(data, &w->dec, q->title, i, q->flush, result);
         }
-        if ( top <= border )
+        if (w->dec.probe_audio && result->status != PREVIEW_SKIPPED)
         {
-            // we never made it past the border region - see if the rows we
-            // didn't check are dark or if we shouldn't crop at all.
-            for ( top = 0; top < border; ++top )
-            {
-                if ( ! row_all_dark( vid_buf, top ) )
-                    break;
-            }
-            if ( top >= border )
-            {
-                top = 0;
-            }
+            flush_audio_scan_cache(q->title);
         }
-        for ( bottom = border; bottom < h4; ++bottom )
+
+        hb_lock(q->lock);
+        if (w->dec.probe_audio)
         {
-            if ( ! row_all_dark( vid_buf, vid_info.geometry.height - 1 - bottom ) )
-                break;
+            q->audio_busy = 0;
         }
-        if ( bottom <= border )
+        if (result->status == PREVIEW_EOF)
         {
-            for ( bottom = 0; bottom < border; ++bottom )
-            {
-                if ( ! row_all_dark( vid_buf, vid_info.geometry.height - 1 - bottom ) )
-                    break;
-            }
-            if ( bottom >= border )
-            {
-                bottom = 0;
-            }
+            q->eof = 1;
         }
-        for ( left = 0; left < w4; ++left )
+        UpdateState3(data, ++q->done);
+        hb_unlock(q->lock);
+    }
+}
+
+static int decode_previews_concurrent( hb_scan_t * data, hb_title_t * title,
+                                       int flush, int threads,
+                                       preview_stats_t * stats )
+{
+    preview_queue_t    q;
+    preview_worker_t * workers;
+    int                i, count = 0;
+
+    if (title->video_codec == WORK_NONE)
+    {
+        hb_error("No video decoder set!");
+        return -1;
+    }
+
+    memset(&q, 0, sizeof(q));
+    q.data    = data;
+    q.title   = title;
+    q.flush   = flush;
+    q.results = calloc(data->preview_count, sizeof(*q.results));
+    workers   = calloc(threads, sizeof(*workers));
+
+    for (i = 0; i < threads; i++)
+    {
+        preview_worker_t * w = &workers[count];
+
+        w->queue = &q;
+        preview_title_init(&w->title, title);
+        w->dec.stream = hb_stream_open(data->h, title->path, &w->title, 0);
+        if (w->dec.stream == NULL)
         {
-            if ( ! column_all_dark( vid_buf, top, bottom, left ) )
-                break;
+            hb_error("Can't open stream!");
         }
-        for ( right = 0; right < w4; ++right )
+        if (w->dec.stream == NULL ||
+            preview_decoder_open(data, &w->dec, &w->title))
         {
-            if ( ! column_all_dark( vid_buf, top, bottom, vid_info.geometry.width - 1 - right ) )
-                break;
+            preview_decoder_close(&w->dec);
+            preview_title_close(title, &w->title);
+            break;
         }
+        count++;
+    }
+
+    if (count > 0)
+    {
+        hb_log("scan: decoding previews on %d threads", count);
 
-        // only record the result if all the crops are less than a quarter of
-        // the frame otherwise we can get fooled by frames with a lot of black
-        // like titles, credits & fade-thru-black transitions.
-        if ( top < h4 && bottom < h4 && left < w4 && right < w4 )
+        q.lock = hb_lock_init();
+        for (i = 0; i < count; i++)
         {
-            record_crop( crops, top, bottom, left, right );
+            workers[i].dec.audio_lock = q.lock;
+            workers[i].thread = hb_thread_init("scan preview",
+                                               preview_worker_func,
+                                               &workers[i],
+                                               HB_NORMAL_PRIORITY);
         }
-        ++npreviews;
-
-skip_preview:
-        /* Make sure we found audio rates and bitrates */
-        for( j = 0; j < hb_list_count( title->list_audio ); j++ )
+        for (i = 0; i < count; i++)
         {
-            hb_audio_t * audio = hb_list_item( title->list_audio, j );
-            if ( audio->priv.scan_cache )
-            {
-                hb_fifo_flush( audio->priv.scan_cache );
-            }
+            hb_thread_close(&workers[i].thread);
         }
-        if (vid_buf)
+        hb_lock_close(&q.lock);
+
+        // Merge in worker order so that the first closed caption track
+        // and Dolby Vision RPU found keep precedence
+        for (i = 0; i < count; i++)
         {
-            hb_buffer_close( &vid_buf );
+            record_decoder_stats(stats, &workers[i].dec);
+            preview_decoder_close(&workers[i].dec);
+            preview_title_close(title, &workers[i].title);
         }
-        if (abort)
+
+        // Merge in preview order so that the results match a
+        // sequential decode
+        for (i = 0; i < data->preview_count && !*data->die; i++)
         {
-            break;
+            if (q.results[i].status == PREVIEW_EOF)
+            {
+                break;
+            }
+            if (q.results[i].status == PREVIEW_DONE)
+            {
+                record_preview(stats, &q.results[i]);
+            }
         }
+        UpdateState3(data, i);
     }
-    UpdateState3(data, i);
 
-    vid_decoder->close( vid_decoder );
-    free( vid_decoder );
+    free(q.results);
+    free(workers);
+
+    if (count == 0 || *data->die)
+    {
+        return -1;
+    }
+    return stats->npreviews;
+}
+
+/***********************************************************************
+ * DecodePreviews
+ ***********************************************************************
+ * Decode 10 pictures for the given title.
+ * It assumes that data->reader and data->vts have successfully been
+ * DVDOpen()ed and ifoOpen()ed.
+ * Previews of files are decoded on up to scan_threads threads at once.
+ **********************************************************************/
+static int DecodePreviews( hb_scan_t * data, hb_title_t * title, int flush )
+{
+    int                i, npreviews;
+    int                progressive_count;
+    int                pulldown_count;
+    int                doubled_frame_count;
+    int                interlaced_preview_count;
+    int                vid_samples;
+    info_list_t      * info_list;
+    crop_record_t    * crops;
+    preview_stats_t    stats;
+    int                threads = 1;
+
+    info_list = calloc(data->preview_count+1, sizeof(*info_list));
+    crops = crop_record_init( data->preview_count );
+
+    memset(&stats, 0, sizeof(stats));
+    stats.info_list = info_list;
+    stats.crops     = crops;
+
+    if( data->batch )
+    {
+        hb_log( "scan: decoding previews for title %d (%s)", title->index, title->path );
+    }
+    else
+    {
+        hb_log( "scan: decoding previews for title %d", title->index );
+    }
 
-    hb_hwaccel_hw_device_ctx_close(&hw_device_ctx);
+    if (data->bd == NULL && data->dvd == NULL)
+    {
+        // BD and DVD previews are read through the single disc reader
+        threads = MIN(scan_threads, data->preview_count);
+    }
 
-    if (stream != NULL)
+    if (threads > 1)
+    {
+        npreviews = decode_previews_concurrent(data, title, flush, threads, &stats);
+    }
+    else
+    {
+        npreviews = decode_previews_sequential(data, title, flush, &stats);
+    }
+    if (npreviews < 0)
     {
-        hb_stream_close(&stream);
+        free( info_list );
+        crop_record_free( crops );
+        return 0;
     }
 
+    progressive_count        = stats.progressive_count;
+    pulldown_count           = stats.pulldown_count;
+    doubled_frame_count      = stats.doubled_frame_count;
+    interlaced_preview_count = stats.interlaced_preview_count;
+    vid_samples              = stats.vid_samples;
+
     if ( npreviews )
     {
         // use the most common frame info for our final title dimensions
@@ -1432,8 +2098,6 @@ skip_preview:
     crop_record_free( crops );
     free( info_list );
 
-    hb_buffer_list_close(&list_es);
-
     if (data->bd)
       hb_bd_stop( data->bd );
     if (data->dvd)
@@ -1914,6 +2578,12 @@ static void UpdateState3(hb_scan_t *scan, int preview)
 {
     hb_state_t state;
 
+    if (scan->title_worker)
+    {
+        // Titles are scanned concurrently, progress is per title
+        return;
+    }
+
     hb_get_state2(scan->h, &state);
 #define p state.param.scanning
     p.preview_cur = preview;
@@ -0,0 +1,693 @@
+/* scancache.c
+
+   Copyright (c) 2003-2026 HandBrake Team
+   This file is part of the HandBrake source code
+   Homepage: <http://handbrake.fr/>.
+   It may be used under the terms of the GNU General Public License v2.
+   For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
+ */
+
+/*
+ * On-disk cache of the preview scan results of files.
+ *
+ * Decoding the previews of a title (DecodePreviews) is the expensive part
+ * of a scan: it finds the frame geometry and rate, crop, interlacing,
+ * HDR metadata, closed captions and the audio parameters.  The cache
+ * stores what the preview scan added to the title, keyed by the path,
+ * size and modification time of the file and the scan parameters.  A
+ * rescan of an unchanged file still probes the stream, which restores all
+ * the demuxer and decoder settings of the title, and then applies the
+ * cached results instead of decoding previews again.
+ */
+
+#include "handbrake/handbrake.h"
+#include "handbrake/hbffmpeg.h"
+#include "handbrake/hb_dict.h"
+
+#if defined(SYS_LINUX)
+#define HB_SCAN_CACHE_DIR       "ghb" DIR_SEP_STR "scancache"
+#elif defined(SYS_MINGW)
+#define HB_SCAN_CACHE_DIR       "HandBrake" DIR_SEP_STR "ScanCache"
+#else
+#define HB_SCAN_CACHE_DIR       "HandBrake" DIR_SEP_STR "ScanCache"
+#endif
+
+// Bump when the content of a cache entry changes
+#define HB_SCAN_CACHE_VERSION   1
+
+// Use the scan cache, see hb_set_scan_cache()
+static int scan_cache = 0;
+
+// hb_set_scan_cache must only be called when no scan is running
+void hb_set_scan_cache( int enable )
+{
+    scan_cache = enable;
+}
+
+/***********************************************************************
+ * Cache entry names
+ **********************************************************************/
+static char * scan_cache_key( hb_title_t * title, const char * params )
+{
+    hb_stat_t sb;
+
+    if (title->path == NULL || hb_stat(title->path, &sb))
+    {
+        return NULL;
+    }
+    return hb_strdup_printf("%s|%"PRId64"|%"PRId64"|%s|%s %d",
+                            title->path, (int64_t)sb.st_size,
+                            (int64_t)sb.st_mtime, params,
+                            HB_PROJECT_VERSION, HB_PROJECT_BUILD);
+}
+
+// 64 bit FNV-1a, the full key is stored in the entry to detect collisions
+static uint64_t scan_cache_hash( const char * key )
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (; *key; key++)
+    {
+        hash ^= (uint8_t)*key;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static void scan_cache_filename( char name[1024], uint64_t hash, int preview )
+{
+    if (preview < 0)
+    {
+        hb_get_user_config_filename(name, "%s" DIR_SEP_STR "%016"PRIx64".json",
+                                    HB_SCAN_CACHE_DIR, hash);
+    }
+    else
+    {
+        hb_get_user_config_filename(name, "%s" DIR_SEP_STR "%016"PRIx64"_%d.jpg",
+                                    HB_SCAN_CACHE_DIR, hash, preview);
+    }
+}
+
+static void scan_cache_mkdir( void )
+{
+    char   path[1024];
+    char * sep;
+    int    base;
+
+    hb_get_user_config_directory(path);
+    base = strlen(path) + 1;
+    hb_get_user_config_filename(path, "%s", HB_SCAN_CACHE_DIR);
+    for (sep = strchr(path + base, DIR_SEP_CHAR); sep != NULL;
+         sep = strchr(sep + 1, DIR_SEP_CHAR))
+    {
+        *sep = 0;
+        hb_mkdir(path);
+        *sep = DIR_SEP_CHAR;
+    }
+    hb_mkdir(path);
+}
+
+static int copy_file( const char * src, const char * dst )
+{
+    FILE   * in, * out;
+    uint8_t  buf[65536];
+    size_t   size;
+    int      result = 0;
+
+    in = hb_fopen(src, "rb");
+    if (in == NULL)
+    {
+        return -1;
+    }
+    out = hb_fopen(dst, "wb");
+    if (out == NULL)
+    {
+        fclose(in);
+        return -1;
+    }
+    while ((size = fread(buf, 1, sizeof(buf), in)) > 0)
+    {
+        if (fwrite(buf, 1, size, out) != size)
+        {
+            result = -1;
+            break;
+        }
+    }
+    if (ferror(in))
+    {
+        result = -1;
+    }
+    fclose(in);
+    if (fclose(out))
+    {
+        result = -1;
+    }
+    return result;
+}
+
+// Moves a file that was written under a temporary name in place, so that
+// an interrupted write can't leave a truncated cache entry behind.
+// Returns 0 on success.
+static int commit_file( const char * tmpname, const char * name, int written )
+{
+    if (written && hb_rename(tmpname, name) == 0)
+    {
+        return 0;
+    }
+    remove(tmpname);
+    return -1;
+}
+
+/***********************************************************************
+ * Serialization helpers
+ **********************************************************************/
+static hb_value_t * rational_value( hb_rational_t r )
+{
+    hb_value_array_t * array = hb_value_array_init();
+
+    hb_value_array_append(array, hb_value_int(r.num));
+    hb_value_array_append(array, hb_value_int(r.den));
+    return array;
+}
+
+static hb_rational_t value_rational( const hb_value_t * value )
+{
+    hb_rational_t r;
+
+    r.num = hb_value_get_int(hb_value_array_get(value, 0));
+    r.den = hb_value_get_int(hb_value_array_get(value, 1));
+    return r;
+}
+
+static hb_value_t * int_array_value( const int * values, int count )
+{
+    hb_value_array_t * array = hb_value_array_init();
+    int                ii;
+
+    for (ii = 0; ii < count; ii++)
+    {
+        hb_value_array_append(array, hb_value_int(values[ii]));
+    }
+    return array;
+}
+
+static void value_int_array( const hb_value_t * value, int * values, int count )
+{
+    int ii;
+
+    for (ii = 0; ii < count; ii++)
+    {
+        values[ii] = hb_value_get_int(hb_value_array_get(value, ii));
+    }
+}
+
+static hb_value_t * data_value( const hb_data_t * data )
+{
+    static const char hex[] = "0123456789abcdef";
+    hb_value_t * value;
+    char       * str = malloc(2 * data->size + 1);
+    size_t       ii;
+
+    for (ii = 0; ii < data->size; ii++)
+    {
+        str[2 * ii]     = hex[data->bytes[ii] >> 4];
+        str[2 * ii + 1] = hex[data->bytes[ii] & 15];
+    }
+    str[2 * ii] = 0;
+    value = hb_value_string(str);
+    free(str);
+    return value;
+}
+
+static int hex_digit( char c )
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+static hb_data_t * value_data( const hb_value_t * value )
+{
+    const char * str = hb_value_get_string(value);
+    hb_data_t  * data;
+    size_t       ii, size;
+
+    if (str == NULL || (size = strlen(str) / 2) == 0)
+    {
+        return NULL;
+    }
+    data = hb_data_init(size);
+    if (data == NULL)
+    {
+        return NULL;
+    }
+    for (ii = 0; ii < size; ii++)
+    {
+        int hi = hex_digit(str[2 * ii]), lo = hex_digit(str[2 * ii + 1]);
+        if (hi < 0 || lo < 0)
+        {
+            hb_data_close(&data);
+            return NULL;
+        }
+        data->bytes[ii] = (hi << 4) | lo;
+    }
+    return data;
+}
+
+static hb_value_t * mastering_value( const hb_mastering_display_metadata_t * m )
+{
+    hb_value_array_t * array = hb_value_array_init();
+    int                ii, jj;
+
+    for (ii = 0; ii < 3; ii++)
+    {
+        for (jj = 0; jj < 2; jj++)
+        {
+            hb_value_array_append(array, rational_value(m->display_primaries[ii][jj]));
+        }
+    }
+    hb_value_array_append(array, rational_value(m->white_point[0]));
+    hb_value_array_append(array, rational_value(m->white_point[1]));
+    hb_value_array_append(array, rational_value(m->min_luminance));
+    hb_value_array_append(array, rational_value(m->max_luminance));
+    hb_value_array_append(array, hb_value_int(m->has_primaries));
+    hb_value_array_append(array, hb_value_int(m->has_luminance));
+    return array;
+}
+
+static void value_mastering( const hb_value_t * value,
+                             hb_mastering_display_metadata_t * m )
+{
+    int ii, jj, kk = 0;
+
+    for (ii = 0; ii < 3; ii++)
+    {
+        for (jj = 0; jj < 2; jj++)
+        {
+            m->display_primaries[ii][jj] = value_rational(hb_value_array_get(value, kk++));
+        }
+    }
+    m->white_point[0] = value_rational(hb_value_array_get(value, kk++));
+    m->white_point[1] = value_rational(hb_value_array_get(value, kk++));
+    m->min_luminance  = value_rational(hb_value_array_get(value, kk++));
+    m->max_luminance  = value_rational(hb_value_array_get(value, kk++));
+    m->has_primaries  = hb_value_get_int(hb_value_array_get(value, kk++));
+    m->has_luminance  = hb_value_get_int(hb_value_array_get(value, kk++));
+}
+
+static hb_audio_t * find_audio( hb_title_t * title, int id )
+{
+    int ii;
+
+    for (ii = 0; ii < hb_list_count(title->list_audio); ii++)
+    {
+        hb_audio_t * audio = hb_list_item(title->list_audio, ii);
+        if (audio->id == id)
+        {
+            return audio;
+        }
+    }
+    return NULL;
+}
+
+static hb_subtitle_t * find_cc_subtitle( hb_title_t * title )
+{
+    int ii;
+
+    for (ii = 0; ii < hb_list_count(title->list_subtitle); ii++)
+    {
+        hb_subtitle_t * subtitle = hb_list_item(title->list_subtitle, ii);
+        if (subtitle->source == CC608SUB)
+        {
+            return subtitle;
+        }
+    }
+    return NULL;
+}
+
+/***********************************************************************
+ * hb_scan_cache_save
+ ***********************************************************************
+ * Stores the preview scan results of a file title. params describes the
+ * scan parameters that the results depend on. stored_previews is the
+ * number of preview positions saved with hb_save_preview(), if any.
+ **********************************************************************/
+void hb_scan_cache_save( hb_handle_t * h, hb_title_t * title,
+                         const char * params, int stored_previews )
+{
+    hb_dict_t        * dict;
+    hb_value_array_t * list;
+    hb_subtitle_t    * subtitle;
+    char             * key, * tmpname;
+    char               name[1024];
+    uint64_t           hash;
+    int                ii;
+
+    if (!scan_cache || (key = scan_cache_key(title, params)) == NULL)
+    {
+        return;
+    }
+    hash = scan_cache_hash(key);
+    scan_cache_mkdir();
+
+    dict = hb_dict_init();
+    hb_dict_set_int(dict, "Version", HB_SCAN_CACHE_VERSION);
+    hb_dict_set_string(dict, "Key", key);
+    hb_dict_set_int(dict, "PreviewCount", title->preview_count);
+    hb_dict_set_bool(dict, "NoIDR", !!(title->flags & HBTF_NO_IDR));
+    hb_dict_set_bool(dict, "HasResolutionChange", title->has_resolution_change);
+    if (title->video_codec_name != NULL)
+    {
+        hb_dict_set_string(dict, "VideoCodecName", title->video_codec_name);
+    }
+    hb_dict_set_int(dict, "VideoCodecProfile", title->video_codec_profile);
+    hb_dict_set_int(dict, "VideoBitrate", title->video_bitrate);
+    hb_dict_set_int(dict, "VideoDecodeSupport", title->video_decode_support);
+    hb_dict_set_int(dict, "Width", title->geometry.width);
+    hb_dict_set_int(dict, "Height", title->geometry.height);
+    hb_dict_set(dict, "PAR", rational_value(title->geometry.par));
+    hb_dict_set(dict, "DAR", rational_value(title->dar));
+    hb_dict_set(dict, "FrameRate", rational_value(title->vrate));
+    hb_dict_set(dict, "Crop", int_array_value(title->crop, 4));
+    hb_dict_set(dict, "LooseCrop", int_array_value(title->loose_crop, 4));
+    hb_dict_set_bool(dict, "InterlaceDetected", title->detected_interlacing);
+    hb_dict_set_int(dict, "PixFmt", title->pix_fmt);
+    hb_dict_set_int(dict, "ColorPrimaries", title->color_prim);
+    hb_dict_set_int(dict, "ColorTransfer", title->color_transfer);
+    hb_dict_set_int(dict, "ColorMatrix", title->color_matrix);
+    hb_dict_set_int(dict, "ColorRange", title->color_range);
+    hb_dict_set_int(dict, "ChromaLocation", title->chroma_location);
+    hb_dict_set(dict, "Mastering", mastering_value(&title->mastering));
+    hb_dict_set_int(dict, "MaxCLL", title->coll.max_cll);
+    hb_dict_set_int(dict, "MaxFALL", title->coll.max_fall);
+    list = hb_value_array_init();
+    hb_value_array_append(list, rational_value(title->ambient.ambient_illuminance));
+    hb_value_array_append(list, rational_value(title->ambient.ambient_light_x));
+    hb_value_array_append(list, rational_value(title->ambient.ambient_light_y));
+    hb_dict_set(dict, "Ambient", list);
+    hb_dict_set_int(dict, "HDR10+", title->hdr_10_plus);
+    if (title->initial_rpu != NULL)
+    {
+        hb_dict_set_int(dict, "RPUType", title->initial_rpu_type);
+        hb_dict_set(dict, "RPU", data_value(title->initial_rpu));
+    }
+
+    subtitle = find_cc_subtitle(title);
+    if (subtitle != NULL)
+    {
+        hb_dict_t * cc = hb_dict_init();
+        hb_dict_set_string(cc, "Language", subtitle->lang);
+        hb_dict_set_string(cc, "LanguageCode", subtitle->iso639_2);
+        hb_dict_set(dict, "ClosedCaption", cc);
+    }
+
+    list = hb_value_array_init();
+    for (ii = 0; ii < hb_list_count(title->list_audio); ii++)
+    {
+        hb_audio_t * audio = hb_list_item(title->list_audio, ii);
+        hb_dict_t  * audio_dict;
+        char         layout[128] = "";
+
+        if (!audio->config.in.bitrate)
+        {
+            continue;
+        }
+        if (audio->config.in.ch_layout != NULL)
+        {
+            av_channel_layout_describe(audio->config.in.ch_layout,
+                                       layout, sizeof(layout));
+        }
+        audio_dict = hb_dict_init();
+        hb_dict_set_int(audio_dict, "ID", audio->id);
+        hb_dict_set_int(audio_dict, "Codec", audio->config.in.codec);
+        hb_dict_set_int(audio_dict, "SampleRate", audio->config.in.samplerate);
+        hb_dict_set_int(audio_dict, "SampleBitDepth", audio->config.in.sample_bit_depth);
+        hb_dict_set_int(audio_dict, "SamplesPerFrame", audio->config.in.samples_per_frame);
+        hb_dict_set_int(audio_dict, "BitRate", audio->config.in.bitrate);
+        hb_dict_set_int(audio_dict, "MatrixEncoding", audio->config.in.matrix_encoding);
+        hb_dict_set_string(audio_dict, "ChannelLayout", layout);
+        hb_dict_set_int(audio_dict, "BitstreamVersion", audio->config.in.version);
+        hb_dict_set_int(audio_dict, "BitstreamFlags", audio->config.in.flags);
+        hb_dict_set_int(audio_dict, "BitstreamMode", audio->config.in.mode);
+        hb_dict_set_string(audio_dict, "Description", audio->config.lang.description);
+        hb_value_array_append(list, audio_dict);
+    }
+    hb_dict_set(dict, "AudioList", list);
+
+    list = hb_value_array_init();
+    for (ii = 0; ii < stored_previews; ii++)
+    {
+        char * filename;
+        int    copied;
+
+        filename = hb_get_temporary_filename("%d_%d_%d.jpg",
+                                             hb_get_instance_id(h),
+                                             title->index, ii);
+        scan_cache_filename(name, hash, ii);
+        tmpname = hb_strdup_printf("%s.tmp", name);
+        // Previews kept in memory have no temporary file
+        copied = !hb_export_preview(h, title->index, ii, tmpname) ||
+                 !copy_file(filename, tmpname);
+        copied = !commit_file(tmpname, name, copied);
+        free(tmpname);
+        free(filename);
+        if (copied)
+        {
+            hb_value_array_append(list, hb_value_int(ii));
+        }
+    }
+    hb_dict_set(dict, "Previews", list);
+
+    scan_cache_filename(name, hash, -1);
+    tmpname = hb_strdup_printf("%s.tmp", name);
+    if (commit_file(tmpname, name, !hb_value_write_json(dict, tmpname)))
+    {
+        hb_log("scan cache: failed to write %s", name);
+    }
+    else
+    {
+        hb_deep_log(2, "scan cache: stored %s", title->path);
+    }
+    free(tmpname);
+    hb_value_free(&dict);
+    free(key);
+}
+
+// Checks that an entry has the strings that are copied into the title,
+// an old or damaged one may lack them
+static int scan_cache_complete( hb_dict_t * dict )
+{
+    hb_value_t * list;
+    hb_dict_t  * cc;
+    int          ii, count;
+
+    cc = hb_dict_get(dict, "ClosedCaption");
+    if (cc != NULL &&
+        (hb_dict_get_string(cc, "Language") == NULL ||
+         hb_dict_get_string(cc, "LanguageCode") == NULL))
+    {
+        return 0;
+    }
+    list = hb_dict_get(dict, "AudioList");
+    count = hb_value_array_len(list);
+    for (ii = 0; ii < count; ii++)
+    {
+        if (hb_dict_get_string(hb_value_array_get(list, ii),
+                               "Description") == NULL)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/***********************************************************************
+ * hb_scan_cache_load
+ ***********************************************************************
+ * Applies the cached preview scan results to a freshly probed file
+ * title. Returns the number of previews of the cached scan, or 0 if
+ * there is no valid cache entry and the previews must be decoded.
+ **********************************************************************/
+int hb_scan_cache_load( hb_handle_t * h, hb_title_t * title,
+                        const char * params, int store_previews )
+{
+    hb_dict_t        * dict, * cc;
+    hb_value_array_t * list;
+    hb_value_t       * rpu;
+    char             * key;
+    char               name[1024];
+    uint64_t           hash;
+    int                ii, count;
+
+    if (!scan_cache || (key = scan_cache_key(title, params)) == NULL)
+    {
+        return 0;
+    }
+    hash = scan_cache_hash(key);
+
+    scan_cache_filename(name, hash, -1);
+    dict = hb_value_read_json(name);
+    if (dict == NULL)
+    {
+        free(key);
+        return 0;
+    }
+    if (hb_dict_get_int(dict, "Version") != HB_SCAN_CACHE_VERSION ||
+        hb_dict_get_string(dict, "Key") == NULL ||
+        strcmp(hb_dict_get_string(dict, "Key"), key) ||
+        hb_dict_get_int(dict, "PreviewCount") <= 0 ||
+        !scan_cache_complete(dict))
+    {
+        hb_value_free(&dict);
+        free(key);
+        return 0;
+    }
+    free(key);
+
+    // Restore the stored preview pictures first, a partial set
+    // would leave the previews the UI shows inconsistent
+    list = hb_dict_get(dict, "Previews");
+    count = hb_value_array_len(list);
+    for (ii = 0; store_previews && ii < count; ii++)
+    {
+        int    preview = hb_value_get_int(hb_value_array_get(list, ii));
+        char * filename;
+        int    copied;
+
+        filename = hb_get_temporary_filename("%d_%d_%d.jpg",
+                                             hb_get_instance_id(h),
+                                             title->index, preview);
+        scan_cache_filename(name, hash, preview);
+        copied = !copy_file(name, filename);
+        free(filename);
+        if (!copied)
+        {
+            hb_log("scan cache: missing preview %d of %s", preview, title->path);
+            hb_value_free(&dict);
+            return 0;
+        }
+    }
+    if (store_previews && count == 0)
+    {
+        hb_value_free(&dict);
+        return 0;
+    }
+
+    title->preview_count = hb_dict_get_int(dict, "PreviewCount");
+    if (hb_dict_get_bool(dict, "NoIDR"))
+    {
+        title->flags |= HBTF_NO_IDR;
+    }
+    title->has_resolution_change = hb_dict_get_bool(dict, "HasResolutionChange");
+    if (title->video_codec_name == NULL &&
+        hb_dict_get_string(dict, "VideoCodecName") != NULL)
+    {
+        title->video_codec_name = strdup(hb_dict_get_string(dict, "VideoCodecName"));
+    }
+    title->video_codec_profile  = hb_dict_get_int(dict, "VideoCodecProfile");
+    title->video_bitrate        = hb_dict_get_int(dict, "VideoBitrate");
+    title->video_decode_support = hb_dict_get_int(dict, "VideoDecodeSupport");
+    title->geometry.width       = hb_dict_get_int(dict, "Width");
+    title->geometry.height      = hb_dict_get_int(dict, "Height");
+    title->geometry.par         = value_rational(hb_dict_get(dict, "PAR"));
+    title->dar                  = value_rational(hb_dict_get(dict, "DAR"));
+    title->vrate                = value_rational(hb_dict_get(dict, "FrameRate"));
+    value_int_array(hb_dict_get(dict, "Crop"), title->crop, 4);
+    value_int_array(hb_dict_get(dict, "LooseCrop"), title->loose_crop, 4);
+    title->detected_interlacing = hb_dict_get_bool(dict, "InterlaceDetected");
+    title->pix_fmt              = hb_dict_get_int(dict, "PixFmt");
+    title->color_prim           = hb_dict_get_int(dict, "ColorPrimaries");
+    title->color_transfer       = hb_dict_get_int(dict, "ColorTransfer");
+    title->color_matrix         = hb_dict_get_int(dict, "ColorMatrix");
+    title->color_range          = hb_dict_get_int(dict, "ColorRange");
+    title->chroma_location      = hb_dict_get_int(dict, "ChromaLocation");
+    value_mastering(hb_dict_get(dict, "Mastering"), &title->mastering);
+    title->coll.max_cll         = hb_dict_get_int(dict, "MaxCLL");
+    title->coll.max_fall        = hb_dict_get_int(dict, "MaxFALL");
+    list = hb_dict_get(dict, "Ambient");
+    title->ambient.ambient_illuminance = value_rational(hb_value_array_get(list, 0));
+    title->ambient.ambient_light_x     = value_rational(hb_value_array_get(list, 1));
+    title->ambient.ambient_light_y     = value_rational(hb_value_array_get(list, 2));
+    title->hdr_10_plus          = hb_dict_get_int(dict, "HDR10+");
+    rpu = hb_dict_get(dict, "RPU");
+    if (rpu != NULL && title->initial_rpu == NULL)
+    {
+        title->initial_rpu      = value_data(rpu);
+        title->initial_rpu_type = hb_dict_get_int(dict, "RPUType");
+    }
+
+    // Closed captions are found by the video decoder while decoding
+    // previews, see decavcodec.c
+    cc = hb_dict_get(dict, "ClosedCaption");
+    if (cc != NULL && find_cc_subtitle(title) == NULL)
+    {
+        hb_subtitle_t * subtitle = calloc(sizeof(hb_subtitle_t), 1);
+
+        subtitle->track        = hb_list_count(title->list_subtitle);
+        subtitle->id           = HB_SUBTITLE_EMBEDDED_CC_TAG;
+        subtitle->format       = TEXTSUB;
+        subtitle->source       = CC608SUB;
+        subtitle->config.dest  = PASSTHRUSUB;
+        subtitle->codec        = WORK_DECAVSUB;
+        subtitle->codec_param  = AV_CODEC_ID_EIA_608;
+        subtitle->attributes   = HB_SUBTITLE_ATTR_CC;
+        subtitle->timebase.num = 1;
+        subtitle->timebase.den = 90000;
+        snprintf(subtitle->lang, sizeof(subtitle->lang), "%s",
+                 hb_dict_get_string(cc, "Language"));
+        snprintf(subtitle->iso639_2, sizeof(subtitle->iso639_2), "%s",
+                 hb_dict_get_string(cc, "LanguageCode"));
+        hb_list_add(title->list_subtitle, subtitle);
+    }
+
+    // Audio tracks that are not in the cache were not identified by the
+    // cached scan and keep a bitrate of 0, so the scan removes them
+    list = hb_dict_get(dict, "AudioList");
+    count = hb_value_array_len(list);
+    for (ii = 0; ii < count; ii++)
+    {
+        hb_dict_t  * audio_dict = hb_value_array_get(list, ii);
+        hb_audio_t * audio = find_audio(title, hb_dict_get_int(audio_dict, "ID"));
+        const char * layout;
+
+        if (audio == NULL)
+        {
+            continue;
+        }
+        audio->config.in.codec             = hb_dict_get_int(audio_dict, "Codec");
+        audio->config.in.samplerate        = hb_dict_get_int(audio_dict, "SampleRate");
+        audio->config.in.sample_bit_depth  = hb_dict_get_int(audio_dict, "SampleBitDepth");
+        audio->config.in.samples_per_frame = hb_dict_get_int(audio_dict, "SamplesPerFrame");
+        audio->config.in.bitrate           = hb_dict_get_int(audio_dict, "BitRate");
+        audio->config.in.matrix_encoding   = hb_dict_get_int(audio_dict, "MatrixEncoding");
+        audio->config.in.version           = hb_dict_get_int(audio_dict, "BitstreamVersion");
+        audio->config.in.flags             = hb_dict_get_int(audio_dict, "BitstreamFlags");
+        audio->config.in.mode              = hb_dict_get_int(audio_dict, "BitstreamMode");
+        if (audio->config.in.ch_layout == NULL)
+        {
+            audio->config.in.ch_layout = calloc(1, sizeof(*audio->config.in.ch_layout));
+        }
+        else
+        {
+            av_channel_layout_uninit(audio->config.in.ch_layout);
+        }
+        layout = hb_dict_get_string(audio_dict, "ChannelLayout");
+        if (layout == NULL || layout[0] == 0 ||
+            av_channel_layout_from_string(audio->config.in.ch_layout, layout))
+        {
+            memset(audio->config.in.ch_layout, 0, sizeof(*audio->config.in.ch_layout));
+        }
+        snprintf(audio->config.lang.description,
+                 sizeof(audio->config.lang.description), "%s",
+                 hb_dict_get_string(audio_dict, "Description"));
+    }
+
+    hb_value_free(&dict);
+
+    hb_log("scan: using cached scan of %s, %d previews, %dx%d, "
+           "autocrop = %d/%d/%d/%d", title->path, title->preview_count,
+           title->geometry.width, title->geometry.height,
+           title->crop[0], title->crop[1], title->crop[2], title->crop[3]);
+
+    return title->preview_count;
+}
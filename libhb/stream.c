@@ -11,6 +11,7 @@
 #include <ctype.h>
 #include <errno.h>
 #include <iconv.h>
+#include <fcntl.h>
 
 #include "handbrake/handbrake.h"
 #include "handbrake/hbffmpeg.h"
@@ -190,7 +191,6 @@ struct hb_stream_s
         int64_t last_timestamp; // used for discontinuity detection when
                                 // there are no PCRs
 
-        uint8_t *packet;        // buffer for one TS packet
         hb_ts_stream_t *list;
         int count;
         int alloc;
@@ -219,6 +219,15 @@ struct hb_stream_s
 
     char    *path;
     FILE    *file_handle;
+    struct
+    {
+        uint8_t *buf;           // STREAM_IO_BLOCK_SIZE + STREAM_IO_PEEK_MAX
+        int     pos;            // read position in buf
+        int     len;            // bytes of the file in buf
+        off_t   offset;         // file offset of buf[0]
+        int     eof;
+        int     error;          // ferror() of the last failed read
+    } io;
     hb_stream_type_t hb_stream_type;
     hb_title_t *title;
 
@@ -268,6 +277,187 @@ static void hb_init_audio_list(hb_stream_t *stream, hb_title_t *title);
 static void hb_init_subtitle_list(hb_stream_t *stream, hb_title_t *title);
 static int hb_ts_stream_find_pids(hb_stream_t *stream);
 
+/*
+ * Block reader of the native TS & PS demuxers.
+ *
+ * The file is read in large blocks that start at aligned offsets, so
+ * there are few read calls and network filesystems can read ahead.
+ * Packets are handed out as pointers into the block instead of being
+ * copied, and seeks inside the block don't touch the file.
+ *
+ * The file position of file_handle is always io.offset + io.len.
+ */
+#define STREAM_IO_BLOCK_SIZE    (1024 * 1024)
+#define STREAM_IO_ALIGN         4096
+#define STREAM_IO_PEEK_MAX      (64 * 1024)     // largest contiguous read
+
+static int stream_io_open( hb_stream_t *stream, FILE *file )
+{
+    stream->io.buf = malloc( STREAM_IO_BLOCK_SIZE + STREAM_IO_PEEK_MAX );
+    if ( stream->io.buf == NULL )
+    {
+        return -1;
+    }
+    // Reads go straight into the block, stdio buffering would only
+    // add a copy
+    setvbuf( file, NULL, _IONBF, 0 );
+#if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise( fileno( file ), 0, 0, POSIX_FADV_SEQUENTIAL );
+#endif
+    stream->file_handle = file;
+    stream->io.pos      = 0;
+    stream->io.len      = 0;
+    stream->io.offset   = 0;
+    stream->io.eof      = 0;
+    stream->io.error    = 0;
+    return 0;
+}
+
+static void stream_io_close( hb_stream_t *stream )
+{
+    if ( stream->file_handle )
+    {
+        fclose( stream->file_handle );
+        stream->file_handle = NULL;
+    }
+    free( stream->io.buf );
+    stream->io.buf = NULL;
+}
+
+/*
+ * Makes at least 'need' (at most STREAM_IO_PEEK_MAX) bytes available at
+ * the read position unless the end of the file is reached. Returns the
+ * number of bytes available.
+ */
+static int stream_io_fill( hb_stream_t *stream, int need )
+{
+    while ( stream->io.len - stream->io.pos < need && !stream->io.eof )
+    {
+        size_t n;
+
+        if ( stream->io.len > STREAM_IO_PEEK_MAX )
+        {
+            // Move the unread tail to the start of the buffer. The file
+            // position doesn't change so the reads stay aligned.
+            int left = stream->io.len - stream->io.pos;
+            memmove( stream->io.buf, stream->io.buf + stream->io.pos, left );
+            stream->io.offset += stream->io.pos;
+            stream->io.len     = left;
+            stream->io.pos     = 0;
+        }
+        n = fread( stream->io.buf + stream->io.len, 1, STREAM_IO_BLOCK_SIZE,
+                   stream->file_handle );
+        stream->io.len += n;
+        if ( n < STREAM_IO_BLOCK_SIZE )
+        {
+            stream->io.error = ferror( stream->file_handle );
+            stream->io.eof   = 1;
+        }
+    }
+    return stream->io.len - stream->io.pos;
+}
+
+static off_t stream_io_tell( hb_stream_t *stream )
+{
+    return stream->io.offset + stream->io.pos;
+}
+
+static off_t stream_io_size( hb_stream_t *stream )
+{
+    off_t size;
+
+    fseeko( stream->file_handle, 0, SEEK_END );
+    size = ftello( stream->file_handle );
+    fseeko( stream->file_handle, stream->io.offset + stream->io.len, SEEK_SET );
+    return size;
+}
+
+static int stream_io_seek( hb_stream_t *stream, off_t pos, int whence )
+{
+    off_t block;
+
+    if ( whence == SEEK_CUR )
+    {
+        pos += stream_io_tell( stream );
+    }
+    else if ( whence == SEEK_END )
+    {
+        pos += stream_io_size( stream );
+    }
+    if ( pos < 0 )
+    {
+        return -1;
+    }
+
+    stream->io.eof = 0;
+    if ( pos >= stream->io.offset &&
+         pos <= stream->io.offset + stream->io.len )
+    {
+        stream->io.pos = pos - stream->io.offset;
+        return 0;
+    }
+
+    block = pos & ~(off_t)(STREAM_IO_ALIGN - 1);
+    if ( fseeko( stream->file_handle, block, SEEK_SET ) < 0 )
+    {
+        return -1;
+    }
+    stream->io.offset = block;
+    stream->io.len    = 0;
+    stream->io.pos    = 0;
+    stream_io_fill( stream, pos - block );
+    stream->io.pos    = MIN( pos - block, stream->io.len );
+    return 0;
+}
+
+/*
+ * Returns a pointer to the next 'len' (at most STREAM_IO_PEEK_MAX) bytes
+ * and moves past them, or NULL at the end of the file. The pointer is
+ * valid until the next read or seek.
+ */
+static const uint8_t * stream_io_get( hb_stream_t *stream, int len )
+{
+    const uint8_t *data;
+
+    if ( stream_io_fill( stream, len ) < len )
+    {
+        return NULL;
+    }
+    data = stream->io.buf + stream->io.pos;
+    stream->io.pos += len;
+    return data;
+}
+
+static size_t stream_io_read( hb_stream_t *stream, void *dst, size_t len )
+{
+    uint8_t *out = dst;
+    size_t   done = 0;
+
+    while ( done < len )
+    {
+        int count = MIN( len - done, STREAM_IO_PEEK_MAX );
+        int avail = stream_io_fill( stream, count );
+        if ( avail <= 0 )
+        {
+            break;
+        }
+        count = MIN( count, avail );
+        memcpy( out + done, stream->io.buf + stream->io.pos, count );
+        stream->io.pos += count;
+        done += count;
+    }
+    return done;
+}
+
+static inline int stream_io_getc( hb_stream_t *stream )
+{
+    if ( stream->io.pos >= stream->io.len && stream_io_fill( stream, 1 ) < 1 )
+    {
+        return EOF;
+    }
+    return stream->io.buf[stream->io.pos++];
+}
+
 static void hb_ps_stream_init(hb_stream_t *stream);
 static hb_buffer_t * hb_ps_stream_decode(hb_stream_t *stream);
 static void hb_ps_stream_find_streams(hb_stream_t *stream);
@@ -554,7 +744,7 @@ static int hb_stream_check_for_ps(hb_stream_t *stream)
     uint8_t sc_buf[4];
     int pos = 0;
 
-    fseek(stream->file_handle, 0, SEEK_SET);
+    stream_io_seek(stream, 0, SEEK_SET);
 
     // program streams should start with a PACK then some other mpeg start
     // code (usually a SYS but that might be missing if we only have a clip).
@@ -562,7 +752,7 @@ static int hb_stream_check_for_ps(hb_stream_t *stream)
     {
         int offset;
 
-        if ( fread(buf, 1, sizeof(buf), stream->file_handle) != sizeof(buf) )
+        if ( stream_io_read(stream, buf, sizeof(buf)) != sizeof(buf) )
             return 0;
 
         for ( offset = 0; offset < 8*1024-27; ++offset )
@@ -592,23 +782,23 @@ static int hb_stream_check_for_ps(hb_stream_t *stream)
                 data_len = (b[4] << 8) + b[5];
                 if ( data_len && sid > 0xba && sid < 0xf9 )
                 {
-                    prev = ftell( stream->file_handle );
+                    prev = stream_io_tell( stream );
                     pos = prev - ( sizeof(buf) - offset );
                     pos += pes_offset + 6 + data_len;
-                    fseek( stream->file_handle, pos, SEEK_SET );
-                    if ( fread(sc_buf, 1, 4, stream->file_handle) != 4 )
+                    stream_io_seek( stream, pos, SEEK_SET );
+                    if ( stream_io_read(stream, sc_buf, 4) != 4 )
                         return 0;
                     if (sc_buf[0] == 0x00 && sc_buf[1] == 0x00 &&
                         sc_buf[2] == 0x01)
                     {
                         return 1;
                     }
-                    fseek( stream->file_handle, prev, SEEK_SET );
+                    stream_io_seek( stream, prev, SEEK_SET );
                 }
             }
         }
-        fseek( stream->file_handle, -27, SEEK_CUR );
-        pos = ftell( stream->file_handle );
+        stream_io_seek( stream, -27, SEEK_CUR );
+        pos = stream_io_tell( stream );
     }
     return 0;
 }
@@ -617,7 +807,7 @@ static int hb_stream_get_type(hb_stream_t *stream)
 {
     uint8_t buf[2048*4];
 
-    if ( fread(buf, 1, sizeof(buf), stream->file_handle) == sizeof(buf) )
+    if ( stream_io_read(stream, buf, sizeof(buf)) == sizeof(buf) )
     {
         int psize;
         if ( ( psize = hb_stream_check_for_ts(buf) ) != 0 )
@@ -646,19 +836,10 @@ static int hb_stream_get_type(hb_stream_t *stream)
 
 static void hb_stream_delete_dynamic( hb_stream_t *d )
 {
-    if( d->file_handle )
-    {
-        fclose( d->file_handle );
-        d->file_handle = NULL;
-    }
+    stream_io_close( d );
 
     int i=0;
 
-    if ( d->ts.packet )
-    {
-        free( d->ts.packet );
-        d->ts.packet = NULL;
-    }
     if ( d->ts.list )
     {
         for (i = 0; i < d->ts.count; i++)
@@ -861,11 +1042,10 @@ hb_stream_open(hb_handle_t *h, const char *path, hb_title_t *title, int scan)
      * reference structure & null otherwise.
      */
     d->h = h;
-    d->file_handle = f;
     d->title = title;
     d->scan = scan;
     d->path = strdup( path );
-    if (d->path != NULL )
+    if (d->path != NULL && stream_io_open( d, f ) == 0)
     {
         if (hb_stream_get_type( d ) != 0)
         {
@@ -878,17 +1058,17 @@ hb_stream_open(hb_handle_t *h, const char *path, hb_title_t *title, int scan)
             hb_stream_seek( d, 0. );
             return d;
         }
-        fclose( d->file_handle );
-        d->file_handle = NULL;
+        stream_io_close( d );
         if ( ffmpeg_open( d, title, scan ) )
         {
             return d;
         }
     }
-    if ( d->file_handle )
+    else
     {
-        fclose( d->file_handle );
+        fclose( f );
     }
+    stream_io_close( d );
     if (d->path)
     {
         free( d->path );
@@ -962,7 +1142,6 @@ hb_stream_t * hb_bd_stream_open( hb_handle_t *h, hb_title_t *title )
     d->file_handle = NULL;
     d->title = title;
     d->path = NULL;
-    d->ts.packet = NULL;
 
     int pid = title->video_id;
     int stream_type = title->video_stream_type;
@@ -1150,27 +1329,26 @@ hb_title_t * hb_stream_title_scan(hb_stream_t *stream, hb_title_t * title)
  */
 static const uint8_t *next_packet( hb_stream_t *stream )
 {
-    uint8_t *buf = stream->ts.packet + stream->packetsize - 188;
-
     while ( 1 )
     {
-        if ( fread(stream->ts.packet, 1, stream->packetsize, stream->file_handle) !=
-             stream->packetsize )
+        const uint8_t *packet = stream_io_get(stream, stream->packetsize);
+        if ( packet == NULL )
         {
             int err;
-            if ((err = ferror(stream->file_handle)) != 0)
+            if ((err = stream->io.error) != 0)
             {
                 hb_error("next_packet: error (%d)", err);
                 hb_set_work_error(stream->h, HB_ERROR_READ);
             }
             return NULL;
         }
+        const uint8_t *buf = packet + stream->packetsize - 188;
         if (buf[0] == 0x47)
         {
             return buf;
         }
         // lost sync - back up to where we started then try to re-establish.
-        off_t pos = ftello(stream->file_handle) - stream->packetsize;
+        off_t pos = stream_io_tell(stream) - stream->packetsize;
         off_t pos2 = align_to_next_packet(stream);
         if ( pos2 == 0 )
         {
@@ -1191,21 +1369,19 @@ static void skip_to_next_pack( hb_stream_t *src_stream )
     uint32_t strt_code = -1;
     int c;
 
-    flockfile( src_stream->file_handle );
-    while ( ( c = getc_unlocked( src_stream->file_handle ) ) != EOF )
+    while ( ( c = stream_io_getc( src_stream ) ) != EOF )
     {
         strt_code = ( strt_code << 8 ) | c;
         if ( strt_code == 0x000001ba )
             // we found the start of the next pack
             break;
     }
-    funlockfile( src_stream->file_handle );
 
     // if we didn't terminate on an eof back up so the next read
     // starts on the pack boundary.
     if ( c != EOF )
     {
-        fseeko( src_stream->file_handle, -4, SEEK_CUR );
+        stream_io_seek( src_stream, -4, SEEK_CUR );
     }
 }
 
@@ -1564,7 +1740,7 @@ static struct pts_pos hb_sample_pts(hb_stream_t *stream, uint64_t fpos)
     {
         const uint8_t *buf;
         int adapt_len;
-        fseeko( stream->file_handle, fpos, SEEK_SET );
+        stream_io_seek( stream, fpos, SEEK_SET );
         align_to_next_packet( stream );
         int pid = stream->ts.list[ts_index_of_video(stream)].pid;
         buf = hb_ts_stream_getPEStype( stream, pid, &adapt_len );
@@ -1592,7 +1768,7 @@ static struct pts_pos hb_sample_pts(hb_stream_t *stream, uint64_t fpos)
                 ++stream->has_IDRs;
             }
         }
-        pp.pos = ftello(stream->file_handle);
+        pp.pos = stream_io_tell(stream);
         if ( !stream->has_IDRs )
         {
             // Scan a little more to see if we will stumble upon one
@@ -1617,7 +1793,7 @@ static struct pts_pos hb_sample_pts(hb_stream_t *stream, uint64_t fpos)
 
         // round address down to nearest dvd sector start
         fpos &=~ ( HB_DVD_READ_BUFFER_SIZE - 1 );
-        fseeko( stream->file_handle, fpos, SEEK_SET );
+        stream_io_seek( stream, fpos, SEEK_SET );
         if ( stream->hb_stream_type == program )
         {
             skip_to_next_pack( stream );
@@ -1662,7 +1838,7 @@ static struct pts_pos hb_sample_pts(hb_stream_t *stream, uint64_t fpos)
         }
 
         pp.pts = pes_info.pts;
-        pp.pos = ftello(stream->file_handle);
+        pp.pos = stream_io_tell(stream);
     }
     return pp;
 }
@@ -1722,8 +1898,7 @@ static void hb_stream_duration(hb_stream_t *stream, hb_title_t *inTitle)
     struct pts_pos *pp = ptspos;
     int i;
 
-    fseeko(stream->file_handle, 0, SEEK_END);
-    uint64_t fsize = ftello(stream->file_handle);
+    uint64_t fsize = stream_io_size(stream);
     uint64_t fincr = fsize / NDURSAMPLES;
     uint64_t fpos = fincr / 2;
     for ( i = NDURSAMPLES; --i >= 0; fpos += fincr )
@@ -1737,7 +1912,7 @@ static void hb_stream_duration(hb_stream_t *stream, hb_title_t *inTitle)
     inTitle->minutes  = ( dur % 3600 ) / 60;
     inTitle->seconds  = dur % 60;
 
-    rewind(stream->file_handle);
+    stream_io_seek(stream, 0, SEEK_SET);
 }
 
 /***********************************************************************
@@ -1840,18 +2015,14 @@ int hb_stream_seek( hb_stream_t * stream, float f )
     {
         return ffmpeg_seek( stream, f );
     }
-    off_t stream_size, cur_pos, new_pos;
+    off_t stream_size, new_pos;
     double pos_ratio = f;
-    cur_pos = ftello( stream->file_handle );
-    fseeko( stream->file_handle, 0, SEEK_END );
-    stream_size = ftello( stream->file_handle );
+    stream_size = stream_io_size( stream );
     new_pos = (off_t) ((double) (stream_size) * pos_ratio);
     new_pos &=~ (HB_DVD_READ_BUFFER_SIZE - 1);
 
-    int r = fseeko( stream->file_handle, new_pos, SEEK_SET );
-    if (r == -1)
+    if ( stream_io_seek( stream, new_pos, SEEK_SET ) < 0 )
     {
-        fseeko( stream->file_handle, cur_pos, SEEK_SET );
         return 0;
     }
 
@@ -2306,8 +2477,6 @@ static int hb_ts_stream_init(hb_stream_t *stream)
     }
     stream->pes.count = 0;
 
-    stream->ts.packet = malloc( stream->packetsize );
-
     // Find the audio and video pids in the stream
     if (hb_ts_stream_find_pids(stream) < 0)
     {
@@ -2485,18 +2654,18 @@ static off_t align_to_next_packet(hb_stream_t *stream)
 {
     uint8_t buf[MAX_HOLE];
     off_t pos = 0;
-    off_t start = ftello(stream->file_handle);
+    off_t start = stream_io_tell(stream);
     off_t orig;
 
     if ( start >= stream->packetsize ) {
         start -= stream->packetsize;
-        fseeko(stream->file_handle, start, SEEK_SET);
+        stream_io_seek(stream, start, SEEK_SET);
     }
     orig = start;
 
     while (1)
     {
-        if (fread(buf, sizeof(buf), 1, stream->file_handle) == 1)
+        if (stream_io_read(stream, buf, sizeof(buf)) == sizeof(buf))
         {
             const uint8_t *bp = buf;
             int i;
@@ -2513,13 +2682,13 @@ static off_t align_to_next_packet(hb_stream_t *stream)
                 pos = ( bp - buf ) - stream->packetsize + 188;
                 break;
             }
-            fseeko(stream->file_handle, -8 * stream->packetsize, SEEK_CUR);
-            start = ftello(stream->file_handle);
+            stream_io_seek(stream, -8 * stream->packetsize, SEEK_CUR);
+            start = stream_io_tell(stream);
         }
         else
         {
             int err;
-            if ((err = ferror(stream->file_handle)) != 0)
+            if ((err = stream->io.error) != 0)
             {
                 hb_error("align_to_next_packet: error (%d)", err);
                 hb_set_work_error(stream->h, HB_ERROR_READ);
@@ -2527,7 +2696,7 @@ static off_t align_to_next_packet(hb_stream_t *stream)
             return 0;
         }
     }
-    fseeko(stream->file_handle, start+pos, SEEK_SET);
+    stream_io_seek(stream, start+pos, SEEK_SET);
     return start - orig + pos;
 }
 
@@ -3377,8 +3546,7 @@ static int hb_ps_read_packet( hb_stream_t * stream, hb_buffer_t *b )
     int c;
 
 #define cp (b->data)
-    flockfile( stream->file_handle );
-    while ( ( c = getc_unlocked( stream->file_handle ) ) != EOF )
+    while ( ( c = stream_io_getc( stream ) ) != EOF )
     {
         start_code = ( start_code << 8 ) | c;
         if ( ( start_code >> 8 )== 0x000001 )
@@ -3410,7 +3578,7 @@ static int hb_ps_read_packet( hb_stream_t * stream, hb_buffer_t *b )
         }
 
         // There are at least 8 bytes.  More if this is mpeg2 pack.
-        if (fread( cp+pos, 1, 8, stream->file_handle ) < 8)
+        if (stream_io_read( stream, cp+pos, 8 ) < 8)
             goto done;
 
         int mark = cp[pos] >> 4;
@@ -3419,12 +3587,12 @@ static int hb_ps_read_packet( hb_stream_t * stream, hb_buffer_t *b )
         if ( mark != 0x02 )
         {
             // mpeg-2 pack,
-            if (fread( cp+pos, 1, 2, stream->file_handle ) == 2)
+            if (stream_io_read( stream, cp+pos, 2 ) == 2)
             {
                 int len = cp[start+13] & 0x7;
                 pos += 2;
                 if (len > 0 &&
-                    fread( cp+pos, 1, len, stream->file_handle ) == len)
+                    stream_io_read( stream, cp+pos, len ) == len)
                     pos += len;
                 else
                     goto done;
@@ -3437,11 +3605,11 @@ static int hb_ps_read_packet( hb_stream_t * stream, hb_buffer_t *b )
     else if ( stream_id >= 0xbb )
     {
         int len = 0;
-        c = getc_unlocked( stream->file_handle );
+        c = stream_io_getc( stream );
         if ( c == EOF )
             goto done;
         len = c << 8;
-        c = getc_unlocked( stream->file_handle );
+        c = stream_io_getc( stream );
         if ( c == EOF )
             goto done;
         len |= c;
@@ -3457,7 +3625,7 @@ static int hb_ps_read_packet( hb_stream_t * stream, hb_buffer_t *b )
         if ( len )
         {
             // Length is non-zero, read the packet all at once
-            len = fread( cp+pos, 1, len, stream->file_handle );
+            len = stream_io_read( stream, cp+pos, len );
             pos += len;
         }
         else
@@ -3465,7 +3633,7 @@ static int hb_ps_read_packet( hb_stream_t * stream, hb_buffer_t *b )
             // Length is zero, read bytes till we find a start code.
             // Only video PES packets are allowed to have zero length.
             start_code = -1;
-            while ( ( c = getc_unlocked( stream->file_handle ) ) != EOF )
+            while ( ( c = stream_io_getc( stream ) ) != EOF )
             {
                 start_code = ( start_code << 8 ) | c;
                 if ( pos  >= b->alloc )
@@ -3484,14 +3652,14 @@ static int hb_ps_read_packet( hb_stream_t * stream, hb_buffer_t *b )
             if ( c == EOF )
                 goto done;
             pos -= 4;
-            fseeko( stream->file_handle, -4, SEEK_CUR );
+            stream_io_seek( stream, -4, SEEK_CUR );
         }
     }
     else
     {
         // Unknown, find next start code
         start_code = -1;
-        while ( ( c = getc_unlocked( stream->file_handle ) ) != EOF )
+        while ( ( c = stream_io_getc( stream ) ) != EOF )
         {
             start_code = ( start_code << 8 ) | c;
             if ( pos  >= b->alloc )
@@ -3508,17 +3676,14 @@ static int hb_ps_read_packet( hb_stream_t * stream, hb_buffer_t *b )
         if ( c == EOF )
             goto done;
         pos -= 4;
-        fseeko( stream->file_handle, -4, SEEK_CUR );
+        stream_io_seek( stream, -4, SEEK_CUR );
     }
 
 done:
     // Parse packet for information we might need
-    funlockfile( stream->file_handle );
-
-    int err;
-    if ((err = ferror(stream->file_handle)) != 0)
+    if (stream->io.error != 0)
     {
-        hb_error("hb_ps_read_packet: error (%d)", err);
+        hb_error("hb_ps_read_packet: error (%d)", stream->io.error);
         hb_set_work_error(stream->h, HB_ERROR_READ);
     }
 
@@ -3896,7 +4061,7 @@ static void hb_ps_stream_find_streams(hb_stream_t *stream)
     int ii, jj;
     hb_buffer_t *buf  = hb_buffer_init(HB_DVD_READ_BUFFER_SIZE);
 
-    fseeko( stream->file_handle, 0, SEEK_SET );
+    stream_io_seek( stream, 0, SEEK_SET );
     // Scan beginning of file, then if no program stream map is found
     // seek to 20% and scan again since there's occasionally no
     // audio at the beginning (particularly for vobs).
@@ -4616,9 +4781,8 @@ static int hb_ts_stream_find_pids(hb_stream_t *stream)
     // changes PMTs (and thus video & audio PIDs) when 'programs' change. Since
     // we may have the tail of the previous program at the beginning of this
     // file, take our PMT from the middle of the file.
-    fseeko(stream->file_handle, 0, SEEK_END);
-    uint64_t fsize = ftello(stream->file_handle);
-    fseeko(stream->file_handle, fsize >> 1, SEEK_SET);
+    uint64_t fsize = stream_io_size(stream);
+    stream_io_seek(stream, fsize >> 1, SEEK_SET);
     align_to_next_packet(stream);
 
     // Read the Transport Stream Packets (188 bytes each) looking at first for PID 0 (the PAT PID), then decode that
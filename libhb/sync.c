@@ -121,6 +121,7 @@ typedef struct
             int     id;
             int     cadence[12];
             int     new_chap;
+            int     passthru;   // compressed packets, see vidpass.c
         } video;
 
         // Audio stream context
@@ -462,6 +463,51 @@ static void setNextPts( sync_common_t * common )
     }
 }
 
+// Copied video can only lose the frames ahead of a key frame.  Drops
+// what precedes the last key frame that starts at or before 'pts'.
+static void dropVideoToKeyFrame( sync_stream_t * stream, int64_t pts )
+{
+    hb_buffer_t * buf;
+    int           ii, key = 0;
+
+    for (ii = 0; ii < hb_list_count(stream->in_queue); ii++)
+    {
+        buf = hb_list_item(stream->in_queue, ii);
+        if (buf->s.start > pts)
+        {
+            break;
+        }
+        if (buf->s.flags & HB_FLAG_FRAMETYPE_KEY)
+        {
+            key = ii;
+        }
+    }
+    while (key-- > 0)
+    {
+        buf = hb_list_item(stream->in_queue, 0);
+        hb_list_rem(stream->in_queue, buf);
+        hb_buffer_close(&buf);
+    }
+}
+
+// Returns the start of the first key frame of copied video that starts
+// at or after 'pts', or 'pts' if none is queued yet.
+static int64_t nextVideoKeyFrame( sync_stream_t * stream, int64_t pts )
+{
+    hb_buffer_t * buf;
+    int           ii;
+
+    for (ii = 0; ii < hb_list_count(stream->in_queue); ii++)
+    {
+        buf = hb_list_item(stream->in_queue, ii);
+        if (buf->s.start >= pts && (buf->s.flags & HB_FLAG_FRAMETYPE_KEY))
+        {
+            return buf->s.start;
+        }
+    }
+    return pts;
+}
+
 static void alignStream( sync_common_t * common, sync_stream_t * stream,
                          int64_t pts )
 {
@@ -490,6 +536,17 @@ static void alignStream( sync_common_t * common, sync_stream_t * stream,
             {
                 continue;
             }
+            if (other_stream->type == SYNC_TYPE_VIDEO &&
+                other_stream->video.passthru)
+            {
+                dropVideoToKeyFrame(other_stream, pts);
+                buf = hb_list_item(other_stream->in_queue, 0);
+                if (buf != NULL && buf->s.start >= pts)
+                {
+                    alignStream(common, other_stream, pts);
+                }
+                continue;
+            }
             while (hb_list_count(other_stream->in_queue) > 0)
             {
                 buf = hb_list_item(other_stream->in_queue, 0);
@@ -533,7 +590,12 @@ static void alignStream( sync_common_t * common, sync_stream_t * stream,
         }
         else if (stream->type == SYNC_TYPE_VIDEO)
         {
-            blank_buf = CreateBlackBuf(stream, gap, pts);
+            // Can't add black frames to copied video either, the first
+            // frame gets extended below
+            if (!stream->video.passthru)
+            {
+                blank_buf = CreateBlackBuf(stream, gap, pts);
+            }
         }
 
         int64_t last_stop = pts;
@@ -573,7 +635,14 @@ static void alignStreams( sync_common_t * common, int64_t pts )
 
             // P-to-P encoding will pass the start point in pts.
             // Drop any buffers that are before the start point.
-            while (buf != NULL && buf->s.start < pts)
+            if (stream->type == SYNC_TYPE_VIDEO && stream->video.passthru &&
+                pts != AV_NOPTS_VALUE)
+            {
+                dropVideoToKeyFrame(stream, pts);
+                buf = hb_list_item(stream->in_queue, 0);
+            }
+            while (buf != NULL && buf->s.start < pts &&
+                   !(stream->type == SYNC_TYPE_VIDEO && stream->video.passthru))
             {
                 hb_list_rem(stream->in_queue, buf);
                 hb_buffer_close(&buf);
@@ -611,6 +680,14 @@ static void alignStreams( sync_common_t * common, int64_t pts )
                 }
             }
         }
+        if (first_pts != AV_NOPTS_VALUE && audio_passthru &&
+            common->streams[0].type == SYNC_TYPE_VIDEO &&
+            common->streams[0].video.passthru)
+        {
+            // Copied video has to start at a key frame, move the start
+            // to the next one rather than cut into a GOP
+            first_pts = nextVideoKeyFrame(&common->streams[0], first_pts);
+        }
         if (first_pts != AV_NOPTS_VALUE)
         {
             for (ii = 0; ii < common->stream_count; ii++)
@@ -937,6 +1014,23 @@ static void fixVideoOverlap( sync_stream_t * stream )
         // For video, an overlap is where the entire frame is
         // in the past.
         overlap = stream->next_pts - buf->s.stop;
+        if (overlap >= 0 && stream->video.passthru)
+        {
+            // Copied frames can't be dropped, later frames depend on
+            // them.  Shift the frame past the previous one instead.
+            if (buf->s.duration <= 0)
+            {
+                buf->s.duration =
+                            90000. * stream->common->job->title->vrate.den /
+                                     stream->common->job->title->vrate.num;
+            }
+            hb_log("sync: video time went backwards %d ms, shifted frame. "
+                   "PTS %"PRId64"", (int)(overlap + buf->s.duration) / 90,
+                   buf->s.start);
+            buf->s.start = stream->next_pts;
+            buf->s.stop  = stream->next_pts + buf->s.duration;
+            break;
+        }
         if (overlap >= 0)
         {
             if (stream->drop == 0)
@@ -1431,6 +1525,13 @@ static void terminateSubtitleStreams( sync_common_t * common )
 // timestamp correction.  In this scenario, we forego lowest PTS and pull
 // the next lowest PTS that has enough buffers in the queue to perform
 // timestamp correction.
+// Copied video can only start (and be cut) at a key frame
+static int isStartFrame( sync_stream_t * stream, hb_buffer_t * buf )
+{
+    return stream->type != SYNC_TYPE_VIDEO || !stream->video.passthru ||
+           (buf->s.flags & HB_FLAG_FRAMETYPE_KEY);
+}
+
 static int OutputBuffer( sync_common_t * common )
 {
     int             ii, more;
@@ -1532,7 +1633,8 @@ static int OutputBuffer( sync_common_t * common )
                     continue;
                 }
                 common->start_pts = buf->s.start + 1;
-                if (out_stream->frame_count >= common->job->frame_to_start)
+                if (out_stream->frame_count >= common->job->frame_to_start &&
+                    isStartFrame(out_stream, buf))
                 {
                     common->start_found = 1;
                     out_stream->frame_count = 0;
@@ -1540,7 +1642,33 @@ static int OutputBuffer( sync_common_t * common )
             }
             else if (common->wait_for_pts)
             {
-                if (buf->s.start >= common->pts_to_start)
+                if (buf->s.start >= common->pts_to_start &&
+                    common->streams[0].video.passthru &&
+                    (out_stream->type != SYNC_TYPE_VIDEO ||
+                     !isStartFrame(out_stream, buf)))
+                {
+                    // Copied video has to start at a key frame.  Only
+                    // video can find it, move the start point past
+                    // video frames that don't qualify.
+                    if (out_stream->type == SYNC_TYPE_VIDEO)
+                    {
+                        common->start_pts    =
+                        common->pts_to_start = buf->s.start + 1;
+                    }
+                    else if (!common->flush)
+                    {
+                        // Wait for more video
+                        break;
+                    }
+                    else
+                    {
+                        // Video ended without a key frame
+                        hb_list_rem(out_stream->in_queue, buf);
+                        hb_buffer_close(&buf);
+                        continue;
+                    }
+                }
+                else if (buf->s.start >= common->pts_to_start)
                 {
                     common->start_found = 1;
                     common->streams[0].frame_count = 0;
@@ -1586,6 +1714,14 @@ static int OutputBuffer( sync_common_t * common )
             }
         }
 
+        // Copied video can only be cut before a key frame, keep going
+        // until the next one
+        if (out_stream->type == SYNC_TYPE_VIDEO &&
+            !isStartFrame(out_stream, buf) && common->stop_pts &&
+            buf->s.start >= common->stop_pts)
+        {
+            common->stop_pts = buf->s.start + 1;
+        }
         // If pts_to_stop or frame_to_stop were specified, stop output
         if (common->stop_pts &&
             buf->s.start >= common->stop_pts )
@@ -1616,7 +1752,8 @@ static int OutputBuffer( sync_common_t * common )
         }
         if (out_stream->type == SYNC_TYPE_VIDEO &&
             common->job->frame_to_stop &&
-            out_stream->frame_count >= common->job->frame_to_stop)
+            out_stream->frame_count >= common->job->frame_to_stop &&
+            isStartFrame(out_stream, buf))
         {
             hb_log("sync: reached video frame %d, exiting early",
                    out_stream->frame_count);
@@ -1729,6 +1866,11 @@ static int OutputBuffer( sync_common_t * common )
             log_chapter(common, buf->s.new_chap, out_stream->frame_count,
                         buf->s.start);
         }
+        if (out_stream->type == SYNC_TYPE_VIDEO &&
+            out_stream->video.passthru)
+        {
+            buf->s.renderOffset = buf->s.start - buf->s.renderOffset;
+        }
         if (buf->s.start < 0)
         {
             // The pipeline can't handle negative timestamps
@@ -2083,9 +2225,20 @@ static void QueueBuffer( sync_stream_t * stream, hb_buffer_t * buf )
         }
     }
 
-    // Render offset is only useful for decoders, which are all
-    // upstream of sync.  Squash it.
-    buf->s.renderOffset = AV_NOPTS_VALUE;
+    if (stream->type == SYNC_TYPE_VIDEO && stream->video.passthru)
+    {
+        // Copied video keeps its decode timestamps.  Timestamp
+        // corrections only touch s.start, so carry the distance to the
+        // decode timestamp instead and restore it in OutputBuffer.
+        buf->s.renderOffset = buf->s.renderOffset != AV_NOPTS_VALUE ?
+                              buf->s.start - buf->s.renderOffset : 0;
+    }
+    else
+    {
+        // Render offset is only useful for decoders, which are all
+        // upstream of sync.  Squash it.
+        buf->s.renderOffset = AV_NOPTS_VALUE;
+    }
 
     hb_deep_log(11,
         "type %8s id %x scr seq %d start %"PRId64" stop %"PRId64" dur %f",
@@ -2151,6 +2304,12 @@ static int InitAudio( sync_common_t * common, int index )
     w->audio        = audio;
     w->fifo_in      = audio->priv.fifo_raw;
     w->fifo_out     = audio->priv.fifo_sync;
+    if (w->fifo_out == NULL)
+    {
+        // Passthrough without an encoder, timestamps are all that
+        // changes so the packets can go to the muxer as they are
+        w->fifo_out = audio->priv.fifo_out;
+    }
 
     pv->common                  = common;
     pv->stream                  = &common->streams[1 + index];
@@ -2256,12 +2415,18 @@ static int InitSubtitle( sync_common_t * common, int index )
     pv->stream->subtitle.subtitle = subtitle;
     pv->stream->fifo_out          = subtitle->fifo_sync;
     pv->stream->fifo_in           = subtitle->fifo_in;
+    if (pv->stream->fifo_out == NULL)
+    {
+        // Passthrough without an encoder, see InitAudio().
+        // fifo_out is also NULL during subtitle scan.
+        pv->stream->fifo_out      = subtitle->fifo_out;
+    }
 
     w = hb_get_work(common->job->h, WORK_SYNC_SUBTITLE);
     w->private_data = pv;
     w->subtitle     = subtitle;
     w->fifo_in      = subtitle->fifo_raw;
-    w->fifo_out     = subtitle->fifo_sync;
+    w->fifo_out     = pv->stream->fifo_out;
 
     memset(&pv->stream->subtitle.sanitizer, 0,
            sizeof(pv->stream->subtitle.sanitizer));
@@ -2354,6 +2519,8 @@ static int syncVideoInit( hb_work_object_t * w, hb_job_t * job)
     pv->stream->last_duration   = (int64_t)AV_NOPTS_VALUE;
     pv->stream->fifo_out        = job->fifo_sync;
     pv->stream->video.id        = job->title->video_id;
+    pv->stream->video.passthru  = job->vcodec == HB_VCODEC_PASS &&
+                                  !job->indepth_scan;
 
     w->fifo_in                  = job->fifo_raw;
     w->fifo_out                 = job->fifo_sync;
@@ -2361,7 +2528,7 @@ static int syncVideoInit( hb_work_object_t * w, hb_job_t * job)
     if (job->pass_id == HB_PASS_ENCODE_FINAL)
     {
         /* We already have an accurate frame count from pass 1 */
-        hb_interjob_t * interjob = hb_interjob_get(job->h);
+        hb_interjob_t * interjob = job->interjob;
         pv->common->est_frame_count = interjob->frame_count;
     }
     else
@@ -2522,7 +2689,7 @@ static void syncVideoClose( hb_work_object_t * w )
     if( job->pass_id == HB_PASS_ENCODE_ANALYSIS )
     {
         /* Preserve frame count for better accuracy in pass 2 */
-        hb_interjob_t * interjob = hb_interjob_get( job->h );
+        hb_interjob_t * interjob = job->interjob;
         interjob->frame_count = pv->stream->frame_count;
     }
     sync_delta_t * delta;
@@ -3185,7 +3352,7 @@ static void UpdateState( sync_common_t * common, int frame_count )
         common->st_counts[3] = frame_count;
     }
 
-    hb_get_state2(job->h, &state);
+    hb_get_job_state(job, &state);
     state.state = HB_STATE_WORKING;
 
 #define p state.param.working
@@ -3225,7 +3392,7 @@ static void UpdateState( sync_common_t * common, int frame_count )
     }
 #undef p
 
-    hb_set_state(job->h, &state);
+    hb_set_job_state(job, &state);
 }
 
 static void UpdateSearchState( sync_common_t * common, int64_t start,
@@ -3250,7 +3417,7 @@ static void UpdateSearchState( sync_common_t * common, int64_t start,
         common->st_first = now;
     }
 
-    hb_get_state2(job->h, &state);
+    hb_get_job_state(job, &state);
     state.state = HB_STATE_SEARCHING;
 
 #define p state.param.working
@@ -3292,7 +3459,7 @@ static void UpdateSearchState( sync_common_t * common, int64_t start,
     }
 #undef p
 
-    hb_set_state(job->h, &state);
+    hb_set_job_state(job, &state);
 }
 
 static int syncSubtitleInit( hb_work_object_t * w, hb_job_t * job )
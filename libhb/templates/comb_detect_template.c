@@ -341,7 +341,20 @@ static void FUNC(detect_gamma_combed_segment)(hb_filter_private_t *pv,
 
         memset(mask, 0, mask_stride);
 
-        for (int x = 0; x < width; x++)
+        int x = 0;
+        if (pv->functions.FUNC(detect_gamma_combed_row) != NULL)
+        {
+            x = pv->functions.FUNC(detect_gamma_combed_row)(prev, cur, next,
+                                                            stride_prev, stride_cur, stride_next,
+                                                            mask, width, pv->force_exaustive_check,
+                                                            &pv->params);
+            cur  += x;
+            prev += x;
+            next += x;
+            mask += x;
+        }
+
+        for (; x < width; x++)
         {
             const float up_diff    = pv->gamma_lut[cur[0]] - pv->gamma_lut[cur[up_1]];
             const float down_diff  = pv->gamma_lut[cur[0]] - pv->gamma_lut[cur[down_1]];
@@ -844,7 +857,20 @@ static void FUNC(detect_combed_segment)(hb_filter_private_t *pv,
 
         memset(mask, 0, mask_stride);
 
-        for (int x = 0; x < width; x++)
+        int x = 0;
+        if (pv->functions.FUNC(detect_combed_row) != NULL)
+        {
+            x = pv->functions.FUNC(detect_combed_row)(prev, cur, next,
+                                                      stride_prev, stride_cur, stride_next,
+                                                      mask, width, pv->force_exaustive_check,
+                                                      &pv->params);
+            cur  += x;
+            prev += x;
+            next += x;
+            mask += x;
+        }
+
+        for (; x < width; x++)
         {
             const int up_diff = cur[0] - cur[up_1];
             const int down_diff = cur[0] - cur[down_1];
@@ -390,16 +390,16 @@ static void FUNC(eedi2_interpolate_plane)(hb_filter_private_t *pv, int plane)
     // edge mask
     FUNC(eedi2_build_edge_mask)(mskp, pitch, srcp, pitch,
                      pv->magnitude_threshold, pv->variance_threshold, pv->laplacian_threshold,
-                     half_height, width, pv->depth);
-    FUNC(eedi2_erode_edge_mask)(mskp, pitch, tmpp, pitch, pv->erosion_threshold, half_height, width, pv->depth);
-    FUNC(eedi2_dilate_edge_mask)(tmpp, pitch, mskp, pitch, pv->dilation_threshold, half_height, width, pv->depth);
-    FUNC(eedi2_erode_edge_mask)(mskp, pitch, tmpp, pitch, pv->erosion_threshold, half_height, width, pv->depth);
+                     half_height, width, pv->depth, &pv->eedi2_functions);
+    FUNC(eedi2_erode_edge_mask)(mskp, pitch, tmpp, pitch, pv->erosion_threshold, half_height, width, pv->depth, &pv->eedi2_functions);
+    FUNC(eedi2_dilate_edge_mask)(tmpp, pitch, mskp, pitch, pv->dilation_threshold, half_height, width, pv->depth, &pv->eedi2_functions);
+    FUNC(eedi2_erode_edge_mask)(mskp, pitch, tmpp, pitch, pv->erosion_threshold, half_height, width, pv->depth, &pv->eedi2_functions);
     FUNC(eedi2_remove_small_gaps)(tmpp, pitch, mskp, pitch, half_height, width, pv->depth);
 
     // direction mask
     FUNC(eedi2_calc_directions)(plane, mskp, pitch, srcp, pitch, tmpp, pitch,
                      pv->maximum_search_distance, pv->noise_threshold,
-                     half_height, width, pv->depth, pv->eedi_limlut);
+                     half_height, width, pv->depth, pv->eedi_limlut, &pv->eedi2_functions);
     FUNC(eedi2_filter_dir_map)(mskp, pitch, tmpp, pitch, dstp, pitch, half_height, width, pv->depth, pv->eedi_limlut);
     FUNC(eedi2_expand_dir_map)(mskp, pitch, dstp, pitch, tmpp, pitch, half_height, width, pv->depth, pv->eedi_limlut);
     FUNC(eedi2_filter_map)(mskp, pitch, tmpp, pitch, dstp, pitch, half_height, width, pv->depth);
@@ -120,7 +120,8 @@ void FUNC(eedi2_upscale_by_2)(const pixel *srcp, pixel *dstp, const int height,
  * @param width Width of srcp bitmap rows, as opposed to the padded stride in src_pitch
  */
 void FUNC(eedi2_build_edge_mask)(pixel *dstp, const int dst_pitch, const pixel *srcp, const int src_pitch,
-                                 int mthresh, const int lthresh, int vthresh, const int height, const int width, const int depth)
+                                 int mthresh, const int lthresh, int vthresh, const int height, const int width, const int depth,
+                                 const EEDI2Functions *functions)
 {
     const pixel peak = (1 << depth) - 1;
     const pixel shift = depth - 8;
@@ -137,7 +138,13 @@ void FUNC(eedi2_build_edge_mask)(pixel *dstp, const int dst_pitch, const pixel *
     const pixel *srcpn = srcp+src_pitch;
     for (int y = 1; y < height - 1; ++y )
     {
-        for (int x = 1; x < width-1; ++x )
+        int x = 1;
+        if (functions->FUNC(build_edge_mask_row) != NULL)
+        {
+            x += functions->FUNC(build_edge_mask_row)(dstp + 1, srcpp + 1, srcp + 1, srcpn + 1, width - 2,
+                                                      mthresh, lthresh, vthresh, depth);
+        }
+        for (; x < width-1; ++x )
         {
             if ((abs(srcpp[x]  -   srcp[x]) < ten &&
                  abs( srcp[x]  -  srcpn[x]) < ten &&
@@ -205,7 +212,8 @@ void FUNC(eedi2_build_edge_mask)(pixel *dstp, const int dst_pitch, const pixel *
  * @param width Width of mskp bitmap rows, as opposed to the pdded stride in msk_pitch
  */
 void FUNC(eedi2_dilate_edge_mask)(const pixel *mskp, const int msk_pitch, pixel *dstp, const int dst_pitch,
-                                  const int dstr, const int height, const int width, const int depth)
+                                  const int dstr, const int height, const int width, const int depth,
+                                  const EEDI2Functions *functions)
 {
     const pixel peak = (1 << depth) - 1;
 
@@ -217,7 +225,13 @@ void FUNC(eedi2_dilate_edge_mask)(const pixel *mskp, const int msk_pitch, pixel
     dstp += dst_pitch;
     for (int y = 1; y < height - 1; ++y)
     {
-        for (int x = 1; x < width - 1; ++x)
+        int x = 1;
+        if (functions->FUNC(dilate_edge_mask_row) != NULL)
+        {
+            x += functions->FUNC(dilate_edge_mask_row)(mskpp + 1, mskp + 1, mskpn + 1, dstp + 1,
+                                                       width - 2, dstr, depth);
+        }
+        for (; x < width - 1; ++x)
         {
             if (mskp[x] != 0)
             {
@@ -257,7 +271,8 @@ void FUNC(eedi2_dilate_edge_mask)(const pixel *mskp, const int msk_pitch, pixel
  * @param width Width of mskp bitmap rows, as opposed to the pdded stride in msk_pitch
  */
 void FUNC(eedi2_erode_edge_mask)(const pixel *mskp, const int msk_pitch, pixel *dstp, const int dst_pitch,
-                                 const int estr, const int height, const int width, const int depth)
+                                 const int estr, const int height, const int width, const int depth,
+                                 const EEDI2Functions *functions)
 {
     const pixel peak = (1 << depth) - 1;
 
@@ -269,7 +284,13 @@ void FUNC(eedi2_erode_edge_mask)(const pixel *mskp, const int msk_pitch, pixel *
     dstp += dst_pitch;
     for (int y = 1; y < height - 1; ++y)
     {
-        for (int x = 1; x < width - 1; ++x)
+        int x = 1;
+        if (functions->FUNC(erode_edge_mask_row) != NULL)
+        {
+            x += functions->FUNC(erode_edge_mask_row)(mskpp + 1, mskp + 1, mskpn + 1, dstp + 1,
+                                                      width - 2, estr, depth);
+        }
+        for (; x < width - 1; ++x)
         {
             if( mskp[x] != peak ) continue;
 
@@ -356,7 +377,8 @@ void FUNC(eedi2_remove_small_gaps)(const pixel *mskp, const int msk_pitch, pixel
  * @param width Width of srcp bitmap rows, as opposed to the pdded stride in src_pitch
  */
 void FUNC(eedi2_calc_directions)(const int plane, const pixel *mskp, const int msk_pitch, const pixel *srcp, const int src_pitch,
-                                 pixel *dstp, const int dst_pitch, const int maxd, const int nt, const int height, const int width, const int depth, const pixel limlut[33])
+                                 pixel *dstp, const int dst_pitch, const int maxd, const int nt, const int height, const int width, const int depth, const pixel limlut[33],
+                                 const EEDI2Functions *functions)
 {
     const pixel neutral = 1 << (depth - 1);
     const pixel peak = (1 << depth) - 1;
@@ -386,99 +408,125 @@ void FUNC(eedi2_calc_directions)(const int plane, const pixel *mskp, const int m
     const pixel *mskpn = mskp + msk_pitch;
     const int maxdt = plane == 0 ? maxd : ( maxd >> 1 );
 
+    int dirs[5][EEDI2_DIRECTIONS_BLOCK];
+
     for (int y = 1; y < height - 1; ++y )
     {
+        // Pixels block_start..block_stop-1 have their directions in dirs
+        int block_start = 0;
+        int block_stop  = 0;
         for (int x = 1; x < width - 1; ++x )
         {
             if( mskp[x] != peak || ( mskp[x-1] != peak && mskp[x+1] != peak ) )
                 continue;
-            const int startu = MAX( -x + 1, -maxdt );
-            const int stopu = MIN( width - 2 - x, maxdt );
-            int minb = MIN( nt13,
-                            ( abs( srcp[x] - srcpn[x] ) +
-                              abs( srcp[x] - srcpp[x] ) ) * 6 );
-            int mina = MIN( nt19,
-                            ( abs( srcp[x] - srcpn[x] ) +
-                              abs( srcp[x] - srcpp[x] ) ) * 9 );
-            int minc = mina;
-            int mind = minb;
-            int mine = minb;
+            if (x >= block_stop && functions->FUNC(calc_directions_block) != NULL &&
+                x - 1 >= maxdt && x + EEDI2_DIRECTIONS_BLOCK + maxdt <= width - 1)
+            {
+                functions->FUNC(calc_directions_block)(mskpp + x, mskpn + x,
+                                                       src2p + x, srcpp + x, srcp + x, srcpn + x, src2n + x,
+                                                       maxdt, nt13, nt19, y == 1, y == height - 2,
+                                                       depth, dirs);
+                block_start = x;
+                block_stop  = x + EEDI2_DIRECTIONS_BLOCK;
+            }
             int dira = -5000, dirb = -5000, dirc = -5000, dird = -5000, dire = -5000;
-            for (int u = startu; u <= stopu; ++u )
+            if (x < block_stop)
+            {
+                dira = dirs[0][x - block_start];
+                dirb = dirs[1][x - block_start];
+                dirc = dirs[2][x - block_start];
+                dird = dirs[3][x - block_start];
+                dire = dirs[4][x - block_start];
+            }
+            else
             {
-                if (y == 1 ||
-                      mskpp[x-1+u] == peak || mskpp[x+u] == peak || mskpp[x+1+u] == peak )
+                const int startu = MAX( -x + 1, -maxdt );
+                const int stopu = MIN( width - 2 - x, maxdt );
+                int minb = MIN( nt13,
+                                ( abs( srcp[x] - srcpn[x] ) +
+                                  abs( srcp[x] - srcpp[x] ) ) * 6 );
+                int mina = MIN( nt19,
+                                ( abs( srcp[x] - srcpn[x] ) +
+                                  abs( srcp[x] - srcpp[x] ) ) * 9 );
+                int minc = mina;
+                int mind = minb;
+                int mine = minb;
+                for (int u = startu; u <= stopu; ++u )
                 {
-                    if( y == height - 2 ||
-                        mskpn[x-1-u] == peak || mskpn[x-u] == peak || mskpn[x+1-u] == peak )
+                    if (y == 1 ||
+                          mskpp[x-1+u] == peak || mskpp[x+u] == peak || mskpp[x+1+u] == peak )
                     {
-                        const int diffsn = abs(  srcp[x-1] - srcpn[x-1-u] ) +
-                                           abs(  srcp[x]   - srcpn[x-u] )   +
-                                           abs(  srcp[x+1] - srcpn[x+1-u] );
-
-                        const int diffsp = abs(  srcp[x-1] - srcpp[x-1+u] ) +
-                                           abs(  srcp[x]   - srcpp[x+u] )   +
-                                           abs(  srcp[x+1] - srcpp[x+1+u] );
-
-                        const int diffps = abs( srcpp[x-1] -  srcp[x-1-u] ) +
-                                           abs( srcpp[x]   -  srcp[x-u] )   +
-                                           abs( srcpp[x+1] -  srcp[x+1-u] );
-
-                        const int diffns = abs( srcpn[x-1] -  srcp[x-1+u] ) +
-                                           abs( srcpn[x]   -  srcp[x+u] )   +
-                                           abs( srcpn[x+1] -  srcp[x+1+u] );
-
-                        const int diff = diffsn + diffsp + diffps + diffns;
-                        int diffd = diffsp + diffns;
-                        int diffe = diffsn + diffps;
-                        if( diff < minb )
+                        if( y == height - 2 ||
+                            mskpn[x-1-u] == peak || mskpn[x-u] == peak || mskpn[x+1-u] == peak )
                         {
-                            dirb = u;
-                            minb = diff;
-                        }
-                        if( __builtin_expect( y > 1, 1) )
-                        {
-                            const int diff2pp = abs( src2p[x-1] - srcpp[x-1-u] ) +
-                                            abs( src2p[x]   - srcpp[x-u] )   +
-                                            abs( src2p[x+1] - srcpp[x+1-u] );
-                            const int diffp2p = abs( srcpp[x-1] - src2p[x-1+u] ) +
-                                            abs( srcpp[x]   - src2p[x+u] )   +
-                                            abs( srcpp[x+1] - src2p[x+1+u] );
-                            const int diffa = diff + diff2pp + diffp2p;
-                            diffd += diffp2p;
-                            diffe += diff2pp;
-                            if( diffa < mina )
+                            const int diffsn = abs(  srcp[x-1] - srcpn[x-1-u] ) +
+                                               abs(  srcp[x]   - srcpn[x-u] )   +
+                                               abs(  srcp[x+1] - srcpn[x+1-u] );
+
+                            const int diffsp = abs(  srcp[x-1] - srcpp[x-1+u] ) +
+                                               abs(  srcp[x]   - srcpp[x+u] )   +
+                                               abs(  srcp[x+1] - srcpp[x+1+u] );
+
+                            const int diffps = abs( srcpp[x-1] -  srcp[x-1-u] ) +
+                                               abs( srcpp[x]   -  srcp[x-u] )   +
+                                               abs( srcpp[x+1] -  srcp[x+1-u] );
+
+                            const int diffns = abs( srcpn[x-1] -  srcp[x-1+u] ) +
+                                               abs( srcpn[x]   -  srcp[x+u] )   +
+                                               abs( srcpn[x+1] -  srcp[x+1+u] );
+
+                            const int diff = diffsn + diffsp + diffps + diffns;
+                            int diffd = diffsp + diffns;
+                            int diffe = diffsn + diffps;
+                            if( diff < minb )
                             {
-                                dira = u;
-                                mina = diffa;
+                                dirb = u;
+                                minb = diff;
                             }
-                        }
-                        if( __builtin_expect( y < height-2, 1) )
-                        {
-                            const int diff2nn = abs( src2n[x-1] - srcpn[x-1+u] ) +
-                                                abs( src2n[x]   - srcpn[x+u] )   +
-                                                abs( src2n[x+1] - srcpn[x+1+u] );
-                            const int diffn2n = abs( srcpn[x-1] - src2n[x-1-u] ) +
-                                                abs( srcpn[x]   - src2n[x-u] )   +
-                                                abs( srcpn[x+1] - src2n[x+1-u] );
-                            const int diffc = diff + diff2nn + diffn2n;
-                            diffd += diff2nn;
-                            diffe += diffn2n;
-                            if( diffc < minc )
+                            if( __builtin_expect( y > 1, 1) )
                             {
-                                dirc = u;
-                                minc = diffc;
+                                const int diff2pp = abs( src2p[x-1] - srcpp[x-1-u] ) +
+                                                abs( src2p[x]   - srcpp[x-u] )   +
+                                                abs( src2p[x+1] - srcpp[x+1-u] );
+                                const int diffp2p = abs( srcpp[x-1] - src2p[x-1+u] ) +
+                                                abs( srcpp[x]   - src2p[x+u] )   +
+                                                abs( srcpp[x+1] - src2p[x+1+u] );
+                                const int diffa = diff + diff2pp + diffp2p;
+                                diffd += diffp2p;
+                                diffe += diff2pp;
+                                if( diffa < mina )
+                                {
+                                    dira = u;
+                                    mina = diffa;
+                                }
+                            }
+                            if( __builtin_expect( y < height-2, 1) )
+                            {
+                                const int diff2nn = abs( src2n[x-1] - srcpn[x-1+u] ) +
+                                                    abs( src2n[x]   - srcpn[x+u] )   +
+                                                    abs( src2n[x+1] - srcpn[x+1+u] );
+                                const int diffn2n = abs( srcpn[x-1] - src2n[x-1-u] ) +
+                                                    abs( srcpn[x]   - src2n[x-u] )   +
+                                                    abs( srcpn[x+1] - src2n[x+1-u] );
+                                const int diffc = diff + diff2nn + diffn2n;
+                                diffd += diff2nn;
+                                diffe += diffn2n;
+                                if( diffc < minc )
+                                {
+                                    dirc = u;
+                                    minc = diffc;
+                                }
+                            }
+                            if( diffd < mind )
+                            {
+                                dird = u;
+                                mind = diffd;
+                            }
+                            if( diffe < mine )
+                            {
+                                dire = u;
+                                mine = diffe;
                             }
-                        }
-                        if( diffd < mind )
-                        {
-                            dird = u;
-                            mind = diffd;
-                        }
-                        if( diffe < mine )
-                        {
-                            dire = u;
-                            mine = diffe;
                         }
                     }
                 }
@@ -675,7 +675,23 @@ static void FUNC(nlmeans_plane)(NLMeansFunctions *functions,
                     const uint32_t *integral_ptr1 = integral + (y  -1)*integral_stride - 1;
                     const uint32_t *integral_ptr2 = integral + (y+n-1)*integral_stride - 1;
 
-                    for (int x = 0; x < dst_w; x++)
+                    int x = 0;
+                    if (functions->accumulate_row != NULL)
+                    {
+                        x = functions->accumulate_row(tmp_data + y*dst_w,
+                                                      integral_ptr1,
+                                                      integral_ptr2,
+                                                      compare + (y+dy)*bw + dx,
+                                                      n,
+                                                      dst_w,
+                                                      exptable,
+                                                      weight_fact_table,
+                                                      diff_max);
+                        integral_ptr1 += x;
+                        integral_ptr2 += x;
+                    }
+
+                    for (; x < dst_w; x++)
                     {
 
                         // Difference between patches
@@ -62,6 +62,9 @@ static int unsharp_work(hb_filter_object_t *filter,
 static int unsharp_work_thread(hb_filter_object_t *filter,
                                hb_buffer_t ** buf_in,
                                hb_buffer_t ** buf_out, int thread);
+static void unsharp_work_band(hb_filter_object_t *filter,
+                              hb_buffer_t * in, hb_buffer_t * out,
+                              int plane, int y_start, int y_end, int thread);
 
 static void unsharp_close(hb_filter_object_t *filter);
 
@@ -81,6 +84,7 @@ hb_filter_object_t hb_filter_unsharp =
     .init_thread       = unsharp_init_thread,
     .work              = unsharp_work,
     .work_thread       = unsharp_work_thread,
+    .work_band         = unsharp_work_band,
     .close             = unsharp_close,
     .settings_template = unsharp_template,
 };
@@ -93,6 +97,8 @@ static void name##_##nbits(const uint8_t *frame_src,
                            const int height,                                                    \
                            int stride_src,                                                      \
                            int stride_dst,                                                      \
+                           const int y_start,                                                   \
+                           const int y_end,                                                     \
                            unsharp_plane_context_t *ctx,                                        \
                            unsharp_thread_context_t *tctx)                                      \
 {                                                                                               \
@@ -100,7 +106,7 @@ static void name##_##nbits(const uint8_t *frame_src,
     uint32_t SR[UNSHARP_SIZE_MAX - 1];                                                          \
     const uint##nbits##_t *src  = (const uint##nbits##_t *)frame_src;                           \
     uint##nbits##_t       *dst  = (uint##nbits##_t *)frame_dst;                                 \
-    const uint##nbits##_t *src2 = (const uint##nbits##_t *)frame_src;                           \
+    const uint##nbits##_t *src2;                                                                \
     const int amount        = ctx->amount;                                                      \
     const int steps         = ctx->steps;                                                       \
     const int scalebits     = ctx->scalebits;                                                   \
@@ -113,7 +119,9 @@ static void name##_##nbits(const uint8_t *frame_src,
                                                                                                 \
     if (!amount)                                                                                \
     {                                                                                           \
-        hb_image_copy_plane(frame_dst, frame_src, stride_dst, stride_src, height);              \
+        hb_image_copy_plane(frame_dst + y_start * stride_dst,                                   \
+                            frame_src + y_start * stride_src,                                   \
+                            stride_dst, stride_src, y_end - y_start);                           \
         return;                                                                                 \
     }                                                                                           \
                                                                                                 \
@@ -125,12 +133,9 @@ static void name##_##nbits(const uint8_t *frame_src,
     stride_src /= ctx->bps;                                                                     \
     stride_dst /= ctx->bps;                                                                     \
                                                                                                 \
-    for (y = -steps; y < height + steps; y++)                                                   \
+    for (y = y_start - steps; y < y_end + steps; y++)                                           \
     {                                                                                           \
-        if (y < height)                                                                         \
-        {                                                                                       \
-            src2 = src;                                                                         \
-        }                                                                                       \
+        src2 = src + MIN(MAX(y, 0), height - 1) * stride_src;                                   \
                                                                                                 \
         memset(SR, 0, sizeof(SR[0]) * (2 * steps));                                             \
                                                                                                 \
@@ -150,21 +155,15 @@ static void name##_##nbits(const uint8_t *frame_src,
                 Tmp1 = SC[z + 1][x + steps] + Tmp2; SC[z + 1][x + steps] = Tmp2;                \
             }                                                                                   \
                                                                                                 \
-            if (x >= steps && y >= steps)                                                       \
+            if (x >= steps && y >= y_start + steps)                                             \
             {                                                                                   \
-                const uint##nbits##_t *srx = src - steps * stride_src + x - steps;              \
-                uint##nbits##_t       *dsx = dst - steps * stride_dst + x - steps;              \
+                const uint##nbits##_t *srx = src + (y - steps) * stride_src + x - steps;        \
+                uint##nbits##_t       *dsx = dst + (y - steps) * stride_dst + x - steps;        \
                                                                                                 \
                 res = (int32_t)*srx + ((((int32_t)*srx -                                        \
                      (int32_t)((Tmp1 + halfscale) >> scalebits)) * amount) >> 16);              \
                 *dsx = res > max_value ? max_value : res < 0 ? 0 : (uint##nbits##_t)res;        \
             }                                                                                   \
-        }                                                                                       \
-                                                                                                \
-        if (y >= 0)                                                                             \
-        {                                                                                       \
-            dst += stride_dst;                                                                  \
-            src += stride_src;                                                                  \
         }                                                                                       \
     }                                                                                           \
 }                                                                                               \
@@ -259,6 +258,8 @@ static int unsharp_init(hb_filter_object_t *filter,
         ctx->steps     = ctx->size / 2;
         ctx->scalebits = ctx->steps * 4;
         ctx->halfscale = 1 << (ctx->scalebits - 1);
+
+        filter->band_halo = MAX(filter->band_halo, ctx->steps);
     }
 
     if (unsharp_init_thread(filter, 1) < 0)
@@ -373,6 +374,7 @@ static int unsharp_work_thread(hb_filter_object_t *filter,
                 in->plane[c].height,
                 in->plane[c].stride,
                 out->plane[c].stride,
+                0, in->plane[c].height,
                 ctx, tctx);
     }
 
@@ -382,6 +384,23 @@ static int unsharp_work_thread(hb_filter_object_t *filter,
     return HB_FILTER_OK;
 }
 
+static void unsharp_work_band(hb_filter_object_t *filter,
+                              hb_buffer_t * in, hb_buffer_t * out,
+                              int plane, int y_start, int y_end, int thread)
+{
+    hb_filter_private_t *pv = filter->private_data;
+
+    unsharp(in->plane[plane].data,
+            out->plane[plane].data,
+            in->plane[plane].width,
+            in->plane[plane].height,
+            in->plane[plane].stride,
+            out->plane[plane].stride,
+            y_start, y_end,
+            &pv->plane_ctx[plane],
+            &pv->thread_ctx[thread][plane]);
+}
+
 static int unsharp_work(hb_filter_object_t *filter,
                         hb_buffer_t ** buf_in,
                         hb_buffer_t ** buf_out)
@@ -0,0 +1,465 @@
+/* vidpass.c
+
+   Copyright (c) 2003-2026 HandBrake Team
+   This file is part of the HandBrake source code
+   Homepage: <http://handbrake.fr/>.
+   It may be used under the terms of the GNU General Public License v2.
+   For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
+ */
+
+/* Video passthrough
+ *
+ * Copies the compressed video of the source to the output without
+ * decoding it. hb_decvidpass takes the place of the video decoder. It
+ * splits the demuxed stream into access units when needed and sends them
+ * to sync in presentation order, because that is the order sync expects
+ * video frames in. Sync only rewrites timestamps and carries the decode
+ * timestamps along, see QueueBuffer() in sync.c. hb_encvidpass takes the
+ * place of the video encoder and puts the packets back in decode order
+ * for the muxer.
+ */
+
+#include "handbrake/handbrake.h"
+
+// Longest reordering of frames that is expected. H.264 and H.265 allow at
+// most 16 frames in the decoded picture buffer.
+#define REORDER_MAX 32
+
+static int  decvidpassInit(hb_work_object_t *, hb_job_t *);
+static int  decvidpassWork(hb_work_object_t *, hb_buffer_t **, hb_buffer_t **);
+static void decvidpassClose(hb_work_object_t *);
+static int  encvidpassInit(hb_work_object_t *, hb_job_t *);
+static int  encvidpassWork(hb_work_object_t *, hb_buffer_t **, hb_buffer_t **);
+static void encvidpassClose(hb_work_object_t *);
+
+hb_work_object_t hb_decvidpass =
+{
+    WORK_DECVIDPASS,
+    "Video passthrough parser",
+    decvidpassInit,
+    decvidpassWork,
+    decvidpassClose
+};
+
+hb_work_object_t hb_encvidpass =
+{
+    WORK_ENCVIDPASS,
+    "Video passthrough",
+    encvidpassInit,
+    encvidpassWork,
+    encvidpassClose
+};
+
+struct hb_work_private_s
+{
+    hb_job_t             * job;
+
+    // Parser for streams that are not demuxed by libavformat
+    AVCodecParserContext * parser;
+    AVCodecContext       * context;
+    int                    new_chap;
+    int                    scr_sequence;
+
+    double                 frame_duration;
+    int64_t                last_dts;
+
+    // Packets waiting to be sent in the other order
+    hb_list_t            * queue;
+};
+
+int hb_video_passthru_supported( hb_title_t * title, int mux )
+{
+    if (title == NULL || title->video_codec != WORK_DECAVCODECV)
+    {
+        return 0;
+    }
+    switch (title->video_codec_param)
+    {
+        case AV_CODEC_ID_H264:
+        case AV_CODEC_ID_HEVC:
+        case AV_CODEC_ID_AV1:
+        case AV_CODEC_ID_MPEG2VIDEO:
+        case AV_CODEC_ID_MPEG4:
+            return !!(mux & (HB_MUX_MASK_MP4 | HB_MUX_MASK_MKV));
+        case AV_CODEC_ID_VC1:
+        case AV_CODEC_ID_MPEG1VIDEO:
+            return !!(mux & HB_MUX_MASK_MKV);
+        case AV_CODEC_ID_VP8:
+        case AV_CODEC_ID_VP9:
+            return !!(mux & (HB_MUX_MASK_MP4 | HB_MUX_MASK_MKV |
+                             HB_MUX_MASK_WEBM));
+        default:
+            return 0;
+    }
+}
+
+static int vidpass_init( hb_work_object_t * w, hb_job_t * job )
+{
+    hb_work_private_t * pv = calloc(1, sizeof(hb_work_private_t));
+
+    if (pv == NULL)
+    {
+        return 1;
+    }
+    w->private_data = pv;
+
+    pv->job      = job;
+    pv->last_dts = AV_NOPTS_VALUE;
+    pv->queue    = hb_list_init();
+    pv->frame_duration = 90000. * job->title->vrate.den /
+                                  job->title->vrate.num;
+
+    return pv->queue == NULL;
+}
+
+static void vidpass_close( hb_work_object_t * w )
+{
+    hb_work_private_t * pv = w->private_data;
+    hb_buffer_t       * buf;
+
+    if (pv == NULL)
+    {
+        return;
+    }
+    while ((buf = hb_list_item(pv->queue, 0)) != NULL)
+    {
+        hb_list_rem(pv->queue, buf);
+        hb_buffer_close(&buf);
+    }
+    hb_list_close(&pv->queue);
+    if (pv->parser != NULL)
+    {
+        av_parser_close(pv->parser);
+    }
+    avcodec_free_context(&pv->context);
+    free(pv);
+    w->private_data = NULL;
+}
+
+/***********************************************************************
+ * queue_sorted
+ ***********************************************************************
+ * Insert buf in pv->queue, which is kept sorted by start time for
+ * decvidpass and by decode time for encvidpass.
+ **********************************************************************/
+static void queue_sorted( hb_work_private_t * pv, hb_buffer_t * buf,
+                          int by_dts )
+{
+    int64_t ts = by_dts ? buf->s.renderOffset : buf->s.start;
+    int     ii;
+
+    for (ii = hb_list_count(pv->queue); ii > 0; ii--)
+    {
+        hb_buffer_t * prev = hb_list_item(pv->queue, ii - 1);
+        if ((by_dts ? prev->s.renderOffset : prev->s.start) <= ts)
+        {
+            break;
+        }
+    }
+    hb_list_insert(pv->queue, ii, buf);
+}
+
+static void decvidpassClose( hb_work_object_t * w )
+{
+    vidpass_close(w);
+}
+
+static int decvidpassInit( hb_work_object_t * w, hb_job_t * job )
+{
+    hb_work_private_t * pv;
+
+    if (vidpass_init(w, job))
+    {
+        return 1;
+    }
+    pv = w->private_data;
+
+    // libavformat already delivers one access unit per packet
+    if (job->title->opaque_priv == NULL)
+    {
+        pv->parser  = av_parser_init(job->title->video_codec_param);
+        pv->context = avcodec_alloc_context3(NULL);
+        if (pv->parser == NULL || pv->context == NULL)
+        {
+            hb_error("decvidpass: no parser for %s",
+                     avcodec_get_name(job->title->video_codec_param));
+            return 1;
+        }
+        pv->context->codec_id = job->title->video_codec_param;
+    }
+
+    return 0;
+}
+
+/***********************************************************************
+ * decvidpass_frame
+ ***********************************************************************
+ * Fill in the timestamps and frame type of an access unit and queue it
+ * in presentation order.
+ **********************************************************************/
+static void decvidpass_frame( hb_work_private_t * pv, hb_buffer_t * buf,
+                              int64_t pts, int64_t dts, int key )
+{
+    // Not every access unit of an elementary stream has timestamps
+    if (dts == AV_NOPTS_VALUE)
+    {
+        dts = pv->last_dts != AV_NOPTS_VALUE ?
+              pv->last_dts + pv->frame_duration : pts;
+    }
+    if (pts == AV_NOPTS_VALUE)
+    {
+        pts = dts;
+    }
+    if (pts == AV_NOPTS_VALUE)
+    {
+        // Nothing to place the frame at before the first timestamp
+        hb_buffer_close(&buf);
+        return;
+    }
+    pv->last_dts = dts;
+
+    buf->s.type         = VIDEO_BUF;
+    buf->s.start        = pts;
+    buf->s.renderOffset = dts;
+    buf->s.duration     = pv->frame_duration;
+    buf->s.stop         = pts + pv->frame_duration;
+    buf->s.scr_sequence = pv->scr_sequence;
+    buf->s.new_chap     = pv->new_chap;
+    buf->s.flags        = HB_FLAG_FRAMETYPE_REF;
+    buf->s.frametype    = HB_FRAME_P;
+    if (key)
+    {
+        buf->s.flags    |= HB_FLAG_FRAMETYPE_KEY;
+        buf->s.frametype = HB_FRAME_I;
+    }
+    pv->new_chap = 0;
+
+    queue_sorted(pv, buf, 0);
+}
+
+/***********************************************************************
+ * decvidpass_output
+ ***********************************************************************
+ * A frame can go to sync once no frame that is still to come can be
+ * presented before it. Frames are presented no earlier than they are
+ * decoded, so that is the case once the decode time of the last frame
+ * has reached its start.
+ **********************************************************************/
+static void decvidpass_output( hb_work_private_t * pv, hb_buffer_list_t * list,
+                               int flush )
+{
+    hb_buffer_t * buf;
+
+    while ((buf = hb_list_item(pv->queue, 0)) != NULL)
+    {
+        if (!flush && buf->s.start > pv->last_dts &&
+            hb_list_count(pv->queue) <= REORDER_MAX)
+        {
+            break;
+        }
+        hb_list_rem(pv->queue, buf);
+        hb_buffer_list_append(list, buf);
+    }
+}
+
+static void decvidpass_parse( hb_work_private_t * pv, hb_buffer_t ** buf_in,
+                              hb_buffer_list_t * list )
+{
+    hb_buffer_t * in   = *buf_in;
+    uint8_t     * data = in->data;
+    int           size = in->size;
+    int64_t       pts  = in->s.start;
+    int64_t       dts  = in->s.renderOffset;
+    int           pos, len;
+
+    // decvidpass_frame() may free 'in' once it takes it over, so only
+    // the saved data and size are used in here
+    for (pos = 0; pos < size; pos += len)
+    {
+        uint8_t * pout = NULL;
+        int       pout_len = 0;
+
+        len = av_parser_parse2(pv->parser, pv->context, &pout, &pout_len,
+                               data + pos, size - pos, pts, dts, 0);
+        pts = dts = AV_NOPTS_VALUE;
+        if (pout == NULL || pout_len <= 0)
+        {
+            continue;
+        }
+
+        hb_buffer_t * buf;
+        int           key;
+
+        if (pout == data && pout_len == size)
+        {
+            // The packet is exactly one access unit, keep it
+            buf = in;
+            *buf_in = NULL;
+        }
+        else
+        {
+            buf = hb_buffer_init(pout_len);
+            memcpy(buf->data, pout, pout_len);
+        }
+        key = pv->parser->key_frame == 1 ||
+              (pv->parser->key_frame < 0 &&
+               pv->parser->pict_type == AV_PICTURE_TYPE_I);
+        decvidpass_frame(pv, buf, pv->parser->pts, pv->parser->dts, key);
+        if (*buf_in == NULL)
+        {
+            // The whole packet went out, and may be gone already
+            break;
+        }
+    }
+}
+
+static int decvidpassWork( hb_work_object_t * w, hb_buffer_t ** buf_in,
+                           hb_buffer_t ** buf_out )
+{
+    hb_work_private_t * pv = w->private_data;
+    hb_buffer_t       * in = *buf_in;
+    hb_buffer_list_t    list;
+
+    hb_buffer_list_clear(&list);
+
+    if (in->s.flags & HB_BUF_FLAG_EOF)
+    {
+        if (pv->parser != NULL)
+        {
+            uint8_t * pout = NULL;
+            int       pout_len = 0;
+
+            av_parser_parse2(pv->parser, pv->context, &pout, &pout_len,
+                             NULL, 0, AV_NOPTS_VALUE, AV_NOPTS_VALUE, 0);
+            if (pout != NULL && pout_len > 0)
+            {
+                hb_buffer_t * buf = hb_buffer_init(pout_len);
+                memcpy(buf->data, pout, pout_len);
+                decvidpass_frame(pv, buf, pv->parser->pts, pv->parser->dts,
+                                 pv->parser->key_frame == 1);
+            }
+        }
+        decvidpass_output(pv, &list, 1);
+        hb_buffer_list_append(&list, in);
+        *buf_in = NULL;
+        *buf_out = hb_buffer_list_clear(&list);
+        return HB_WORK_DONE;
+    }
+
+    if (in->s.new_chap > 0)
+    {
+        pv->new_chap = in->s.new_chap;
+    }
+    pv->scr_sequence = in->s.scr_sequence;
+
+    if (pv->parser != NULL)
+    {
+        decvidpass_parse(pv, buf_in, &list);
+    }
+    else
+    {
+        *buf_in = NULL;
+        decvidpass_frame(pv, in, in->s.start, in->s.renderOffset,
+                         !!(in->s.flags & HB_FLAG_FRAMETYPE_KEY));
+    }
+    decvidpass_output(pv, &list, 0);
+    *buf_out = hb_buffer_list_clear(&list);
+
+    return HB_WORK_OK;
+}
+
+static void encvidpassClose( hb_work_object_t * w )
+{
+    vidpass_close(w);
+}
+
+static int encvidpassInit( hb_work_object_t * w, hb_job_t * job )
+{
+    if (vidpass_init(w, job))
+    {
+        return 1;
+    }
+
+    // Sources demuxed by libavformat come with their codec configuration.
+    // For elementary streams the muxer extracts it from the first key
+    // frame, see avformatInit().
+    if (job->title->opaque_priv != NULL)
+    {
+        AVFormatContext   * ic  = (AVFormatContext*)job->title->opaque_priv;
+        AVCodecParameters * par = ic->streams[job->title->video_id]->codecpar;
+
+        if (par->extradata_size > 0)
+        {
+            *w->extradata = hb_data_init(par->extradata_size);
+            if (*w->extradata == NULL)
+            {
+                return 1;
+            }
+            memcpy((*w->extradata)->bytes, par->extradata, par->extradata_size);
+        }
+    }
+    *w->init_delay = 0;
+
+    return 0;
+}
+
+/***********************************************************************
+ * encvidpass_output
+ ***********************************************************************
+ * Send the packets in decode order. Sync moved the presentation times,
+ * so the decode times it derived may now overlap slightly or fall after
+ * the presentation time. Keep them increasing and no later than the
+ * presentation time.
+ **********************************************************************/
+static void encvidpass_output( hb_work_private_t * pv, hb_buffer_list_t * list,
+                               int flush )
+{
+    hb_buffer_t * buf;
+
+    while (hb_list_count(pv->queue) > (flush ? 0 : REORDER_MAX))
+    {
+        buf = hb_list_item(pv->queue, 0);
+        hb_list_rem(pv->queue, buf);
+
+        if (buf->s.renderOffset > buf->s.start)
+        {
+            buf->s.renderOffset = buf->s.start;
+        }
+        if (pv->last_dts != AV_NOPTS_VALUE &&
+            buf->s.renderOffset <= pv->last_dts)
+        {
+            buf->s.renderOffset = pv->last_dts + 1;
+        }
+        pv->last_dts = buf->s.renderOffset;
+        hb_buffer_list_append(list, buf);
+    }
+}
+
+static int encvidpassWork( hb_work_object_t * w, hb_buffer_t ** buf_in,
+                           hb_buffer_t ** buf_out )
+{
+    hb_work_private_t * pv = w->private_data;
+    hb_buffer_t       * in = *buf_in;
+    hb_buffer_list_t    list;
+
+    *buf_in = NULL;
+    hb_buffer_list_clear(&list);
+
+    if (in->s.flags & HB_BUF_FLAG_EOF)
+    {
+        encvidpass_output(pv, &list, 1);
+        hb_buffer_list_append(&list, in);
+        *buf_out = hb_buffer_list_clear(&list);
+        return HB_WORK_DONE;
+    }
+
+    if (in->s.renderOffset == AV_NOPTS_VALUE)
+    {
+        in->s.renderOffset = in->s.start;
+    }
+    queue_sorted(pv, in, 1);
+    encvidpass_output(pv, &list, 0);
+    *buf_out = hb_buffer_list_clear(&list);
+
+    return HB_WORK_OK;
+}
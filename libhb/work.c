@@ -15,6 +15,7 @@
 #include "handbrake/dovi_common.h"
 #include "handbrake/rpu.h"
 #include "handbrake/hwaccel.h"
+#include "handbrake/executor.h"
 
 #if HB_PROJECT_FEATURE_QSV
 #include "handbrake/qsv_common.h"
@@ -27,15 +28,31 @@
 typedef struct
 {
     hb_list_t * jobs;
-    hb_job_t  ** current_job;
     hb_error_code * error;
     volatile int * die;
 
+    // Jobs are taken from the queue by up to job_concurrency runners,
+    // see work_next_job()
+    hb_lock_t * lock;
+    hb_cond_t * cond;
+    int         active;
+    int         exclusive;
+    int         thread_count;
 } hb_work_t;
 
 static void work_func(void * _work);
 static void do_job( hb_job_t *);
 static void filter_loop( void * );
+static int  work_task( void * );
+static int  filter_task( void * );
+
+// Run work objects and filters as executor tasks, see hb_set_work_executor()
+static int work_executor = 0;
+
+// Jobs worked on at once and threads per job, see hb_set_job_concurrency()
+// and hb_set_job_threads()
+static int job_concurrency = 1;
+static int job_threads     = 0;
 
 #define FIFO_UNBOUNDED 65536
 #define FIFO_UNBOUNDED_WAKE 65535
@@ -46,18 +63,49 @@ static void filter_loop( void * );
 #define FIFO_MINI 4
 #define FIFO_MINI_WAKE 3
 
+// hb_set_work_executor must only be called when no job is running
+void hb_set_work_executor( int enable )
+{
+    work_executor = enable;
+}
+
+// hb_set_job_concurrency must only be called when no job is running
+void hb_set_job_concurrency( int jobs )
+{
+    job_concurrency = MIN(MAX(jobs, 1), HB_MAX_ACTIVE_JOBS);
+}
+
+// hb_set_job_threads must only be called when no job is running
+void hb_set_job_threads( int threads )
+{
+    job_threads = MAX(threads, 0);
+}
+
+/**
+ * Returns the number of threads the decoder, filters and encoder of a
+ * job may each use.
+ * @param job Handle to hb_job_t.
+ */
+int hb_job_thread_count( hb_job_t * job )
+{
+    if (job != NULL && job->thread_count > 0)
+    {
+        return MIN(job->thread_count, hb_get_cpu_count());
+    }
+    return hb_get_cpu_count();
+}
+
 /**
  * Allocates work object and launches work thread with work_func.
  * @param jobs Handle to hb_list_t.
  * @param die Handle to user initiated exit indicator.
  * @param error Handle to error indicator.
  */
-hb_thread_t * hb_work_init( hb_list_t * jobs, volatile int * die, hb_error_code * error, hb_job_t ** job )
+hb_thread_t * hb_work_init( hb_list_t * jobs, volatile int * die, hb_error_code * error )
 {
     hb_work_t * work = calloc( sizeof( hb_work_t ), 1 );
 
     work->jobs      = jobs;
-    work->current_job = job;
     work->die       = die;
     work->error     = error;
 
@@ -84,7 +132,7 @@ static void InitWorkState(hb_job_t * job, int pass, int pass_count)
     p.seconds         = -1;
 #undef p
 
-    hb_set_state( job->h, &state );
+    hb_set_job_state(job, &state);
 }
 
 static void SetWorkStateInfo(hb_job_t *job)
@@ -95,92 +143,192 @@ static void SetWorkStateInfo(hb_job_t *job)
     {
         return;
     }
-    hb_get_state2(job->h, &state);
+    hb_get_job_state(job, &state);
     state.param.working.error        = *job->done_error;
-    hb_set_state( job->h, &state );
+    hb_set_job_state(job, &state);
 }
 
 /**
- * Iterates through job list and calls do_job for each job.
+ * Takes the next job off the queue for a runner. JSON jobs rescan the
+ * titles of the handle, which the jobs being worked on point into, so
+ * they run on their own.
+ * @param work Handle work object.
+ */
+static hb_job_t * work_next_job( hb_work_t * work )
+{
+    hb_job_t * job = NULL;
+
+    hb_lock(work->lock);
+    while (!*work->die && (job = hb_list_item(work->jobs, 0)) != NULL)
+    {
+        if (work->exclusive || (job->json != NULL && work->active > 0))
+        {
+            job = NULL;
+            hb_cond_timedwait(work->cond, work->lock, 100);
+            continue;
+        }
+        hb_list_rem(work->jobs, job);
+        work->active++;
+        work->exclusive = job->json != NULL;
+        break;
+    }
+    hb_unlock(work->lock);
+
+    return job;
+}
+
+/**
+ * Runs all passes of a job.
+ * @param work Handle work object.
+ * @param job Handle to the queued job.
+ */
+static void work_job( hb_work_t * work, hb_job_t * job )
+{
+    hb_handle_t   * h = job->h;
+    hb_interjob_t * interjob;
+    hb_list_t     * passes = hb_list_init();
+
+    hb_add_active_job(h, job);
+
+    // JSON jobs get special treatment.  We want to perform the title
+    // scan for the JSON job automatically.  This requires that we delay
+    // filling the job struct till we have performed the title scan
+    // because the default values for the job come from the title.
+    if (job->json != NULL)
+    {
+        hb_deep_log(1, "json job:\n%s", job->json);
+
+        // Initialize state sequence_id
+        InitWorkState(job, 0, 0);
+        // Perform title scan for json job
+        hb_json_job_scan(job->h, job->json);
+
+        // Expand json string to full job struct
+        hb_job_t *new_job = hb_json_to_job(job->h, job->json);
+        if (new_job == NULL)
+        {
+            hb_rem_active_job(h, job);
+            hb_job_close(&job);
+            hb_list_close(&passes);
+            *work->error = HB_ERROR_INIT;
+            *work->die = 1;
+            return;
+        }
+        new_job->h = job->h;
+        new_job->sequence_id = job->sequence_id;
+        hb_add_active_job(h, new_job);
+        hb_job_close(&job);
+        job = new_job;
+    }
+
+    interjob = calloc(1, sizeof(hb_interjob_t));
+    hb_job_setup_passes(job->h, job, passes);
+    hb_add_active_job(h, hb_list_item(passes, 0));
+    hb_job_close(&job);
+
+    int pass_count, pass;
+    pass_count = hb_list_count(passes);
+    for (pass = 0; pass < pass_count && !*work->die; pass++)
+    {
+        job = hb_list_item(passes, pass);
+        job->die = work->die;
+        job->done_error = work->error;
+        job->thread_count = work->thread_count;
+        job->interjob = interjob;
+        hb_add_active_job(h, job);
+        InitWorkState(job, pass + 1, pass_count);
+        do_job( job );
+    }
+    SetWorkStateInfo(job);
+    hb_rem_active_job(h, hb_list_item(passes, 0));
+
+    // Clean job passes
+    for (pass = 0; pass < pass_count; pass++)
+    {
+        job = hb_list_item(passes, pass);
+        hb_job_close(&job);
+    }
+    hb_list_close(&passes);
+    hb_subtitle_close(&interjob->select_subtitle);
+    free(interjob);
+}
+
+/**
+ * Takes jobs off the queue and works on them until the queue is empty.
  * @param _work Handle work object.
  */
-static void work_func( void * _work )
+static void work_runner( void * _work )
 {
     hb_work_t  * work = _work;
     hb_job_t   * job;
 
-    time_t t = time(NULL);
-    hb_log("Starting work at: %s", asctime(localtime(&t)));
-    hb_log( "%d job(s) to process", hb_list_count( work->jobs ) );
-
-    while( !*work->die && ( job = hb_list_item( work->jobs, 0 ) ) )
+    while ((job = work_next_job(work)) != NULL)
     {
         hb_handle_t * h = job->h;
 
-        hb_list_rem( work->jobs, job );
-        hb_list_t * passes = hb_list_init();
+        work_job(work, job);
 
-        // JSON jobs get special treatment.  We want to perform the title
-        // scan for the JSON job automatically.  This requires that we delay
-        // filling the job struct till we have performed the title scan
-        // because the default values for the job come from the title.
-        if (job->json != NULL)
-        {
-            hb_deep_log(1, "json job:\n%s", job->json);
+        hb_lock(work->lock);
+        // Force rescan of next source processed by this hb_handle_t.
+        // Under work->lock since jobs that end together share it.
+        // TODO: Fix this ugly hack!
+        hb_force_rescan(h);
+        work->active--;
+        work->exclusive = 0;
+        hb_cond_broadcast(work->cond);
+        hb_unlock(work->lock);
+    }
+}
 
-            // Initialize state sequence_id
-            InitWorkState(job, 0, 0);
-            // Perform title scan for json job
-            hb_json_job_scan(job->h, job->json);
+/**
+ * Works on the jobs of the job list, up to job_concurrency at once.
+ * @param _work Handle work object.
+ */
+static void work_func( void * _work )
+{
+    hb_work_t  * work = _work;
+    int          runners, ii;
 
-            // Expand json string to full job struct
-            hb_job_t *new_job = hb_json_to_job(job->h, job->json);
-            if (new_job == NULL)
-            {
-                hb_job_close(&job);
-                hb_list_close(&passes);
-                *work->error = HB_ERROR_INIT;
-                *work->die = 1;
-                break;
-            }
-            new_job->h = job->h;
-            new_job->sequence_id = job->sequence_id;
-            hb_job_close(&job);
-            job = new_job;
-        }
+    time_t t = time(NULL);
+    hb_log("Starting work at: %s", asctime(localtime(&t)));
+    hb_log( "%d job(s) to process", hb_list_count( work->jobs ) );
 
-        hb_job_setup_passes(job->h, job, passes);
-        hb_job_close(&job);
+    work->lock = hb_lock_init();
+    work->cond = hb_cond_init();
+
+    runners = MIN(job_concurrency, hb_list_count(work->jobs));
+    work->thread_count = job_threads;
+    if (work->thread_count == 0 && runners > 1)
+    {
+        // Share the CPUs between the jobs
+        work->thread_count = MAX(hb_get_cpu_count() / runners, 1);
+    }
 
-        int pass_count, pass;
-        pass_count = hb_list_count(passes);
-        for (pass = 0; pass < pass_count && !*work->die; pass++)
+    if (runners > 1)
+    {
+        hb_thread_t * threads[HB_MAX_ACTIVE_JOBS];
+
+        hb_log("work: up to %d jobs at once, %d threads each", runners,
+               work->thread_count);
+        for (ii = 0; ii < runners; ii++)
         {
-            job = hb_list_item(passes, pass);
-            job->die = work->die;
-            job->done_error = work->error;
-            *(work->current_job) = job;
-            InitWorkState(job, pass + 1, pass_count);
-            do_job( job );
+            threads[ii] = hb_thread_init("job", work_runner, work,
+                                         HB_LOW_PRIORITY);
         }
-        SetWorkStateInfo(job);
-        *(work->current_job) = NULL;
-
-        // Clean job passes
-        for (pass = 0; pass < pass_count; pass++)
+        for (ii = 0; ii < runners; ii++)
         {
-            job = hb_list_item(passes, pass);
-            hb_job_close(&job);
+            hb_thread_close(&threads[ii]);
         }
-        hb_list_close(&passes);
-
-        // Force rescan of next source processed by this hb_handle_t
-        // TODO: Fix this ugly hack!
-        hb_force_rescan(h);
+    }
+    else
+    {
+        work_runner(work);
     }
 
     t = time(NULL);
     hb_log("Finished work at: %s", asctime(localtime(&t)));
+    hb_cond_close(&work->cond);
+    hb_lock_close(&work->lock);
     free( work );
 }
 
@@ -977,7 +1125,7 @@ static void analyze_subtitle_scan( hb_job_t * job )
         subtitle = hb_list_item( job->list_subtitle, i );
         if (subtitle->id == subtitle_hit)
         {
-            hb_interjob_t *interjob = hb_interjob_get(job->h);
+            hb_interjob_t *interjob = job->interjob;
 
             subtitle->config = job->select_subtitle_config;
             // Remove from list since we are taking ownership
@@ -993,7 +1141,7 @@ static int sanitize_subtitles( hb_job_t * job )
 {
     int             i;
     uint8_t         one_burned = 0;
-    hb_interjob_t * interjob = hb_interjob_get(job->h);
+    hb_interjob_t * interjob = job->interjob;
     hb_subtitle_t * subtitle;
 
     if (job->indepth_scan)
@@ -1063,6 +1211,32 @@ static int sanitize_subtitles( hb_job_t * job )
     for (i = 0; i < hb_list_count(job->list_subtitle);)
     {
         subtitle = hb_list_item(job->list_subtitle, i);
+        if (job->vcodec == HB_VCODEC_PASS)
+        {
+            // Copied video is never decoded, nothing can be burned in
+            // and there are no closed captions to extract
+            if (subtitle->source == CC608SUB &&
+                subtitle->id == HB_SUBTITLE_EMBEDDED_CC_TAG)
+            {
+                hb_log("Video passthru can not extract closed captions, dropping track %d.", i);
+                hb_list_rem(job->list_subtitle, subtitle);
+                free(subtitle);
+                continue;
+            }
+            if (subtitle->config.dest == RENDERSUB ||
+                hb_subtitle_must_burn(subtitle, job->mux))
+            {
+                if (!hb_subtitle_can_pass(subtitle->source, job->mux))
+                {
+                    hb_log("Video passthru can not burn in subtitles, dropping track %d.", i);
+                    hb_list_rem(job->list_subtitle, subtitle);
+                    free(subtitle);
+                    continue;
+                }
+                hb_log("Video passthru can not burn in subtitles.  Changing track %d to soft subtitle.", i);
+                subtitle->config.dest = PASSTHRUSUB;
+            }
+        }
         if (subtitle->config.dest == RENDERSUB)
         {
             if (one_burned)
@@ -1400,6 +1574,25 @@ static int sanitize_audio(hb_job_t *job)
     return 0;
 }
 
+// Native filters that take their output frames from the frame pools,
+// which are filled at the start of the job for their geometry
+static int filter_uses_frame_pool(int filter_id)
+{
+    switch (filter_id)
+    {
+        case HB_FILTER_DETELECINE:
+        case HB_FILTER_DECOMB:
+        case HB_FILTER_DENOISE:
+        case HB_FILTER_NLMEANS:
+        case HB_FILTER_CHROMA_SMOOTH:
+        case HB_FILTER_LAPSHARP:
+        case HB_FILTER_UNSHARP:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
 static void sanitize_filter_list_pre(hb_job_t *job, hb_geometry_t src_geo)
 {
     hb_list_t *list = job->list_filter;
@@ -1726,16 +1919,66 @@ static void sanitize_dynamic_hdr_metadata_passthru(hb_job_t *job)
  * Closes threads and frees fifos.
  * @param job Handle work hb_job_t.
  */
+static void task_notify( void * task )
+{
+    hb_task_schedule(task);
+}
+
+// Work objects that only wait on their input fifo can run as tasks.
+// Data sources, sync and the muxer block on other things and keep
+// their own threads.
+static int work_is_task( hb_work_object_t * w )
+{
+    switch (w->id)
+    {
+        case WORK_SYNC_VIDEO:
+        case WORK_SYNC_AUDIO:
+        case WORK_SYNC_SUBTITLE:
+        case WORK_MUX:
+        case WORK_READER:
+        case WORK_ENCSEGMENT:
+            return 0;
+        default:
+            return w->fifo_in != NULL;
+    }
+}
+
+static void filter_start( hb_executor_t * executor, hb_filter_object_t * filter )
+{
+    if (executor != NULL)
+    {
+        filter->task = hb_task_init(executor, filter->name, filter_task,
+                                    filter);
+    }
+    if (filter->task != NULL)
+    {
+        hb_fifo_register_push_notify(filter->fifo_in, task_notify,
+                                     filter->task);
+        if (filter->fifo_out != NULL)
+        {
+            hb_fifo_register_get_notify(filter->fifo_out, task_notify,
+                                        filter->task);
+        }
+        hb_task_schedule(filter->task);
+    }
+    else
+    {
+        filter->thread = hb_thread_init(filter->name, filter_loop,
+                                        filter, HB_LOW_PRIORITY);
+    }
+}
+
 static void do_job(hb_job_t *job)
 {
     int                i, result;
     hb_title_t       * title;
     hb_interjob_t    * interjob;
     hb_work_object_t * w;
+    hb_executor_t    * executor;
 
     title = job->title;
 
-    interjob = hb_interjob_get(job->h);
+    interjob = job->interjob;
     if (job->sequence_id != interjob->sequence_id)
     {
         // New job sequence, clear interjob
@@ -1783,6 +2026,28 @@ static void do_job(hb_job_t *job)
         *job->die = 1;
         goto cleanup;
     }
+    if (job->vcodec == HB_VCODEC_PASS && !job->indepth_scan)
+    {
+        if (!hb_video_passthru_supported(title, job->mux))
+        {
+            hb_error("Video passthru of %s is not supported in this container",
+                     avcodec_get_name(title->video_codec_param));
+            *job->done_error = HB_ERROR_WRONG_INPUT;
+            *job->die = 1;
+            goto cleanup;
+        }
+        // The video is copied as it is, drop the filters
+        while (hb_list_count(job->list_filter) > 0)
+        {
+            hb_filter_object_t * filter = hb_list_item(job->list_filter, 0);
+            hb_log("Video passthru, ignoring filter '%s'", filter->name);
+            hb_list_rem(job->list_filter, filter);
+            hb_filter_close(&filter);
+        }
+        job->hw_decode = 0;
+        job->output_pix_fmt = title->pix_fmt;
+    }
+
     // Filters have an effect on settings.
     // So initialize the filters and update the job.
     if (job->list_filter && hb_list_count(job->list_filter))
@@ -1857,6 +2122,12 @@ static void do_job(hb_job_t *job)
                 hb_filter_close( &filter );
                 continue;
             }
+            if (job->hw_pix_fmt == AV_PIX_FMT_NONE &&
+                filter_uses_frame_pool(filter->id))
+            {
+                hb_frame_pool_prewarm(init.pix_fmt, init.geometry.width,
+                                      init.geometry.height);
+            }
             i++;
         }
         job->output_pix_fmt = init.pix_fmt;
@@ -1879,6 +2150,9 @@ static void do_job(hb_job_t *job)
         // Combine HB_FILTER_AVFILTERs that are sequential
         hb_avfilter_combine(job->list_filter);
 
+        // Run sequential filters that work on bands of lines in one pass
+        hb_fused_filter_combine(job, job->list_filter);
+
         // Perform filter post_init which informs filters of final
         // job configuration. e.g. rendersub filter needs to know the
         // final crop dimensions.
@@ -1929,14 +2203,20 @@ static void do_job(hb_job_t *job)
         update_dolby_vision_level(job);
     }
 
-    job->fifo_in     = hb_fifo_init( FIFO_SMALL, FIFO_SMALL_WAKE );
-    job->fifo_raw    = hb_fifo_init( FIFO_SMALL, FIFO_SMALL_WAKE );
+    // The video and audio fifos each connect a single producer thread
+    // to a single consumer thread, so they can use the lock-free fifo.
+    // sync pushes to all of its output fifos, but only while holding
+    // its common mutex.  Subtitle fifos can have several producers
+    // (e.g. closed captions are pushed by the video decoder), so they
+    // use regular fifos.
+    job->fifo_in     = hb_fifo_init_spsc( FIFO_SMALL, FIFO_SMALL_WAKE );
+    job->fifo_raw    = hb_fifo_init_spsc( FIFO_SMALL, FIFO_SMALL_WAKE );
     if (!job->indepth_scan)
     {
         // When doing subtitle indepth scan, the pipeline ends at sync
-        job->fifo_sync   = hb_fifo_init( FIFO_SMALL, FIFO_SMALL_WAKE );
+        job->fifo_sync   = hb_fifo_init_spsc( FIFO_SMALL, FIFO_SMALL_WAKE );
         job->fifo_render = NULL; // Attached to filter chain
-        job->fifo_out    = hb_fifo_init( FIFO_LARGE, FIFO_LARGE_WAKE );
+        job->fifo_out    = hb_fifo_init_spsc( FIFO_LARGE, FIFO_LARGE_WAKE );
     }
 
     result = sanitize_audio(job);
@@ -1956,10 +2236,10 @@ static void do_job(hb_job_t *job)
             hb_audio_t *audio = hb_list_item(job->list_audio, i);
 
             /* set up the audio work fifos */
-            audio->priv.fifo_in   = hb_fifo_init(FIFO_LARGE, FIFO_LARGE_WAKE);
-            audio->priv.fifo_raw  = hb_fifo_init(FIFO_SMALL, FIFO_SMALL_WAKE);
-            audio->priv.fifo_sync = hb_fifo_init(FIFO_SMALL, FIFO_SMALL_WAKE);
-            audio->priv.fifo_out  = hb_fifo_init(FIFO_LARGE, FIFO_LARGE_WAKE);
+            audio->priv.fifo_in   = hb_fifo_init_spsc(FIFO_LARGE, FIFO_LARGE_WAKE);
+            audio->priv.fifo_raw  = hb_fifo_init_spsc(FIFO_SMALL, FIFO_SMALL_WAKE);
+            audio->priv.fifo_sync = hb_fifo_init_spsc(FIFO_SMALL, FIFO_SMALL_WAKE);
+            audio->priv.fifo_out  = hb_fifo_init_spsc(FIFO_LARGE, FIFO_LARGE_WAKE);
 
             // Add audio decoder work object
             w = hb_audio_decoder(job->h, audio->config.in.codec);
@@ -2021,8 +2301,16 @@ static void do_job(hb_job_t *job)
     }
 
     // Video decoder
-    w = hb_video_decoder(job->h, title->video_codec, title->video_codec_param,
-                         job->hw_device_ctx, job->hw_accel);
+    if (job->vcodec == HB_VCODEC_PASS && !job->indepth_scan)
+    {
+        w = hb_get_work(job->h, WORK_DECVIDPASS);
+    }
+    else
+    {
+        w = hb_video_decoder(job->h, title->video_codec,
+                             title->video_codec_param,
+                             job->hw_device_ctx, job->hw_accel);
+    }
     if (w == NULL)
     {
         *job->done_error = HB_ERROR_WRONG_INPUT;
@@ -2101,13 +2389,24 @@ static void do_job(hb_job_t *job)
                     if (!filter->skip)
                     {
                         filter->fifo_in = fifo_in;
-                        filter->fifo_out = hb_fifo_init(FIFO_MINI, FIFO_MINI_WAKE);
+                        filter->fifo_out = hb_fifo_init_spsc(FIFO_MINI, FIFO_MINI_WAKE);
                         fifo_in = filter->fifo_out;
                     }
                 }
                 audio->priv.fifo_render = fifo_in;
             }
 
+            // Passthrough tracks that aren't filtered need no encoder.
+            // Sync pushes their packets straight to the muxer's fifo,
+            // see InitAudio() in sync.c
+            if ((audio->config.out.codec & HB_ACODEC_PASS_FLAG) &&
+                hb_list_count(list_filter) == 0)
+            {
+                hb_fifo_close(&audio->priv.fifo_sync);
+                audio->priv.fifo_render = NULL;
+                continue;
+            }
+
             /*
             * Audio Encoder Thread
             */
@@ -2140,6 +2439,13 @@ static void do_job(hb_job_t *job)
         {
             hb_subtitle_t *subtitle = hb_list_item(job->list_subtitle, i);
 
+            // Same as passthrough audio, sync feeds the muxer directly
+            if (subtitle->config.codec == HB_SCODEC_PASS)
+            {
+                hb_fifo_close(&subtitle->fifo_sync);
+                continue;
+            }
+
             /*
             * Subtitle Encoder Thread
             */
@@ -2169,7 +2475,7 @@ static void do_job(hb_job_t *job)
                 if (!filter->skip)
                 {
                     filter->fifo_in = fifo_in;
-                    filter->fifo_out = hb_fifo_init(FIFO_MINI, FIFO_MINI_WAKE);
+                    filter->fifo_out = hb_fifo_init_spsc(FIFO_MINI, FIFO_MINI_WAKE);
                     fifo_in = filter->fifo_out;
                 }
             }
@@ -2182,7 +2488,18 @@ static void do_job(hb_job_t *job)
         }
 
         // Video encoder
-        w = hb_video_encoder(job->h, job->vcodec);
+        if (job->vcodec == HB_VCODEC_PASS)
+        {
+            w = hb_get_work(job->h, WORK_ENCVIDPASS);
+        }
+        else if (hb_segment_encoding_supported(job))
+        {
+            w = hb_get_work(job->h, WORK_ENCSEGMENT);
+        }
+        else
+        {
+            w = hb_video_encoder(job->h, job->vcodec);
+        }
         if (w == NULL)
         {
             *job->done_error = HB_ERROR_INIT;
@@ -2239,10 +2556,28 @@ static void do_job(hb_job_t *job)
     }
 
     /* Launch processing threads */
+    executor = work_executor ? hb_executor_get() : NULL;
     for (i = 0; i < hb_list_count( job->list_work ); i++)
     {
         w = hb_list_item(job->list_work, i);
-        w->thread = hb_thread_init(w->name, hb_work_loop, w, HB_LOW_PRIORITY);
+        if (executor != NULL && work_is_task(w))
+        {
+            w->task = hb_task_init(executor, w->name, work_task, w);
+        }
+        if (w->task != NULL)
+        {
+            hb_fifo_register_push_notify(w->fifo_in, task_notify, w->task);
+            if (w->fifo_out != NULL)
+            {
+                hb_fifo_register_get_notify(w->fifo_out, task_notify, w->task);
+            }
+            hb_task_schedule(w->task);
+        }
+        else
+        {
+            w->thread = hb_thread_init(w->name, hb_work_loop, w,
+                                       HB_LOW_PRIORITY);
+        }
     }
 
     if (!job->indepth_scan)
@@ -2255,8 +2590,7 @@ static void do_job(hb_job_t *job)
             {
                 // Filters were initialized earlier, so we just need
                 // to start the filter's thread
-                filter->thread = hb_thread_init(filter->name, filter_loop,
-                                                filter, HB_LOW_PRIORITY);
+                filter_start(executor, filter);
             }
         }
 
@@ -2273,8 +2607,7 @@ static void do_job(hb_job_t *job)
                 {
                     // Filters were initialized earlier, so we just need
                     // to start the filter's thread
-                    filter->thread = hb_thread_init(filter->name, filter_loop,
-                                                    filter, HB_LOW_PRIORITY);
+                    filter_start(executor, filter);
                 }
             }
         }
@@ -2288,9 +2621,8 @@ static void do_job(hb_job_t *job)
     w->die = job->die;
     hb_thread_close(&w->thread);
 
-    hb_handle_t * h = job->h;
     hb_state_t state;
-    hb_get_state2( h, &state );
+    hb_get_job_state(job, &state);
 
     hb_log("work: average encoding speed for job is %f fps",
            state.param.working.rate_avg);
@@ -2298,6 +2630,30 @@ static void do_job(hb_job_t *job)
 cleanup:
     job->done = 1;
 
+    // Stop all tasks before closing anything.  A running task may
+    // still push to a fifo that notifies another task.
+    for (i = 0; i < hb_list_count(job->list_work); i++)
+    {
+        w = hb_list_item(job->list_work, i);
+        hb_task_stop(w->task);
+    }
+    for (i = 0; i < hb_list_count(job->list_filter); i++)
+    {
+        hb_filter_object_t * filter = hb_list_item(job->list_filter, i);
+        hb_task_stop(filter->task);
+    }
+    for (i = 0; i < hb_list_count(job->list_audio); i++)
+    {
+        hb_audio_t *audio = hb_list_item(job->list_audio, i);
+        hb_list_t *list_filter = audio->config.out.list_filter;
+
+        for (int j = 0; j < hb_list_count(list_filter); j++)
+        {
+            hb_filter_object_t *filter = hb_list_item(list_filter, j);
+            hb_task_stop(filter->task);
+        }
+    }
+
     // Close render filter pipeline
     if (job->list_filter)
     {
@@ -2339,6 +2695,27 @@ cleanup:
             hb_thread_close(&w->thread);
         }
     }
+    for (i = 0; i < hb_list_count(job->list_work); i++)
+    {
+        w = hb_list_item(job->list_work, i);
+        hb_task_close(&w->task);
+    }
+    for (i = 0; i < hb_list_count(job->list_filter); i++)
+    {
+        hb_filter_object_t * filter = hb_list_item(job->list_filter, i);
+        hb_task_close(&filter->task);
+    }
+    for (i = 0; i < hb_list_count(job->list_audio); i++)
+    {
+        hb_audio_t *audio = hb_list_item(job->list_audio, i);
+        hb_list_t *list_filter = audio->config.out.list_filter;
+
+        for (int j = 0; j < hb_list_count(list_filter); j++)
+        {
+            hb_filter_object_t *filter = hb_list_item(list_filter, j);
+            hb_task_close(&filter->task);
+        }
+    }
     while ((w = hb_list_item(job->list_work, 0)))
     {
         hb_list_rem(job->list_work, w);
@@ -2507,6 +2884,62 @@ void hb_work_loop( void * _w )
     }
 }
 
+/**
+ * Executor task version of hb_work_loop.
+ * Processes one input buffer each time it runs.  Goes idle when the
+ * input fifo is empty or the output fifo is full, fifo notifications
+ * schedule it again.
+ * @param _w Handle to work object.
+ */
+static int work_task( void * _w )
+{
+    hb_work_object_t * w = _w;
+    hb_buffer_t      * buf_in, * buf_out;
+
+    if ((w->die != NULL && *w->die) || *w->done)
+    {
+        return HB_TASK_DONE;
+    }
+    if (w->status == HB_WORK_DONE)
+    {
+        // Consume data in incoming fifo till job completes so that
+        // residual data does not stall the pipeline.
+        while ((buf_in = hb_fifo_get(w->fifo_in)) != NULL)
+        {
+            hb_buffer_close(&buf_in);
+        }
+        return HB_TASK_IDLE;
+    }
+    if (w->fifo_out != NULL && hb_fifo_is_full(w->fifo_out))
+    {
+        return HB_TASK_IDLE;
+    }
+    buf_in = hb_fifo_get(w->fifo_in);
+    if (buf_in == NULL)
+    {
+        return HB_TASK_IDLE;
+    }
+
+    buf_out = NULL;
+    w->status = w->work( w, &buf_in, &buf_out );
+
+    copy_chapter( buf_out, buf_in );
+
+    if( buf_in )
+    {
+        hb_buffer_close( &buf_in );
+    }
+    if ( buf_out && w->fifo_out == NULL )
+    {
+        hb_buffer_close( &buf_out );
+    }
+    if( buf_out )
+    {
+        hb_fifo_push( w->fifo_out, buf_out );
+    }
+    return HB_TASK_PROGRESS;
+}
+
 /**
  * Performs the filter object's specific work function.
  * Loops calling work function for associated filter object.
@@ -2590,3 +3023,68 @@ static void filter_loop( void * _f )
     }
 }
 
+/**
+ * Executor task version of filter_loop.
+ * @param _f Handle to filter object.
+ */
+static int filter_task( void * _f )
+{
+    hb_filter_object_t * f = _f;
+    hb_buffer_t        * buf_in, * buf_out;
+
+    if ( *f->done )
+    {
+        return HB_TASK_DONE;
+    }
+    if (f->status == HB_FILTER_DONE)
+    {
+        // Consume data in incoming fifo till job complete so that
+        // residual data does not stall the pipeline
+        while ((buf_in = hb_fifo_get(f->fifo_in)) != NULL)
+        {
+            hb_buffer_close(&buf_in);
+        }
+        return HB_TASK_IDLE;
+    }
+    if (f->fifo_out != NULL && hb_fifo_is_full(f->fifo_out))
+    {
+        return HB_TASK_IDLE;
+    }
+    buf_in = hb_fifo_get(f->fifo_in);
+    if (buf_in == NULL)
+    {
+        return HB_TASK_IDLE;
+    }
+
+    // Filters can drop buffers.  Remember chapter information
+    // so that it can be propagated to the next buffer
+    if ( buf_in->s.new_chap )
+    {
+        f->chapter_time = buf_in->s.start;
+        f->chapter_val = buf_in->s.new_chap;
+        buf_in->s.new_chap = 0;
+    }
+
+    buf_out = NULL;
+    f->status = f->work( f, &buf_in, &buf_out );
+
+    if ( buf_out && f->chapter_val && f->chapter_time <= buf_out->s.start )
+    {
+        buf_out->s.new_chap = f->chapter_val;
+        f->chapter_val = 0;
+    }
+
+    if( buf_in )
+    {
+        hb_buffer_close( &buf_in );
+    }
+    if ( buf_out && f->fifo_out == NULL )
+    {
+        hb_buffer_close( &buf_out );
+    }
+    if( buf_out )
+    {
+        hb_fifo_push( f->fifo_out, buf_out );
+    }
+    return HB_TASK_PROGRESS;
+}
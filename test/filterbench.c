@@ -0,0 +1,1038 @@
+/* filterbench.c
+
+   Copyright (c) 2003-2026 HandBrake Team
+   This file is part of the HandBrake source code
+   Homepage: <http://handbrake.fr/>.
+   It may be used under the terms of the GNU General Public License v2.
+   For full terms see the file COPYING file or visit http://www.gnu.org/licenses/gpl-2.0.html
+ */
+
+/* Micro-benchmark for libhb video filters.
+ *
+ * Feeds a stream of synthetic or raw video frames through one filter at a
+ * time, calling the filter init, work and close functions directly, and
+ * reports frames/s, ns/pixel and peak memory for every combination of
+ * filter, bit depth and resolution. Only the time spent in the filter work
+ * function is measured.
+ *
+ * With --verify, the filters are not timed but run with the C code and then
+ * with each SIMD instruction set the CPU supports, and their output frames
+ * and comb detection results must be bit identical.
+ *
+ * With --blend, the subtitle blend kernels are checked instead: random
+ * overlays are blended with the C code and then with each SIMD instruction
+ * set the CPU supports, and the results must be bit identical.
+ *
+ * The filter objects are libhb internals, so this is built with __LIBHB__
+ * and linked against the static library, like the rest of libhb.
+ */
+
+#define __LIBHB__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <inttypes.h>
+
+#if !defined(__MINGW32__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "handbrake/handbrake.h"
+#include "handbrake/hbffmpeg.h"
+#include "libavutil/cpu.h"
+#include "libavutil/md5.h"
+
+#define MAX_CASES        32
+#define SOURCE_FRAMES    8
+#define BLEND_OVERLAYS   3
+#define COUNT_OF(a)      ((int)(sizeof(a) / sizeof((a)[0])))
+
+typedef struct
+{
+    int          id;
+    const char * name;
+    const char * preset;
+    const char * tune;
+    const char * custom;
+} bench_filter_t;
+
+static bench_filter_t filters[MAX_CASES];
+static int            filter_count;
+static int            depths[MAX_CASES];
+static int            depth_count;
+static int            widths[MAX_CASES];
+static int            heights[MAX_CASES];
+static int            resolution_count;
+
+static int            frame_count = 100;
+static int            warmup_count = 5;
+static int            interlaced;
+static const char   * input_path;
+static int            verify;
+static int            verify_blend;
+
+// Instruction sets the SIMD kernels are checked with, each one includes
+// the ones before it. The first entry disables them all.
+typedef struct
+{
+    const char * name;
+    int          cpu_flags;
+} cpu_level_t;
+
+#define CPU_FLAGS_SSE2   (AV_CPU_FLAG_MMX | AV_CPU_FLAG_MMXEXT | \
+                          AV_CPU_FLAG_SSE | AV_CPU_FLAG_SSE2)
+#define CPU_FLAGS_SSE41  (CPU_FLAGS_SSE2 | AV_CPU_FLAG_SSE3 | \
+                          AV_CPU_FLAG_SSSE3 | AV_CPU_FLAG_SSE4)
+#define CPU_FLAGS_AVX2   (CPU_FLAGS_SSE41 | AV_CPU_FLAG_SSE42 | \
+                          AV_CPU_FLAG_AVX | AV_CPU_FLAG_AVX2 | \
+                          AV_CPU_FLAG_FMA3 | AV_CPU_FLAG_BMI1 | \
+                          AV_CPU_FLAG_BMI2)
+#define CPU_FLAGS_AVX512 (CPU_FLAGS_AVX2 | AV_CPU_FLAG_AVX512)
+
+static const cpu_level_t cpu_levels[] =
+{
+    { "c",      0 },
+#if defined(ARCH_X86)
+    { "sse2",   CPU_FLAGS_SSE2 },
+    { "sse4.1", CPU_FLAGS_SSE41 },
+    { "avx2",   CPU_FLAGS_AVX2 },
+    { "avx512", CPU_FLAGS_AVX512 },
+#elif defined(__aarch64__)
+    { "neon",   AV_CPU_FLAG_ARMV8 | AV_CPU_FLAG_NEON },
+#endif
+};
+
+static void ShowHelp(void)
+{
+    fprintf(stdout,
+"Usage: filterbench [options] -f <filter> [-f <filter> ...]\n"
+"       filterbench [options] --blend\n"
+"\n"
+"Runs each filter on a stream of frames for every bit depth and resolution\n"
+"given and reports frames/s, ns/pixel and peak memory.\n"
+"\n"
+"   -f, --filter <name[,preset[,tune]]>\n"
+"                           Filter to benchmark, by short name (e.g.\n"
+"                           nlmeans, decomb, comb_detect, lapsharp). Uses the\n"
+"                           filter's default preset and tune if not given.\n"
+"   -c, --custom <settings> Custom settings for the preceding filter\n"
+"   -d, --depth <8|10|12>   Bit depth (default: 8), may be repeated\n"
+"   -r, --resolution <WxH>  Frame size (default: 1920x1080), may be repeated\n"
+"   -n, --frames <number>   Frames to time (default: 100)\n"
+"   -w, --warmup <number>   Untimed frames sent first (default: 5)\n"
+"   -I, --interlaced        Make the synthetic frames combed\n"
+"   -i, --input <file>      Read raw planar YUV 4:2:0 frames from file instead\n"
+"                           of generating them, 8 bit or 16 bit little endian\n"
+"                           samples matching the bit depth, at most %d frames\n"
+"                           are loaded and looped\n"
+"   -V, --verify            Instead of timing the filters, run them with the C\n"
+"                           code and then with each instruction set the CPU\n"
+"                           supports, and check that the output frames and\n"
+"                           comb detection results are bit identical, e.g.\n"
+"                           -V -I -f comb_detect -c mode=7 compares the\n"
+"                           filtered combing masks\n"
+"   -b, --blend             Check that the subtitle blend kernels of every\n"
+"                           instruction set the CPU supports give the same\n"
+"                           output as the C code, for planar and semi planar\n"
+"                           frames of every bit depth and resolution given\n"
+"   -h, --help              Show this message\n"
+"\n",
+    SOURCE_FRAMES);
+}
+
+static int ParseOptions(int argc, char **argv)
+{
+    static struct option long_options[] =
+    {
+        { "help",       no_argument,       NULL, 'h' },
+        { "filter",     required_argument, NULL, 'f' },
+        { "custom",     required_argument, NULL, 'c' },
+        { "depth",      required_argument, NULL, 'd' },
+        { "resolution", required_argument, NULL, 'r' },
+        { "frames",     required_argument, NULL, 'n' },
+        { "warmup",     required_argument, NULL, 'w' },
+        { "interlaced", no_argument,       NULL, 'I' },
+        { "input",      required_argument, NULL, 'i' },
+        { "verify",     no_argument,       NULL, 'V' },
+        { "blend",      no_argument,       NULL, 'b' },
+        { 0, 0, 0, 0 }
+    };
+
+    for (;;)
+    {
+        int c = getopt_long(argc, argv, "hf:c:d:r:n:w:Ii:Vb", long_options, NULL);
+        if (c < 0)
+        {
+            break;
+        }
+
+        switch (c)
+        {
+            case 'h':
+                ShowHelp();
+                exit(0);
+            case 'f':
+            {
+                if (filter_count >= MAX_CASES)
+                {
+                    fprintf(stderr, "Too many filters\n");
+                    return -1;
+                }
+                char *name   = strdup(optarg);
+                char *preset = strchr(name, ',');
+                char *tune   = NULL;
+                if (preset != NULL)
+                {
+                    *preset++ = 0;
+                    tune = strchr(preset, ',');
+                    if (tune != NULL)
+                    {
+                        *tune++ = 0;
+                    }
+                }
+                int id = hb_filter_get_from_name(name);
+                if (id <= HB_FILTER_INVALID || id >= HB_FILTER_LAST)
+                {
+                    fprintf(stderr, "Unknown video filter '%s'\n", name);
+                    return -1;
+                }
+                filters[filter_count].id     = id;
+                filters[filter_count].name   = name;
+                filters[filter_count].preset = preset;
+                filters[filter_count].tune   = tune;
+                filter_count++;
+            } break;
+            case 'c':
+                if (filter_count == 0)
+                {
+                    fprintf(stderr, "--custom must follow a --filter\n");
+                    return -1;
+                }
+                filters[filter_count - 1].custom = optarg;
+                break;
+            case 'd':
+                if (depth_count >= MAX_CASES)
+                {
+                    fprintf(stderr, "Too many bit depths\n");
+                    return -1;
+                }
+                depths[depth_count] = atoi(optarg);
+                if (depths[depth_count] != 8 && depths[depth_count] != 10 &&
+                    depths[depth_count] != 12)
+                {
+                    fprintf(stderr, "Unsupported bit depth '%s'\n", optarg);
+                    return -1;
+                }
+                depth_count++;
+                break;
+            case 'r':
+                if (resolution_count >= MAX_CASES)
+                {
+                    fprintf(stderr, "Too many resolutions\n");
+                    return -1;
+                }
+                if (sscanf(optarg, "%dx%d", &widths[resolution_count],
+                           &heights[resolution_count]) != 2 ||
+                    widths[resolution_count]  < 16 ||
+                    heights[resolution_count] < 16)
+                {
+                    fprintf(stderr, "Invalid resolution '%s'\n", optarg);
+                    return -1;
+                }
+                resolution_count++;
+                break;
+            case 'n':
+                frame_count = atoi(optarg);
+                break;
+            case 'w':
+                warmup_count = atoi(optarg);
+                break;
+            case 'I':
+                interlaced = 1;
+                break;
+            case 'i':
+                input_path = optarg;
+                break;
+            case 'V':
+                verify = 1;
+                break;
+            case 'b':
+                verify_blend = 1;
+                break;
+            default:
+                ShowHelp();
+                return -1;
+        }
+    }
+
+    if (filter_count == 0 && !verify_blend)
+    {
+        ShowHelp();
+        return -1;
+    }
+    if (depth_count == 0)
+    {
+        depths[depth_count++] = 8;
+    }
+    if (resolution_count == 0)
+    {
+        widths[resolution_count]  = 1920;
+        heights[resolution_count] = 1080;
+        resolution_count++;
+    }
+    if (frame_count < 1 || warmup_count < 0)
+    {
+        fprintf(stderr, "Invalid frame count\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int depth_to_pix_fmt(int depth)
+{
+    switch (depth)
+    {
+        case 10:
+            return AV_PIX_FMT_YUV420P10;
+        case 12:
+            return AV_PIX_FMT_YUV420P12;
+        default:
+            return AV_PIX_FMT_YUV420P;
+    }
+}
+
+static void store_sample(hb_buffer_t *buf, int plane, int x, int y,
+                         int depth, int value)
+{
+    uint8_t *row = buf->plane[plane].data + y * buf->plane[plane].stride;
+    if (depth > 8)
+    {
+        ((uint16_t *)row)[x] = value << (depth - 8);
+    }
+    else
+    {
+        row[x] = value;
+    }
+}
+
+// Moving diagonal bars over a gradient with some noise, so that denoisers
+// and comb detectors take their usual code paths. Interlaced frames shift
+// the bottom field, which combs every moving edge.
+static hb_buffer_t * make_synthetic_frame(int depth, int width, int height,
+                                          int index)
+{
+    hb_buffer_t *buf = hb_frame_buffer_init(depth_to_pix_fmt(depth),
+                                            width, height);
+    if (buf == NULL)
+    {
+        return NULL;
+    }
+
+    uint32_t seed = 0x9e3779b9u * (index + 1);
+    for (int pp = 0; pp < 3; pp++)
+    {
+        const int pw = buf->plane[pp].width;
+        const int ph = buf->plane[pp].height;
+        const int scale = pp ? 2 : 1;
+        for (int y = 0; y < ph; y++)
+        {
+            const int shift = interlaced && (y & 1) ? 6 / scale : 0;
+            for (int x = 0; x < pw; x++)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                const int bar = ((x * scale + y * scale + index * 8 + shift) / 48) & 1;
+                int value = pp ? 128 + bar * 24 - 12
+                               : 32 + (x * 160) / pw + bar * 48;
+                value += (int)(seed >> 29) - 4;
+                store_sample(buf, pp, x, y, depth, value < 0 ? 0 : value > 255 ? 255 : value);
+            }
+        }
+    }
+    return buf;
+}
+
+static int load_input_frames(hb_buffer_t **frames, int depth,
+                             int width, int height)
+{
+    FILE *file = fopen(input_path, "rb");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Can't open '%s'\n", input_path);
+        return 0;
+    }
+
+    const int bps = depth > 8 ? 2 : 1;
+    int count;
+    for (count = 0; count < SOURCE_FRAMES; count++)
+    {
+        hb_buffer_t *buf = hb_frame_buffer_init(depth_to_pix_fmt(depth),
+                                                width, height);
+        int ok = buf != NULL;
+        for (int pp = 0; ok && pp < 3; pp++)
+        {
+            for (int y = 0; ok && y < buf->plane[pp].height; y++)
+            {
+                uint8_t *row = buf->plane[pp].data + y * buf->plane[pp].stride;
+                ok = fread(row, bps, buf->plane[pp].width, file) ==
+                     (size_t)buf->plane[pp].width;
+            }
+        }
+        if (!ok)
+        {
+            hb_buffer_close(&buf);
+            break;
+        }
+        frames[count] = buf;
+    }
+    fclose(file);
+
+    if (count == 0)
+    {
+        fprintf(stderr, "'%s' does not contain a %dx%d frame\n",
+                input_path, width, height);
+    }
+    return count;
+}
+
+static int cpu_level_supported(const cpu_level_t *level, int cpu_flags)
+{
+    return (cpu_flags & level->cpu_flags) == level->cpu_flags;
+}
+
+static uint32_t random_next(uint32_t *seed)
+{
+    *seed = *seed * 1664525u + 1013904223u;
+    return *seed >> 8;
+}
+
+// Hashes the visible samples of a frame, the stride padding is ignored
+static void frame_md5_update(struct AVMD5 *md5, const hb_buffer_t *buf)
+{
+    for (int pp = 0; pp < av_pix_fmt_count_planes(buf->f.fmt); pp++)
+    {
+        const int bytes = av_image_get_linesize(buf->f.fmt, buf->f.width, pp);
+        for (int y = 0; y < buf->plane[pp].height; y++)
+        {
+            av_md5_update(md5, buf->plane[pp].data + y * buf->plane[pp].stride,
+                          bytes);
+        }
+    }
+}
+
+// Closes the output frames, after adding them and their comb detection
+// result to the hash if any
+static int count_frames(hb_buffer_t **out, struct AVMD5 *md5)
+{
+    int count = 0;
+    hb_buffer_t *buf = *out;
+    while (buf != NULL)
+    {
+        hb_buffer_t *next = buf->next;
+        if (!(buf->s.flags & HB_BUF_FLAG_EOF))
+        {
+            count++;
+            if (md5 != NULL)
+            {
+                const uint8_t combed = buf->s.combed;
+                frame_md5_update(md5, buf);
+                av_md5_update(md5, &combed, sizeof(combed));
+            }
+        }
+        buf->next = NULL;
+        hb_buffer_close(&buf);
+        buf = next;
+    }
+    *out = NULL;
+    return count;
+}
+
+static double peak_memory_mib(void)
+{
+#if defined(__MINGW32__)
+    return -1;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return -1;
+    }
+#if defined(__APPLE__)
+    return usage.ru_maxrss / (1024. * 1024.);
+#else
+    return usage.ru_maxrss / 1024.;
+#endif
+#endif
+}
+
+static int load_sources(hb_buffer_t **sources, int depth,
+                        int width, int height)
+{
+    int source_count;
+
+    if (input_path != NULL)
+    {
+        return load_input_frames(sources, depth, width, height);
+    }
+    for (source_count = 0; source_count < SOURCE_FRAMES; source_count++)
+    {
+        sources[source_count] = make_synthetic_frame(depth, width, height,
+                                                     source_count);
+        if (sources[source_count] == NULL)
+        {
+            break;
+        }
+    }
+    return source_count;
+}
+
+// Runs the filter on the warmup and timed frames. The time spent in the
+// filter and the frames output are counted for the timed frames only,
+// every output frame is added to the hash if any.
+static int run_filter(const bench_filter_t *bf, hb_buffer_t **sources,
+                      int source_count, int depth, int width, int height,
+                      uint64_t *elapsed, int *frames_out, struct AVMD5 *md5)
+{
+    int result = -1;
+
+    const char *preset = bf->preset;
+    const char *tune   = bf->tune;
+    if (preset == NULL && bf->custom == NULL)
+    {
+        preset = hb_filter_param_get_default_preset(bf->id);
+        tune   = hb_filter_param_get_default_tune(bf->id);
+    }
+    hb_dict_t *settings = hb_generate_filter_settings(bf->id, preset, tune,
+                                                      bf->custom);
+    if (settings == NULL)
+    {
+        fprintf(stderr, "%s: invalid filter settings\n", bf->name);
+        return -1;
+    }
+
+    hb_title_t *title = hb_title_init("filterbench", 1);
+    title->geometry.width   = width;
+    title->geometry.height  = height;
+    title->geometry.par.num = 1;
+    title->geometry.par.den = 1;
+    title->vrate.num        = 30000;
+    title->vrate.den        = 1001;
+    title->pix_fmt          = depth_to_pix_fmt(depth);
+
+    hb_job_t *job = hb_job_init(title);
+    job->input_pix_fmt = title->pix_fmt;
+
+    hb_list_t *list = hb_list_init();
+    hb_add_filter_dict(list, hb_filter_init(bf->id), settings);
+    hb_value_free(&settings);
+    hb_filter_object_t *filter = hb_list_item(list, 0);
+
+    hb_filter_init_t init;
+    memset(&init, 0, sizeof(init));
+    init.time_base.num   = 1;
+    init.time_base.den   = 90000;
+    init.job             = job;
+    init.pix_fmt         = title->pix_fmt;
+    init.hw_pix_fmt      = AV_PIX_FMT_NONE;
+    init.color_prim      = AVCOL_PRI_BT709;
+    init.color_transfer  = AVCOL_TRC_BT709;
+    init.color_matrix    = AVCOL_SPC_BT709;
+    init.color_range     = AVCOL_RANGE_MPEG;
+    init.chroma_location = AVCHROMA_LOC_LEFT;
+    init.geometry        = title->geometry;
+    init.vrate           = title->vrate;
+
+    volatile int done = 0;
+    filter->done = &done;
+    if (filter->init != NULL && filter->init(filter, &init))
+    {
+        fprintf(stderr, "%s: filter init failed\n", bf->name);
+        goto close;
+    }
+    if (filter->post_init != NULL && filter->post_init(filter, job))
+    {
+        fprintf(stderr, "%s: filter post init failed\n", bf->name);
+        goto close;
+    }
+
+    const int64_t duration = 90000LL * title->vrate.den / title->vrate.num;
+    int status = HB_FILTER_OK;
+
+    *elapsed    = 0;
+    *frames_out = 0;
+    for (int ii = 0; ii < warmup_count + frame_count + 1 &&
+                     status != HB_FILTER_DONE && status != HB_FILTER_FAILED; ii++)
+    {
+        hb_buffer_t *in, *out = NULL;
+        if (ii < warmup_count + frame_count)
+        {
+            in = hb_buffer_dup(sources[ii % source_count]);
+            in->s.start    = ii * duration;
+            in->s.stop     = in->s.start + duration;
+            in->s.duration = duration;
+        }
+        else
+        {
+            in = hb_buffer_eof_init();
+        }
+
+        const uint64_t start = hb_get_time_us();
+        status = filter->work(filter, &in, &out);
+        const uint64_t stop = hb_get_time_us();
+
+        if (ii >= warmup_count)
+        {
+            *elapsed    += stop - start;
+            *frames_out += count_frames(&out, md5);
+        }
+        else
+        {
+            count_frames(&out, md5);
+        }
+        hb_buffer_close(&in);
+    }
+
+    if (status == HB_FILTER_FAILED)
+    {
+        fprintf(stderr, "%s: filter failed\n", bf->name);
+        goto close;
+    }
+    result = 0;
+
+close:
+    if (filter->close != NULL)
+    {
+        filter->close(filter);
+    }
+    hb_filter_close(&filter);
+    hb_list_close(&list);
+    hb_job_close(&job);
+    hb_title_close(&title);
+    return result;
+}
+
+static int run_case(const bench_filter_t *bf, int depth, int width, int height)
+{
+    hb_buffer_t *sources[SOURCE_FRAMES] = { NULL };
+    uint64_t elapsed;
+    int frames_out;
+
+    const int source_count = load_sources(sources, depth, width, height);
+    if (source_count == 0)
+    {
+        return -1;
+    }
+
+    int result = run_filter(bf, sources, source_count, depth, width, height,
+                            &elapsed, &frames_out, NULL);
+    if (result == 0)
+    {
+        const double seconds = elapsed / 1e6;
+        const double pixels  = (double)frame_count * width * height;
+        const double peak    = peak_memory_mib();
+        char resolution[32];
+        snprintf(resolution, sizeof(resolution), "%dx%d", width, height);
+        fprintf(stdout, "%-16s %5d  %-11s %7d %7d %10.2f %10.3f ",
+                bf->name, depth, resolution, frame_count, frames_out,
+                seconds > 0 ? frame_count / seconds : 0,
+                pixels > 0 ? elapsed * 1000. / pixels : 0);
+        if (peak >= 0)
+        {
+            fprintf(stdout, "%10.1f\n", peak);
+        }
+        else
+        {
+            fprintf(stdout, "%10s\n", "-");
+        }
+        fflush(stdout);
+    }
+
+    for (int ii = 0; ii < source_count; ii++)
+    {
+        hb_buffer_close(&sources[ii]);
+    }
+    return result;
+}
+
+// Random samples of the frame depth. The alpha plane, if any, is mostly
+// fully transparent or fully opaque, like in rendered subtitles.
+static void fill_random_frame(hb_buffer_t *buf, uint32_t *seed)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(buf->f.fmt);
+    const int depth = desc->comp[0].depth;
+    const int shift = desc->comp[0].shift;
+    const int bps   = depth > 8 ? 2 : 1;
+
+    for (int pp = 0; pp < av_pix_fmt_count_planes(buf->f.fmt); pp++)
+    {
+        const int samples = av_image_get_linesize(buf->f.fmt, buf->f.width, pp) / bps;
+        for (int y = 0; y < buf->plane[pp].height; y++)
+        {
+            uint8_t *row = buf->plane[pp].data + y * buf->plane[pp].stride;
+            for (int x = 0; x < samples; x++)
+            {
+                uint32_t value = random_next(seed);
+                if (pp == 3)
+                {
+                    value = (value & 3) == 0 ? 0 :
+                            (value & 3) == 1 ? 255 : (value >> 2) & 0xff;
+                }
+                else
+                {
+                    value &= (1 << depth) - 1;
+                }
+
+                if (bps == 2)
+                {
+                    ((uint16_t *)row)[x] = value << shift;
+                }
+                else
+                {
+                    row[x] = value;
+                }
+            }
+        }
+    }
+}
+
+// An overlay of random size and position inside of the frame. Sizes and
+// positions are even, like those of the subtitles placed by render_sub.
+static hb_buffer_t * make_overlay(int pix_fmt, int width, int height,
+                                  uint32_t *seed)
+{
+    const int ov_width  = 2 + (random_next(seed) % (width  - 1) & ~1);
+    const int ov_height = 2 + (random_next(seed) % (height - 1) & ~1);
+
+    hb_buffer_t *buf = hb_frame_buffer_init(pix_fmt, ov_width, ov_height);
+    if (buf == NULL)
+    {
+        return NULL;
+    }
+    fill_random_frame(buf, seed);
+    buf->f.x = random_next(seed) % (width  - ov_width  + 1) & ~1;
+    buf->f.y = random_next(seed) % (height - ov_height + 1) & ~1;
+    return buf;
+}
+
+// Blends the same random overlays on the same random frames whatever
+// the cpu flags are, and returns the hash of the results
+static int blend_frames(int pix_fmt, int overlay_pix_fmt,
+                        int width, int height, uint8_t digest[16])
+{
+    hb_blend_object_t blend = hb_blend;
+    if (blend.init(&blend, width, height, pix_fmt, AVCHROMA_LOC_LEFT,
+                   AVCOL_RANGE_MPEG, overlay_pix_fmt))
+    {
+        fprintf(stderr, "blend: init failed\n");
+        return -1;
+    }
+
+    struct AVMD5 *md5 = av_md5_alloc();
+    if (md5 == NULL)
+    {
+        blend.close(&blend);
+        return -1;
+    }
+    av_md5_init(md5);
+
+    uint32_t seed = 0x9e3779b9u;
+    int result = 0;
+    for (int ii = 0; ii < SOURCE_FRAMES && result == 0; ii++)
+    {
+        hb_buffer_list_t overlays;
+        memset(&overlays, 0, sizeof(overlays));
+
+        hb_buffer_t *frame = hb_frame_buffer_init(pix_fmt, width, height);
+        if (frame == NULL)
+        {
+            result = -1;
+            break;
+        }
+        fill_random_frame(frame, &seed);
+        for (int jj = 0; jj < BLEND_OVERLAYS; jj++)
+        {
+            hb_buffer_t *overlay = make_overlay(overlay_pix_fmt, width,
+                                                height, &seed);
+            if (overlay == NULL)
+            {
+                result = -1;
+                break;
+            }
+            hb_buffer_list_append(&overlays, overlay);
+        }
+        if (result == 0)
+        {
+            frame = blend.work(&blend, frame, &overlays, 1);
+            frame_md5_update(md5, frame);
+        }
+        hb_buffer_close(&frame);
+        hb_buffer_list_close(&overlays);
+    }
+
+    av_md5_final(md5, digest);
+    av_free(md5);
+    blend.close(&blend);
+    return result;
+}
+
+static int depth_to_semi_planar_pix_fmt(int depth)
+{
+    switch (depth)
+    {
+        case 10:
+            return AV_PIX_FMT_P010;
+        case 12:
+            return AV_PIX_FMT_P012;
+        default:
+            return AV_PIX_FMT_NV12;
+    }
+}
+
+static int run_blend_case(int depth, int width, int height)
+{
+    // render_sub gives overlays of the frame chroma subsampling,
+    // or 4:4:4 ones that are subsampled while blending
+    static const int overlay_pix_fmts[] =
+    {
+        AV_PIX_FMT_YUVA420P, AV_PIX_FMT_YUVA444P
+    };
+    const int pix_fmts[] =
+    {
+        depth_to_pix_fmt(depth), depth_to_semi_planar_pix_fmt(depth)
+    };
+    const int cpu_flags = av_get_cpu_flags();
+    int result = 0;
+
+    char resolution[32];
+    snprintf(resolution, sizeof(resolution), "%dx%d", width, height);
+
+    for (int ff = 0; ff < COUNT_OF(pix_fmts); ff++)
+    {
+        for (int oo = 0; oo < COUNT_OF(overlay_pix_fmts); oo++)
+        {
+            uint8_t reference[16];
+
+            for (int ll = 0; ll < COUNT_OF(cpu_levels); ll++)
+            {
+                uint8_t digest[16];
+
+                if (!cpu_level_supported(&cpu_levels[ll], cpu_flags))
+                {
+                    continue;
+                }
+                av_force_cpu_flags(cpu_levels[ll].cpu_flags);
+                if (blend_frames(pix_fmts[ff], overlay_pix_fmts[oo],
+                                 width, height, digest))
+                {
+                    result = -1;
+                    break;
+                }
+                if (ll == 0)
+                {
+                    memcpy(reference, digest, sizeof(reference));
+                }
+
+                const int same = memcmp(reference, digest, sizeof(reference)) == 0;
+                fprintf(stdout, "%-16s %5d  %-11s %-10s %-10s %-7s %s\n",
+                        "blend", depth, resolution,
+                        av_get_pix_fmt_name(pix_fmts[ff]),
+                        av_get_pix_fmt_name(overlay_pix_fmts[oo]),
+                        cpu_levels[ll].name,
+                        ll == 0 ? "reference" : same ? "ok" : "MISMATCH");
+                if (!same)
+                {
+                    result = -1;
+                }
+            }
+        }
+    }
+    fflush(stdout);
+    av_force_cpu_flags(-1);
+    return result;
+}
+
+static int run_verify_case(const bench_filter_t *bf, int depth,
+                           int width, int height)
+{
+    hb_buffer_t *sources[SOURCE_FRAMES] = { NULL };
+    const int cpu_flags = av_get_cpu_flags();
+    uint8_t reference[16];
+    int result = 0;
+
+    const int source_count = load_sources(sources, depth, width, height);
+    if (source_count == 0)
+    {
+        return -1;
+    }
+
+    char resolution[32];
+    snprintf(resolution, sizeof(resolution), "%dx%d", width, height);
+
+    for (int ll = 0; ll < COUNT_OF(cpu_levels); ll++)
+    {
+        uint8_t digest[16];
+        uint64_t elapsed;
+        int frames_out;
+
+        if (!cpu_level_supported(&cpu_levels[ll], cpu_flags))
+        {
+            continue;
+        }
+        struct AVMD5 *md5 = av_md5_alloc();
+        if (md5 == NULL)
+        {
+            result = -1;
+            break;
+        }
+        av_md5_init(md5);
+        av_force_cpu_flags(cpu_levels[ll].cpu_flags);
+        const int failed = run_filter(bf, sources, source_count, depth,
+                                      width, height, &elapsed, &frames_out,
+                                      md5);
+        av_md5_final(md5, digest);
+        av_free(md5);
+        if (failed)
+        {
+            result = -1;
+            break;
+        }
+        if (ll == 0)
+        {
+            memcpy(reference, digest, sizeof(reference));
+        }
+
+        const int same = memcmp(reference, digest, sizeof(reference)) == 0;
+        fprintf(stdout, "%-16s %5d  %-11s %7d %-7s %s\n",
+                bf->name, depth, resolution, frames_out, cpu_levels[ll].name,
+                ll == 0 ? "reference" : same ? "ok" : "MISMATCH");
+        if (!same)
+        {
+            result = -1;
+        }
+    }
+    fflush(stdout);
+    av_force_cpu_flags(-1);
+
+    for (int ii = 0; ii < source_count; ii++)
+    {
+        hb_buffer_close(&sources[ii]);
+    }
+    return result;
+}
+
+// The blend check when bf is NULL
+static int run_any_case(const bench_filter_t *bf, int depth,
+                        int width, int height)
+{
+    if (bf == NULL)
+    {
+        return run_blend_case(depth, width, height);
+    }
+    if (verify)
+    {
+        return run_verify_case(bf, depth, width, height);
+    }
+    return run_case(bf, depth, width, height);
+}
+
+static int run_case_isolated(const bench_filter_t *bf, int depth,
+                             int width, int height)
+{
+#if defined(__MINGW32__)
+    return run_any_case(bf, depth, width, height);
+#else
+    // Run every case in its own process so that the peak memory reported
+    // belongs to that case alone. libhb is initialized in the child since
+    // its threads do not survive a fork.
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0)
+    {
+        hb_global_init_no_hardware();
+        int result = run_any_case(bf, depth, width, height);
+        hb_global_close();
+        _exit(result ? 1 : 0);
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0)
+    {
+        fprintf(stderr, "%s: %s failed at %d bit %dx%d\n",
+                bf != NULL ? bf->name : "blend",
+                bf != NULL && !verify ? "benchmark" : "check",
+                depth, width, height);
+        return -1;
+    }
+    return 0;
+#endif
+}
+
+int main(int argc, char **argv)
+{
+#if defined(__MINGW32__)
+    hb_global_init_no_hardware();
+#endif
+
+    if (ParseOptions(argc, argv))
+    {
+        return 1;
+    }
+
+    int failed = 0;
+    if (verify_blend)
+    {
+        fprintf(stdout, "%-16s %5s  %-11s %-10s %-10s %-7s %s\n",
+                "kernel", "depth", "resolution", "format", "overlay",
+                "cpu", "result");
+        for (int dd = 0; dd < depth_count; dd++)
+        {
+            for (int rr = 0; rr < resolution_count; rr++)
+            {
+                failed |= run_case_isolated(NULL, depths[dd],
+                                            widths[rr], heights[rr]) != 0;
+            }
+        }
+#if defined(__MINGW32__)
+        hb_global_close();
+#endif
+        return failed;
+    }
+
+    if (verify)
+    {
+        fprintf(stdout, "%-16s %5s  %-11s %7s %-7s %s\n",
+                "filter", "depth", "resolution", "output", "cpu", "result");
+    }
+    else
+    {
+        fprintf(stdout, "%-16s %5s  %-11s %7s %7s %10s %10s %10s\n",
+                "filter", "depth", "resolution", "frames", "output",
+                "frames/s", "ns/pixel", "peak MiB");
+    }
+
+    for (int ff = 0; ff < filter_count; ff++)
+    {
+        for (int dd = 0; dd < depth_count; dd++)
+        {
+            for (int rr = 0; rr < resolution_count; rr++)
+            {
+                failed |= run_case_isolated(&filters[ff], depths[dd],
+                                            widths[rr], heights[rr]) != 0;
+            }
+        }
+    }
+
+#if defined(__MINGW32__)
+    hb_global_close();
+#endif
+    return failed;
+}
@@ -67,6 +67,15 @@ static int     json                = 0;
 static int     inline_parameter_sets = -1;
 static int     align_av_start      = -1;
 static int     dvdnav              = 1;
+static int     work_executor       = 0;
+static int     scan_threads        = 1;
+static int     batch_scan_threads  = 1;
+static int     scan_cache          = 0;
+static int     read_ahead          = 0;
+static int     segment_encoders    = 0;
+static int     job_concurrency     = 1;
+static int     job_threads         = 0;
+static int     huge_pages          = 0;
 static char *  input               = NULL;
 static char *  output              = NULL;
 static char *  format              = NULL;
@@ -541,6 +550,15 @@ int main( int argc, char ** argv )
     hb_register_error_handler(&hb_cli_error_handler);
 
     hb_dvd_set_dvdnav( dvdnav );
+    hb_set_work_executor( work_executor );
+    hb_set_scan_threads( scan_threads );
+    hb_set_batch_scan_threads( batch_scan_threads );
+    hb_set_scan_cache( scan_cache );
+    hb_set_read_ahead( read_ahead );
+    hb_set_segment_encoders( segment_encoders );
+    hb_set_job_concurrency( job_concurrency );
+    hb_set_job_threads( job_threads );
+    hb_set_huge_pages( huge_pages );
 
     /* Show version */
     fprintf( stderr, "%s - %s - %s\n",
@@ -1650,6 +1668,37 @@ static void ShowHelp(void)
 "   --queue-import-file <filename>\n"
 "                           Import an encode queue file created by the GUI\n"
 "       --no-dvdnav         Do not use dvdnav for reading DVDs\n"
+"       --work-executor     Run decoders, filters and encoders on a shared\n"
+"                           work-stealing thread pool instead of one thread\n"
+"                           each\n"
+"       --scan-threads <number>\n"
+"                           Decode the scan previews of files on up to\n"
+"                           <number> threads at once (0: one per CPU,\n"
+"                           default: 1)\n"
+"       --batch-scan-threads <number>\n"
+"                           Scan up to <number> files of a folder or a list\n"
+"                           of inputs at once (0: one per CPU, default: 1)\n"
+"       --scan-cache        Reuse the preview scan results of unchanged files\n"
+"                           from earlier scans, stored in the user config\n"
+"                           directory\n"
+"       --read-ahead <MB>   Read up to <MB> megabytes of the source ahead of\n"
+"                           the demuxer on a separate thread (default: 0)\n"
+"       --segment-encoders <number>\n"
+"                           Encode the video in short segments on up to\n"
+"                           <number> encoder instances at once. Used for\n"
+"                           single pass constant quality x264, x265,\n"
+"                           SVT-AV1, VP8 and VP9 encodes (default: 0)\n"
+"       --job-concurrency <number>\n"
+"                           Encode up to <number> jobs of the queue at once\n"
+"                           (default: 1)\n"
+"       --job-threads <number>\n"
+"                           Limit each job to <number> threads (default: 0,\n"
+"                           the CPUs are shared between concurrent jobs)\n"
+"       --huge-pages <string>\n"
+"                           Back video frames with huge pages (Linux only):\n"
+"                               none (default)\n"
+"                               transparent\n"
+"                               explicit    (reserved with vm.nr_hugepages)\n"
 "\n"
 "\n"
 "Source Options ---------------------------------------------------------------\n"
@@ -2587,6 +2636,15 @@ static int ParseOptions( int argc, char ** argv )
     #define FILTER_DEBAND                 338
     #define AUDIO_COMPRESSOR              339
     #define AUDIO_GATE                    340
+    #define WORK_EXECUTOR                 341
+    #define SCAN_THREADS                  342
+    #define BATCH_SCAN_THREADS            343
+    #define SCAN_CACHE                    344
+    #define READ_AHEAD                    345
+    #define SEGMENT_ENCODERS              346
+    #define JOB_CONCURRENCY               347
+    #define JOB_THREADS                   348
+    #define HUGE_PAGES                    349
 
     for( ;; )
     {
@@ -2597,6 +2655,15 @@ static int ParseOptions( int argc, char ** argv )
             { "describe",    no_argument,       NULL,    DESCRIBE },
             { "verbose",     optional_argument, NULL,    'v' },
             { "no-dvdnav",   no_argument,       NULL,    DVDNAV },
+            { "work-executor", no_argument,     NULL,    WORK_EXECUTOR },
+            { "scan-threads", required_argument, NULL,   SCAN_THREADS },
+            { "batch-scan-threads", required_argument, NULL, BATCH_SCAN_THREADS },
+            { "scan-cache",  no_argument,       NULL,    SCAN_CACHE },
+            { "read-ahead",  required_argument, NULL,    READ_AHEAD },
+            { "segment-encoders", required_argument, NULL, SEGMENT_ENCODERS },
+            { "job-concurrency", required_argument, NULL, JOB_CONCURRENCY },
+            { "job-threads", required_argument, NULL,    JOB_THREADS },
+            { "huge-pages",  required_argument, NULL,    HUGE_PAGES },
 
 #if HB_PROJECT_FEATURE_QSV
             { "qsv-async-depth",      required_argument, NULL,        QSV_ASYNC_DEPTH,    },
@@ -2883,6 +2950,49 @@ static int ParseOptions( int argc, char ** argv )
             case DVDNAV:
                 dvdnav = 0;
                 break;
+            case WORK_EXECUTOR:
+                work_executor = 1;
+                break;
+            case SCAN_THREADS:
+                scan_threads = atoi( optarg );
+                break;
+            case BATCH_SCAN_THREADS:
+                batch_scan_threads = atoi( optarg );
+                break;
+            case SCAN_CACHE:
+                scan_cache = 1;
+                break;
+            case READ_AHEAD:
+                read_ahead = atoi( optarg );
+                break;
+            case SEGMENT_ENCODERS:
+                segment_encoders = atoi( optarg );
+                break;
+            case JOB_CONCURRENCY:
+                job_concurrency = atoi( optarg );
+                break;
+            case JOB_THREADS:
+                job_threads = atoi( optarg );
+                break;
+            case HUGE_PAGES:
+                if (!strcasecmp(optarg, "none"))
+                {
+                    huge_pages = 0;
+                }
+                else if (!strcasecmp(optarg, "transparent"))
+                {
+                    huge_pages = 1;
+                }
+                else if (!strcasecmp(optarg, "explicit"))
+                {
+                    huge_pages = 2;
+                }
+                else
+                {
+                    fprintf(stderr, "Invalid huge pages mode (%s)\n", optarg);
+                    return -1;
+                }
+                break;
 
             case 'f':
                 format = strdup( optarg );
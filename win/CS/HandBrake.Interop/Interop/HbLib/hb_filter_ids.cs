@@ -54,6 +54,8 @@ namespace HandBrake.Interop.Interop.HbLib
 
         HB_FILTER_LAST,
         // wrapper filter for frame based multi-threading of simple filters
-        HB_FILTER_MT_FRAME
+        HB_FILTER_MT_FRAME,
+        // wrapper filter that runs consecutive simple filters on bands of lines
+        HB_FILTER_FUSED
     }
 }